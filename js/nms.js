@@ -7,6 +7,8 @@
 var nms = (function() {
 
   var sharers = {};
+  // ArrayBuffers of the trace being recorded, see startTrace().
+  var traceChunks = [];
 
   //////////////////////////////////////////////////////////////////////////
   // Async command list
@@ -299,6 +301,11 @@ var nms = (function() {
   }
 
   function handleMessage(message) {
+    if ('trace' in message.data) {
+      traceChunks.push(message.data.trace);
+      return;
+    }
+
     if ('log' in message.data) {
       console.log(message);
       common.logFunc(message.data.log);
@@ -365,12 +372,66 @@ var nms = (function() {
     });
   }
 
+  // Records the packet and frame events of the module into a binary trace,
+  // to be read with nacl/tools/trace_analyzer.
+  function startTrace() {
+    return new Promise(function(resolve, reject) {
+      function _resolved(data) {
+        traceChunks = [];
+        resolve();
+      }
+
+      function _rejected(data) {
+        reject("Already tracing");
+      }
+
+      _postMessage('startTrace', null, _resolved, _rejected);
+    });
+  }
+
+  // Resolves with a Blob of the trace, e.g. to be downloaded.
+  function stopTrace() {
+    return new Promise(function(resolve, reject) {
+      function _resolved(data) {
+        var trace = new Blob(traceChunks, {type: 'application/octet-stream'});
+        traceChunks = [];
+        resolve(trace);
+      }
+
+      function _rejected(data) {
+        reject("Not tracing");
+      }
+
+      _postMessage('stopTrace', null, _resolved, _rejected);
+    });
+  }
+
+  // Resolves with the current metrics of the module, as an object keyed by
+  // metric name, or as Prometheus text if |format| is 'prometheus'.
+  function getMetrics(format) {
+    return new Promise(function(resolve, reject) {
+      function _resolved(data) {
+        resolve(data);
+      }
+
+      function _rejected(data) {
+        reject();
+      }
+
+      _postMessage('getMetrics', {format: format || 'json'}, _resolved,
+                   _rejected);
+    });
+  }
+
   // The symbols to export
   return {
     loadModule: loadModule,
     createSharer: createSharer,
     startPlayer: startPlayer,
-    stopPlayer: stopPlayer
+    stopPlayer: stopPlayer,
+    startTrace: startTrace,
+    stopTrace: stopTrace,
+    getMetrics: getMetrics
   };
 
 }());
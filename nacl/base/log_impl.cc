@@ -4,8 +4,8 @@
 
 #include "base/log_impl.h"
 
-#include "ppapi/cpp/var.h"
-#include "ppapi/cpp/var_dictionary.h"
+#include <chrono>
+#include <limits>
 
 // Define LOGSTDOUTPUT to make log output go to stderr
 #define LOGSTDOUTPUT 1
@@ -16,21 +16,117 @@
 
 namespace base {
 
-LoggedStream::LoggedStream(pp::Instance* instance, int logLevel, int msgLevel)
-    : instance_(instance),
-      log_level_(logLevel),
-      msg_level_(msgLevel) {
-}
+// Nothing is logged until LogInit() sets the level.
+std::atomic<int> g_log_level(std::numeric_limits<int>::max());
+
+LoggedStream::LoggedStream(int msgLevel) : msg_level_(msgLevel) {}
 
 LoggedStream::~LoggedStream() {
+  LogSink::Get()->Write(msg_level_, stream_.str());
+}
+
+const size_t LogSink::kMaxQueuedMessages;
+
+// static
+LogSink* LogSink::Get() {
+  // Leaked on purpose: messages may be logged from other threads while
+  // static destructors run.
+  static LogSink* sink = new LogSink();
+  return sink;
+}
+
+LogSink::LogSink()
+    : dropped_(0), queued_(0), delivered_(0), thread_(&LogSink::Run, this) {}
+
+LogSink::~LogSink() {}
+
+void LogSink::SetOutput(const Output& output) {
+  std::unique_lock<std::mutex> lock(lock_);
+  const uint64_t queued = queued_;
+  delivered_changed_.wait(lock, [this, queued] { return delivered_ >= queued; });
+  output_ = output;
+}
+
+void LogSink::Write(int level, std::string message) {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (queue_.size() >= kMaxQueuedMessages) {
+      ++dropped_;
+      return;
+    }
+    queue_.push_back(std::make_pair(level, std::move(message)));
+    ++queued_;
+  }
+  wake_.notify_one();
+}
+
+void LogSink::Run() {
+  std::deque<std::pair<int, std::string>> messages;
+  for (;;) {
+    size_t dropped;
+    Output output;
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      wake_.wait(lock, [this] { return !queue_.empty() || dropped_; });
+      messages.swap(queue_);
+      dropped = dropped_;
+      dropped_ = 0;
+      output = output_;
+    }
+    const size_t batch = messages.size();
+
+    if (dropped) {
+      std::ostringstream stream;
+      stream << "Log queue full, dropped " << dropped << " messages.";
+      messages.push_back(std::make_pair(0, stream.str()));
+    }
+
+    for (const auto& message : messages) {
 #if defined(LOGSTDOUTPUT)
-  std::cerr << stream_.str() << std::endl;
+      std::cerr << message.second << std::endl;
 #endif
-  pp::VarDictionary dict;
-  dict.Set(pp::Var("log"), stream_.str());
-  dict.Set(pp::Var("level"), msg_level_);
-  if (instance_ && msg_level_ >= log_level_) instance_->PostMessage(dict);
-  stream_.str("");
+      if (output) output(message.first, message.second);
+    }
+    messages.clear();
+
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      delivered_ += batch;
+    }
+    delivered_changed_.notify_all();
+  }
+}
+
+namespace {
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+LogRateLimiter::LogRateLimiter()
+    : last_ms_(std::numeric_limits<int64_t>::min() / 2), dropped_(0) {}
+
+int LogRateLimiter::Take(int64_t interval_ms) {
+  const int64_t now = NowMs();
+  int64_t last = last_ms_.load(std::memory_order_relaxed);
+  // Another thread may log from the same site at the same time, only one of
+  // them wins.
+  if (now - last < interval_ms ||
+      !last_ms_.compare_exchange_strong(last, now,
+                                        std::memory_order_relaxed)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return -1;
+  }
+  return dropped_.exchange(0, std::memory_order_relaxed);
+}
+
+std::ostream& operator<<(std::ostream& os, LogDropped dropped) {
+  if (dropped.count > 0) os << "(" << dropped.count << " similar dropped) ";
+  return os;
 }
 
 }
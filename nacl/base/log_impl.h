@@ -5,33 +5,116 @@
 #ifndef BASE_LOG_IMPL_H_
 #define BASE_LOG_IMPL_H_
 
-#include "ppapi/cpp/instance.h"
+#include <stdint.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
 #include <sstream>
-#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
 
 namespace base {
 
-class LoggedStream {
+// Runtime log level, see LogInit().
+extern std::atomic<int> g_log_level;
+
+inline bool ShouldLog(int level) {
+  return level >= g_log_level.load(std::memory_order_relaxed);
+}
 
+// A single log message. It is handed to the LogSink once complete, at the
+// end of the statement that logs it.
+class LoggedStream {
  public:
-  explicit LoggedStream(pp::Instance* instance, int level, int curlevel);
-  LoggedStream(LoggedStream&& l) = default;
-  LoggedStream(const LoggedStream& l) = delete;
-  LoggedStream& operator=(LoggedStream&& l) = default;
-  LoggedStream& operator=(const LoggedStream& l) = delete;
+  explicit LoggedStream(int level);
   ~LoggedStream();
 
   std::ostringstream& s() { return stream_; }
 
  private:
-  pp::Instance* instance_; // non-owning pointer
   std::ostringstream stream_;
-
-  int log_level_;
   int msg_level_;
+
+  LoggedStream(const LoggedStream&) = delete;
+  LoggedStream& operator=(const LoggedStream&) = delete;
+};
+
+// Turns the stream expression of a log statement into void, so that it can
+// be the other branch of a conditional with (void)0.
+struct LogVoidify {
+  void operator&(std::ostream&) {}
+};
+
+// Writes log messages out on a background thread, so that the threads logging
+// don't wait for stderr or for the message to be posted to JavaScript.
+//
+// At most kMaxQueuedMessages wait at once. Beyond that, messages are dropped
+// and counted.
+class LogSink {
+ public:
+  using Output = std::function<void(int level, const std::string& message)>;
+
+  static const size_t kMaxQueuedMessages = 1024;
+
+  // The sink lives until the process exits.
+  static LogSink* Get();
+
+  // |output| is called on the sink thread with every message, besides the
+  // copy written to stderr. The messages written so far still go to the
+  // previous output, and it is not called anymore once this returns, so
+  // that what it refers to can go away. Not to be called from an output.
+  void SetOutput(const Output& output);
+  void Write(int level, std::string message);
+
+ private:
+  LogSink();
+  ~LogSink();
+  void Run();
+
+  std::mutex lock_;
+  std::condition_variable wake_;
+  std::deque<std::pair<int, std::string>> queue_;
+  size_t dropped_;
+  // Messages queued, and those of them given to the output so far.
+  uint64_t queued_;
+  uint64_t delivered_;
+  std::condition_variable delivered_changed_;
+  Output output_;
+  std::thread thread_;
+
+  LogSink(const LogSink&) = delete;
+  LogSink& operator=(const LogSink&) = delete;
+};
+
+// Per call site state of the rate limited log macros.
+class LogRateLimiter {
+ public:
+  LogRateLimiter();
+
+  // Returns -1 if this site logged less than |interval_ms| ago. Otherwise
+  // the message goes through, and this returns how many were dropped since
+  // the last one.
+  int Take(int64_t interval_ms);
+
+ private:
+  std::atomic<int64_t> last_ms_;
+  std::atomic<int> dropped_;
+
+  LogRateLimiter(const LogRateLimiter&) = delete;
+  LogRateLimiter& operator=(const LogRateLimiter&) = delete;
 };
 
+struct LogDropped {
+  int count;
+};
+
+std::ostream& operator<<(std::ostream& os, LogDropped dropped);
+
 }
 
 #endif // BASE_LOG_IMPL_H_
@@ -3,18 +3,22 @@
 // found in the LICENSE file.
 
 #include "base/logger.h"
-#include "ppapi/cpp/instance.h"
 
-static pp::Instance* instance_ = nullptr; // non-owning pointer
-static LogLevel log_level_ = LOGDISABLED;
+#include "ppapi/cpp/instance.h"
+#include "ppapi/cpp/var.h"
+#include "ppapi/cpp/var_dictionary.h"
 
 void LogInit(pp::Instance* instance, LogLevel level) {
-  instance_ = instance;
-  log_level_ = level;
+  base::g_log_level.store(level);
 
-  DINF() << "Initializing log system with level: " << level;
-}
+  auto post_message = [instance](int level, const std::string& message) {
+    pp::VarDictionary dict;
+    dict.Set(pp::Var("log"), message);
+    dict.Set(pp::Var("level"), level);
+    instance->PostMessage(dict);
+  };
+  base::LogSink::Get()->SetOutput(
+      instance ? base::LogSink::Output(post_message) : nullptr);
 
-base::LoggedStream LogPrint(LogLevel level) {
-  return base::LoggedStream(instance_, log_level_, level);
+  DINF() << "Initializing log system with level: " << level;
 }
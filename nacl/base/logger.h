@@ -5,11 +5,11 @@
 #ifndef BASE_LOGGER_H_
 #define BASE_LOGGER_H_
 
-#define DEBUG 1
-
 #include "base/log_impl.h"
 
-#include "ppapi/cpp/instance.h"
+namespace pp {
+class Instance;
+}
 
 enum LogLevel {
   LOGINFO = 0,
@@ -18,15 +18,50 @@ enum LogLevel {
   LOGDISABLED
 };
 
+// Messages below this level are compiled out, e.g. build with
+// -DLOG_MIN_LEVEL=1 to keep only warnings and errors.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+// DINF(), DWRN() and DERR() are compiled out of release builds.
+#if !defined(NDEBUG)
+#define DEBUG 1
+#endif
+
+// Messages below |level| are dropped before they are formatted. Messages are
+// written to stderr and posted to |instance| if not null.
 void LogInit(pp::Instance* instance, LogLevel level);
-base::LoggedStream LogPrint(LogLevel level);
 
-#define LOG(level) LogPrint(level).s() << __FILE__ << ":" << __LINE__ << " "
+#define LOG_IS_ON(level) \
+  ((level) >= LOG_MIN_LEVEL && base::ShouldLog(level))
+
+#define LOG_STREAM_(level) \
+  base::LoggedStream(level).s() << __FILE__ << ":" << __LINE__ << " "
+
+// Neither the stream nor the arguments are evaluated unless the message is
+// logged.
+#define LOG(level) \
+  !LOG_IS_ON(level) ? (void)0 : base::LogVoidify() & LOG_STREAM_(level)
+
+// Logs at most once every |ms| milliseconds from this call site, for per
+// packet paths. The message tells how many were dropped before it.
+#define LOG_EVERY_MS(level, ms)                                        \
+  for (int log_dropped_ = LOG_IS_ON(level)                             \
+                              ? []() -> base::LogRateLimiter& {        \
+                                  static base::LogRateLimiter limiter; \
+                                  return limiter;                      \
+                                }().Take(ms)                           \
+                              : -1;                                    \
+       log_dropped_ >= 0; log_dropped_ = -1)                           \
+  LOG_STREAM_(level) << base::LogDropped{log_dropped_}
 
 #ifdef DEBUG
 #define DLOG(level) LOG(level)
+#define DLOG_EVERY_MS(level, ms) LOG_EVERY_MS(level, ms)
 #else
-#define DLOG(level) while (false) LogPrint(level).s()
+#define DLOG(level) while (false) LOG_STREAM_(level)
+#define DLOG_EVERY_MS(level, ms) while (false) LOG_STREAM_(level)
 #endif
 
 #define INF() LOG(LOGINFO)
@@ -37,4 +72,12 @@ base::LoggedStream LogPrint(LogLevel level);
 #define DWRN() DLOG(LOGWARNING)
 #define DERR() DLOG(LOGERROR)
 
+#define INF_EVERY_MS(ms) LOG_EVERY_MS(LOGINFO, ms)
+#define WRN_EVERY_MS(ms) LOG_EVERY_MS(LOGWARNING, ms)
+#define ERR_EVERY_MS(ms) LOG_EVERY_MS(LOGERROR, ms)
+
+#define DINF_EVERY_MS(ms) DLOG_EVERY_MS(LOGINFO, ms)
+#define DWRN_EVERY_MS(ms) DLOG_EVERY_MS(LOGWARNING, ms)
+#define DERR_EVERY_MS(ms) DLOG_EVERY_MS(LOGERROR, ms)
+
 #endif // BASE_LOGGER_H_
@@ -0,0 +1,107 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_MPSC_RING_H_
+#define BASE_MPSC_RING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+#include "base/macros.h"
+
+namespace base {
+
+// Bounded lock-free ring with any number of producer threads and one
+// consumer thread, for small fixed-size values.
+//
+// Each slot carries a sequence number telling whether it is free for the
+// producer of a given position or holds the value for the consumer, so
+// producers only contend on the position counter and never wait for each
+// other. Push() never blocks nor allocates, and fails when the ring is full.
+// |capacity| is rounded up to a power of two.
+template <typename T>
+class MpscRing {
+ public:
+  explicit MpscRing(size_t capacity)
+      : size_(RoundUpToPowerOfTwo(capacity)),
+        mask_(size_ - 1),
+        slots_(new Slot[size_]),
+        push_pos_(0),
+        pop_pos_(0) {
+    for (size_t i = 0; i < size_; ++i)
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  ~MpscRing() {}
+
+  // Any thread. Returns false if the ring is full.
+  bool Push(const T& value) {
+    size_t pos = push_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots_[pos & mask_];
+      const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      const intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        // The slot is free for |pos|: claim the position.
+        if (push_pos_.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+          slot.value = value;
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        // The consumer hasn't taken the value from a lap ago yet.
+        return false;
+      } else {
+        // Another producer took |pos|.
+        pos = push_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Consumer thread only. Returns false if the ring is empty, or the next
+  // value is still being written.
+  bool Pop(T* value) {
+    Slot& slot = slots_[pop_pos_ & mask_];
+    if (slot.sequence.load(std::memory_order_acquire) != pop_pos_ + 1)
+      return false;
+    *value = slot.value;
+    // Free for the producer of the same slot on the next lap.
+    slot.sequence.store(pop_pos_ + size_, std::memory_order_release);
+    ++pop_pos_;
+    return true;
+  }
+
+  size_t capacity() const { return size_; }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  static size_t RoundUpToPowerOfTwo(size_t n) {
+    size_t result = 1;
+    while (result < n) result <<= 1;
+    return result;
+  }
+
+  const size_t size_;
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+
+  // Shared by the producers, apart from the consumer's position.
+  std::atomic<size_t> push_pos_;
+  char padding_[64];
+  size_t pop_pos_;
+
+  DISALLOW_COPY_AND_ASSIGN(MpscRing);
+};
+
+}  // namespace base
+
+#endif  // BASE_MPSC_RING_H_
@@ -0,0 +1,84 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_SPSC_QUEUE_H_
+#define BASE_SPSC_QUEUE_H_
+
+#include <stddef.h>
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "base/macros.h"
+
+namespace base {
+
+// Bounded lock-free queue with one producer thread and one consumer thread.
+//
+// Push() must only be called from the producer and Pop() from the consumer.
+// |capacity| is rounded up to a power of two.
+template <typename T>
+class SpscQueue {
+ public:
+  explicit SpscQueue(size_t capacity)
+      : slots_(RoundUpToPowerOfTwo(capacity)),
+        mask_(slots_.size() - 1),
+        head_(0),
+        tail_(0) {}
+  ~SpscQueue() {}
+
+  // Returns false, leaving |value| untouched, if the queue is full.
+  bool Push(T&& value) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == slots_.size())
+      return false;
+    slots_[tail & mask_] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool Push(const T& value) {
+    T copy(value);
+    return Push(std::move(copy));
+  }
+
+  // Returns false if the queue is empty.
+  bool Pop(T* value) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) return false;
+    *value = std::move(slots_[head & mask_]);
+    slots_[head & mask_] = T();
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Only exact when neither side is running.
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+ private:
+  static size_t RoundUpToPowerOfTwo(size_t n) {
+    size_t result = 1;
+    while (result < n) result <<= 1;
+    return result;
+  }
+
+  std::vector<T> slots_;
+  const size_t mask_;
+
+  // Only written by the consumer and the producer, respectively. Padded apart
+  // so the two threads don't keep stealing each other's cache line.
+  std::atomic<size_t> head_;
+  char padding_[64];
+  std::atomic<size_t> tail_;
+
+  DISALLOW_COPY_AND_ASSIGN(SpscQueue);
+};
+
+}  // namespace base
+
+#endif  // BASE_SPSC_QUEUE_H_
@@ -0,0 +1,138 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Compares the raw frame copy kernels of sender/frame_copy.h against plain
+// memcpy() on I420 frames of common capture sizes.
+
+#include "sender/frame_copy.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+namespace {
+
+struct Resolution {
+  const char* name;
+  int width;
+  int height;
+};
+
+const Resolution kResolutions[] = {
+    {"720p", 1280, 720}, {"1080p", 1920, 1080}, {"4K", 3840, 2160},
+};
+
+// Frames cycled through, so that frames don't stay in the cache between
+// iterations, as is the case for captured frames.
+const int kFrameSlots = 8;
+const int kRuns = 9;
+const double kMinRunSeconds = 0.2;
+
+double NowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+uint64_t NowCycles() {
+#if defined(HAVE_TSC)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+struct Result {
+  double seconds_per_frame;
+  double cycles_per_frame;
+};
+
+Result RunKernel(sharer::FrameCopyFunction copy, size_t frame_size,
+                 std::vector<std::vector<uint8_t>>* src,
+                 std::vector<std::vector<uint8_t>>* dst) {
+  // Calibrate the number of frames for one run.
+  int frames = 1;
+  for (;;) {
+    const double start = NowSeconds();
+    for (int i = 0; i < frames; ++i)
+      copy((*dst)[i % kFrameSlots].data(), (*src)[i % kFrameSlots].data(),
+           frame_size);
+    if (NowSeconds() - start >= kMinRunSeconds / 4) break;
+    frames *= 2;
+  }
+  frames *= 4;
+
+  std::vector<Result> runs;
+  for (int run = 0; run < kRuns; ++run) {
+    const double start = NowSeconds();
+    const uint64_t start_cycles = NowCycles();
+    for (int i = 0; i < frames; ++i)
+      copy((*dst)[i % kFrameSlots].data(), (*src)[i % kFrameSlots].data(),
+           frame_size);
+    const uint64_t cycles = NowCycles() - start_cycles;
+    const double seconds = NowSeconds() - start;
+    runs.push_back({seconds / frames, static_cast<double>(cycles) / frames});
+  }
+
+  // Median run.
+  std::sort(runs.begin(), runs.end(), [](const Result& a, const Result& b) {
+    return a.seconds_per_frame < b.seconds_per_frame;
+  });
+  return runs[kRuns / 2];
+}
+
+}  // namespace
+
+int main() {
+  std::vector<sharer::FrameCopyKernel> kernels =
+      sharer::SupportedFrameCopyKernels();
+  // What the encoder uses: the preferred kernel above the size threshold.
+  kernels.push_back({"CopyFrameData", &sharer::CopyFrameData});
+
+  printf("%-6s %-14s %10s %10s %12s %8s\n", "size", "kernel", "ms/frame",
+         "GB/s", "bytes/cycle", "vs memcpy");
+  for (const Resolution& resolution : kResolutions) {
+    const size_t chroma = static_cast<size_t>((resolution.width + 1) / 2) *
+                          ((resolution.height + 1) / 2);
+    const size_t frame_size =
+        static_cast<size_t>(resolution.width) * resolution.height + 2 * chroma;
+
+    std::vector<std::vector<uint8_t>> src(kFrameSlots);
+    std::vector<std::vector<uint8_t>> dst(kFrameSlots);
+    for (int i = 0; i < kFrameSlots; ++i) {
+      src[i].assign(frame_size, static_cast<uint8_t>(i));
+      dst[i].assign(frame_size, 0);
+    }
+
+    double memcpy_seconds = 0;
+    for (const sharer::FrameCopyKernel& kernel : kernels) {
+      const Result result = RunKernel(kernel.function, frame_size, &src, &dst);
+      if (!memcpy_seconds) memcpy_seconds = result.seconds_per_frame;
+
+      for (int i = 0; i < kFrameSlots; ++i) {
+        if (memcmp(src[i].data(), dst[i].data(), frame_size)) {
+          fprintf(stderr, "%s: copy mismatch\n", kernel.name);
+          return 1;
+        }
+      }
+
+      printf("%-6s %-14s %10.3f %10.2f %12.2f %7.2fx\n", resolution.name,
+             kernel.name, result.seconds_per_frame * 1e3,
+             frame_size / result.seconds_per_frame / 1e9,
+             result.cycles_per_frame ? frame_size / result.cycles_per_frame
+                                     : 0.0,
+             memcpy_seconds / result.seconds_per_frame);
+    }
+  }
+  return 0;
+}
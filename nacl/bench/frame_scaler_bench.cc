@@ -0,0 +1,99 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Times ScaleI420() on one core for the downscales the sender does, with the
+// SIMD kernels and with the C ones, and checks that both give the same image.
+
+#include "sender/frame_scaler.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+struct ScaleCase {
+  const char* name;
+  int src_width;
+  int src_height;
+  int dst_width;
+  int dst_height;
+  // Must stay within kBudgetMs.
+  bool budgeted;
+};
+
+const ScaleCase kCases[] = {
+    {"4K->1080p (2:1)", 3840, 2160, 1920, 1080, true},
+    {"4K->720p (3:1)", 3840, 2160, 1280, 720, false},
+    {"1080p->1440x808 (4:3)", 1920, 1080, 1440, 808, false},
+    {"1080p->720p (3:2)", 1920, 1080, 1280, 720, false},
+    {"1080p->540p (2:1)", 1920, 1080, 960, 540, false},
+};
+
+const int kRuns = 15;
+
+// Time per frame the sender can spend downscaling 4K capture to 1080p.
+const double kBudgetMs = 2.0;
+
+double NowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Median time of one ScaleI420() call, in ms. Leaves the result in |dst|.
+double TimeScale(const ScaleCase& scale_case, const std::vector<uint8_t>& src,
+                 std::vector<uint8_t>* dst) {
+  std::vector<double> runs;
+  for (int run = 0; run < kRuns; ++run) {
+    const double start = NowSeconds();
+    sharer::ScaleI420(src.data(), scale_case.src_width, scale_case.src_height,
+                      dst->data(), scale_case.dst_width, scale_case.dst_height);
+    runs.push_back((NowSeconds() - start) * 1e3);
+  }
+  std::sort(runs.begin(), runs.end());
+  return runs[kRuns / 2];
+}
+
+}  // namespace
+
+int main() {
+  const int num_cases = sizeof(kCases) / sizeof(kCases[0]);
+  std::vector<std::vector<uint8_t>> sources(num_cases);
+  std::vector<std::vector<uint8_t>> simd_results(num_cases);
+  std::vector<double> simd_ms(num_cases);
+
+  for (int i = 0; i < num_cases; ++i) {
+    const ScaleCase& c = kCases[i];
+    sources[i].resize(sharer::I420BufferSize(c.src_width, c.src_height));
+    // Something with detail in both directions.
+    for (size_t p = 0; p < sources[i].size(); ++p)
+      sources[i][p] = static_cast<uint8_t>((p * 7) ^ (p / c.src_width * 13));
+    simd_results[i].resize(sharer::I420BufferSize(c.dst_width, c.dst_height));
+    simd_ms[i] = TimeScale(c, sources[i], &simd_results[i]);
+  }
+
+  sharer::DisableScalerSimdForTesting();
+
+  int failures = 0;
+  printf("%-24s %10s %10s %8s %s\n", "scale", "simd ms", "c ms", "speedup",
+         "");
+  for (int i = 0; i < num_cases; ++i) {
+    const ScaleCase& c = kCases[i];
+    std::vector<uint8_t> c_result(simd_results[i].size());
+    const double c_ms = TimeScale(c, sources[i], &c_result);
+
+    const bool match = c_result == simd_results[i];
+    const bool in_budget = !c.budgeted || simd_ms[i] <= kBudgetMs;
+    if (!match) ++failures;
+    printf("%-24s %10.3f %10.3f %7.2fx %s%s\n", c.name, simd_ms[i], c_ms,
+           c_ms / simd_ms[i], match ? "" : "MISMATCH ",
+           in_budget ? "" : "over budget");
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,86 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// The per packet work of the receiver, with its per packet log site. Built
+// several times by the Makefile, once per logging configuration, each in its
+// own LOG_BENCH_NAMESPACE:
+//
+// - compiled_in: as built by default, logging off at runtime.
+// - compiled_out: built with -DLOG_MIN_LEVEL=3.
+// - formatted: every message formatted and thrown away, as the logger did
+//   before checking the level first, less writing it out.
+
+#include "base/logger.h"
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(LOG_BENCH_FORMAT_ALWAYS)
+#undef DINF
+#define DINF() std::ostringstream().flush() << __FILE__ << ":" << __LINE__ << " "
+#endif
+
+namespace LOG_BENCH_NAMESPACE {
+
+namespace {
+
+const size_t kRtpHeaderSize = 12;
+const size_t kSharerHeaderSize = 7;
+
+struct Packet {
+  bool key_frame;
+  uint32_t frame_id;
+  uint16_t packet_id;
+  uint16_t max_packet_id;
+  std::string payload;
+};
+
+uint16_t ReadU16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+
+// Header parsing and payload copy as RTP::parse() does, then the insertion
+// of the payload in the frame as the Framer does.
+std::unique_ptr<Packet> Parse(const std::vector<uint8_t>& data) {
+  if (data.size() < kRtpHeaderSize + kSharerHeaderSize) return nullptr;
+  const uint8_t* header = data.data() + kRtpHeaderSize;
+  std::unique_ptr<Packet> packet(new Packet());
+  packet->key_frame = header[0] & 0x80;
+  packet->frame_id = header[1];
+  packet->packet_id = ReadU16(header + 2);
+  packet->max_packet_id = ReadU16(header + 4);
+  packet->payload.assign(
+      reinterpret_cast<const char*>(header + kSharerHeaderSize),
+      data.size() - kRtpHeaderSize - kSharerHeaderSize);
+  return packet;
+}
+
+}  // namespace
+
+size_t ReceivePackets(const std::vector<std::vector<uint8_t>>& packets) {
+  std::map<uint16_t, std::string> frame;
+  size_t frames = 0;
+  for (const auto& data : packets) {
+    std::unique_ptr<Packet> packet = Parse(data);
+    if (!packet) continue;
+    const uint16_t packet_id = packet->packet_id;
+    const uint32_t frame_id = packet->frame_id;
+    // As in FrameReceiver::ProcessParsedPacket().
+    if (packet->key_frame)
+      DINF() << "Received key packet: " << frame_id << ":" << packet_id;
+    else
+      DINF() << "Received packet: " << frame_id << ":" << packet_id;
+
+    frame[packet_id].swap(packet->payload);
+    if (packet_id == packet->max_packet_id) {
+      frames += frame.size() == packet_id + 1u;
+      frame.clear();
+    }
+  }
+  return frames;
+}
+
+}  // namespace LOG_BENCH_NAMESPACE
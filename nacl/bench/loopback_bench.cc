@@ -0,0 +1,825 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Runs one sender and N receivers in one process, over the in-memory network
+// of host/, to find out how many receivers a sender can serve:
+//
+//   loopback_bench [--receivers=1,4,16] [--loss=0.01[,0.05...]]
+//                  [--bitrate_kbps=2000] [--fps=30] [--gop=60]
+//                  [--seconds=20] [--delay_ms=2] [--json]
+//                  [--layers=3 [--link_kbps=0,1000,300...]] [--joins=5]
+//
+// The sender is the real one from FrameSender down, fed with synthetic
+// frames at the given bitrate, with a key frame every |gop| frames or when a
+// receiver asks for one. Each receiver is a FrameReceiver, with its own
+// framer, NACKs and RTCP, dropping the given fraction of what it receives;
+// with several --loss values they go round the receivers.
+//
+// With --layers, the sender sends that many simulcast layers, each on its
+// own multicast group and with a quarter of the bitrate of the one before,
+// and each receiver is a NetworkHandler picking its layer with join
+// experiments. The receivers then sit behind links of the given rates, 0 for
+// no limit, going round the receivers like --loss, which they ignore. After
+// each session, prints the layer each receiver settled on.
+//
+// With --joins, that many more receivers join during the session, one every
+// other GOP and halfway through it, and the time from their join to their
+// first complete frame is printed. Their frames are not counted with those of
+// the other receivers, but their feedback and repairs are.
+//
+// Time is simulated, so a session runs as fast as the CPU allows. For each
+// number of receivers, prints the CPU time the sender takes per Mbit of
+// video and what each receiver takes, the feedback and retransmissions the
+// sender gets, and how long after capture frames are complete on the
+// receivers. Retransmissions, fast starts included, go to one receiver each,
+// and are also given per 100 packets multicast. With --json, prints one JSON
+// object per line instead.
+
+#include <arpa/inet.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base/logger.h"
+#include "base/ptr_utils.h"
+#include "base/time/tick_clock.h"
+#include "net/rtp/rtp.h"
+#include "net/rtp/rtp_receiver_defines.h"
+#include "net/transport_sender.h"
+#include "receiver/frame_receiver.h"
+#include "receiver/network_handler.h"
+#include "sender/congestion_control.h"
+#include "sender/frame_sender.h"
+#include "sharer_config.h"
+#include "sharer_defines.h"
+#include "sharer_environment.h"
+
+#include "ppapi/cpp/module.h"
+#include "ppapi/cpp/udp_socket.h"
+#include "ppapi/utility/completion_callback_factory.h"
+#include "ppapi_host.h"
+
+namespace {
+
+const char kGroupAddress[] = "239.255.1.1";
+const uint16_t kGroupPort = 5678;
+// Where UdpTransport listens for feedback.
+const uint16_t kSenderPort = 5679;
+
+// Key frames are this many times larger than the other frames.
+const int kKeyFrameSizeRatio = 5;
+
+// Queue of the constrained links, see ppapi_host::SetLinkRate().
+const double kLinkQueueSeconds = 0.1;
+
+// CPU accounts, see ppapi_host::ScopedCpuAccount.
+const int kSenderAccount = 1;
+const int kReceiverAccount = 2;
+
+struct Options {
+  Options()
+      : bitrate_kbps(2000),
+        fps(30),
+        gop(60),
+        seconds(20),
+        delay_ms(2),
+        layers(1),
+        joins(0),
+        json(false) {}
+
+  std::vector<int> receivers;
+  std::vector<double> loss;
+  std::vector<double> link_kbps;
+  int bitrate_kbps;
+  int fps;
+  int gop;
+  int seconds;
+  int delay_ms;
+  int layers;
+  int joins;
+  bool json;
+};
+
+// The time of pp::Core, simulated by ppapi_host.
+class PpapiTickClock : public base::TickClock {
+ public:
+  base::TimeTicks NowTicks() override {
+    return base::TimeTicks() + base::TimeDelta::FromSecondsD(
+                                   pp::Module::Get()->core()->GetTimeTicks());
+  }
+};
+
+// Bitrate of simulcast |layer|: each one has half the resolution of the one
+// before it, so about a quarter of the bits.
+int LayerBitrateKbps(const Options& options, int layer) {
+  return std::max(1, options.bitrate_kbps >> (2 * layer));
+}
+
+// Address of receiver |index|.
+std::string ReceiverAddress(int index) {
+  return "10.0." + std::to_string(index / 250) + "." +
+         std::to_string(index % 250 + 1);
+}
+
+// Sends frames of the size the bitrate allows instead of encoding captured
+// ones, see VideoSender.
+class SyntheticSender : public sharer::FrameSender {
+ public:
+  SyntheticSender(sharer::SharerEnvironment* env,
+                  sharer::TransportSender* transport_sender,
+                  const Options& options, int layer)
+      : FrameSender(env->clock(), false, transport_sender,
+                    sharer::kVideoFrequency, sharer::VideoSsrcForLayer(layer),
+                    options.fps, base::TimeDelta(),
+                    base::TimeDelta::FromMilliseconds(
+                        sharer::kDefaultRtpMaxDelayMs),
+                    base::TimeDelta(),
+                    sharer::NewFixedCongestionControl(
+                        LayerBitrateKbps(options, layer) * 1000)),
+        clock_(env->clock()),
+        gop_(options.gop),
+        next_frame_id_(0),
+        key_frame_requested_(true),
+        key_frame_requests_(0),
+        sent_bytes_(0) {
+    // Sizes that average to the bitrate over a GOP.
+    const size_t gop_bytes =
+        static_cast<size_t>(LayerBitrateKbps(options, layer)) * 1000 / 8 *
+        gop_ / options.fps;
+    frame_size_ = gop_bytes / (gop_ - 1 + kKeyFrameSizeRatio);
+    key_frame_size_ = frame_size_ * kKeyFrameSizeRatio;
+
+    auto sharer_feedback_cb = [this](const std::string& addr,
+                                     const RtcpSharerMessage& message) {
+      this->OnReceivedSharerFeedback(message);
+    };
+    auto rtt_cb = [this](base::TimeDelta rtt) {
+      this->OnMeasuredRoundTripTime(rtt);
+    };
+    SharerTransportRtpConfig transport_config;
+    transport_config.ssrc = sharer::VideoSsrcForLayer(layer);
+    transport_config.feedback_ssrc = sharer::VideoFeedbackSsrcForLayer(layer);
+    transport_config.rtp_payload_type = RTP::VIDEO;
+    transport_sender->InitializeVideo(transport_config, sharer_feedback_cb,
+                                      rtt_cb);
+  }
+
+  void SendNextFrame() {
+    const uint32_t frame_id = next_frame_id_++;
+    const bool key = key_frame_requested_ || frame_id % gop_ == 0;
+    key_frame_requested_ = false;
+
+    auto frame = std::make_shared<EncodedFrame>();
+    frame->dependency = key ? EncodedFrame::KEY : EncodedFrame::DEPENDENT;
+    frame->frame_id = frame_id;
+    frame->referenced_frame_id = key ? frame_id : frame_id - 1;
+    frame->temporal_layer_id = 0;
+    frame->reference_time = clock_->NowTicks();
+    frame->rtp_timestamp = static_cast<uint32_t>(sharer::TimeDeltaToRtpDelta(
+        frame->reference_time - base::TimeTicks(), sharer::kVideoFrequency));
+    frame->data.assign(key ? key_frame_size_ : frame_size_, 'x');
+
+    capture_times_.push_back(frame->reference_time);
+    sent_bytes_ += frame->data.size();
+    SendEncodedFrame(frame);
+  }
+
+  base::TimeTicks capture_time(uint32_t frame_id) const {
+    return capture_times_[frame_id];
+  }
+  uint32_t frames_sent() const { return next_frame_id_; }
+  int key_frame_requests() const { return key_frame_requests_; }
+  int64_t sent_bytes() const { return sent_bytes_; }
+
+ protected:
+  int GetNumberOfFramesInEncoder() const final { return 0; }
+  base::TimeDelta GetInFlightMediaDuration() const final {
+    return base::TimeDelta();
+  }
+  size_t GetPredictedBytesInEncoder() const final { return 0; }
+  size_t GetPredictedNextFrameBytes() const final { return frame_size_; }
+  void OnAck(uint32_t frame_id) final {}
+  void OnKeyFrameRequested() final {
+    key_frame_requested_ = true;
+    key_frame_requests_++;
+  }
+
+ private:
+  base::TickClock* const clock_;
+  const uint32_t gop_;
+  size_t frame_size_;
+  size_t key_frame_size_;
+
+  uint32_t next_frame_id_;
+  bool key_frame_requested_;
+  int key_frame_requests_;
+  int64_t sent_bytes_;
+  std::vector<base::TimeTicks> capture_times_;
+
+  DISALLOW_COPY_AND_ASSIGN(SyntheticSender);
+};
+
+// What the session reports about each receiver.
+class BenchReceiver {
+ public:
+  virtual ~BenchReceiver() {}
+
+  // Time from capture to complete of each frame, in ms.
+  virtual const std::vector<double>& latencies() const = 0;
+  // When the first frame was complete, null if none was.
+  virtual base::TimeTicks first_frame_time() const = 0;
+  virtual int64_t feedback_packets() const = 0;
+  virtual int64_t feedback_bytes() const = 0;
+};
+
+// A FrameReceiver on its own address, joined to the group of the sender.
+class LoopbackReceiver : public UDPSender, public BenchReceiver {
+ public:
+  LoopbackReceiver(pp::Instance* instance, base::TickClock* clock, int index,
+                   double loss, const SyntheticSender* sender,
+                   const Options& options)
+      : env_(instance),
+        sender_(sender),
+        loss_(loss),
+        random_(index + 1),
+        socket_(instance),
+        factory_(this),
+        feedback_packets_(0),
+        feedback_bytes_(0) {
+    env_.set_clock(clock);
+
+    ReceiverConfig config;
+    config.sender_ssrc = sharer::kVideoSsrc;
+    config.receiver_ssrc = sharer::kVideoFeedbackSsrc;
+    config.rtp_max_delay_ms = sharer::kDefaultRtpMaxDelayMs;
+    config.target_frame_rate = options.fps;
+    config.rtp_timebase = sharer::kVideoFrequency;
+    receiver_ = make_unique<FrameReceiver>(&env_, config, this);
+
+    const PP_NetAddress_IPv4 local = {
+        htons(kGroupPort),
+        {10, 0, static_cast<uint8_t>(index / 250),
+         static_cast<uint8_t>(index % 250 + 1)}};
+    const PP_NetAddress_IPv4 group = {htons(kGroupPort), {239, 255, 1, 1}};
+    const PP_NetAddress_IPv4 sender_addr = {htons(kSenderPort),
+                                            {127, 0, 0, 1}};
+    sender_addr_ = pp::NetAddress(instance, sender_addr);
+    socket_.Bind(pp::NetAddress(instance, local), pp::CompletionCallback());
+    socket_.JoinGroup(pp::NetAddress(instance, group),
+                      pp::CompletionCallback());
+    ReceiveNextPacket();
+    RequestFrame();
+  }
+
+  // Feedback for the sender.
+  void SendPacket(PacketRef packet) override {
+    feedback_packets_++;
+    feedback_bytes_ += packet->size();
+    socket_.SendTo(reinterpret_cast<const char*>(packet->data()),
+                   packet->size(), sender_addr_, pp::CompletionCallback());
+  }
+
+  const std::vector<double>& latencies() const override { return latencies_; }
+  base::TimeTicks first_frame_time() const override {
+    return first_frame_time_;
+  }
+  int64_t feedback_packets() const override { return feedback_packets_; }
+  int64_t feedback_bytes() const override { return feedback_bytes_; }
+
+ private:
+  void ReceiveNextPacket() {
+    socket_.RecvFrom(buffer_, sizeof(buffer_),
+                     factory_.NewCallbackWithOutput(
+                         &LoopbackReceiver::OnReceived));
+  }
+
+  void OnReceived(int32_t result, pp::NetAddress source) {
+    if (result > 0 && std::uniform_real_distribution<>()(random_) >= loss_) {
+      std::unique_ptr<RTPBase> packet =
+          rtpParse(env_.instance(),
+                   reinterpret_cast<const unsigned char*>(buffer_), result,
+                   nullptr);
+      if (packet) receiver_->ProcessPacket(std::move(packet));
+    }
+    ReceiveNextPacket();
+  }
+
+  void RequestFrame() {
+    receiver_->RequestEncodedFrame(
+        [this](std::shared_ptr<EncodedFrame> frame) { OnFrame(frame); });
+  }
+
+  void OnFrame(std::shared_ptr<EncodedFrame> frame) {
+    const base::TimeTicks now = env_.clock()->NowTicks();
+    if (first_frame_time_.is_null()) first_frame_time_ = now;
+    const base::TimeDelta latency =
+        now - sender_->capture_time(frame->frame_id);
+    latencies_.push_back(latency.InMillisecondsF());
+    RequestFrame();
+  }
+
+  sharer::SharerEnvironment env_;
+  const SyntheticSender* const sender_;
+  const double loss_;
+  std::mt19937 random_;
+
+  pp::UDPSocket socket_;
+  pp::NetAddress sender_addr_;
+  char buffer_[4096];
+  pp::CompletionCallbackFactory<LoopbackReceiver> factory_;
+
+  std::unique_ptr<FrameReceiver> receiver_;
+  std::vector<double> latencies_;
+  base::TimeTicks first_frame_time_;
+  int64_t feedback_packets_;
+  int64_t feedback_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoopbackReceiver);
+};
+
+// Counts the feedback arriving at the sender, by source host. Bound to the
+// host of the sender, it gets a copy of what the sender gets.
+class FeedbackTap {
+ public:
+  explicit FeedbackTap(pp::Instance* instance)
+      : socket_(instance), factory_(this) {
+    const PP_NetAddress_IPv4 sender_addr = {htons(kSenderPort),
+                                            {127, 0, 0, 1}};
+    socket_.Bind(pp::NetAddress(instance, sender_addr),
+                 pp::CompletionCallback());
+    ReceiveNextPacket();
+  }
+
+  int64_t packets(const std::string& host) const {
+    auto it = packets_.find(host);
+    return it == packets_.end() ? 0 : it->second;
+  }
+  int64_t bytes(const std::string& host) const {
+    auto it = bytes_.find(host);
+    return it == bytes_.end() ? 0 : it->second;
+  }
+
+ private:
+  void ReceiveNextPacket() {
+    socket_.RecvFrom(buffer_, sizeof(buffer_),
+                     factory_.NewCallbackWithOutput(&FeedbackTap::OnReceived));
+  }
+
+  void OnReceived(int32_t result, pp::NetAddress source) {
+    if (result > 0) {
+      const std::string host = source.DescribeAsString(false).AsString();
+      packets_[host]++;
+      bytes_[host] += result;
+    }
+    ReceiveNextPacket();
+  }
+
+  pp::UDPSocket socket_;
+  char buffer_[4096];
+  pp::CompletionCallbackFactory<FeedbackTap> factory_;
+  std::map<std::string, int64_t> packets_;
+  std::map<std::string, int64_t> bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(FeedbackTap);
+};
+
+// A NetworkHandler on its own host, picking its simulcast layer with join
+// experiments, behind a link of |link_kbps| unless 0.
+class LayeredReceiver : public BenchReceiver {
+ public:
+  LayeredReceiver(pp::Instance* instance, base::TickClock* clock, int index,
+                  double link_kbps, const SyntheticSender* sender,
+                  const FeedbackTap* tap, const Options& options)
+      : env_(instance),
+        sender_(sender),
+        tap_(tap),
+        address_(ReceiverAddress(index)),
+        link_kbps_(link_kbps),
+        layer_switches_(0) {
+    env_.set_clock(clock);
+    if (link_kbps > 0) {
+      ppapi_host::SetLinkRate(address_.c_str(), link_kbps * 1000 / 8,
+                              kLinkQueueSeconds);
+    }
+
+    // As MyInstance::StartNetwork() does.
+    ReceiverConfig audio_config;
+    audio_config.target_frame_rate = 100;
+    audio_config.rtp_timebase = 48000;
+    audio_config.receiver_ssrc = 2;
+    audio_config.sender_ssrc = 1;
+    ReceiverConfig video_config;
+    video_config.target_frame_rate = options.fps;
+    video_config.rtp_timebase = sharer::kVideoFrequency;
+    video_config.receiver_ssrc = sharer::kVideoFeedbackSsrc;
+    video_config.sender_ssrc = sharer::kVideoSsrc;
+
+    sharer::ReceiverNetConfig net_config;
+    net_config.address = kGroupAddress;
+    net_config.port = kGroupPort;
+    net_config.multicast_layers = options.layers;
+
+    ppapi_host::ScopedHost host(address_.c_str());
+    handler_ = make_unique<NetworkHandler>(&env_, audio_config, video_config,
+                                           net_config);
+    last_layer_ = handler_->video_layer();
+    RequestFrame();
+  }
+
+  ~LayeredReceiver() override {
+    if (link_kbps_ > 0) ppapi_host::SetLinkRate(address_.c_str(), 0, 0);
+  }
+
+  const std::vector<double>& latencies() const override { return latencies_; }
+  base::TimeTicks first_frame_time() const override {
+    return first_frame_time_;
+  }
+  int64_t feedback_packets() const override {
+    return tap_->packets(address_);
+  }
+  int64_t feedback_bytes() const override { return tap_->bytes(address_); }
+
+  const std::string& address() const { return address_; }
+  double link_kbps() const { return link_kbps_; }
+  int layer() const { return handler_->video_layer(); }
+  int layer_switches() const { return layer_switches_; }
+  // Layer of each frame of latencies().
+  const std::vector<int>& frame_layers() const { return frame_layers_; }
+
+ private:
+  void RequestFrame() {
+    handler_->GetNextFrame(
+        [this](std::shared_ptr<EncodedFrame> frame) { OnFrame(frame); });
+  }
+
+  void OnFrame(std::shared_ptr<EncodedFrame> frame) {
+    // All layers number their frames alike, see SyntheticSender.
+    const base::TimeTicks now = env_.clock()->NowTicks();
+    if (first_frame_time_.is_null()) first_frame_time_ = now;
+    const base::TimeDelta latency =
+        now - sender_->capture_time(frame->frame_id);
+    latencies_.push_back(latency.InMillisecondsF());
+
+    const int layer = handler_->video_layer();
+    if (layer != last_layer_) layer_switches_++;
+    last_layer_ = layer;
+    frame_layers_.push_back(layer);
+    RequestFrame();
+  }
+
+  sharer::SharerEnvironment env_;
+  const SyntheticSender* const sender_;
+  const FeedbackTap* const tap_;
+  const std::string address_;
+  const double link_kbps_;
+
+  std::unique_ptr<NetworkHandler> handler_;
+  std::vector<double> latencies_;
+  base::TimeTicks first_frame_time_;
+  int last_layer_;
+  int layer_switches_;
+  std::vector<int> frame_layers_;
+
+  DISALLOW_COPY_AND_ASSIGN(LayeredReceiver);
+};
+
+// Sum of the samples of a counter.
+double MetricTotal(const sharer::MetricsRegistry& registry,
+                   const std::string& name) {
+  sharer::MetricsSnapshot snapshot;
+  registry.Snapshot(sharer::MetricLabels(), &snapshot);
+  double total = 0;
+  auto it = snapshot.families.find(name);
+  if (it == snapshot.families.end()) return 0;
+  for (const auto& sample : it->second.samples) total += sample.value;
+  return total;
+}
+
+double Percentile(const std::vector<double>& sorted, double fraction) {
+  if (sorted.empty()) return 0;
+  return sorted[std::min(sorted.size() - 1,
+                         static_cast<size_t>(fraction * sorted.size()))];
+}
+
+void RunSession(int receivers, const Options& options) {
+  pp::Instance instance(1);
+  PpapiTickClock clock;
+
+  const double sender_cpu_start = ppapi_host::CpuSeconds(kSenderAccount);
+  const double receiver_cpu_start = ppapi_host::CpuSeconds(kReceiverAccount);
+
+  sharer::SenderConfig config;
+  config.initial_bitrate = options.bitrate_kbps;
+  config.frame_rate = options.fps;
+  config.remote_address = kGroupAddress;
+  config.remote_port = kGroupPort;
+  config.multicast = true;
+  if (options.layers > 1) {
+    config.simulcast_layers = options.layers;
+    config.layered_multicast = true;
+  }
+
+  sharer::SharerEnvironment sender_env(&instance);
+  sender_env.set_clock(&clock);
+  std::unique_ptr<sharer::TransportSender> transport;
+  // One per simulcast layer.
+  std::vector<std::unique_ptr<SyntheticSender>> senders;
+  {
+    ppapi_host::ScopedCpuAccount account(kSenderAccount);
+    transport = make_unique<sharer::TransportSender>(
+        &sender_env, config, nullptr, sharer::PacerGroup::BitrateShareCb(),
+        [](bool result) {
+          if (!result) {
+            fprintf(stderr, "Could not initialize the transport.\n");
+            exit(1);
+          }
+        });
+    for (int layer = 0; layer < options.layers; layer++) {
+      senders.push_back(make_unique<SyntheticSender>(
+          &sender_env, transport.get(), options, layer));
+    }
+  }
+  const SyntheticSender* const sender = senders[0].get();
+
+  std::unique_ptr<FeedbackTap> tap;
+  if (options.layers > 1) tap = make_unique<FeedbackTap>(&instance);
+
+  // Receiver |index|, of the kind the options ask for.
+  std::vector<const LayeredReceiver*> layered_receivers;
+  auto create_receiver = [&](int index) -> std::unique_ptr<BenchReceiver> {
+    ppapi_host::ScopedCpuAccount account(kReceiverAccount);
+    if (options.layers > 1) {
+      const double link_kbps =
+          options.link_kbps.empty()
+              ? 0
+              : options.link_kbps[index % options.link_kbps.size()];
+      auto receiver = make_unique<LayeredReceiver>(
+          &instance, &clock, index, link_kbps, sender, tap.get(), options);
+      layered_receivers.push_back(receiver.get());
+      return std::move(receiver);
+    }
+    const double loss =
+        options.loss.empty() ? 0 : options.loss[index % options.loss.size()];
+    return make_unique<LoopbackReceiver>(&instance, &clock, index, loss,
+                                         sender, options);
+  };
+
+  std::vector<std::unique_ptr<BenchReceiver>> loopback_receivers;
+  for (int i = 0; i < receivers; i++)
+    loopback_receivers.push_back(create_receiver(i));
+  const size_t session_receivers = layered_receivers.size();
+
+  // Late joiners, halfway through every other GOP from the second one on, so
+  // that they don't share a key frame someone asked for.
+  std::vector<std::unique_ptr<BenchReceiver>> joiners;
+  std::vector<base::TimeTicks> join_times;
+  const uint32_t frames = options.seconds * options.fps;
+  for (uint32_t i = 0; i < frames; i++) {
+    if (joiners.size() < static_cast<size_t>(options.joins) &&
+        i == options.gop * (1 + 2 * joiners.size()) + options.gop / 2) {
+      join_times.push_back(clock.NowTicks());
+      joiners.push_back(create_receiver(receivers + joiners.size()));
+    }
+    {
+      ppapi_host::ScopedCpuAccount account(kSenderAccount);
+      for (const auto& layer_sender : senders) layer_sender->SendNextFrame();
+    }
+    ppapi_host::RunFor(1.0 / options.fps);
+  }
+  // The joiners are left out of the layer report.
+  layered_receivers.resize(session_receivers);
+  // Lets the last frames and their repairs arrive.
+  ppapi_host::RunFor(1);
+
+  const double sender_cpu =
+      ppapi_host::CpuSeconds(kSenderAccount) - sender_cpu_start;
+  const double receiver_cpu =
+      ppapi_host::CpuSeconds(kReceiverAccount) - receiver_cpu_start;
+  int64_t sent_bytes = 0;
+  int key_frame_requests = 0;
+  for (const auto& layer_sender : senders) {
+    sent_bytes += layer_sender->sent_bytes();
+    key_frame_requests += layer_sender->key_frame_requests();
+  }
+  const double mbits = sent_bytes * 8 / 1e6;
+
+  std::vector<double> latencies;
+  int64_t feedback_packets = 0;
+  int64_t feedback_bytes = 0;
+  size_t min_frames = frames;
+  for (const auto& receiver : loopback_receivers) {
+    latencies.insert(latencies.end(), receiver->latencies().begin(),
+                     receiver->latencies().end());
+    feedback_packets += receiver->feedback_packets();
+    feedback_bytes += receiver->feedback_bytes();
+    min_frames = std::min(min_frames, receiver->latencies().size());
+  }
+  std::sort(latencies.begin(), latencies.end());
+
+  // Time from join to first complete frame of the joiners that got one.
+  std::vector<double> join_latencies;
+  for (size_t i = 0; i < joiners.size(); i++) {
+    const base::TimeTicks first_frame = joiners[i]->first_frame_time();
+    if (!first_frame.is_null())
+      join_latencies.push_back((first_frame - join_times[i]).InMillisecondsF());
+  }
+  std::sort(join_latencies.begin(), join_latencies.end());
+
+  const sharer::MetricsRegistry& metrics = *sender_env.metrics();
+  const double packets_sent =
+      MetricTotal(metrics, "sharer_pacer_packets_sent_total");
+  const double retransmitted =
+      MetricTotal(metrics, "sharer_pacer_packets_retransmitted_total");
+  const double nacks = MetricTotal(metrics, "sharer_pacer_nacks_received_total");
+  const double seconds = options.seconds;
+
+  const double sender_cpu_ms_per_mbit = sender_cpu * 1000 / mbits;
+  const double receiver_cpu_ms_per_s = receiver_cpu * 1000 / seconds / receivers;
+  const double feedback_per_s = feedback_packets / seconds;
+  const double feedback_kbps = feedback_bytes * 8 / seconds / 1000;
+  const double nacks_per_s = nacks / seconds;
+  const double rtx_per_s = retransmitted / seconds;
+  const double rtx_percent = packets_sent ? 100 * retransmitted / packets_sent : 0;
+  const double complete_percent = 100.0 * min_frames / frames;
+
+  // The layer each receiver settled on: the one it decoded most frames from
+  // in the last third of the session, and their share. The layer it ended on
+  // may be a join experiment about to fail.
+  std::string layers_json;
+  std::string layers_text;
+  for (const LayeredReceiver* receiver : layered_receivers) {
+    const std::vector<int>& frame_layers = receiver->frame_layers();
+    const size_t recent = std::min<size_t>(frames / 3, frame_layers.size());
+    int layer = receiver->layer();
+    size_t on_layer = 0;
+    for (int candidate = 0; candidate < options.layers; ++candidate) {
+      const size_t count = std::count(frame_layers.end() - recent,
+                                      frame_layers.end(), candidate);
+      if (count > on_layer) {
+        layer = candidate;
+        on_layer = count;
+      }
+    }
+    const double settled_percent = recent ? 100.0 * on_layer / recent : 0;
+
+    char line[256];
+    snprintf(line, sizeof(line),
+             "%s{\"address\": \"%s\", \"link_kbps\": %.0f, \"layer\": %d, "
+             "\"settled_percent\": %.1f, \"layer_switches\": %d}",
+             layers_json.empty() ? "" : ", ", receiver->address().c_str(),
+             receiver->link_kbps(), layer, settled_percent,
+             receiver->layer_switches());
+    layers_json += line;
+    snprintf(line, sizeof(line),
+             "%19s  link %6.0f kbps  layer %d (%5.1f%% of the last third)  "
+             "%d switches\n",
+             receiver->address().c_str(), receiver->link_kbps(), layer,
+             settled_percent, receiver->layer_switches());
+    layers_text += line;
+  }
+  if (!layered_receivers.empty())
+    layers_json = ", \"layers\": [" + layers_json + "]";
+
+  std::string joins_json;
+  std::string joins_text;
+  if (options.joins > 0) {
+    char line[256];
+    snprintf(line, sizeof(line),
+             ", \"joins\": {\"joined\": %zu, \"started\": %zu, "
+             "\"first_frame_ms\": {\"p50\": %.1f, \"max\": %.1f}}",
+             join_latencies.size(), joiners.size(),
+             Percentile(join_latencies, 0.5),
+             join_latencies.empty() ? 0 : join_latencies.back());
+    joins_json = line;
+    snprintf(line, sizeof(line),
+             "%19s  %zu of %zu joins got a frame, join to first frame ms  "
+             "p50 %.1f  max %.1f\n",
+             "joins", join_latencies.size(), joiners.size(),
+             Percentile(join_latencies, 0.5),
+             join_latencies.empty() ? 0 : join_latencies.back());
+    joins_text = line;
+  }
+
+  if (options.json) {
+    printf(
+        "{\"receivers\": %d, \"sender_cpu_ms_per_mbit\": %.3f, "
+        "\"receiver_cpu_ms_per_s\": %.3f, \"feedback_packets_per_s\": %.1f, "
+        "\"feedback_kbps\": %.1f, \"nacks_per_s\": %.1f, "
+        "\"retransmissions_per_s\": %.1f, \"retransmitted_percent\": %.2f, "
+        "\"key_frame_requests\": %d, \"min_frames_complete_percent\": %.1f, "
+        "\"latency_ms\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, "
+        "\"max\": %.1f}%s%s}\n",
+        receivers, sender_cpu_ms_per_mbit, receiver_cpu_ms_per_s,
+        feedback_per_s, feedback_kbps, nacks_per_s, rtx_per_s, rtx_percent,
+        key_frame_requests, complete_percent,
+        Percentile(latencies, 0.5), Percentile(latencies, 0.9),
+        Percentile(latencies, 0.99), latencies.empty() ? 0 : latencies.back(),
+        layers_json.c_str(), joins_json.c_str());
+  } else {
+    printf(
+        "%9d %10.3f %10.3f %9.1f %9.1f %8.1f %8.1f %6.2f %5d %7.1f "
+        "%6.1f %6.1f %6.1f %6.1f\n",
+        receivers, sender_cpu_ms_per_mbit, receiver_cpu_ms_per_s,
+        feedback_per_s, feedback_kbps, nacks_per_s, rtx_per_s, rtx_percent,
+        key_frame_requests, complete_percent,
+        Percentile(latencies, 0.5), Percentile(latencies, 0.9),
+        Percentile(latencies, 0.99), latencies.empty() ? 0 : latencies.back());
+    printf("%s%s", layers_text.c_str(), joins_text.c_str());
+  }
+  fflush(stdout);
+}
+
+bool ParseList(const char* value, std::vector<double>* list) {
+  list->clear();
+  while (*value) {
+    char* end;
+    list->push_back(strtod(value, &end));
+    if (end == value || (*end && *end != ',')) return false;
+    value = *end ? end + 1 : end;
+  }
+  return !list->empty();
+}
+
+bool ParseOptions(int argc, char* argv[], Options* options) {
+  std::vector<double> receivers = {1, 4, 16, 64};
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = strchr(arg, '=');
+    const std::string name(arg, value ? value - arg : strlen(arg));
+    if (value) value++;
+
+    if (name == "--json" && !value) {
+      options->json = true;
+    } else if (!value) {
+      return false;
+    } else if (name == "--receivers") {
+      if (!ParseList(value, &receivers)) return false;
+    } else if (name == "--loss") {
+      if (!ParseList(value, &options->loss)) return false;
+    } else if (name == "--bitrate_kbps") {
+      options->bitrate_kbps = atoi(value);
+    } else if (name == "--fps") {
+      options->fps = atoi(value);
+    } else if (name == "--gop") {
+      options->gop = atoi(value);
+    } else if (name == "--seconds") {
+      options->seconds = atoi(value);
+    } else if (name == "--delay_ms") {
+      options->delay_ms = atoi(value);
+    } else if (name == "--layers") {
+      options->layers = atoi(value);
+    } else if (name == "--link_kbps") {
+      if (!ParseList(value, &options->link_kbps)) return false;
+    } else if (name == "--joins") {
+      options->joins = atoi(value);
+    } else {
+      return false;
+    }
+  }
+
+  for (double count : receivers) {
+    if (count < 1) return false;
+    options->receivers.push_back(static_cast<int>(count));
+  }
+  return options->bitrate_kbps > 0 && options->fps > 0 && options->gop > 1 &&
+         options->seconds > 0 && options->delay_ms >= 0 &&
+         options->layers >= 1 &&
+         options->layers <= sharer::kMaxSimulcastLayers && options->joins >= 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    fprintf(stderr,
+            "Usage: %s [--receivers=1,4,16] [--loss=0.01[,0.05...]] "
+            "[--bitrate_kbps=2000] [--fps=30] [--gop=60] [--seconds=20] "
+            "[--delay_ms=2] [--json] [--layers=3 [--link_kbps=0,1000...]] "
+            "[--joins=5]\n",
+            argv[0]);
+    return 1;
+  }
+
+  LogInit(nullptr, LOGERROR);
+  ppapi_host::UseSimulatedTime();
+  ppapi_host::SetNetworkDelay(options.delay_ms / 1000.0);
+
+  if (!options.json) {
+    printf(
+        "receivers  sender cpu  recv cpu  feedback  feedback    nacks "
+        "     rtx   rtx%%  key  frames   ---- latency ms ----\n"
+        "           ms/Mbit     ms/s      pkt/s     kbps        /s    "
+        "     /s          reqs   ok%%      p50    p90    p99    max\n");
+  }
+  for (int receivers : options.receivers) RunSession(receivers, options);
+  return 0;
+}
@@ -0,0 +1,108 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "bench/op_counters.h"
+
+#include <dlfcn.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+namespace {
+
+std::atomic<bool> g_enabled(false);
+std::atomic<uint64_t> g_allocations(0);
+std::atomic<uint64_t> g_allocated_bytes(0);
+std::atomic<uint64_t> g_copied_bytes(0);
+
+void* Allocate(size_t size) {
+  if (g_enabled.load(std::memory_order_relaxed)) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+  return malloc(size ? size : 1);
+}
+
+void CountCopy(size_t size) {
+  if (g_enabled.load(std::memory_order_relaxed))
+    g_copied_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+using CopyFunction = void* (*)(void*, const void*, size_t);
+
+// Until libc's functions are found, e.g. while dlsym() itself copies.
+void* ByteCopy(void* dst, const void* src, size_t size) {
+  volatile unsigned char* d = static_cast<unsigned char*>(dst);
+  const volatile unsigned char* s = static_cast<const unsigned char*>(src);
+  if (d < s) {
+    for (size_t i = 0; i < size; i++) d[i] = s[i];
+  } else {
+    for (size_t i = size; i > 0; i--) d[i - 1] = s[i - 1];
+  }
+  return dst;
+}
+
+CopyFunction LibcFunction(const char* name, std::atomic<CopyFunction>* slot) {
+  static thread_local bool resolving = false;
+  CopyFunction function = slot->load(std::memory_order_relaxed);
+  if (!function && !resolving) {
+    resolving = true;
+    function = reinterpret_cast<CopyFunction>(dlsym(RTLD_NEXT, name));
+    slot->store(function, std::memory_order_relaxed);
+    resolving = false;
+  }
+  return function ? function : &ByteCopy;
+}
+
+std::atomic<CopyFunction> g_memcpy(nullptr);
+std::atomic<CopyFunction> g_memmove(nullptr);
+
+}  // namespace
+
+namespace bench {
+
+void EnableOpCounters(bool enable) { g_enabled.store(enable); }
+
+OpCounts GetOpCounts() {
+  return {g_allocations.load(), g_allocated_bytes.load(),
+          g_copied_bytes.load()};
+}
+
+}  // namespace bench
+
+extern "C" void* memcpy(void* dst, const void* src, size_t size) throw() {
+  CountCopy(size);
+  return LibcFunction("memcpy", &g_memcpy)(dst, src, size);
+}
+
+extern "C" void* memmove(void* dst, const void* src, size_t size) throw() {
+  CountCopy(size);
+  return LibcFunction("memmove", &g_memmove)(dst, src, size);
+}
+
+void* operator new(size_t size) {
+  void* p = Allocate(size);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+
+void operator delete[](void* p) noexcept { free(p); }
+
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
@@ -0,0 +1,30 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BENCH_OP_COUNTERS_H_
+#define BENCH_OP_COUNTERS_H_
+
+#include <stdint.h>
+
+// Counts the heap allocations and the bytes copied by the whole program while
+// enabled. Linking op_counters.cc replaces operator new and interposes
+// memcpy() and memmove(), libstdc++'s calls included. Copies the compiler
+// inlines, i.e. of a few bytes, and element by element copies, e.g. inserting
+// a std::string into a std::vector<uint8_t>, aren't seen.
+namespace bench {
+
+struct OpCounts {
+  uint64_t allocations;
+  uint64_t allocated_bytes;
+  uint64_t copied_bytes;
+};
+
+void EnableOpCounters(bool enable);
+
+// Totals while enabled, since the start of the program.
+OpCounts GetOpCounts();
+
+}  // namespace bench
+
+#endif  // BENCH_OP_COUNTERS_H_
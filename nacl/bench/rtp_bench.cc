@@ -0,0 +1,743 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the per packet and per frame work of the RTP and RTCP code, as
+// built for the module, against the host ppapi of host/.
+//
+//   rtp_bench [--json] [filter]
+//
+// Runs the benchmarks whose name contains |filter|, and prints for each the
+// time, heap allocations, bytes allocated and bytes copied per operation.
+// With --json, prints one JSON object per benchmark and line instead, for
+// comparing runs.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base/big_endian.h"
+#include "base/ptr_utils.h"
+#include "bench/op_counters.h"
+#include "net/pacing/paced_sender.h"
+#include "net/rtcp/rtcp_builder.h"
+#include "net/rtcp/rtcp_utility.h"
+#include "net/rtp/frame_buffer.h"
+#include "net/rtp/framer.h"
+#include "net/rtp/packet_storage.h"
+#include "net/rtp/rtp.h"
+#include "net/rtp/rtp_defines.h"
+#include "net/rtp/rtp_packetizer.h"
+#include "net/udp_transport.h"
+#include "sharer_defines.h"
+#include "sharer_environment.h"
+
+#include "ppapi_host.h"
+
+namespace {
+
+const int kRuns = 5;
+const double kMinRunSeconds = 0.1;
+// Frames kept for resends by the sender benchmarks, as if the older ones had
+// been acked.
+const uint32_t kStoredFrames = 30;
+// Offsets of the Sharer header fields in a video packet, see RtpPacketizer.
+const size_t kFlagsOffset = sharer::kRtpHeaderLength;
+const size_t kFrameIdOffset = 13;
+const size_t kReferenceFrameIdOffset = 21;
+
+double NowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+std::string SizeName(size_t size) {
+  return size >= 1000000 ? std::to_string(size / 1000000) + "MB"
+                         : size >= 1000 ? std::to_string(size / 1000) + "KB"
+                                        : std::to_string(size) + "B";
+}
+
+// Measures the operations run between the start of a run and its end, less
+// the work between PauseTiming() and ResumeTiming(), e.g. to prepare the
+// inputs of the next operation.
+class BenchState {
+ public:
+  explicit BenchState(int64_t ops)
+      : ops_(ops), seconds_(0), start_(0), counts_(), start_counts_() {}
+
+  int64_t ops() const { return ops_; }
+  double seconds() const { return seconds_; }
+  const bench::OpCounts& counts() const { return counts_; }
+
+  void ResumeTiming() {
+    start_counts_ = bench::GetOpCounts();
+    bench::EnableOpCounters(true);
+    start_ = NowSeconds();
+  }
+
+  void PauseTiming() {
+    seconds_ += NowSeconds() - start_;
+    bench::EnableOpCounters(false);
+    const bench::OpCounts end = bench::GetOpCounts();
+    counts_.allocations += end.allocations - start_counts_.allocations;
+    counts_.allocated_bytes +=
+        end.allocated_bytes - start_counts_.allocated_bytes;
+    counts_.copied_bytes += end.copied_bytes - start_counts_.copied_bytes;
+  }
+
+ private:
+  const int64_t ops_;
+  double seconds_;
+  double start_;
+  bench::OpCounts counts_;
+  bench::OpCounts start_counts_;
+};
+
+// Created once, then run several times with the number of operations to do.
+class Benchmark {
+ public:
+  virtual ~Benchmark() {}
+  virtual void Run(BenchState* state) = 0;
+};
+
+using BenchmarkFactory = std::function<std::unique_ptr<Benchmark>()>;
+
+struct BenchmarkInfo {
+  std::string name;
+  BenchmarkFactory factory;
+};
+
+// Steps only when told to, so that the NACK timers of the receiver fire on
+// every operation.
+class ManualTickClock : public base::TickClock {
+ public:
+  ManualTickClock() : now_(base::TimeTicks::Now()) {}
+
+  base::TimeTicks NowTicks() override { return now_; }
+  void Advance(base::TimeDelta delta) { now_ += delta; }
+
+ private:
+  base::TimeTicks now_;
+};
+
+class FeedbackCounter : public RtpPayloadFeedback {
+ public:
+  FeedbackCounter() : messages_(0), nacks_(0) {}
+
+  void SharerFeedback(const RtcpSharerMessage& message) override {
+    messages_++;
+    for (const auto& frame : message.missing_frames_and_packets)
+      nacks_ += frame.second.size();
+  }
+
+  int64_t messages() const { return messages_; }
+  int64_t nacks() const { return nacks_; }
+
+ private:
+  int64_t messages_;
+  int64_t nacks_;
+};
+
+// The sender from the packetizer down, sending to nowhere through the host
+// UDPSocket.
+class SenderStack {
+ public:
+  SenderStack()
+      : instance_(1),
+        env_(&instance_),
+        transport_(&env_, "239.255.0.1", 5678, 1, 0, [](bool result) {}),
+        pacer_(&env_, &transport_),
+        packetizer_(&pacer_, &storage_, PacketizerConfig(), &env_),
+        next_frame_id_(0) {
+    pacer_.RegisterVideoSsrc(sharer::kVideoSsrc);
+    // Resolves the address.
+    ppapi_host::RunUntilIdle();
+  }
+
+  sharer::PacedSender* pacer() { return &pacer_; }
+
+  // A frame of |size| bytes following the previous one, with a key frame
+  // every |gop| frames.
+  EncodedFrame* NextFrame(size_t size, uint32_t gop) {
+    const uint32_t frame_id = next_frame_id_++;
+    const bool key = frame_id % gop == 0;
+    frame_.dependency =
+        key ? EncodedFrame::KEY : EncodedFrame::DEPENDENT;
+    frame_.frame_id = frame_id;
+    frame_.referenced_frame_id = key ? frame_id : frame_id - 1;
+    frame_.rtp_timestamp = frame_id * (sharer::kVideoFrequency / 30);
+    frame_.reference_time = env_.clock()->NowTicks();
+    if (frame_.data.size() != size) {
+      frame_.data.resize(size);
+      for (size_t i = 0; i < size; i++) frame_.data[i] = static_cast<char>(i);
+    }
+    return &frame_;
+  }
+
+  void SendFrame(const EncodedFrame& frame) {
+    packetizer_.SendFrameAsPackets(frame);
+  }
+
+  // Lets the pacer send everything, and forgets the oldest frame.
+  void Flush(uint32_t frame_id) {
+    ppapi_host::RunUntilIdle();
+    if (frame_id >= kStoredFrames)
+      storage_.ReleaseFrame(frame_id - kStoredFrames);
+  }
+
+  // The packets of a frame of |size| bytes.
+  std::vector<Packet> PacketizeFrame(size_t size, bool key) {
+    EncodedFrame* frame = NextFrame(size, key ? 1 : 0xffffffff);
+    SendFrame(*frame);
+    std::vector<Packet> packets;
+    for (const auto& packet : *storage_.GetFrame32(frame->frame_id))
+      packets.push_back(*packet.second);
+    Flush(frame->frame_id);
+    return packets;
+  }
+
+ private:
+  static sharer::RtpPacketizerConfig PacketizerConfig() {
+    sharer::RtpPacketizerConfig config;
+    config.payload_type = RTP::VIDEO;
+    config.ssrc = sharer::kVideoSsrc;
+    return config;
+  }
+
+  pp::Instance instance_;
+  sharer::SharerEnvironment env_;
+  sharer::UdpTransport transport_;
+  sharer::PacedSender pacer_;
+  sharer::PacketStorage storage_;
+  sharer::RtpPacketizer packetizer_;
+
+  uint32_t next_frame_id_;
+  EncodedFrame frame_;
+};
+
+std::unique_ptr<RTP> ParseRtp(const Packet& packet) {
+  std::unique_ptr<RTPBase> parsed =
+      rtpParse(nullptr, packet.data(), packet.size(), nullptr);
+  if (!parsed || !parsed->isRTP()) return nullptr;
+  return std::unique_ptr<RTP>(static_cast<RTP*>(parsed.release()));
+}
+
+// Rewrites the frame ids of a packet of PacketizeFrame(), making it a key
+// frame packet if the frame references itself.
+void SetFrameIds(uint32_t frame_id, uint32_t reference_frame_id,
+                 Packet* packet) {
+  if (frame_id == reference_frame_id)
+    (*packet)[kFlagsOffset] |= sharer::kSharerKeyFrameBitMask;
+  else
+    (*packet)[kFlagsOffset] &= ~sharer::kSharerKeyFrameBitMask;
+  BigEndianWriter(reinterpret_cast<char*>(&(*packet)[kFrameIdOffset]), 4)
+      .WriteU32(frame_id);
+  BigEndianWriter(reinterpret_cast<char*>(&(*packet)[kReferenceFrameIdOffset]),
+                  4)
+      .WriteU32(reference_frame_id);
+}
+
+// RtpPacketizer::SendFrameAsPackets(), which stores the packets and queues
+// them in the pacer.
+class PacketizeBenchmark : public Benchmark {
+ public:
+  explicit PacketizeBenchmark(size_t frame_size) : frame_size_(frame_size) {}
+
+  void Run(BenchState* state) override {
+    for (int64_t i = 0; i < state->ops(); i++) {
+      state->PauseTiming();
+      const EncodedFrame* frame = stack_.NextFrame(frame_size_, 30);
+      state->ResumeTiming();
+      stack_.SendFrame(*frame);
+      state->PauseTiming();
+      stack_.Flush(frame->frame_id);
+      state->ResumeTiming();
+    }
+  }
+
+ private:
+  const size_t frame_size_;
+  SenderStack stack_;
+};
+
+// PacedSender::SendPackets() of a frame, then everything the pacer does
+// until the packets are sent, one burst after the other.
+class PacerBenchmark : public Benchmark {
+ public:
+  explicit PacerBenchmark(size_t frame_size) {
+    const std::vector<Packet> packets =
+        stack_.PacketizeFrame(frame_size, false);
+    for (size_t i = 0; i < packets.size(); i++)
+      packets_.push_back(std::make_shared<Packet>(packets[i]));
+  }
+
+  void Run(BenchState* state) override {
+    for (int64_t i = 0; i < state->ops(); i++) {
+      state->PauseTiming();
+      // Keys as for a new frame.
+      const base::TimeTicks now = base::TimeTicks::Now();
+      sharer::SendPacketVector packets;
+      for (size_t j = 0; j < packets_.size(); j++) {
+        packets.push_back(std::make_pair(
+            sharer::PacedSender::MakePacketKey(now, sharer::kVideoSsrc, j),
+            packets_[j]));
+      }
+      state->ResumeTiming();
+      stack_.pacer()->SendPackets(packets, false);
+      ppapi_host::RunUntilIdle();
+    }
+  }
+
+ private:
+  SenderStack stack_;
+  std::vector<PacketRef> packets_;
+};
+
+// rtpParse() of packets of a frame of |frame_size| bytes, each one being
+// copied into the RTP object.
+class RtpParseBenchmark : public Benchmark {
+ public:
+  explicit RtpParseBenchmark(size_t frame_size)
+      : packets_(SenderStack().PacketizeFrame(frame_size, false)) {}
+
+  void Run(BenchState* state) override {
+    uint32_t ssrc = 0;
+    for (int64_t i = 0; i < state->ops(); i++) {
+      const Packet& packet = packets_[i % packets_.size()];
+      std::unique_ptr<RTPBase> parsed =
+          rtpParse(nullptr, packet.data(), packet.size(), &ssrc);
+      if (!parsed) abort();
+    }
+  }
+
+ private:
+  const std::vector<Packet> packets_;
+};
+
+// FrameBuffer::InsertPacket() of every packet of a frame, then
+// AssembleEncodedFrame().
+class FrameBufferBenchmark : public Benchmark {
+ public:
+  explicit FrameBufferBenchmark(size_t frame_size)
+      : frame_size_(frame_size),
+        packets_(SenderStack().PacketizeFrame(frame_size, true)) {}
+
+  void Run(BenchState* state) override {
+    for (int64_t i = 0; i < state->ops(); i++) {
+      state->PauseTiming();
+      std::vector<std::unique_ptr<RTP>> parsed;
+      for (const auto& packet : packets_) parsed.push_back(ParseRtp(packet));
+      state->ResumeTiming();
+
+      FrameBuffer buffer;
+      for (auto& packet : parsed) buffer.InsertPacket(std::move(packet));
+      EncodedFrame frame;
+      if (!buffer.Complete() || !buffer.AssembleEncodedFrame(&frame) ||
+          frame.data.size() != frame_size_) {
+        abort();
+      }
+    }
+  }
+
+ private:
+  const size_t frame_size_;
+  const std::vector<Packet> packets_;
+};
+
+// Framer::InsertPacket() of every packet of a frame, in order or shuffled,
+// then getting the frame out as FrameReceiver does.
+class FramerBenchmark : public Benchmark {
+ public:
+  FramerBenchmark(size_t frame_size, bool reordered)
+      : instance_(1),
+        env_(&instance_),
+        framer_(&env_, &feedback_, sharer::kVideoSsrc, true,
+                sharer::kMaxUnackedFrames),
+        packets_(SenderStack().PacketizeFrame(frame_size, true)),
+        next_frame_id_(0) {
+    for (size_t i = 0; i < packets_.size(); i++) order_.push_back(i);
+    if (reordered) {
+      std::mt19937 random(1);
+      std::shuffle(order_.begin(), order_.end(), random);
+    }
+  }
+
+  void Run(BenchState* state) override {
+    for (int64_t i = 0; i < state->ops(); i++) {
+      state->PauseTiming();
+      // The first frame is a key frame, the next ones reference the previous
+      // frame.
+      const uint32_t frame_id = next_frame_id_++;
+      std::vector<std::unique_ptr<RTP>> parsed;
+      for (size_t index : order_) {
+        Packet packet = packets_[index];
+        SetFrameIds(frame_id, frame_id ? frame_id - 1 : 0, &packet);
+        parsed.push_back(ParseRtp(packet));
+      }
+      state->ResumeTiming();
+
+      bool duplicate;
+      for (auto& packet : parsed) framer_.InsertPacket(std::move(packet), &duplicate);
+      EncodedFrame frame;
+      bool next_frame;
+      bool multiple;
+      if (!framer_.GetEncodedFrame(&frame, &next_frame, &multiple) ||
+          frame.frame_id != frame_id) {
+        abort();
+      }
+      framer_.AckFrame(frame_id);
+      framer_.ReleaseFrame(frame_id);
+    }
+  }
+
+ private:
+  pp::Instance instance_;
+  sharer::SharerEnvironment env_;
+  FeedbackCounter feedback_;
+  Framer framer_;
+  const std::vector<Packet> packets_;
+  std::vector<size_t> order_;
+  uint32_t next_frame_id_;
+};
+
+// The NACK list the receiver builds on each feedback, see
+// SharerMessageBuilder::BuildPacketList(), with the framer holding
+// |missing_frames| lost frames and then |partial_frames| frames missing every
+// other packet.
+class NackBenchmark : public Benchmark {
+ public:
+  NackBenchmark(uint32_t missing_frames, uint32_t partial_frames)
+      : instance_(1), env_(&instance_) {
+    env_.set_clock(&clock_);
+    framer_ = make_unique<Framer>(&env_, &feedback_, sharer::kVideoSsrc, true,
+                                  sharer::kMaxUnackedFrames);
+
+    const std::vector<Packet> packets =
+        SenderStack().PacketizeFrame(100000, true);
+    bool duplicate;
+    for (Packet packet : packets) {
+      SetFrameIds(0, 0, &packet);
+      framer_->InsertPacket(ParseRtp(packet), &duplicate);
+    }
+    framer_->AckFrame(0);
+    framer_->ReleaseFrame(0);
+
+    const uint32_t first = 1 + missing_frames;
+    for (uint32_t frame_id = first; frame_id < first + partial_frames;
+         frame_id++) {
+      for (size_t i = 0; i < packets.size(); i += 2) {
+        Packet packet = packets[i];
+        SetFrameIds(frame_id, frame_id - 1, &packet);
+        framer_->InsertPacket(ParseRtp(packet), &duplicate);
+      }
+    }
+
+    // The newest frame is only NACKed up to its last received packet, so
+    // take the first list as the reference for the next ones.
+    expected_nacks_ = SendSharerMessage();
+    if (expected_nacks_ < missing_frames + partial_frames) abort();
+  }
+
+  void Run(BenchState* state) override {
+    for (int64_t i = 0; i < state->ops(); i++) {
+      if (SendSharerMessage() != expected_nacks_) abort();
+    }
+  }
+
+ private:
+  pp::Instance instance_;
+  ManualTickClock clock_;
+  sharer::SharerEnvironment env_;
+  FeedbackCounter feedback_;
+  std::unique_ptr<Framer> framer_;
+  // Returns the number of packets NACKed.
+  int64_t SendSharerMessage() {
+    // Past the NACK repeat interval.
+    clock_.Advance(base::TimeDelta::FromMilliseconds(40));
+    const int64_t nacks = feedback_.nacks();
+    framer_->SendSharerMessage();
+    return feedback_.nacks() - nacks;
+  }
+
+  int64_t expected_nacks_;
+};
+
+// RtcpBuilder::BuildRtcpFromSender() parsed by the receiver.
+class SenderReportBenchmark : public Benchmark {
+ public:
+  SenderReportBenchmark()
+      : builder_(sharer::kVideoSsrc),
+        parser_ssrc_(sharer::kVideoFeedbackSsrc) {
+    info_.ntp_seconds = 1000;
+    info_.ntp_fraction = 2000;
+    info_.rtp_timestamp = 3000;
+    info_.send_packet_count = 4000;
+    info_.send_octet_count = 5000;
+  }
+
+  void Run(BenchState* state) override {
+    for (int64_t i = 0; i < state->ops(); i++) {
+      info_.rtp_timestamp += 3000;
+      PacketRef packet = builder_.BuildRtcpFromSender(info_);
+      sharer::RtcpParser parser(parser_ssrc_, sharer::kVideoSsrc);
+      BigEndianReader reader(reinterpret_cast<const char*>(packet->data()),
+                             packet->size());
+      if (!parser.Parse(&reader) || !parser.has_sender_report() ||
+          parser.sender_report().rtp_timestamp != info_.rtp_timestamp) {
+        abort();
+      }
+    }
+  }
+
+ private:
+  RtcpBuilder builder_;
+  const uint32_t parser_ssrc_;
+  RtcpSenderInfo info_;
+};
+
+// RtcpBuilder::BuildRtcpFromReceiver() with a report and feedback NACKing
+// |nacks_per_frame| packets of each of |frames| frames, parsed by the sender.
+class ReceiverFeedbackBenchmark : public Benchmark {
+ public:
+  ReceiverFeedbackBenchmark(int frames, int nacks_per_frame)
+      : message_(sharer::kVideoSsrc), expected_nacks_(frames * nacks_per_frame) {
+    message_.ack_frame_id = 100;
+    for (int frame = 0; frame < frames; frame++) {
+      PacketIdSet& packets = message_.missing_frames_and_packets[101 + frame];
+      for (int packet = 0; packet < nacks_per_frame; packet++)
+        packets.insert(packet * 3);
+    }
+    report_block_.remote_ssrc = sharer::kVideoFeedbackSsrc;
+    report_block_.media_ssrc = sharer::kVideoSsrc;
+    report_block_.fraction_lost = 12;
+    report_block_.cumulative_lost = 345;
+    report_block_.extended_high_sequence_number = 6789;
+    report_block_.jitter = 10;
+    report_block_.last_sr = 1234;
+    report_block_.delay_since_last_sr = 5678;
+    rrtr_.remote_ssrc = sharer::kVideoFeedbackSsrc;
+    rrtr_.ntp_seconds = 1000;
+    rrtr_.ntp_fraction = 2000;
+  }
+
+  void Run(BenchState* state) override {
+    for (int64_t i = 0; i < state->ops(); i++) {
+      // One builder per feedback, as RtcpHandler does.
+      RtcpBuilder builder(sharer::kVideoFeedbackSsrc);
+      PacketRef packet = builder.BuildRtcpFromReceiver(
+          &report_block_, &rrtr_, &message_,
+          base::TimeDelta::FromMilliseconds(100));
+      sharer::RtcpParser parser(sharer::kVideoSsrc,
+                                sharer::kVideoFeedbackSsrc);
+      BigEndianReader reader(reinterpret_cast<const char*>(packet->data()),
+                             packet->size());
+      if (!parser.Parse(&reader) || !parser.has_sharer_message()) abort();
+      size_t nacks = 0;
+      for (const auto& frame :
+           parser.sharer_message().missing_frames_and_packets) {
+        nacks += frame.second.size();
+      }
+      if (static_cast<int>(nacks) != expected_nacks_) abort();
+    }
+  }
+
+ private:
+  RtcpSharerMessage message_;
+  const int expected_nacks_;
+  RtcpReportBlock report_block_;
+  RtcpReceiverReferenceTimeReport rrtr_;
+};
+
+// The fixed part of the RTP and Sharer headers, written or read field by
+// field as the packetizer and the parser do.
+class BigEndianBenchmark : public Benchmark {
+ public:
+  explicit BigEndianBenchmark(bool write) : write_(write), buffer_(), sum_(0) {}
+
+  void Run(BenchState* state) override {
+    char* buffer = reinterpret_cast<char*>(buffer_);
+    for (int64_t i = 0; i < state->ops(); i++) {
+      const uint32_t value = static_cast<uint32_t>(i);
+      if (write_) {
+        BigEndianWriter writer(buffer, sizeof(buffer_));
+        writer.WriteU8(0x80);
+        writer.WriteU8(RTP::VIDEO);
+        writer.WriteU16(value);
+        writer.WriteU32(value * 3000);
+        writer.WriteU32(sharer::kVideoSsrc);
+        writer.WriteU8(0);
+        writer.WriteU32(value);
+        writer.WriteU16(value & 0xff);
+        writer.WriteU16(100);
+        writer.WriteU32(value - 1);
+      } else {
+        BigEndianReader reader(buffer, sizeof(buffer_));
+        uint8_t u8;
+        uint16_t u16;
+        uint32_t u32;
+        reader.ReadU8(&u8);
+        reader.ReadU8(&u8);
+        reader.ReadU16(&u16);
+        sum_ += u16;
+        reader.ReadU32(&u32);
+        sum_ += u32;
+        reader.ReadU32(&u32);
+        reader.ReadU8(&u8);
+        reader.ReadU32(&u32);
+        sum_ += u32;
+        reader.ReadU16(&u16);
+        reader.ReadU16(&u16);
+        reader.ReadU32(&u32);
+        sum_ += u32;
+        buffer_[2] = static_cast<uint8_t>(i);
+      }
+    }
+  }
+
+ private:
+  const bool write_;
+  uint8_t buffer_[sharer::kRtpHeaderLength + sharer::kSharerHeaderLength];
+  volatile uint64_t sum_;
+};
+
+template <typename T, typename... Args>
+BenchmarkFactory Make(Args... args) {
+  return [args...]() -> std::unique_ptr<Benchmark> {
+    return make_unique<T>(args...);
+  };
+}
+
+std::vector<BenchmarkInfo> AllBenchmarks() {
+  std::vector<BenchmarkInfo> benchmarks;
+  for (size_t size : {1000, 10000, 100000, 1000000}) {
+    benchmarks.push_back({"packetize/" + SizeName(size),
+                          Make<PacketizeBenchmark>(size)});
+  }
+  for (size_t size : {1000, 10000, 100000}) {
+    benchmarks.push_back(
+        {"pacer/" + SizeName(size), Make<PacerBenchmark>(size)});
+  }
+  for (size_t size : {100, 100000}) {
+    benchmarks.push_back({"rtp_parse/" + SizeName(size) + "_frame",
+                          Make<RtpParseBenchmark>(size)});
+  }
+  for (size_t size : {10000, 100000, 1000000}) {
+    benchmarks.push_back({"frame_buffer/" + SizeName(size),
+                          Make<FrameBufferBenchmark>(size)});
+  }
+  for (size_t size : {10000, 100000}) {
+    benchmarks.push_back({"framer/in_order/" + SizeName(size),
+                          Make<FramerBenchmark>(size, false)});
+    benchmarks.push_back({"framer/reordered/" + SizeName(size),
+                          Make<FramerBenchmark>(size, true)});
+  }
+  benchmarks.push_back(
+      {"nack/30_lost_frames", Make<NackBenchmark>(30u, 1u)});
+  benchmarks.push_back(
+      {"nack/10_half_lost_frames", Make<NackBenchmark>(0u, 10u)});
+  benchmarks.push_back(
+      {"rtcp/sender_report", Make<SenderReportBenchmark>()});
+  benchmarks.push_back(
+      {"rtcp/receiver_ack", Make<ReceiverFeedbackBenchmark>(0, 0)});
+  benchmarks.push_back(
+      {"rtcp/receiver_nacks", Make<ReceiverFeedbackBenchmark>(5, 16)});
+  benchmarks.push_back(
+      {"big_endian/write_header", Make<BigEndianBenchmark>(true)});
+  benchmarks.push_back(
+      {"big_endian/read_header", Make<BigEndianBenchmark>(false)});
+  return benchmarks;
+}
+
+struct Result {
+  int64_t ops;
+  double ns_per_op;
+  double allocations_per_op;
+  double allocated_bytes_per_op;
+  double copied_bytes_per_op;
+};
+
+Result RunBenchmark(Benchmark* benchmark) {
+  // Calibrate the number of operations for one run.
+  int64_t ops = 1;
+  for (;;) {
+    BenchState state(ops);
+    state.ResumeTiming();
+    benchmark->Run(&state);
+    state.PauseTiming();
+    if (state.seconds() >= kMinRunSeconds / 4) break;
+    ops *= 2;
+  }
+  ops *= 4;
+
+  std::vector<double> seconds;
+  bench::OpCounts counts = {0, 0, 0};
+  for (int run = 0; run < kRuns; run++) {
+    BenchState state(ops);
+    state.ResumeTiming();
+    benchmark->Run(&state);
+    state.PauseTiming();
+    seconds.push_back(state.seconds());
+    counts.allocations += state.counts().allocations;
+    counts.allocated_bytes += state.counts().allocated_bytes;
+    counts.copied_bytes += state.counts().copied_bytes;
+  }
+
+  // Median run.
+  std::sort(seconds.begin(), seconds.end());
+  const double total_ops = static_cast<double>(ops) * kRuns;
+  return {ops, seconds[kRuns / 2] / ops * 1e9,
+          counts.allocations / total_ops, counts.allocated_bytes / total_ops,
+          counts.copied_bytes / total_ops};
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  bool json = false;
+  const char* filter = "";
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--json")) {
+      json = true;
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "Usage: %s [--json] [filter]\n", argv[0]);
+      return 1;
+    } else {
+      filter = argv[i];
+    }
+  }
+
+  if (!json) {
+    printf("%-28s %12s %10s %12s %12s\n", "benchmark", "ns/op", "allocs/op",
+           "alloc B/op", "copied B/op");
+  }
+  for (const BenchmarkInfo& info : AllBenchmarks()) {
+    if (info.name.find(filter) == std::string::npos) continue;
+
+    std::unique_ptr<Benchmark> benchmark = info.factory();
+    const Result result = RunBenchmark(benchmark.get());
+    if (json) {
+      printf(
+          "{\"benchmark\": \"%s\", \"ops\": %lld, \"ns_per_op\": %.1f, "
+          "\"allocs_per_op\": %.2f, \"alloc_bytes_per_op\": %.1f, "
+          "\"copied_bytes_per_op\": %.1f}\n",
+          info.name.c_str(), static_cast<long long>(result.ops),
+          result.ns_per_op, result.allocations_per_op,
+          result.allocated_bytes_per_op, result.copied_bytes_per_op);
+    } else {
+      printf("%-28s %12.1f %10.2f %12.1f %12.1f\n", info.name.c_str(),
+             result.ns_per_op, result.allocations_per_op,
+             result.allocated_bytes_per_op, result.copied_bytes_per_op);
+    }
+    fflush(stdout);
+  }
+  return 0;
+}
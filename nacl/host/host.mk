@@ -0,0 +1,41 @@
+# Copyright 2015 Intel Corporation. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+# The network code as built for the release module, over host/, for the
+# Makefiles of the host programs next to host/, e.g. bench/ and tools/.
+NET_SOURCES = \
+	../base/big_endian.cc \
+	../base/log_impl.cc \
+	../base/logger.cc \
+	../base/rand_util.cc \
+	../base/rand_util_nacl.cc \
+	../base/strings/string16.cc \
+	../base/strings/string_piece.cc \
+	../base/time/default_tick_clock.cc \
+	../base/time/tick_clock.cc \
+	../base/time/time.cc \
+	../base/time/time_posix.cc \
+	../common/clock_drift_smoother.cc \
+	../host/ppapi_host.cc \
+	../logging/log_event_dispatcher.cc \
+	../logging/logging_defines.cc \
+	../logging/metrics_registry.cc \
+	../net/pacing/pacer_group.cc \
+	../net/pacing/paced_sender.cc \
+	../net/rtcp/rtcp.cc \
+	../net/rtcp/rtcp_builder.cc \
+	../net/rtcp/rtcp_defines.cc \
+	../net/rtcp/rtcp_utility.cc \
+	../net/rtp/frame_buffer.cc \
+	../net/rtp/framer.cc \
+	../net/rtp/packet_storage.cc \
+	../net/rtp/rtp.cc \
+	../net/rtp/rtp_packetizer.cc \
+	../net/rtp/rtp_receiver_defines.cc \
+	../net/rtp/sharer_message_builder.cc \
+	../net/sharer_transport_config.cc \
+	../net/udp_transport.cc \
+	../sharer_environment.cc
+
+NET_CXXFLAGS = -DNDEBUG -I../host
@@ -0,0 +1,20 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_NACL_NACL_RANDOM_H_
+#define HOST_NACL_NACL_RANDOM_H_
+
+#include <errno.h>
+#include <stddef.h>
+#include <sys/random.h>
+
+// The NaCl IRT call, from the kernel of the host.
+inline int nacl_secure_random(void* dest, size_t bytes, size_t* bytes_written) {
+  const ssize_t result = getrandom(dest, bytes, 0);
+  if (result < 0) return errno;
+  *bytes_written = result;
+  return 0;
+}
+
+#endif  // HOST_NACL_NACL_RANDOM_H_
@@ -0,0 +1,20 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_C_PP_ERRORS_H_
+#define HOST_PPAPI_C_PP_ERRORS_H_
+
+enum {
+  PP_OK = 0,
+  PP_OK_COMPLETIONPENDING = -1,
+  PP_ERROR_FAILED = -2,
+  PP_ERROR_ABORTED = -3,
+  PP_ERROR_BADARGUMENT = -4,
+  PP_ERROR_BADRESOURCE = -5,
+  PP_ERROR_INPROGRESS = -11,
+  PP_ERROR_NOTSUPPORTED = -12,
+  PP_ERROR_NAME_NOT_RESOLVED = -110,
+};
+
+#endif  // HOST_PPAPI_C_PP_ERRORS_H_
@@ -0,0 +1,12 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_C_PP_INSTANCE_H_
+#define HOST_PPAPI_C_PP_INSTANCE_H_
+
+#include <stdint.h>
+
+typedef int32_t PP_Instance;
+
+#endif  // HOST_PPAPI_C_PP_INSTANCE_H_
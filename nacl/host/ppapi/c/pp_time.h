@@ -0,0 +1,14 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_C_PP_TIME_H_
+#define HOST_PPAPI_C_PP_TIME_H_
+
+// Seconds since the epoch.
+typedef double PP_Time;
+// Seconds since an arbitrary point, monotonic.
+typedef double PP_TimeTicks;
+typedef double PP_TimeDelta;
+
+#endif  // HOST_PPAPI_C_PP_TIME_H_
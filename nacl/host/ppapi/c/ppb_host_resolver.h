@@ -0,0 +1,15 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_C_PPB_HOST_RESOLVER_H_
+#define HOST_PPAPI_C_PPB_HOST_RESOLVER_H_
+
+#include "ppapi/c/ppb_net_address.h"
+
+struct PP_HostResolver_Hint {
+  PP_NetAddress_Family family;
+  int32_t flags;
+};
+
+#endif  // HOST_PPAPI_C_PPB_HOST_RESOLVER_H_
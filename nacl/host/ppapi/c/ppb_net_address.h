@@ -0,0 +1,22 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_C_PPB_NET_ADDRESS_H_
+#define HOST_PPAPI_C_PPB_NET_ADDRESS_H_
+
+#include <stdint.h>
+
+typedef enum {
+  PP_NETADDRESS_FAMILY_UNSPECIFIED = 0,
+  PP_NETADDRESS_FAMILY_IPV4 = 1,
+  PP_NETADDRESS_FAMILY_IPV6 = 2
+} PP_NetAddress_Family;
+
+// |port| and |addr| are in network byte order.
+struct PP_NetAddress_IPv4 {
+  uint16_t port;
+  uint8_t addr[4];
+};
+
+#endif  // HOST_PPAPI_C_PPB_NET_ADDRESS_H_
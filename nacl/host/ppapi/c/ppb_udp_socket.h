@@ -0,0 +1,17 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_C_PPB_UDP_SOCKET_H_
+#define HOST_PPAPI_C_PPB_UDP_SOCKET_H_
+
+typedef enum {
+  PP_UDPSOCKET_OPTION_ADDRESS_REUSE = 0,
+  PP_UDPSOCKET_OPTION_BROADCAST = 1,
+  PP_UDPSOCKET_OPTION_SEND_BUFFER_SIZE = 2,
+  PP_UDPSOCKET_OPTION_RECV_BUFFER_SIZE = 3,
+  PP_UDPSOCKET_OPTION_MULTICAST_LOOP = 4,
+  PP_UDPSOCKET_OPTION_MULTICAST_TTL = 5
+} PP_UDPSocket_Option;
+
+#endif  // HOST_PPAPI_C_PPB_UDP_SOCKET_H_
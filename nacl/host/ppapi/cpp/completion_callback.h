@@ -0,0 +1,53 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_CPP_COMPLETION_CALLBACK_H_
+#define HOST_PPAPI_CPP_COMPLETION_CALLBACK_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+
+#include "ppapi/c/pp_errors.h"
+
+namespace pp {
+
+class CompletionCallback {
+ public:
+  using Func = std::function<void(int32_t result)>;
+
+  // Does nothing when run.
+  CompletionCallback() {}
+  explicit CompletionCallback(const Func& func) : func_(func) {}
+
+  void Run(int32_t result) {
+    if (func_) func_(result);
+  }
+
+  // Like the browser does for a call that completed synchronously: runs the
+  // callback later on the main thread, unless |result| says it's pending.
+  int32_t MayForce(int32_t result) const;
+
+ private:
+  Func func_;
+};
+
+// The output of the call is written to output() before the callback runs.
+template <typename T>
+class CompletionCallbackWithOutput : public CompletionCallback {
+ public:
+  CompletionCallbackWithOutput() : output_(std::make_shared<T>()) {}
+  CompletionCallbackWithOutput(const Func& func, std::shared_ptr<T> output)
+      : CompletionCallback(func), output_(output) {}
+
+  T* output() const { return output_.get(); }
+
+ private:
+  std::shared_ptr<T> output_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_COMPLETION_CALLBACK_H_
@@ -0,0 +1,30 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_CPP_CORE_H_
+#define HOST_PPAPI_CPP_CORE_H_
+
+#include <stdint.h>
+
+#include "ppapi/c/pp_time.h"
+#include "ppapi/cpp/completion_callback.h"
+
+namespace pp {
+
+class Core {
+ public:
+  PP_Time GetTime();
+  PP_TimeTicks GetTimeTicks();
+  // Can be called from any thread. The callback runs from
+  // ppapi_host::RunUntilIdle() or ppapi_host::RunReadyCallbacks().
+  void CallOnMainThread(int32_t delay_in_milliseconds,
+                        const CompletionCallback& callback,
+                        int32_t result = 0);
+  // The main thread is the one that ran the static initializers.
+  bool IsMainThread();
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_CORE_H_
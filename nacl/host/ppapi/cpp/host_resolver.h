@@ -0,0 +1,43 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_CPP_HOST_RESOLVER_H_
+#define HOST_PPAPI_CPP_HOST_RESOLVER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "ppapi/c/ppb_host_resolver.h"
+#include "ppapi/cpp/completion_callback.h"
+#include "ppapi/cpp/net_address.h"
+#include "ppapi/cpp/resource.h"
+
+namespace pp {
+
+class Instance;
+
+// Resolves dotted IPv4 addresses only, which is all the sharer is given.
+class HostResolver : public Resource {
+ public:
+  HostResolver();
+  explicit HostResolver(Instance* instance);
+  ~HostResolver();
+
+  static bool IsAvailable() { return true; }
+
+  int32_t Resolve(const char* host, uint16_t port,
+                  const PP_HostResolver_Hint& hint,
+                  const CompletionCallback& callback);
+  uint32_t GetNetAddressCount() const { return addresses_.size(); }
+  NetAddress GetNetAddress(uint32_t index) const;
+
+ private:
+  Instance* instance_;
+  std::vector<NetAddress> addresses_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_HOST_RESOLVER_H_
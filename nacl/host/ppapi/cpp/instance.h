@@ -0,0 +1,35 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_CPP_INSTANCE_H_
+#define HOST_PPAPI_CPP_INSTANCE_H_
+
+#include "ppapi/c/pp_instance.h"
+#include "ppapi/cpp/var.h"
+// Reached through view.h in the SDK.
+#include "ppapi/cpp/size.h"
+
+namespace pp {
+
+class Instance {
+ public:
+  explicit Instance(PP_Instance instance);
+  virtual ~Instance();
+
+  PP_Instance pp_instance() const { return pp_instance_; }
+
+  virtual void HandleMessage(const Var& message) {}
+  // Goes to the handler set with ppapi_host::SetMessageHandler().
+  void PostMessage(const Var& message);
+
+ private:
+  PP_Instance pp_instance_;
+
+  Instance(const Instance&) = delete;
+  void operator=(const Instance&) = delete;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_INSTANCE_H_
@@ -0,0 +1,13 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_CPP_LOGGING_H_
+#define HOST_PPAPI_CPP_LOGGING_H_
+
+#include <assert.h>
+
+#define PP_DCHECK(a) assert(a)
+#define PP_NOTREACHED() assert(false)
+
+#endif  // HOST_PPAPI_CPP_LOGGING_H_
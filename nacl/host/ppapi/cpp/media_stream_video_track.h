@@ -0,0 +1,14 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_CPP_MEDIA_STREAM_VIDEO_TRACK_H_
+#define HOST_PPAPI_CPP_MEDIA_STREAM_VIDEO_TRACK_H_
+
+// Capture isn't available on the host.
+namespace pp {
+class MediaStreamVideoTrack;
+class VideoFrame;
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_MEDIA_STREAM_VIDEO_TRACK_H_
@@ -0,0 +1,26 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_CPP_MODULE_H_
+#define HOST_PPAPI_CPP_MODULE_H_
+
+#include "ppapi/cpp/core.h"
+
+namespace pp {
+
+class Module {
+ public:
+  static Module* Get();
+
+  Core* core() { return &core_; }
+
+ private:
+  Module() {}
+
+  Core core_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_MODULE_H_
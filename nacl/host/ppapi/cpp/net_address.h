@@ -0,0 +1,33 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_CPP_NET_ADDRESS_H_
+#define HOST_PPAPI_CPP_NET_ADDRESS_H_
+
+#include "ppapi/c/ppb_net_address.h"
+#include "ppapi/cpp/resource.h"
+#include "ppapi/cpp/var.h"
+
+namespace pp {
+
+class Instance;
+
+// IPv4 only.
+class NetAddress : public Resource {
+ public:
+  NetAddress();
+  NetAddress(Instance* instance, const PP_NetAddress_IPv4& ipv4_addr);
+
+  PP_NetAddress_Family GetFamily() const;
+  // "1.2.3.4" or "1.2.3.4:5678".
+  Var DescribeAsString(bool include_port) const;
+  bool DescribeAsIPv4Address(PP_NetAddress_IPv4* ipv4_addr) const;
+
+ private:
+  PP_NetAddress_IPv4 ipv4_addr_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_NET_ADDRESS_H_
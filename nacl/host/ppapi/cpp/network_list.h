@@ -0,0 +1,35 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_CPP_NETWORK_LIST_H_
+#define HOST_PPAPI_CPP_NETWORK_LIST_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "ppapi/cpp/resource.h"
+
+namespace pp {
+
+// Names only, which is all the sharer logs.
+class NetworkList : public Resource {
+ public:
+  NetworkList() : Resource(false) {}
+  explicit NetworkList(const std::vector<std::string>& names)
+      : Resource(false), names_(names) {}
+
+  uint32_t GetCount() const { return names_.size(); }
+  std::string GetName(uint32_t index) const {
+    return index < names_.size() ? names_[index] : std::string();
+  }
+
+ private:
+  std::vector<std::string> names_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_NETWORK_LIST_H_
@@ -0,0 +1,29 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_CPP_NETWORK_MONITOR_H_
+#define HOST_PPAPI_CPP_NETWORK_MONITOR_H_
+
+#include <stdint.h>
+
+#include "ppapi/cpp/completion_callback.h"
+#include "ppapi/cpp/network_list.h"
+#include "ppapi/cpp/resource.h"
+
+namespace pp {
+
+class Instance;
+
+// The in-memory network of UDPSocket has a single interface, "lo".
+class NetworkMonitor : public Resource {
+ public:
+  explicit NetworkMonitor(Instance* instance);
+
+  int32_t UpdateNetworkList(
+      const CompletionCallbackWithOutput<NetworkList>& callback);
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_NETWORK_MONITOR_H_
@@ -0,0 +1,23 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_CPP_RESOURCE_H_
+#define HOST_PPAPI_CPP_RESOURCE_H_
+
+namespace pp {
+
+class Resource {
+ public:
+  bool is_null() const { return is_null_; }
+
+ protected:
+  explicit Resource(bool is_null) : is_null_(is_null) {}
+
+ private:
+  bool is_null_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_RESOURCE_H_
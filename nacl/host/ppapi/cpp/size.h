@@ -0,0 +1,27 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_CPP_SIZE_H_
+#define HOST_PPAPI_CPP_SIZE_H_
+
+#include <stdint.h>
+
+namespace pp {
+
+class Size {
+ public:
+  Size() : width_(0), height_(0) {}
+  Size(int32_t width, int32_t height) : width_(width), height_(height) {}
+
+  int32_t width() const { return width_; }
+  int32_t height() const { return height_; }
+
+ private:
+  int32_t width_;
+  int32_t height_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_SIZE_H_
@@ -0,0 +1,58 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_CPP_UDP_SOCKET_H_
+#define HOST_PPAPI_CPP_UDP_SOCKET_H_
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "ppapi/c/ppb_udp_socket.h"
+#include "ppapi/cpp/completion_callback.h"
+#include "ppapi/cpp/net_address.h"
+#include "ppapi/cpp/resource.h"
+#include "ppapi/cpp/var.h"
+
+namespace pp {
+
+class Instance;
+
+// Doesn't reach the network: the sockets of the program exchange datagrams in
+// memory. A datagram sent to a.b.c.d:port goes to every socket bound to that
+// port and to a.b.c.d or 0.0.0.0, or, for a multicast a.b.c.d, to those that
+// joined it. Bound to 0.0.0.0, a socket sends from 127.0.0.1.
+//
+// Datagrams arrive ppapi_host::SetNetworkDelay() after being sent, in order,
+// and wait in the socket until received. Nothing is ever dropped.
+class UDPSocket : public Resource {
+ public:
+  UDPSocket();
+  explicit UDPSocket(Instance* instance);
+  ~UDPSocket();
+
+  int32_t Bind(const NetAddress& addr, const CompletionCallback& callback);
+  NetAddress GetBoundAddress() const;
+  int32_t RecvFrom(char* buffer, int32_t num_bytes,
+                   const CompletionCallbackWithOutput<NetAddress>& callback);
+  int32_t SendTo(const char* buffer, int32_t num_bytes, const NetAddress& addr,
+                 const CompletionCallback& callback);
+  void Close();
+  int32_t SetOption(PP_UDPSocket_Option name, const Var& value,
+                    const CompletionCallback& callback);
+  int32_t JoinGroup(const NetAddress& group,
+                    const CompletionCallback& callback);
+  int32_t LeaveGroup(const NetAddress& group,
+                     const CompletionCallback& callback);
+
+ private:
+  struct State;
+
+  // Shared by the copies of the socket.
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_UDP_SOCKET_H_
@@ -0,0 +1,56 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_CPP_VAR_H_
+#define HOST_PPAPI_CPP_VAR_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace pp {
+
+// Undefined, bool, int, double, string or dictionary.
+class Var {
+ public:
+  Var();
+  Var(bool value);
+  Var(int32_t value);
+  Var(double value);
+  Var(const char* value);
+  Var(const std::string& value);
+  ~Var();
+
+  bool is_undefined() const { return type_ == Type::UNDEFINED; }
+  bool is_bool() const { return type_ == Type::BOOL; }
+  bool is_int() const { return type_ == Type::INT; }
+  bool is_double() const { return type_ == Type::DOUBLE; }
+  bool is_number() const { return is_int() || is_double(); }
+  bool is_string() const { return type_ == Type::STRING; }
+  bool is_dictionary() const { return type_ == Type::DICTIONARY; }
+
+  bool AsBool() const { return number_ != 0; }
+  int32_t AsInt() const { return static_cast<int32_t>(number_); }
+  double AsDouble() const { return number_; }
+  std::string AsString() const { return string_; }
+
+  // JSON-like, for printing.
+  std::string DebugString() const;
+
+ protected:
+  enum class Type { UNDEFINED, BOOL, INT, DOUBLE, STRING, DICTIONARY };
+  using Dictionary = std::map<std::string, Var>;
+
+  Type type_;
+  double number_;
+  std::string string_;
+  // Shared by copies, as the browser's vars are reference counted.
+  std::shared_ptr<Dictionary> dictionary_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_VAR_H_
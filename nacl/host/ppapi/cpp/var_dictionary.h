@@ -0,0 +1,27 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_CPP_VAR_DICTIONARY_H_
+#define HOST_PPAPI_CPP_VAR_DICTIONARY_H_
+
+#include "ppapi/cpp/var.h"
+
+namespace pp {
+
+class VarDictionary : public Var {
+ public:
+  VarDictionary();
+  // |var| must be a dictionary.
+  explicit VarDictionary(const Var& var);
+  ~VarDictionary();
+
+  // Keys are strings, like in JavaScript.
+  Var Get(const Var& key) const;
+  bool Set(const Var& key, const Var& value);
+  bool HasKey(const Var& key) const;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_VAR_DICTIONARY_H_
@@ -0,0 +1,69 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_UTILITY_COMPLETION_CALLBACK_FACTORY_H_
+#define HOST_PPAPI_UTILITY_COMPLETION_CALLBACK_FACTORY_H_
+
+#include <atomic>
+#include <memory>
+#include <type_traits>
+
+#include "ppapi/cpp/completion_callback.h"
+
+namespace pp {
+
+struct NonThreadSafeThreadTraits {};
+struct ThreadSafeThreadTraits {};
+
+// Callbacks to the methods of |T|. As with the real factory, callbacks still
+// pending when the factory is destroyed don't call |T| anymore. Both thread
+// traits are thread-safe here.
+template <typename T, typename ThreadTraits = NonThreadSafeThreadTraits>
+class CompletionCallbackFactory {
+ public:
+  explicit CompletionCallbackFactory(T* object)
+      : back_(std::make_shared<std::atomic<T*>>(object)) {}
+  ~CompletionCallbackFactory() { CancelAll(); }
+
+  void CancelAll() {
+    back_->store(nullptr);
+    back_ = std::make_shared<std::atomic<T*>>(nullptr);
+  }
+
+  // |method| is called with the result of the call, then |args|.
+  template <typename Method, typename... Args>
+  CompletionCallback NewCallback(Method method, const Args&... args) {
+    std::shared_ptr<std::atomic<T*>> back = back_;
+    return CompletionCallback([back, method, args...](int32_t result) mutable {
+      T* object = back->load();
+      if (object) (object->*method)(result, args...);
+    });
+  }
+
+  // |method| is called with the result of the call, its output, then |args|.
+  template <typename Output, typename... Params, typename... Args>
+  CompletionCallbackWithOutput<typename std::decay<Output>::type>
+  NewCallbackWithOutput(void (T::*method)(int32_t, Output, Params...),
+                        const Args&... args) {
+    using OutputType = typename std::decay<Output>::type;
+    std::shared_ptr<std::atomic<T*>> back = back_;
+    std::shared_ptr<OutputType> output = std::make_shared<OutputType>();
+    return CompletionCallbackWithOutput<OutputType>(
+        [back, method, output, args...](int32_t result) mutable {
+          T* object = back->load();
+          if (object) (object->*method)(result, *output, args...);
+        },
+        output);
+  }
+
+ private:
+  std::shared_ptr<std::atomic<T*>> back_;
+
+  CompletionCallbackFactory(const CompletionCallbackFactory&) = delete;
+  void operator=(const CompletionCallbackFactory&) = delete;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_UTILITY_COMPLETION_CALLBACK_FACTORY_H_
@@ -0,0 +1,681 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ppapi_host.h"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "ppapi/cpp/host_resolver.h"
+#include "ppapi/cpp/instance.h"
+#include "ppapi/cpp/module.h"
+#include "ppapi/cpp/network_monitor.h"
+#include "ppapi/cpp/udp_socket.h"
+#include "ppapi/cpp/var_dictionary.h"
+
+namespace {
+
+double ClockSeconds(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct PostedCallback {
+  double due;
+  // Keeps callbacks due at the same time in the order they were posted.
+  uint64_t sequence;
+  pp::CompletionCallback callback;
+  int32_t result;
+  // See ppapi_host::ScopedCpuAccount.
+  int account;
+
+  bool operator>(const PostedCallback& other) const {
+    return due != other.due ? due > other.due : sequence > other.sequence;
+  }
+};
+
+class MainThread {
+ public:
+  MainThread()
+      : thread_id_(std::this_thread::get_id()),
+        next_sequence_(0),
+        simulated_(false),
+        simulated_now_(0),
+        simulated_start_time_(0),
+        account_(0),
+        account_start_(ClockSeconds(CLOCK_THREAD_CPUTIME_ID)) {}
+
+  bool IsCurrent() const { return std::this_thread::get_id() == thread_id_; }
+
+  void Post(double due, const pp::CompletionCallback& callback,
+            int32_t result) {
+    const int account = IsCurrent() ? account_ : 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    callbacks_.push({due, next_sequence_++, callback, result, account});
+  }
+
+  // Pops the first callback due by |now|, any if |now| is negative.
+  bool Pop(double now, PostedCallback* callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (callbacks_.empty() || (now >= 0 && callbacks_.top().due > now))
+      return false;
+    *callback = callbacks_.top();
+    callbacks_.pop();
+    return true;
+  }
+
+  bool NextDue(double* due) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (callbacks_.empty()) return false;
+    *due = callbacks_.top().due;
+    return true;
+  }
+
+  void Run(PostedCallback* posted) {
+    const int previous = SwitchAccount(posted->account);
+    posted->callback.Run(posted->result);
+    SwitchAccount(previous);
+  }
+
+  bool simulated() const { return simulated_; }
+  int account() const { return account_; }
+
+  void UseSimulatedTime() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    simulated_now_ = ClockSeconds(CLOCK_MONOTONIC);
+    simulated_start_time_ = ClockSeconds(CLOCK_REALTIME) - simulated_now_;
+    simulated_ = true;
+  }
+
+  // Moves the simulated time forward to |now|.
+  void AdvanceTo(double now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (now > simulated_now_) simulated_now_ = now;
+  }
+
+  double Now() {
+    if (!simulated_) return ClockSeconds(CLOCK_MONOTONIC);
+    std::lock_guard<std::mutex> lock(mutex_);
+    return simulated_now_;
+  }
+
+  double WallTime() {
+    if (!simulated_) return ClockSeconds(CLOCK_REALTIME);
+    std::lock_guard<std::mutex> lock(mutex_);
+    return simulated_start_time_ + simulated_now_;
+  }
+
+  // Charges the CPU time since the last switch to the current account, and
+  // makes |account| current. Returns the previous one.
+  int SwitchAccount(int account) {
+    const double now = ClockSeconds(CLOCK_THREAD_CPUTIME_ID);
+    cpu_seconds_[account_] += now - account_start_;
+    account_start_ = now;
+    const int previous = account_;
+    account_ = account;
+    return previous;
+  }
+
+  double CpuSeconds(int account) {
+    SwitchAccount(account_);
+    return cpu_seconds_[account];
+  }
+
+  std::function<void(const pp::Var&)> message_handler;
+
+ private:
+  const std::thread::id thread_id_;
+  std::mutex mutex_;
+  std::priority_queue<PostedCallback, std::vector<PostedCallback>,
+                      std::greater<PostedCallback>>
+      callbacks_;
+  uint64_t next_sequence_;
+
+  bool simulated_;
+  double simulated_now_;
+  // Real time when the simulated time was 0.
+  double simulated_start_time_;
+
+  // Main thread only.
+  int account_;
+  double account_start_;
+  std::map<int, double> cpu_seconds_;
+};
+
+// Created by the static initializers, so on the main thread.
+MainThread g_main_thread;
+
+bool IsMulticast(const PP_NetAddress_IPv4& addr) {
+  return (addr.addr[0] & 0xf0) == 0xe0;
+}
+
+bool IsAny(const PP_NetAddress_IPv4& addr) {
+  return !addr.addr[0] && !addr.addr[1] && !addr.addr[2] && !addr.addr[3];
+}
+
+bool SameHost(const PP_NetAddress_IPv4& a, const PP_NetAddress_IPv4& b) {
+  return !memcmp(a.addr, b.addr, sizeof(a.addr));
+}
+
+struct Datagram {
+  pp::NetAddress source;
+  std::vector<char> data;
+};
+
+double g_network_delay = 0;
+
+// Host of the sockets being created, see ppapi_host::ScopedHost, 0 if none.
+// In network byte order, as are the addresses of PP_NetAddress_IPv4.
+uint32_t g_current_host = 0;
+
+uint32_t HostOf(const PP_NetAddress_IPv4& addr) {
+  uint32_t host;
+  memcpy(&host, addr.addr, sizeof(host));
+  return host;
+}
+
+uint32_t ParseHost(const char* address) {
+  uint32_t host = 0;
+  if (inet_pton(AF_INET, address, &host) != 1) {
+    fprintf(stderr, "Invalid host address: %s\n", address);
+    abort();
+  }
+  return host;
+}
+
+// See ppapi_host::SetLinkRate().
+struct Link {
+  double bytes_per_second;
+  double queue_seconds;
+  // When the datagrams queued so far are through.
+  double busy_until;
+};
+
+std::map<uint32_t, Link> g_links;
+
+// Returns when a datagram of |size| bytes sent to |host| now arrives, or a
+// negative value if the link of |host| drops it.
+double ArrivalTime(uint32_t host, size_t size, double now) {
+  double arrival = now + g_network_delay;
+  auto it = g_links.find(host);
+  if (it == g_links.end()) return arrival;
+
+  Link& link = it->second;
+  const double start = std::max(now, link.busy_until);
+  if (start - now > link.queue_seconds) return -1;
+  link.busy_until = start + size / link.bytes_per_second;
+  return link.busy_until + g_network_delay;
+}
+
+void AppendQuoted(const std::string& value, std::string* out) {
+  out->push_back('"');
+  for (char c : value) {
+    if (c == '"' || c == '\\') out->push_back('\\');
+    out->push_back(c);
+  }
+  out->push_back('"');
+}
+
+}  // namespace
+
+namespace ppapi_host {
+
+size_t RunUntilIdle() {
+  size_t count = 0;
+  PostedCallback posted;
+  while (g_main_thread.Pop(-1, &posted)) {
+    if (g_main_thread.simulated()) g_main_thread.AdvanceTo(posted.due);
+    g_main_thread.Run(&posted);
+    count++;
+  }
+  return count;
+}
+
+size_t RunReadyCallbacks() {
+  const double now = g_main_thread.Now();
+  size_t count = 0;
+  PostedCallback posted;
+  while (g_main_thread.Pop(now, &posted)) {
+    g_main_thread.Run(&posted);
+    count++;
+  }
+  return count;
+}
+
+size_t RunFor(double seconds) {
+  const double end = g_main_thread.Now() + seconds;
+  size_t count = 0;
+  for (;;) {
+    double due;
+    const bool has_due = g_main_thread.NextDue(&due) && due <= end;
+    if (g_main_thread.simulated()) {
+      if (!has_due) break;
+      g_main_thread.AdvanceTo(due);
+    } else {
+      const double wait = (has_due ? due : end) - g_main_thread.Now();
+      if (wait > 0) {
+        // Short naps, for the callbacks posted from other threads meanwhile.
+        std::this_thread::sleep_for(
+            std::chrono::duration<double>(std::min(wait, 0.001)));
+        continue;
+      }
+      if (!has_due) break;
+    }
+    count += RunReadyCallbacks();
+  }
+  if (g_main_thread.simulated()) g_main_thread.AdvanceTo(end);
+  return count;
+}
+
+void UseSimulatedTime() { g_main_thread.UseSimulatedTime(); }
+
+void SetNetworkDelay(double seconds) { g_network_delay = seconds; }
+
+ScopedHost::ScopedHost(const char* address) : previous_(g_current_host) {
+  g_current_host = ParseHost(address);
+}
+
+ScopedHost::~ScopedHost() { g_current_host = previous_; }
+
+void SetLinkRate(const char* address, double bytes_per_second,
+                 double queue_seconds) {
+  const uint32_t host = ParseHost(address);
+  if (bytes_per_second <= 0) {
+    g_links.erase(host);
+    return;
+  }
+  Link& link = g_links[host];
+  link.bytes_per_second = bytes_per_second;
+  link.queue_seconds = queue_seconds;
+  link.busy_until = 0;
+}
+
+ScopedCpuAccount::ScopedCpuAccount(int account)
+    : previous_(g_main_thread.SwitchAccount(account)) {}
+
+ScopedCpuAccount::~ScopedCpuAccount() {
+  g_main_thread.SwitchAccount(previous_);
+}
+
+double CpuSeconds(int account) { return g_main_thread.CpuSeconds(account); }
+
+void SetMessageHandler(const std::function<void(const pp::Var&)>& handler) {
+  g_main_thread.message_handler = handler;
+}
+
+}  // namespace ppapi_host
+
+namespace pp {
+
+int32_t CompletionCallback::MayForce(int32_t result) const {
+  if (result == PP_OK_COMPLETIONPENDING) return result;
+  Module::Get()->core()->CallOnMainThread(0, *this, result);
+  return PP_OK_COMPLETIONPENDING;
+}
+
+// static
+Module* Module::Get() {
+  static Module module;
+  return &module;
+}
+
+PP_Time Core::GetTime() { return g_main_thread.WallTime(); }
+
+PP_TimeTicks Core::GetTimeTicks() { return g_main_thread.Now(); }
+
+void Core::CallOnMainThread(int32_t delay_in_milliseconds,
+                            const CompletionCallback& callback,
+                            int32_t result) {
+  g_main_thread.Post(GetTimeTicks() + delay_in_milliseconds / 1000.0,
+                     callback, result);
+}
+
+bool Core::IsMainThread() { return g_main_thread.IsCurrent(); }
+
+Var::Var() : type_(Type::UNDEFINED), number_(0) {}
+Var::Var(bool value) : type_(Type::BOOL), number_(value) {}
+Var::Var(int32_t value) : type_(Type::INT), number_(value) {}
+Var::Var(double value) : type_(Type::DOUBLE), number_(value) {}
+Var::Var(const char* value)
+    : type_(Type::STRING), number_(0), string_(value) {}
+Var::Var(const std::string& value)
+    : type_(Type::STRING), number_(0), string_(value) {}
+Var::~Var() {}
+
+std::string Var::DebugString() const {
+  char buffer[32];
+  switch (type_) {
+    case Type::UNDEFINED:
+      return "undefined";
+    case Type::BOOL:
+      return number_ ? "true" : "false";
+    case Type::INT:
+    case Type::DOUBLE:
+      snprintf(buffer, sizeof(buffer), "%.15g", number_);
+      return buffer;
+    case Type::STRING: {
+      std::string out;
+      AppendQuoted(string_, &out);
+      return out;
+    }
+    case Type::DICTIONARY: {
+      std::string out = "{";
+      for (const auto& entry : *dictionary_) {
+        if (out.size() > 1) out.push_back(',');
+        AppendQuoted(entry.first, &out);
+        out.push_back(':');
+        out.append(entry.second.DebugString());
+      }
+      out.push_back('}');
+      return out;
+    }
+  }
+  return std::string();
+}
+
+VarDictionary::VarDictionary() {
+  type_ = Type::DICTIONARY;
+  dictionary_ = std::make_shared<Dictionary>();
+}
+
+VarDictionary::VarDictionary(const Var& var) : Var(var) {
+  if (!is_dictionary()) {
+    type_ = Type::DICTIONARY;
+    dictionary_ = std::make_shared<Dictionary>();
+  }
+}
+
+VarDictionary::~VarDictionary() {}
+
+Var VarDictionary::Get(const Var& key) const {
+  auto it = dictionary_->find(key.AsString());
+  return it != dictionary_->end() ? it->second : Var();
+}
+
+bool VarDictionary::Set(const Var& key, const Var& value) {
+  if (!key.is_string()) return false;
+  (*dictionary_)[key.AsString()] = value;
+  return true;
+}
+
+bool VarDictionary::HasKey(const Var& key) const {
+  return dictionary_->count(key.AsString()) != 0;
+}
+
+Instance::Instance(PP_Instance instance) : pp_instance_(instance) {}
+
+Instance::~Instance() {}
+
+void Instance::PostMessage(const Var& message) {
+  if (g_main_thread.message_handler) g_main_thread.message_handler(message);
+}
+
+NetAddress::NetAddress() : Resource(true), ipv4_addr_() {}
+
+NetAddress::NetAddress(Instance* instance, const PP_NetAddress_IPv4& ipv4_addr)
+    : Resource(false), ipv4_addr_(ipv4_addr) {}
+
+PP_NetAddress_Family NetAddress::GetFamily() const {
+  return is_null() ? PP_NETADDRESS_FAMILY_UNSPECIFIED
+                   : PP_NETADDRESS_FAMILY_IPV4;
+}
+
+Var NetAddress::DescribeAsString(bool include_port) const {
+  if (is_null()) return Var();
+  char buffer[32];
+  const uint8_t* a = ipv4_addr_.addr;
+  if (include_port) {
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u:%u", a[0], a[1], a[2], a[3],
+             ntohs(ipv4_addr_.port));
+  } else {
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", a[0], a[1], a[2], a[3]);
+  }
+  return Var(buffer);
+}
+
+bool NetAddress::DescribeAsIPv4Address(PP_NetAddress_IPv4* ipv4_addr) const {
+  if (is_null()) return false;
+  *ipv4_addr = ipv4_addr_;
+  return true;
+}
+
+HostResolver::HostResolver() : Resource(true), instance_(nullptr) {}
+
+HostResolver::HostResolver(Instance* instance)
+    : Resource(false), instance_(instance) {}
+
+HostResolver::~HostResolver() {}
+
+int32_t HostResolver::Resolve(const char* host, uint16_t port,
+                              const PP_HostResolver_Hint& hint,
+                              const CompletionCallback& callback) {
+  addresses_.clear();
+  PP_NetAddress_IPv4 ipv4_addr;
+  ipv4_addr.port = htons(port);
+  if (inet_pton(AF_INET, host, ipv4_addr.addr) != 1)
+    return callback.MayForce(PP_ERROR_NAME_NOT_RESOLVED);
+  addresses_.push_back(NetAddress(instance_, ipv4_addr));
+  return callback.MayForce(PP_OK);
+}
+
+NetAddress HostResolver::GetNetAddress(uint32_t index) const {
+  return index < addresses_.size() ? addresses_[index] : NetAddress();
+}
+
+NetworkMonitor::NetworkMonitor(Instance* instance) : Resource(false) {}
+
+int32_t NetworkMonitor::UpdateNetworkList(
+    const CompletionCallbackWithOutput<NetworkList>& callback) {
+  *callback.output() = NetworkList({"lo"});
+  return callback.MayForce(PP_OK);
+}
+
+struct UDPSocket::State {
+  State()
+      : id(next_id++),
+        host(0),
+        account(0),
+        bound(false),
+        recv_pending(false),
+        recv_buffer(nullptr),
+        recv_size(0) {}
+
+  ~State() { Sockets().erase(id); }
+
+  // Of all the sockets, by creation.
+  static std::map<uint64_t, State*>& Sockets() {
+    static std::map<uint64_t, State*> sockets;
+    return sockets;
+  }
+
+  bool IsDestination(const PP_NetAddress_IPv4& addr) const {
+    if (!bound || bound_addr.port != addr.port) return false;
+    if (IsMulticast(addr)) {
+      for (const auto& group : groups) {
+        if (SameHost(group, addr)) return true;
+      }
+      return false;
+    }
+    if (!IsAny(bound_addr)) return SameHost(bound_addr, addr);
+    return !host || HostOf(addr) == host;
+  }
+
+  // Host the datagrams to this socket go through, see SetLinkRate().
+  uint32_t DestinationHost() const {
+    return IsAny(bound_addr) ? host : HostOf(bound_addr);
+  }
+
+  NetAddress SourceAddress() const {
+    PP_NetAddress_IPv4 source = bound_addr;
+    if (!bound || IsAny(source)) {
+      const uint8_t loopback[4] = {127, 0, 0, 1};
+      memcpy(source.addr, loopback, sizeof(loopback));
+      if (host) memcpy(source.addr, &host, sizeof(host));
+    }
+    return NetAddress(nullptr, source);
+  }
+
+  // Completes the pending RecvFrom() with the next datagram, if any.
+  void Receive() {
+    if (!recv_pending || datagrams.empty()) return;
+    CompletionCallbackWithOutput<NetAddress> callback = recv_callback;
+    recv_pending = false;
+    callback.Run(Pop(recv_buffer, recv_size, callback.output()));
+  }
+
+  int32_t Pop(char* buffer, int32_t size, NetAddress* source) {
+    std::shared_ptr<const Datagram> datagram = datagrams.front();
+    datagrams.pop_front();
+    const int32_t length =
+        std::min(size, static_cast<int32_t>(datagram->data.size()));
+    memcpy(buffer, datagram->data.data(), length);
+    *source = datagram->source;
+    return length;
+  }
+
+  static uint64_t next_id;
+
+  const uint64_t id;
+  // See ppapi_host::ScopedHost, 0 if none.
+  uint32_t host;
+  int account;
+  bool bound;
+  PP_NetAddress_IPv4 bound_addr;
+  std::vector<PP_NetAddress_IPv4> groups;
+  std::deque<std::shared_ptr<const Datagram>> datagrams;
+
+  bool recv_pending;
+  char* recv_buffer;
+  int32_t recv_size;
+  CompletionCallbackWithOutput<NetAddress> recv_callback;
+};
+
+uint64_t UDPSocket::State::next_id = 0;
+
+UDPSocket::UDPSocket() : Resource(true) {}
+
+UDPSocket::UDPSocket(Instance* instance)
+    : Resource(false), state_(std::make_shared<State>()) {
+  state_->host = g_current_host;
+  state_->account = g_main_thread.account();
+}
+
+UDPSocket::~UDPSocket() {}
+
+int32_t UDPSocket::Bind(const NetAddress& addr,
+                        const CompletionCallback& callback) {
+  if (!state_ || !addr.DescribeAsIPv4Address(&state_->bound_addr))
+    return callback.MayForce(PP_ERROR_BADARGUMENT);
+  if (!state_->bound) State::Sockets()[state_->id] = state_.get();
+  state_->bound = true;
+  return callback.MayForce(PP_OK);
+}
+
+NetAddress UDPSocket::GetBoundAddress() const {
+  return state_ && state_->bound ? NetAddress(nullptr, state_->bound_addr)
+                                 : NetAddress();
+}
+
+int32_t UDPSocket::RecvFrom(
+    char* buffer, int32_t num_bytes,
+    const CompletionCallbackWithOutput<NetAddress>& callback) {
+  if (!state_) return callback.MayForce(PP_ERROR_BADRESOURCE);
+  if (state_->recv_pending) return callback.MayForce(PP_ERROR_INPROGRESS);
+  if (!state_->datagrams.empty())
+    return callback.MayForce(
+        state_->Pop(buffer, num_bytes, callback.output()));
+
+  state_->recv_pending = true;
+  state_->recv_buffer = buffer;
+  state_->recv_size = num_bytes;
+  state_->recv_callback = callback;
+  return PP_OK_COMPLETIONPENDING;
+}
+
+int32_t UDPSocket::SendTo(const char* buffer, int32_t num_bytes,
+                          const NetAddress& addr,
+                          const CompletionCallback& callback) {
+  PP_NetAddress_IPv4 destination;
+  if (!state_ || !addr.DescribeAsIPv4Address(&destination))
+    return callback.MayForce(PP_ERROR_BADARGUMENT);
+
+  std::shared_ptr<Datagram> datagram;
+  for (const auto& socket : State::Sockets()) {
+    if (!socket.second->IsDestination(destination)) continue;
+
+    const double now = g_main_thread.Now();
+    const double arrival = ArrivalTime(socket.second->DestinationHost(),
+                                       num_bytes, now);
+    if (arrival < 0) continue;
+
+    if (!datagram) {
+      datagram = std::make_shared<Datagram>();
+      datagram->source = state_->SourceAddress();
+      datagram->data.assign(buffer, buffer + num_bytes);
+    }
+    // Arrives on the account of the receiving socket, unless closed by then.
+    const uint64_t id = socket.first;
+    auto arrive = [id, datagram](int32_t result) {
+      auto it = State::Sockets().find(id);
+      if (it == State::Sockets().end()) return;
+      it->second->datagrams.push_back(datagram);
+      it->second->Receive();
+    };
+    const int previous = g_main_thread.SwitchAccount(socket.second->account);
+    g_main_thread.Post(arrival, CompletionCallback(arrive), PP_OK);
+    g_main_thread.SwitchAccount(previous);
+  }
+  return callback.MayForce(num_bytes);
+}
+
+void UDPSocket::Close() {
+  if (!state_) return;
+  State::Sockets().erase(state_->id);
+  state_->bound = false;
+  state_->datagrams.clear();
+  state_->recv_pending = false;
+}
+
+int32_t UDPSocket::SetOption(PP_UDPSocket_Option name, const Var& value,
+                             const CompletionCallback& callback) {
+  return callback.MayForce(PP_OK);
+}
+
+int32_t UDPSocket::JoinGroup(const NetAddress& group,
+                             const CompletionCallback& callback) {
+  PP_NetAddress_IPv4 addr;
+  if (!state_ || !group.DescribeAsIPv4Address(&addr))
+    return callback.MayForce(PP_ERROR_BADARGUMENT);
+  state_->groups.push_back(addr);
+  return callback.MayForce(PP_OK);
+}
+
+int32_t UDPSocket::LeaveGroup(const NetAddress& group,
+                              const CompletionCallback& callback) {
+  PP_NetAddress_IPv4 addr;
+  if (!state_ || !group.DescribeAsIPv4Address(&addr))
+    return callback.MayForce(PP_ERROR_BADARGUMENT);
+  for (auto it = state_->groups.begin(); it != state_->groups.end(); ++it) {
+    if (SameHost(*it, addr)) {
+      state_->groups.erase(it);
+      break;
+    }
+  }
+  return callback.MayForce(PP_OK);
+}
+
+}  // namespace pp
@@ -0,0 +1,90 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_PPAPI_HOST_H_
+#define HOST_PPAPI_HOST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+
+#include "ppapi/cpp/var.h"
+
+// The headers under host/ppapi stand in for the parts of the ppapi C++ API
+// that the network code uses, so that benchmarks and tools can build the real
+// sources with the host compiler: put host/ before the SDK in the include
+// path and link ppapi_host.cc.
+//
+// There's no browser to run the callbacks of the main thread, so the program
+// does it by calling these.
+namespace ppapi_host {
+
+// Runs the callbacks posted to the main thread until there are none left,
+// including the ones they post. Delayed callbacks don't wait: they run in
+// the order they're due once nothing else is, the simulated time jumping to
+// when they're due. Returns the number run.
+size_t RunUntilIdle();
+
+// Runs the callbacks already due. Returns the number run.
+size_t RunReadyCallbacks();
+
+// Runs the callbacks due within the next |seconds| as they get due, waiting
+// for them unless the time is simulated. Returns the number run.
+size_t RunFor(double seconds);
+
+// From now on the time of pp::Core starts from the current time but only
+// moves in RunFor() and RunUntilIdle(), jumping to when the next callback is
+// due, so that a session runs in the CPU time it takes. Call before anything
+// is posted.
+void UseSimulatedTime();
+
+// One-way delay of the datagrams between the UDPSockets, 0 by default.
+void SetNetworkDelay(double seconds);
+
+// Makes the UDPSockets created while in scope belong to the host |address|,
+// e.g. "10.0.0.2": bound to 0.0.0.0 they only get the datagrams sent to it,
+// and send from it. Lets several programs listen on the same port, as on
+// different machines. Outside any scope, sockets bound to 0.0.0.0 get the
+// datagrams sent to any host, and send from 127.0.0.1.
+class ScopedHost {
+ public:
+  explicit ScopedHost(const char* address);
+  ~ScopedHost();
+
+ private:
+  const uint32_t previous_;
+};
+
+// Limits the datagrams to the host |address| to |bytes_per_second|, like the
+// last hop of a receiver on a constrained link: they are queued in order, and
+// those arriving when more than |queue_seconds| of them wait are dropped.
+// A rate of 0 removes the limit.
+void SetLinkRate(const char* address, double bytes_per_second,
+                 double queue_seconds);
+
+// Charges the CPU time of the main thread to |account| while in scope, and
+// that of the callbacks posted meanwhile whenever they run, and so on, so
+// that the work of objects created under different accounts can be told
+// apart. A UDPSocket charges the datagrams it receives to the account it was
+// created under. The time outside any scope goes to account 0.
+class ScopedCpuAccount {
+ public:
+  explicit ScopedCpuAccount(int account);
+  ~ScopedCpuAccount();
+
+ private:
+  const int previous_;
+};
+
+// Seconds of CPU time charged to |account| so far.
+double CpuSeconds(int account);
+
+// Called with the messages posted by any instance. They're dropped by
+// default.
+void SetMessageHandler(const std::function<void(const pp::Var&)>& handler);
+
+}  // namespace ppapi_host
+
+#endif  // HOST_PPAPI_HOST_H_
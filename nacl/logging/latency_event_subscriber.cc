@@ -0,0 +1,197 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "logging/latency_event_subscriber.h"
+
+#include "base/logger.h"
+
+#include <iomanip>
+
+namespace sharer {
+
+namespace {
+
+LatencyEventSubscriber::Stage StageForFrameEvent(SharerLoggingEvent type) {
+  switch (type) {
+    case FRAME_CAPTURE_END:
+      return LatencyEventSubscriber::CAPTURE;
+    case FRAME_ENCODE_BEGIN:
+      return LatencyEventSubscriber::ENCODE_BEGIN;
+    case FRAME_ENCODED:
+      return LatencyEventSubscriber::ENCODED;
+    case FRAME_PACKETIZED:
+      return LatencyEventSubscriber::PACKETIZED;
+    case FRAME_COMPLETE:
+      return LatencyEventSubscriber::COMPLETE;
+    case FRAME_DECODE_BEGIN:
+      return LatencyEventSubscriber::DECODE_BEGIN;
+    case FRAME_DECODED:
+      return LatencyEventSubscriber::DECODED;
+    case FRAME_PLAYOUT:
+      return LatencyEventSubscriber::PLAYOUT;
+    default:
+      return LatencyEventSubscriber::kNumStages;
+  }
+}
+
+double InMillisecondsF(base::TimeDelta delta) {
+  return delta.InMicroseconds() / 1000.0;
+}
+
+}  // namespace
+
+LatencyEventSubscriber::Frame::Frame(uint32_t ssrc, RtpTimestamp rtp_timestamp)
+    : ssrc(ssrc),
+      rtp_timestamp(rtp_timestamp),
+      packets_sent(0),
+      packets_received(0) {}
+
+LatencyEventSubscriber::LatencyEventSubscriber(uint32_t ssrc)
+    : ssrc_(ssrc), last_stage_(CAPTURE) {}
+
+LatencyEventSubscriber::~LatencyEventSubscriber() {}
+
+void LatencyEventSubscriber::OnReceiveFrameEvent(
+    const FrameEvent& frame_event) {
+  if (frame_event.media_type != VIDEO_EVENT) return;
+
+  const Stage stage = StageForFrameEvent(frame_event.type);
+  if (stage == kNumStages) return;
+
+  Frame* frame = GetFrame(frame_event.ssrc, frame_event.rtp_timestamp);
+  if (frame) RecordStage(frame, stage, frame_event.timestamp);
+}
+
+void LatencyEventSubscriber::OnReceivePacketEvent(
+    const PacketEvent& packet_event) {
+  if (packet_event.media_type != VIDEO_EVENT) return;
+  if (packet_event.type != PACKET_SENT_TO_NETWORK &&
+      packet_event.type != PACKET_RECEIVED) {
+    return;
+  }
+
+  Frame* frame = GetFrame(packet_event.ssrc, packet_event.rtp_timestamp);
+  if (!frame) return;
+
+  // Retransmissions are logged as such, and duplicates are not logged, so
+  // the frame is on its way once every packet has been seen once.
+  const int num_packets = packet_event.max_packet_id + 1;
+  if (packet_event.type == PACKET_SENT_TO_NETWORK) {
+    RecordStage(frame, FIRST_PACKET_SENT, packet_event.timestamp);
+    if (++frame->packets_sent == num_packets)
+      RecordStage(frame, LAST_PACKET_SENT, packet_event.timestamp);
+  } else {
+    RecordStage(frame, FIRST_PACKET_RECEIVED, packet_event.timestamp);
+    if (++frame->packets_received == num_packets)
+      RecordStage(frame, LAST_PACKET_RECEIVED, packet_event.timestamp);
+  }
+}
+
+LatencyEventSubscriber::Frame* LatencyEventSubscriber::GetFrame(
+    uint32_t ssrc, RtpTimestamp rtp_timestamp) {
+  if (ssrc_ && ssrc && ssrc != ssrc_) return nullptr;
+
+  // Events mostly concern the latest frames.
+  for (auto it = frames_.rbegin(); it != frames_.rend(); ++it) {
+    if (it->rtp_timestamp != rtp_timestamp) continue;
+    if (!it->ssrc) it->ssrc = ssrc;
+    if (!ssrc || it->ssrc == ssrc) return &*it;
+  }
+
+  frames_.emplace_back(ssrc, rtp_timestamp);
+  if (frames_.size() > kMaxTrackedFrames) {
+    AddToHistograms(frames_.front());
+    frames_.pop_front();
+  }
+  return &frames_.back();
+}
+
+void LatencyEventSubscriber::RecordStage(Frame* frame, Stage stage,
+                                         base::TimeTicks time) {
+  // Only the first time counts, e.g. not the GOP sent again to a new
+  // receiver.
+  if (!frame->times[stage].is_null()) return;
+
+  frame->times[stage] = time;
+  if (stage > last_stage_) last_stage_ = stage;
+}
+
+void LatencyEventSubscriber::AddToHistograms(const Frame& frame) {
+  base::TimeTicks previous;
+  for (int stage = 0; stage < kNumStages; stage++) {
+    if (frame.times[stage].is_null()) continue;
+    if (!previous.is_null())
+      stage_latencies_[stage].Add(frame.times[stage] - previous);
+    previous = frame.times[stage];
+  }
+
+  // Frames that didn't go all the way, e.g. dropped as late, are not part of
+  // the end to end latency.
+  if (last_stage_ != CAPTURE && !frame.times[CAPTURE].is_null() &&
+      !frame.times[last_stage_].is_null()) {
+    total_latency_.Add(frame.times[last_stage_] - frame.times[CAPTURE]);
+  }
+}
+
+void LatencyEventSubscriber::PrintAndReset() {
+  for (int stage = 0; stage < kNumStages; stage++) {
+    LatencyHistogram& histogram = stage_latencies_[stage];
+    if (!histogram.count()) continue;
+
+    INF() << "Latency to " << StageToString(static_cast<Stage>(stage))
+          << ": " << std::fixed << std::setprecision(1)
+          << "p50 " << InMillisecondsF(histogram.Percentile(50)) << " ms, "
+          << "p99 " << InMillisecondsF(histogram.Percentile(99)) << " ms, "
+          << "max " << InMillisecondsF(histogram.max()) << " ms ("
+          << histogram.count() << " frames)";
+    histogram.Reset();
+  }
+
+  if (total_latency_.count()) {
+    INF() << "Latency from capture to " << StageToString(last_stage_) << ": "
+          << std::fixed << std::setprecision(1)
+          << "p50 " << InMillisecondsF(total_latency_.Percentile(50))
+          << " ms, "
+          << "p99 " << InMillisecondsF(total_latency_.Percentile(99))
+          << " ms, "
+          << "max " << InMillisecondsF(total_latency_.max()) << " ms ("
+          << total_latency_.count() << " frames)";
+    total_latency_.Reset();
+  }
+}
+
+// static
+const char* LatencyEventSubscriber::StageToString(Stage stage) {
+  switch (stage) {
+    case CAPTURE:
+      return "capture";
+    case ENCODE_BEGIN:
+      return "encode begin";
+    case ENCODED:
+      return "encoded";
+    case PACKETIZED:
+      return "packetized";
+    case FIRST_PACKET_SENT:
+      return "first packet sent";
+    case LAST_PACKET_SENT:
+      return "last packet sent";
+    case FIRST_PACKET_RECEIVED:
+      return "first packet received";
+    case LAST_PACKET_RECEIVED:
+      return "last packet received";
+    case COMPLETE:
+      return "complete";
+    case DECODE_BEGIN:
+      return "decode begin";
+    case DECODED:
+      return "decoded";
+    case PLAYOUT:
+      return "playout";
+    case kNumStages:
+      break;
+  }
+  return "";
+}
+
+}  // namespace sharer
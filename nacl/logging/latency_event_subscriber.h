@@ -0,0 +1,95 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LOGGING_LATENCY_EVENT_SUBSCRIBER_H_
+#define LOGGING_LATENCY_EVENT_SUBSCRIBER_H_
+
+#include <array>
+#include <deque>
+
+#include "base/macros.h"
+#include "logging/latency_histogram.h"
+#include "logging/raw_event_subscriber.h"
+
+namespace sharer {
+
+// RawEventSubscriber that follows each video frame through the stages of the
+// pipeline, from capture to playout, and records the time taken by each
+// stage in a LatencyHistogram.
+//
+// The sender sees the stages up to the last packet sent, the receiver the
+// stages from the first packet received. The receiver also gets the capture
+// time of each frame, from the sender's clock mapped to its own through the
+// RTCP sender reports, so that its end to end latency includes the sender.
+class LatencyEventSubscriber : public RawEventSubscriber {
+ public:
+  enum Stage {
+    CAPTURE,
+    ENCODE_BEGIN,
+    ENCODED,
+    PACKETIZED,
+    FIRST_PACKET_SENT,
+    LAST_PACKET_SENT,
+    FIRST_PACKET_RECEIVED,
+    LAST_PACKET_RECEIVED,
+    COMPLETE,
+    DECODE_BEGIN,
+    DECODED,
+    PLAYOUT,
+    kNumStages
+  };
+
+  // Frames are added to the histograms when they leave this window, so that
+  // late events, e.g. the capture time on the receiver, still count.
+  static const size_t kMaxTrackedFrames = 64;
+
+  // Follows the frames of |ssrc| only, or of any stream if 0.
+  explicit LatencyEventSubscriber(uint32_t ssrc);
+  ~LatencyEventSubscriber() final;
+
+  // RawEventSubscriber implementations.
+  void OnReceiveFrameEvent(const FrameEvent& frame_event) final;
+  void OnReceivePacketEvent(const PacketEvent& packet_event) final;
+
+  // Time from the previous stage the frames went through to |stage|.
+  const LatencyHistogram& stage_latency(Stage stage) const {
+    return stage_latencies_[stage];
+  }
+  // Time from capture to the last stage seen, e.g. playout on the receiver.
+  const LatencyHistogram& total_latency() const { return total_latency_; }
+
+  // Logs the percentiles of every stage, and starts over.
+  void PrintAndReset();
+
+  static const char* StageToString(Stage stage);
+
+ private:
+  struct Frame {
+    Frame(uint32_t ssrc, RtpTimestamp rtp_timestamp);
+
+    uint32_t ssrc;
+    RtpTimestamp rtp_timestamp;
+    std::array<base::TimeTicks, kNumStages> times;
+    int packets_sent;
+    int packets_received;
+  };
+
+  // Events without SSRC match the frame of any stream.
+  Frame* GetFrame(uint32_t ssrc, RtpTimestamp rtp_timestamp);
+  void RecordStage(Frame* frame, Stage stage, base::TimeTicks time);
+  void AddToHistograms(const Frame& frame);
+
+  const uint32_t ssrc_;
+  std::deque<Frame> frames_;
+  Stage last_stage_;
+
+  std::array<LatencyHistogram, kNumStages> stage_latencies_;
+  LatencyHistogram total_latency_;
+
+  DISALLOW_COPY_AND_ASSIGN(LatencyEventSubscriber);
+};
+
+}  // namespace sharer
+
+#endif  // LOGGING_LATENCY_EVENT_SUBSCRIBER_H_
@@ -0,0 +1,68 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "logging/latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sharer {
+
+LatencyHistogram::LatencyHistogram() { Reset(); }
+
+LatencyHistogram::~LatencyHistogram() {}
+
+void LatencyHistogram::Add(base::TimeDelta value) {
+  const int64_t value_us = std::min(std::max<int64_t>(value.InMicroseconds(), 0),
+                                    (int64_t(1) << kMaxValueBits) - 1);
+  buckets_[BucketForValue(value_us)]++;
+  count_++;
+  max_us_ = std::max(max_us_, value_us);
+}
+
+void LatencyHistogram::Reset() {
+  buckets_.fill(0);
+  count_ = 0;
+  max_us_ = 0;
+}
+
+base::TimeDelta LatencyHistogram::Percentile(double percentile) const {
+  if (!count_) return base::TimeDelta();
+
+  const int64_t rank = std::max<int64_t>(
+      1, static_cast<int64_t>(std::ceil(count_ * percentile / 100.0)));
+  int64_t seen = 0;
+  for (int bucket = 0; bucket < kNumBuckets; bucket++) {
+    seen += buckets_[bucket];
+    if (seen >= rank) {
+      return base::TimeDelta::FromMicroseconds(
+          std::min(ValueForBucket(bucket), max_us_));
+    }
+  }
+  return max();
+}
+
+// Values below 2 * kSubBuckets have a bucket each. Above, the kSubBucketBits
+// bits below the most significant one pick one of the kSubBuckets buckets of
+// its power of two.
+// static
+int LatencyHistogram::BucketForValue(int64_t value_us) {
+  if (value_us < 2 * kSubBuckets) return static_cast<int>(value_us);
+
+  const int msb = 63 - __builtin_clzll(static_cast<uint64_t>(value_us));
+  const int shift = msb - kSubBucketBits;
+  return shift * kSubBuckets + static_cast<int>(value_us >> shift);
+}
+
+// static
+int64_t LatencyHistogram::ValueForBucket(int bucket) {
+  if (bucket < 2 * kSubBuckets) return bucket;
+
+  const int shift = bucket / kSubBuckets - 1;
+  const int64_t lower = int64_t(bucket % kSubBuckets + kSubBuckets) << shift;
+  // Middle of the bucket.
+  return lower + ((int64_t(1) << shift) - 1) / 2;
+}
+
+}  // namespace sharer
@@ -0,0 +1,60 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LOGGING_LATENCY_HISTOGRAM_H_
+#define LOGGING_LATENCY_HISTOGRAM_H_
+
+#include <stdint.h>
+
+#include <array>
+
+#include "base/macros.h"
+#include "base/time/time.h"
+
+namespace sharer {
+
+// Histogram of durations with log-linear buckets, like HdrHistogram: every
+// power of two is split into kSubBuckets buckets, so percentiles are within
+// 1 / kSubBuckets of the recorded values at any scale, from microseconds to
+// minutes, in a fixed amount of memory.
+class LatencyHistogram {
+ public:
+  static const int kSubBucketBits = 4;
+  static const int kSubBuckets = 1 << kSubBucketBits;
+  // Durations are recorded in microseconds, up to about 71 minutes.
+  static const int kMaxValueBits = 32;
+  static const int kNumBuckets =
+      (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets;
+
+  LatencyHistogram();
+  ~LatencyHistogram();
+
+  // Negative durations, e.g. from the sender and receiver clocks being
+  // slightly out of sync, are counted as zero.
+  void Add(base::TimeDelta value);
+  void Reset();
+
+  int64_t count() const { return count_; }
+  base::TimeDelta max() const {
+    return base::TimeDelta::FromMicroseconds(max_us_);
+  }
+
+  // Smallest recorded duration that |percentile| percent of the values are
+  // no greater than, give or take the bucket width. Zero if empty.
+  base::TimeDelta Percentile(double percentile) const;
+
+ private:
+  static int BucketForValue(int64_t value_us);
+  static int64_t ValueForBucket(int bucket);
+
+  std::array<int64_t, kNumBuckets> buckets_;
+  int64_t count_;
+  int64_t max_us_;
+
+  DISALLOW_COPY_AND_ASSIGN(LatencyHistogram);
+};
+
+}  // namespace sharer
+
+#endif  // LOGGING_LATENCY_HISTOGRAM_H_
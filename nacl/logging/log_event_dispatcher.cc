@@ -12,46 +12,39 @@
 
 namespace sharer {
 
-LogEventDispatcher::LogEventDispatcher() : impl_() {}
+namespace {
+
+// About a second of packets at the pacer's highest rate, and of frames at
+// 60 fps for a few simulcast layers.
+const size_t kPacketEventRingSize = 2048;
+const size_t kFrameEventRingSize = 256;
+
+}  // namespace
+
+const int64_t LogEventDispatcher::kDispatchIntervalMs;
+
+LogEventDispatcher::LogEventDispatcher()
+    : impl_(),
+      frame_events_(kFrameEventRingSize),
+      packet_events_(kPacketEventRingSize),
+      dropped_events_(0),
+      dispatch_posted_(false),
+      reported_dropped_events_(0),
+      factory_(this) {
+  frame_batch_.reserve(frame_events_.capacity());
+  packet_batch_.reserve(packet_events_.capacity());
+}
 
 LogEventDispatcher::~LogEventDispatcher() {}
 
-void LogEventDispatcher::DispatchFrameEvent(
-    std::unique_ptr<FrameEvent> event) const {
-  if (pp::Module::Get()->core()->IsMainThread()) {
-    impl_.DispatchFrameEvent(std::move(event));
-  } else {
-    // TODO: This is how dispatching event from a different thread was done in
-    // original Chromecast code. So far we don't support it, but leave this
-    // commented code as a reference for the future.
-    //
-    // env_->PostTask(CastEnvironment::MAIN, FROM_HERE,
-    //                std::bind(&LogEventDispatcher::Impl::DispatchFrameEvent,
-    //                           impl_, base::Passed(&event)));
-    ERR() << "Only supported on main thread.";
-  }
-}
-
-void LogEventDispatcher::DispatchPacketEvent(
-    std::unique_ptr<PacketEvent> event) const {
-  if (pp::Module::Get()->core()->IsMainThread()) {
-    impl_.DispatchPacketEvent(std::move(event));
-  } else {
-    // TODO: Add support to call this from other threads.
-    ERR() << "Only supported on main thread.";
-  }
+void LogEventDispatcher::DispatchFrameEvent(const FrameEvent& event) {
+  if (!frame_events_.Push(event)) OnEventDropped();
+  ScheduleDispatch();
 }
 
-void LogEventDispatcher::DispatchBatchOfEvents(
-    std::unique_ptr<std::vector<FrameEvent>> frame_events,
-    std::unique_ptr<std::vector<PacketEvent>> packet_events) const {
-  if (pp::Module::Get()->core()->IsMainThread()) {
-    impl_.DispatchBatchOfEvents(std::move(frame_events),
-                                std::move(packet_events));
-  } else {
-    // TODO: Add support to call this from other threads.
-    ERR() << "Only supported on main thread.";
-  }
+void LogEventDispatcher::DispatchPacketEvent(const PacketEvent& event) {
+  if (!packet_events_.Push(event)) OnEventDropped();
+  ScheduleDispatch();
 }
 
 void LogEventDispatcher::Subscribe(RawEventSubscriber* subscriber) {
@@ -72,26 +65,56 @@ void LogEventDispatcher::Unsubscribe(RawEventSubscriber* subscriber) {
   }
 }
 
-LogEventDispatcher::Impl::Impl() {}
+void LogEventDispatcher::OnEventDropped() {
+  dropped_events_.fetch_add(1, std::memory_order_relaxed);
+}
 
-LogEventDispatcher::Impl::~Impl() { PP_DCHECK(subscribers_.empty()); }
+void LogEventDispatcher::ScheduleDispatch() {
+  if (dispatch_posted_.load(std::memory_order_relaxed) ||
+      dispatch_posted_.exchange(true)) {
+    return;
+  }
 
-void LogEventDispatcher::Impl::DispatchFrameEvent(
-    std::unique_ptr<FrameEvent> event) const {
-  for (RawEventSubscriber* s : subscribers_) s->OnReceiveFrameEvent(*event);
+  auto cc = factory_.NewCallback(&LogEventDispatcher::DispatchQueuedEvents);
+  pp::Module::Get()->core()->CallOnMainThread(kDispatchIntervalMs, cc);
 }
 
-void LogEventDispatcher::Impl::DispatchPacketEvent(
-    std::unique_ptr<PacketEvent> event) const {
-  for (RawEventSubscriber* s : subscribers_) s->OnReceivePacketEvent(*event);
+void LogEventDispatcher::DispatchQueuedEvents(int32_t result) {
+  // Clear the flag first: events logged from now on are either popped below
+  // or schedule another dispatch.
+  dispatch_posted_.store(false);
+  DispatchPendingEvents();
 }
 
+void LogEventDispatcher::DispatchPendingEvents() {
+  FrameEvent frame_event;
+  while (frame_events_.Pop(&frame_event)) frame_batch_.push_back(frame_event);
+  PacketEvent packet_event;
+  while (packet_events_.Pop(&packet_event))
+    packet_batch_.push_back(packet_event);
+
+  impl_.DispatchBatchOfEvents(frame_batch_, packet_batch_);
+  frame_batch_.clear();
+  packet_batch_.clear();
+
+  const uint64_t dropped = dropped_events_.load();
+  if (dropped != reported_dropped_events_) {
+    WRN() << "Event rings full, dropped "
+          << dropped - reported_dropped_events_ << " logging events.";
+    reported_dropped_events_ = dropped;
+  }
+}
+
+LogEventDispatcher::Impl::Impl() {}
+
+LogEventDispatcher::Impl::~Impl() { PP_DCHECK(subscribers_.empty()); }
+
 void LogEventDispatcher::Impl::DispatchBatchOfEvents(
-    std::unique_ptr<std::vector<FrameEvent>> frame_events,
-    std::unique_ptr<std::vector<PacketEvent>> packet_events) const {
+    const std::vector<FrameEvent>& frame_events,
+    const std::vector<PacketEvent>& packet_events) const {
   for (RawEventSubscriber* s : subscribers_) {
-    for (const FrameEvent& e : *frame_events) s->OnReceiveFrameEvent(e);
-    for (const PacketEvent& e : *packet_events) s->OnReceivePacketEvent(e);
+    for (const FrameEvent& e : frame_events) s->OnReceiveFrameEvent(e);
+    for (const PacketEvent& e : packet_events) s->OnReceivePacketEvent(e);
   }
 }
 
@@ -6,31 +6,37 @@
 #ifndef LOGGING_LOG_EVENT_DISPATCHER_H_
 #define LOGGING_LOG_EVENT_DISPATCHER_H_
 
+#include <atomic>
 #include <vector>
 
 #include "base/macros.h"
+#include "base/mpsc_ring.h"
 #include "logging/logging_defines.h"
 #include "raw_event_subscriber.h"
 
+#include "ppapi/utility/completion_callback_factory.h"
+
 namespace sharer {
 
-// A non-thread-safe receiver of logging events that manages an active list of
+// A receiver of logging events that manages an active list of
 // EventSubscribers and dispatches the logging events to them on the MAIN
-// thread. All methods, constructor, and destructor can be invoked on any
-// thread. Thread safety might be added in the future, so we keep the
-// implementation of the dispatcher inside the Impl class.
+// thread.
+//
+// Events can be logged from any thread. They are copied into lock-free rings,
+// without allocating nor blocking, and handed to the subscribers in batches
+// on the MAIN thread every kDispatchIntervalMs. Events logged while the rings
+// are full are dropped and counted.
 class LogEventDispatcher {
  public:
+  static const int64_t kDispatchIntervalMs = 20;
+
   explicit LogEventDispatcher();
 
   ~LogEventDispatcher();
 
-  // Events can only be dispatched from the MAIN thread.
-  void DispatchFrameEvent(std::unique_ptr<FrameEvent> event) const;
-  void DispatchPacketEvent(std::unique_ptr<PacketEvent> event) const;
-  void DispatchBatchOfEvents(
-      std::unique_ptr<std::vector<FrameEvent>> frame_events,
-      std::unique_ptr<std::vector<PacketEvent>> packet_events) const;
+  // Can be called from any thread.
+  void DispatchFrameEvent(const FrameEvent& event);
+  void DispatchPacketEvent(const PacketEvent& event);
 
   // Adds |subscriber| from the MAIN thread, to the active list to begin
   // receiving events on MAIN thread. Unsubscribe() must be called before
@@ -41,6 +47,13 @@ class LogEventDispatcher {
   // |subscriber| is guaranteed not to receive any more events.
   void Unsubscribe(RawEventSubscriber* subscriber);
 
+  // Hands the events queued so far to the subscribers without waiting for the
+  // next batch, e.g. before unsubscribing. MAIN thread only.
+  void DispatchPendingEvents();
+
+  // Events dropped because the rings were full, since creation.
+  uint64_t dropped_events() const { return dropped_events_.load(); }
+
  private:
   // The part of the implementation that runs exclusively on the MAIN thread.
   class Impl {
@@ -48,11 +61,9 @@ class LogEventDispatcher {
     Impl();
     ~Impl();
 
-    void DispatchFrameEvent(std::unique_ptr<FrameEvent> event) const;
-    void DispatchPacketEvent(std::unique_ptr<PacketEvent> event) const;
-    void DispatchBatchOfEvents(
-        std::unique_ptr<std::vector<FrameEvent>> frame_events,
-        std::unique_ptr<std::vector<PacketEvent>> packet_events) const;
+    void DispatchBatchOfEvents(const std::vector<FrameEvent>& frame_events,
+                               const std::vector<PacketEvent>& packet_events)
+        const;
     void Subscribe(RawEventSubscriber* subscriber);
     void Unsubscribe(RawEventSubscriber* subscriber);
 
@@ -62,8 +73,26 @@ class LogEventDispatcher {
     DISALLOW_COPY_AND_ASSIGN(Impl);
   };
 
+  void OnEventDropped();
+  void ScheduleDispatch();
+  void DispatchQueuedEvents(int32_t result);
+
   Impl impl_;
 
+  base::MpscRing<FrameEvent> frame_events_;
+  base::MpscRing<PacketEvent> packet_events_;
+  std::atomic<uint64_t> dropped_events_;
+  // Set while a DispatchQueuedEvents() task is pending.
+  std::atomic<bool> dispatch_posted_;
+
+  // Reused for every batch, MAIN thread only.
+  std::vector<FrameEvent> frame_batch_;
+  std::vector<PacketEvent> packet_batch_;
+  uint64_t reported_dropped_events_;
+
+  pp::CompletionCallbackFactory<LogEventDispatcher, pp::ThreadSafeThreadTraits>
+      factory_;
+
   DISALLOW_COPY_AND_ASSIGN(LogEventDispatcher);
 };
 
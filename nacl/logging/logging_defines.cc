@@ -18,22 +18,42 @@ const char* CastLoggingToString(SharerLoggingEvent event) {
     ENUM_TO_STRING(UNKNOWN);
     ENUM_TO_STRING(FRAME_CAPTURE_BEGIN);
     ENUM_TO_STRING(FRAME_CAPTURE_END);
+    ENUM_TO_STRING(FRAME_ENCODE_BEGIN);
     ENUM_TO_STRING(FRAME_ENCODED);
+    ENUM_TO_STRING(FRAME_PACKETIZED);
     ENUM_TO_STRING(FRAME_ACK_RECEIVED);
     ENUM_TO_STRING(FRAME_ACK_SENT);
+    ENUM_TO_STRING(FRAME_COMPLETE);
+    ENUM_TO_STRING(FRAME_DECODE_BEGIN);
     ENUM_TO_STRING(FRAME_DECODED);
     ENUM_TO_STRING(FRAME_PLAYOUT);
+    ENUM_TO_STRING(FRAME_DROPPED);
     ENUM_TO_STRING(PACKET_SENT_TO_NETWORK);
     ENUM_TO_STRING(PACKET_RETRANSMITTED);
     ENUM_TO_STRING(PACKET_RTX_REJECTED);
+    ENUM_TO_STRING(PACKET_NACK_RECEIVED);
+    ENUM_TO_STRING(PACKET_DROPPED);
     ENUM_TO_STRING(PACKET_RECEIVED);
   }
   PP_NOTREACHED();
   return "";
 }
 
+uint32_t ReceiverIdForAddress(const std::string& address) {
+  if (address.empty()) return 0;
+
+  // FNV-1a, never 0.
+  uint32_t hash = 2166136261u;
+  for (char c : address) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 16777619u;
+  }
+  return hash ? hash : 1;
+}
+
 FrameEvent::FrameEvent()
-    : rtp_timestamp(0u),
+    : ssrc(0u),
+      rtp_timestamp(0u),
       frame_id(kFrameIdUnknown),
       width(0),
       height(0),
@@ -47,11 +67,13 @@ FrameEvent::FrameEvent()
 FrameEvent::~FrameEvent() {}
 
 PacketEvent::PacketEvent()
-    : rtp_timestamp(0),
+    : ssrc(0),
+      rtp_timestamp(0),
       frame_id(kFrameIdUnknown),
       max_packet_id(0),
       packet_id(0),
       size(0),
+      receiver_id(0),
       type(UNKNOWN),
       media_type(UNKNOWN_EVENT) {}
 PacketEvent::~PacketEvent() {}
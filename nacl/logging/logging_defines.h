@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "base/time/time.h"
+#include "logging/logging_events.h"
 
 namespace sharer {
 
@@ -18,40 +19,17 @@ static const uint32_t kFrameIdUnknown = 0xFFFFFFFF;
 
 typedef uint32_t RtpTimestamp;
 
-enum SharerLoggingEvent {
-  UNKNOWN,
-  // Sender side frame events.
-  FRAME_CAPTURE_BEGIN,
-  FRAME_CAPTURE_END,
-  FRAME_ENCODED,
-  FRAME_ACK_RECEIVED,
-  // Receiver side frame events.
-  FRAME_ACK_SENT,
-  FRAME_DECODED,
-  FRAME_PLAYOUT,
-  // Sender side packet events.
-  PACKET_SENT_TO_NETWORK,
-  PACKET_RETRANSMITTED,
-  PACKET_RTX_REJECTED,
-  // Receiver side packet events.
-  PACKET_RECEIVED,
-  kNumOfLoggingEvents = PACKET_RECEIVED
-};
-
 const char* SharerLoggingToString(SharerLoggingEvent event);
 
-// SharerLoggingEvent are classified into one of three following types.
-enum EventMediaType {
-  AUDIO_EVENT,
-  VIDEO_EVENT,
-  UNKNOWN_EVENT,
-  EVENT_MEDIA_TYPE_LAST = UNKNOWN_EVENT
-};
+// Identifies the receiver at |address| in PacketEvents, 0 for multicast.
+uint32_t ReceiverIdForAddress(const std::string& address);
 
 struct FrameEvent {
   FrameEvent();
   ~FrameEvent();
 
+  // SSRC of the stream, 0 if unknown.
+  uint32_t ssrc;
   RtpTimestamp rtp_timestamp;
   uint32_t frame_id;
 
@@ -62,7 +40,8 @@ struct FrameEvent {
   // Size of encoded frame in bytes. Only set for FRAME_ENCODED event.
   size_t size;
 
-  // Time of event logged.
+  // Time of event logged. For receiver FRAME_CAPTURE_END events, the capture
+  // time on the sender, in the receiver's clock.
   base::TimeTicks timestamp;
 
   SharerLoggingEvent type;
@@ -92,12 +71,18 @@ struct PacketEvent {
   PacketEvent();
   ~PacketEvent();
 
+  // SSRC of the stream, 0 if unknown.
+  uint32_t ssrc;
   RtpTimestamp rtp_timestamp;
   uint32_t frame_id;
   uint16_t max_packet_id;
   uint16_t packet_id;
   size_t size;
 
+  // For sender events about a single receiver, e.g. retransmissions, a hash
+  // of its address, see ReceiverIdForAddress(). 0 otherwise.
+  uint32_t receiver_id;
+
   // Time of event logged.
   base::TimeTicks timestamp;
   SharerLoggingEvent type;
@@ -0,0 +1,54 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LOGGING_LOGGING_EVENTS_H_
+#define LOGGING_LOGGING_EVENTS_H_
+
+// Kept free of ppapi and base dependencies, so that host tools reading
+// recorded events can use them, see trace_format.h.
+
+namespace sharer {
+
+enum SharerLoggingEvent {
+  UNKNOWN,
+  // Sender side frame events.
+  FRAME_CAPTURE_BEGIN,
+  FRAME_CAPTURE_END,
+  FRAME_ENCODE_BEGIN,
+  FRAME_ENCODED,
+  FRAME_PACKETIZED,
+  FRAME_ACK_RECEIVED,
+  // Receiver side frame events.
+  FRAME_ACK_SENT,
+  FRAME_COMPLETE,
+  FRAME_DECODE_BEGIN,
+  FRAME_DECODED,
+  FRAME_PLAYOUT,
+  // Skipped because it was too late to play.
+  FRAME_DROPPED,
+  // Sender side packet events.
+  PACKET_SENT_TO_NETWORK,
+  PACKET_RETRANSMITTED,
+  PACKET_RTX_REJECTED,
+  // A receiver asked for the packet again.
+  PACKET_NACK_RECEIVED,
+  // Discarded from the send queue without being sent.
+  PACKET_DROPPED,
+  // Receiver side packet events.
+  PACKET_RECEIVED,
+  kNumOfLoggingEvents = PACKET_RECEIVED
+};
+
+// SharerLoggingEvent are classified into one of three following types.
+enum EventMediaType {
+  AUDIO_EVENT,
+  VIDEO_EVENT,
+  UNKNOWN_EVENT,
+  EVENT_MEDIA_TYPE_LAST = UNKNOWN_EVENT
+};
+
+}  // namespace sharer
+
+#endif  // LOGGING_LOGGING_EVENTS_H_
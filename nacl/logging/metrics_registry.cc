@@ -0,0 +1,265 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "logging/metrics_registry.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "base/ptr_utils.h"
+
+namespace sharer {
+
+namespace {
+
+// Prometheus label values escape backslashes, quotes and newlines.
+void AppendLabelValue(const std::string& value, std::string* out) {
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if (c == '\n') {
+      out->append("\\n");
+    } else {
+      out->push_back(c);
+    }
+  }
+}
+
+// |le| is appended to |labels|, for histogram buckets, unless empty.
+void AppendLabels(const MetricLabels& labels, const std::string& le,
+                  std::string* out) {
+  if (labels.empty() && le.empty()) return;
+
+  out->push_back('{');
+  for (size_t i = 0; i < labels.size(); i++) {
+    if (i) out->push_back(',');
+    out->append(labels[i].first);
+    out->append("=\"");
+    AppendLabelValue(labels[i].second, out);
+    out->push_back('"');
+  }
+  if (!le.empty()) {
+    if (!labels.empty()) out->push_back(',');
+    out->append("le=\"");
+    out->append(le);
+    out->push_back('"');
+  }
+  out->push_back('}');
+}
+
+void AppendValue(double value, std::string* out) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), " %.15g\n", value);
+  out->append(buffer);
+}
+
+}  // namespace
+
+const char* MetricTypeToString(MetricType type) {
+  switch (type) {
+    case MetricType::COUNTER:
+      return "counter";
+    case MetricType::GAUGE:
+      return "gauge";
+    case MetricType::HISTOGRAM:
+      return "histogram";
+  }
+  return "untyped";
+}
+
+MetricHistogram::MetricHistogram(const std::vector<int64_t>& bounds)
+    : bounds_(bounds),
+      buckets_(new std::atomic<int64_t>[bounds.size() + 1]),
+      sum_(0) {
+  for (size_t i = 0; i <= bounds_.size(); i++) buckets_[i].store(0);
+}
+
+MetricHistogram::~MetricHistogram() {}
+
+void MetricHistogram::Add(int64_t value) {
+  const size_t bucket =
+      std::lower_bound(bounds_.begin(), bounds_.end(), value) -
+      bounds_.begin();
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+}
+
+std::vector<int64_t> MetricHistogram::BucketCounts() const {
+  std::vector<int64_t> counts(bounds_.size() + 1);
+  for (size_t i = 0; i < counts.size(); i++)
+    counts[i] = buckets_[i].load(std::memory_order_relaxed);
+  return counts;
+}
+
+MetricsSnapshot::Sample::Sample() : value(0), sum(0) {}
+MetricsSnapshot::Sample::~Sample() {}
+
+MetricsSnapshot::Family::Family() : type(MetricType::GAUGE) {}
+MetricsSnapshot::Family::~Family() {}
+
+MetricsSnapshot::MetricsSnapshot() {}
+MetricsSnapshot::~MetricsSnapshot() {}
+
+void MetricsSnapshot::AddGauge(const std::string& name,
+                               const std::string& help,
+                               const MetricLabels& labels, double value) {
+  Family& family = families[name];
+  if (family.samples.empty()) {
+    family.type = MetricType::GAUGE;
+    family.help = help;
+  }
+  Sample sample;
+  sample.labels = labels;
+  sample.value = value;
+  family.samples.push_back(sample);
+}
+
+std::string MetricsToPrometheusText(const MetricsSnapshot& snapshot) {
+  std::string out;
+  for (const auto& entry : snapshot.families) {
+    const std::string& name = entry.first;
+    const MetricsSnapshot::Family& family = entry.second;
+    out.append("# HELP " + name + " " + family.help + "\n");
+    out.append("# TYPE " + name + " " + MetricTypeToString(family.type) +
+               "\n");
+
+    for (const auto& sample : family.samples) {
+      if (family.type != MetricType::HISTOGRAM) {
+        out.append(name);
+        AppendLabels(sample.labels, std::string(), &out);
+        AppendValue(sample.value, &out);
+        continue;
+      }
+
+      // Prometheus buckets are cumulative.
+      int64_t count = 0;
+      for (size_t i = 0; i < sample.buckets.size(); i++) {
+        count += sample.buckets[i];
+        const std::string le = i < family.bounds.size()
+                                   ? std::to_string(family.bounds[i])
+                                   : std::string("+Inf");
+        out.append(name + "_bucket");
+        AppendLabels(sample.labels, le, &out);
+        AppendValue(count, &out);
+      }
+      out.append(name + "_sum");
+      AppendLabels(sample.labels, std::string(), &out);
+      AppendValue(sample.sum, &out);
+      out.append(name + "_count");
+      AppendLabels(sample.labels, std::string(), &out);
+      AppendValue(count, &out);
+    }
+  }
+  return out;
+}
+
+MetricsRegistry::Metric::Metric() : type(MetricType::GAUGE) {}
+MetricsRegistry::Metric::~Metric() {}
+
+MetricsRegistry::MetricsRegistry() : next_collector_id_(0) {}
+
+MetricsRegistry::~MetricsRegistry() {}
+
+MetricCounter* MetricsRegistry::Counter(const std::string& name,
+                                        const std::string& help,
+                                        const MetricLabels& labels) {
+  Metric* metric = GetMetric(name, help, labels, MetricType::COUNTER);
+  if (!metric) return nullptr;
+  if (!metric->counter) metric->counter = make_unique<MetricCounter>();
+  return metric->counter.get();
+}
+
+MetricGauge* MetricsRegistry::Gauge(const std::string& name,
+                                    const std::string& help,
+                                    const MetricLabels& labels) {
+  Metric* metric = GetMetric(name, help, labels, MetricType::GAUGE);
+  if (!metric) return nullptr;
+  if (!metric->gauge) metric->gauge = make_unique<MetricGauge>();
+  return metric->gauge.get();
+}
+
+MetricHistogram* MetricsRegistry::Histogram(const std::string& name,
+                                            const std::string& help,
+                                            const std::vector<int64_t>& bounds,
+                                            const MetricLabels& labels) {
+  Metric* metric = GetMetric(name, help, labels, MetricType::HISTOGRAM);
+  if (!metric) return nullptr;
+  if (!metric->histogram)
+    metric->histogram = make_unique<MetricHistogram>(bounds);
+  return metric->histogram.get();
+}
+
+int MetricsRegistry::AddCollector(const CollectCb& cb) {
+  const int id = next_collector_id_++;
+  collectors_[id] = cb;
+  return id;
+}
+
+void MetricsRegistry::RemoveCollector(int id) { collectors_.erase(id); }
+
+void MetricsRegistry::Snapshot(const MetricLabels& labels,
+                               MetricsSnapshot* snapshot) const {
+  MetricsSnapshot own;
+  for (const auto& entry : metrics_) {
+    const Metric& metric = *entry.second;
+    MetricsSnapshot::Family& family = own.families[metric.name];
+    family.type = metric.type;
+    family.help = metric.help;
+
+    MetricsSnapshot::Sample sample;
+    sample.labels = metric.labels;
+    switch (metric.type) {
+      case MetricType::COUNTER:
+        sample.value = metric.counter->value();
+        break;
+      case MetricType::GAUGE:
+        sample.value = metric.gauge->value();
+        break;
+      case MetricType::HISTOGRAM:
+        family.bounds = metric.histogram->bounds();
+        sample.buckets = metric.histogram->BucketCounts();
+        sample.sum = metric.histogram->sum();
+        break;
+    }
+    family.samples.push_back(sample);
+  }
+  for (const auto& collector : collectors_) collector.second(&own);
+
+  for (auto& entry : own.families) {
+    MetricsSnapshot::Family& family = snapshot->families[entry.first];
+    if (family.samples.empty()) {
+      family.type = entry.second.type;
+      family.help = entry.second.help;
+      family.bounds = entry.second.bounds;
+    } else if (family.type != entry.second.type ||
+               family.bounds != entry.second.bounds) {
+      // Can't be exported under the same name.
+      continue;
+    }
+    for (auto& sample : entry.second.samples) {
+      sample.labels.insert(sample.labels.begin(), labels.begin(),
+                           labels.end());
+      family.samples.push_back(std::move(sample));
+    }
+  }
+}
+
+MetricsRegistry::Metric* MetricsRegistry::GetMetric(const std::string& name,
+                                                    const std::string& help,
+                                                    const MetricLabels& labels,
+                                                    MetricType type) {
+  std::unique_ptr<Metric>& metric = metrics_[std::make_pair(name, labels)];
+  if (!metric) {
+    metric = make_unique<Metric>();
+    metric->name = name;
+    metric->labels = labels;
+    metric->type = type;
+    metric->help = help;
+  }
+  return metric->type == type ? metric.get() : nullptr;
+}
+
+}  // namespace sharer
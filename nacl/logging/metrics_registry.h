@@ -0,0 +1,185 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LOGGING_METRICS_REGISTRY_H_
+#define LOGGING_METRICS_REGISTRY_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/macros.h"
+
+namespace sharer {
+
+// Labels of a metric, e.g. {{"ssrc", "11"}}.
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+enum class MetricType { COUNTER, GAUGE, HISTOGRAM };
+
+// "counter", "gauge" or "histogram".
+const char* MetricTypeToString(MetricType type);
+
+// Count of events since creation. Can be incremented from any thread.
+class MetricCounter {
+ public:
+  MetricCounter() : value_(0) {}
+
+  void Increment(int64_t count = 1) {
+    value_.fetch_add(count, std::memory_order_relaxed);
+  }
+  int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_;
+
+  DISALLOW_COPY_AND_ASSIGN(MetricCounter);
+};
+
+// Current value of something. Can be set from any thread.
+class MetricGauge {
+ public:
+  MetricGauge() : value_(0) {}
+
+  void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_;
+
+  DISALLOW_COPY_AND_ASSIGN(MetricGauge);
+};
+
+// Distribution of values over fixed buckets. Can be updated from any thread.
+class MetricHistogram {
+ public:
+  // |bounds| are the inclusive upper bounds of the buckets, in increasing
+  // order. Larger values go to one more bucket.
+  explicit MetricHistogram(const std::vector<int64_t>& bounds);
+  ~MetricHistogram();
+
+  void Add(int64_t value);
+
+  const std::vector<int64_t>& bounds() const { return bounds_; }
+  // Count of each bucket, the last one being the overflow bucket.
+  std::vector<int64_t> BucketCounts() const;
+  int64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+
+ private:
+  const std::vector<int64_t> bounds_;
+  std::unique_ptr<std::atomic<int64_t>[]> buckets_;
+  std::atomic<int64_t> sum_;
+
+  DISALLOW_COPY_AND_ASSIGN(MetricHistogram);
+};
+
+// Values of all metrics at one point in time, grouped by name.
+struct MetricsSnapshot {
+  struct Sample {
+    Sample();
+    ~Sample();
+
+    MetricLabels labels;
+    // Counters and gauges.
+    double value;
+    // Histograms, see MetricHistogram.
+    std::vector<int64_t> buckets;
+    double sum;
+  };
+
+  struct Family {
+    Family();
+    ~Family();
+
+    MetricType type;
+    std::string help;
+    // Histograms only.
+    std::vector<int64_t> bounds;
+    std::vector<Sample> samples;
+  };
+
+  MetricsSnapshot();
+  ~MetricsSnapshot();
+
+  // For MetricsRegistry collectors.
+  void AddGauge(const std::string& name, const std::string& help,
+                const MetricLabels& labels, double value);
+
+  std::map<std::string, Family> families;
+};
+
+// Prometheus text exposition format, version 0.0.4.
+std::string MetricsToPrometheusText(const MetricsSnapshot& snapshot);
+
+// Metrics of the components of a SharerEnvironment.
+//
+// Components get their metrics once, when created, and update them as they
+// go: that is a relaxed atomic operation, so it is cheap enough for the
+// packet path and can be done from any thread. Values that are already kept
+// somewhere, e.g. queue lengths, are read by collectors instead, only when a
+// snapshot is taken.
+//
+// Creating metrics, adding collectors and taking snapshots must happen on
+// the MAIN thread.
+class MetricsRegistry {
+ public:
+  using CollectCb = std::function<void(MetricsSnapshot* snapshot)>;
+
+  MetricsRegistry();
+  ~MetricsRegistry();
+
+  // Metrics live as long as the registry. Asking again for the same name and
+  // labels returns the same metric, or null if it is of another type.
+  MetricCounter* Counter(const std::string& name, const std::string& help,
+                         const MetricLabels& labels = MetricLabels());
+  MetricGauge* Gauge(const std::string& name, const std::string& help,
+                     const MetricLabels& labels = MetricLabels());
+  MetricHistogram* Histogram(const std::string& name, const std::string& help,
+                             const std::vector<int64_t>& bounds,
+                             const MetricLabels& labels = MetricLabels());
+
+  // |cb| is run on each snapshot until removed with the returned id.
+  int AddCollector(const CollectCb& cb);
+  void RemoveCollector(int id);
+
+  // Adds the metrics to |snapshot|, with |labels| in front of their own, so
+  // that the registries of several senders can be told apart.
+  void Snapshot(const MetricLabels& labels, MetricsSnapshot* snapshot) const;
+
+ private:
+  struct Metric {
+    Metric();
+    ~Metric();
+
+    std::string name;
+    MetricLabels labels;
+    MetricType type;
+    std::string help;
+    std::unique_ptr<MetricCounter> counter;
+    std::unique_ptr<MetricGauge> gauge;
+    std::unique_ptr<MetricHistogram> histogram;
+  };
+
+  // Null if |name| and |labels| are taken by another type of metric.
+  Metric* GetMetric(const std::string& name, const std::string& help,
+                    const MetricLabels& labels, MetricType type);
+
+  // Keyed by name and labels.
+  std::map<std::pair<std::string, MetricLabels>, std::unique_ptr<Metric>>
+      metrics_;
+  std::map<int, CollectCb> collectors_;
+  int next_collector_id_;
+
+  DISALLOW_COPY_AND_ASSIGN(MetricsRegistry);
+};
+
+}  // namespace sharer
+
+#endif  // LOGGING_METRICS_REGISTRY_H_
@@ -13,12 +13,22 @@
 namespace sharer {
 
 StatsEventSubscriber::StatsEventSubscriber()
-    : packets_total_(0), packets_sent_(0), packets_retransmitted_(0), packets_rejected_(0) {}
+    : frames_encoded_(0),
+      key_frames_encoded_(0),
+      bytes_encoded_(0),
+      packets_total_(0),
+      packets_sent_(0),
+      packets_retransmitted_(0),
+      packets_rejected_(0) {}
 
 StatsEventSubscriber::~StatsEventSubscriber() {}
 
 void StatsEventSubscriber::OnReceiveFrameEvent(const FrameEvent& frame_event) {
-  // Not handling frame events yet
+  if (frame_event.type != FRAME_ENCODED) return;
+
+  frames_encoded_++;
+  if (frame_event.key_frame) key_frames_encoded_++;
+  bytes_encoded_ += frame_event.size;
 }
 
 void StatsEventSubscriber::OnReceivePacketEvent(
@@ -34,6 +44,9 @@ void StatsEventSubscriber::OnReceivePacketEvent(
 }
 
 void StatsEventSubscriber::Reset() {
+  frames_encoded_ = 0;
+  key_frames_encoded_ = 0;
+  bytes_encoded_ = 0;
   packets_total_ = 0;
   packets_sent_ = 0;
   packets_retransmitted_ = 0;
@@ -63,6 +76,10 @@ void StatsEventSubscriber::PrintPackets() const {
 }
 
 void StatsEventSubscriber::PrintFrames() const {
+  DINF() << "Frames Encoded: " << frames_encoded_ << ", "
+         << key_frames_encoded_ << " key frames, "
+         << (frames_encoded_ ? bytes_encoded_ / frames_encoded_ : 0)
+         << " bytes per frame";
 }
 
 }  // namespace sharer
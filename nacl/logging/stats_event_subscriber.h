@@ -34,6 +34,10 @@ class StatsEventSubscriber : public RawEventSubscriber {
   int packets_retransmitted() const { return packets_retransmitted_; }
 
  private:
+  int frames_encoded_;
+  int key_frames_encoded_;
+  uint64_t bytes_encoded_;
+
   int packets_total_;
   int packets_sent_;
   int packets_retransmitted_;
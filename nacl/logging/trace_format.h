@@ -0,0 +1,60 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LOGGING_TRACE_FORMAT_H_
+#define LOGGING_TRACE_FORMAT_H_
+
+#include <stdint.h>
+
+#include "logging/logging_events.h"
+
+namespace sharer {
+
+// Binary trace of logging events, written by TraceRecorder and read by
+// tools/trace_analyzer. A TraceFileHeader followed by TraceRecords, all in
+// the byte order of the machine that recorded them. Bump kTraceVersion when
+// changing the records or the values of SharerLoggingEvent.
+
+static const char kTraceMagic[8] = {'S', 'H', 'A', 'R', 'T', 'R', 'C', 'E'};
+static const uint32_t kTraceVersion = 1;
+
+struct TraceFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+};
+
+enum TraceRecordFlags {
+  // The record is a PacketEvent, else a FrameEvent.
+  kTracePacketEvent = 1 << 0,
+  kTraceKeyFrame = 1 << 1,
+};
+
+// One FrameEvent or PacketEvent.
+struct TraceRecord {
+  // base::TimeTicks of the event.
+  int64_t timestamp_us;
+  uint32_t ssrc;
+  uint32_t rtp_timestamp;
+  uint32_t frame_id;
+  // Bytes of the frame or packet.
+  uint32_t size;
+  // See PacketEvent::receiver_id.
+  uint32_t receiver_id;
+  uint16_t packet_id;
+  uint16_t max_packet_id;
+  // SharerLoggingEvent.
+  uint8_t type;
+  // EventMediaType.
+  uint8_t media_type;
+  // TraceRecordFlags.
+  uint8_t flags;
+  uint8_t reserved[5];
+};
+
+static_assert(sizeof(TraceRecord) == 40, "TraceRecord layout changed");
+
+}  // namespace sharer
+
+#endif  // LOGGING_TRACE_FORMAT_H_
@@ -0,0 +1,71 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "logging/trace_recorder.h"
+
+#include <string.h>
+
+namespace sharer {
+
+TraceRecorder::TraceRecorder(const ChunkCb& chunk_cb)
+    : chunk_cb_(chunk_cb),
+      chunk_(sizeof(TraceFileHeader) + kChunkRecords * sizeof(TraceRecord)),
+      chunk_size_(0),
+      records_(0) {
+  TraceFileHeader header;
+  memcpy(header.magic, kTraceMagic, sizeof(header.magic));
+  header.version = kTraceVersion;
+  header.record_size = sizeof(TraceRecord);
+  memcpy(chunk_.data(), &header, sizeof(header));
+  chunk_size_ = sizeof(header);
+}
+
+TraceRecorder::~TraceRecorder() {}
+
+void TraceRecorder::OnReceiveFrameEvent(const FrameEvent& frame_event) {
+  TraceRecord* record = NextRecord();
+  record->timestamp_us = frame_event.timestamp.ToInternalValue();
+  record->ssrc = frame_event.ssrc;
+  record->rtp_timestamp = frame_event.rtp_timestamp;
+  record->frame_id = frame_event.frame_id;
+  record->size = static_cast<uint32_t>(frame_event.size);
+  record->type = frame_event.type;
+  record->media_type = frame_event.media_type;
+  record->flags = frame_event.key_frame ? kTraceKeyFrame : 0;
+}
+
+void TraceRecorder::OnReceivePacketEvent(const PacketEvent& packet_event) {
+  TraceRecord* record = NextRecord();
+  record->timestamp_us = packet_event.timestamp.ToInternalValue();
+  record->ssrc = packet_event.ssrc;
+  record->rtp_timestamp = packet_event.rtp_timestamp;
+  record->frame_id = packet_event.frame_id;
+  record->size = static_cast<uint32_t>(packet_event.size);
+  record->receiver_id = packet_event.receiver_id;
+  record->packet_id = packet_event.packet_id;
+  record->max_packet_id = packet_event.max_packet_id;
+  record->type = packet_event.type;
+  record->media_type = packet_event.media_type;
+  record->flags = kTracePacketEvent;
+}
+
+void TraceRecorder::Flush() {
+  if (!chunk_size_) return;
+
+  chunk_cb_(chunk_.data(), chunk_size_);
+  chunk_size_ = 0;
+}
+
+TraceRecord* TraceRecorder::NextRecord() {
+  if (chunk_size_ + sizeof(TraceRecord) > chunk_.size()) Flush();
+
+  TraceRecord* record =
+      reinterpret_cast<TraceRecord*>(chunk_.data() + chunk_size_);
+  memset(record, 0, sizeof(*record));
+  chunk_size_ += sizeof(TraceRecord);
+  records_++;
+  return record;
+}
+
+}  // namespace sharer
@@ -0,0 +1,56 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LOGGING_TRACE_RECORDER_H_
+#define LOGGING_TRACE_RECORDER_H_
+
+#include <functional>
+#include <vector>
+
+#include "base/macros.h"
+#include "logging/raw_event_subscriber.h"
+#include "logging/trace_format.h"
+
+namespace sharer {
+
+// RawEventSubscriber that records every event as a fixed-size TraceRecord
+// into a preallocated chunk, and hands full chunks over to be written out,
+// see trace_format.h. Recording an event is a copy into the chunk, so the
+// recorder can stay subscribed at full bitrate.
+class TraceRecorder : public RawEventSubscriber {
+ public:
+  // Called with |size| bytes of the trace, the first time starting with the
+  // TraceFileHeader. The data is only valid during the call.
+  using ChunkCb = std::function<void(const void* data, size_t size)>;
+
+  // ~400KB, a few seconds of a 20 Mbit/s stream.
+  static const size_t kChunkRecords = 10240;
+
+  explicit TraceRecorder(const ChunkCb& chunk_cb);
+  ~TraceRecorder() final;
+
+  // RawEventSubscriber implementations.
+  void OnReceiveFrameEvent(const FrameEvent& frame_event) final;
+  void OnReceivePacketEvent(const PacketEvent& packet_event) final;
+
+  // Hands over the records of the current chunk, e.g. when stopping.
+  void Flush();
+
+  uint64_t records() const { return records_; }
+
+ private:
+  TraceRecord* NextRecord();
+
+  const ChunkCb chunk_cb_;
+  // Raw bytes, so the header fits in the first chunk.
+  std::vector<char> chunk_;
+  size_t chunk_size_;
+  uint64_t records_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceRecorder);
+};
+
+}  // namespace sharer
+
+#endif  // LOGGING_TRACE_RECORDER_H_
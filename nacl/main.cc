@@ -23,17 +23,24 @@
 #include "ppapi/cpp/module.h"
 #include "ppapi/cpp/rect.h"
 #include "ppapi/cpp/var.h"
+#include "ppapi/cpp/var_array.h"
+#include "ppapi/cpp/var_array_buffer.h"
 #include "ppapi/cpp/var_dictionary.h"
 /* #include "ppapi/cpp/video_decoder.h" */
 #include "ppapi/utility/completion_callback_factory.h"
 
 #include "base/logger.h"
 #include "base/ptr_utils.h"
+#include "logging/latency_event_subscriber.h"
+#include "logging/metrics_registry.h"
+#include "logging/trace_recorder.h"
 #include "sharer_config.h"
+#include "net/pacing/pacer_group.h"
 #include "net/sharer_transport_config.h"
 #include "receiver/decoder.h"
 #include "receiver/network_handler.h"
 #include "sharer_defines.h"
+#include "sharer_environment.h"
 #include "sharer_sender.h"
 
 // Use assert as a poor-man's CHECK, even in non-debug mode.
@@ -67,6 +74,49 @@ struct PendingPicture {
   PP_VideoPicture picture;
 };
 
+// {name: {type, help, bounds, samples: [{labels, value, buckets, sum}]}},
+// with bounds, buckets and sum for histograms only.
+pp::VarDictionary MetricsToVar(const sharer::MetricsSnapshot& snapshot) {
+  pp::VarDictionary metrics;
+  for (const auto& entry : snapshot.families) {
+    const sharer::MetricsSnapshot::Family& family = entry.second;
+    const bool histogram = family.type == sharer::MetricType::HISTOGRAM;
+
+    pp::VarArray samples;
+    for (size_t i = 0; i < family.samples.size(); i++) {
+      const sharer::MetricsSnapshot::Sample& sample = family.samples[i];
+      pp::VarDictionary var_sample;
+      pp::VarDictionary labels;
+      for (const auto& label : sample.labels)
+        labels.Set(label.first, label.second);
+      var_sample.Set("labels", labels);
+      if (histogram) {
+        pp::VarArray buckets;
+        for (size_t j = 0; j < sample.buckets.size(); j++)
+          buckets.Set(j, static_cast<double>(sample.buckets[j]));
+        var_sample.Set("buckets", buckets);
+        var_sample.Set("sum", sample.sum);
+      } else {
+        var_sample.Set("value", sample.value);
+      }
+      samples.Set(i, var_sample);
+    }
+
+    pp::VarDictionary var_family;
+    var_family.Set("type", sharer::MetricTypeToString(family.type));
+    var_family.Set("help", family.help);
+    if (histogram) {
+      pp::VarArray bounds;
+      for (size_t i = 0; i < family.bounds.size(); i++)
+        bounds.Set(i, static_cast<double>(family.bounds[i]));
+      var_family.Set("bounds", bounds);
+    }
+    var_family.Set("samples", samples);
+    metrics.Set(entry.first, var_family);
+  }
+  return metrics;
+}
+
 class MyInstance : public pp::Instance, public pp::Graphics3DClient {
  public:
   MyInstance(PP_Instance instance, pp::Module* module);
@@ -137,6 +187,11 @@ class MyInstance : public pp::Instance, public pp::Graphics3DClient {
   void StopSharer(int cmd_id, const pp::Var& payload);
   void ChangeEncoding(int cmd_id, const pp::Var& payload);
   void SetSharerTracks(int cmd_id, const pp::Var& payload);
+  void GetMetrics(int cmd_id, const pp::Var& payload);
+  void StartTrace(int cmd_id);
+  void StopTrace(int cmd_id);
+  // Returns the number of events recorded.
+  uint64_t StopTraceRecorder();
 
   pp::Size plugin_size_;
   bool is_painting_;
@@ -149,10 +204,15 @@ class MyInstance : public pp::Instance, public pp::Graphics3DClient {
 
   int num_frames_rendered_;
   PP_TimeTicks first_frame_delivered_ticks_;
+  PP_TimeTicks join_ticks_;
   PP_TimeTicks last_swap_request_ticks_;
   PP_TimeTicks swap_ticks_;
   pp::CompletionCallbackFactory<MyInstance> callback_factory_;
 
+  // Shared by the network handler and the decoder, outlives both.
+  sharer::SharerEnvironment receiver_env_;
+  sharer::LatencyEventSubscriber receiver_latency_;
+
   // Unowned pointers.
   const PPB_Console* console_if_;
   const PPB_Core* core_if_;
@@ -165,9 +225,15 @@ class MyInstance : public pp::Instance, public pp::Graphics3DClient {
   std::unique_ptr<NetworkHandler> network_handler_;
 
   pp::VarDictionary sender_supported_params_;
+  // All senders pace their packets together. Outlives them.
+  sharer::PacerGroup pacer_group_;
   std::map<int, std::unique_ptr<sharer::SharerSender>> senders_;
   int next_sender_id_;
 
+  // Records the events of the receiver and of every sender while tracing,
+  // posting the trace to the page in chunks.
+  std::unique_ptr<sharer::TraceRecorder> trace_recorder_;
+
   // Shader program to draw GL_TEXTURE_2D target.
   Shader shader_2d_;
   // Shader program to draw GL_TEXTURE_RECTANGLE_ARB target.
@@ -183,9 +249,12 @@ MyInstance::MyInstance(PP_Instance instance, pp::Module* module)
       is_listening_(false),
       num_frames_rendered_(0),
       first_frame_delivered_ticks_(-1),
+      join_ticks_(-1),
       last_swap_request_ticks_(-1),
       swap_ticks_(0),
       callback_factory_(this),
+      receiver_env_(this),
+      receiver_latency_(0),
       context_(NULL),
       gl_initialized_(false),
       next_sender_id_(0) {
@@ -197,10 +266,17 @@ MyInstance::MyInstance(PP_Instance instance, pp::Module* module)
   gles2_if_ = static_cast<const PPB_OpenGLES2*>(
       pp::Module::Get()->GetBrowserInterface(PPB_OPENGLES2_INTERFACE));
 
+  receiver_env_.logger()->Subscribe(&receiver_latency_);
+
   RequestInputEvents(PP_INPUTEVENT_CLASS_MOUSE);
 }
 
 MyInstance::~MyInstance() {
+  // The log output posts messages to this instance, and other threads may
+  // still log while it goes away.
+  base::LogSink::Get()->SetOutput(nullptr);
+  StopTraceRecorder();
+  receiver_env_.logger()->Unsubscribe(&receiver_latency_);
   if (!context_) return;
 
   PP_Resource graphics_3d = context_->pp_resource();
@@ -222,6 +298,7 @@ void MyInstance::DidChangeView(const pp::Rect& position,
           << position.height();
   }
   plugin_size_ = position.size();
+  if (network_handler_) network_handler_->SetDisplaySize(plugin_size_);
 
   // Resize buffers only if the GL context was initialized
   if (gl_initialized_) {
@@ -260,8 +337,17 @@ void MyInstance::StartPlaying(int cmd_id, const pp::Var& payload) {
     std::string port_str = dict.Get(pp::Var("port")).AsString();
     config.port = std::stoi(port_str);
   }
+  if (dict.HasKey(pp::Var("max_layer"))) {
+    std::string layer_str = dict.Get(pp::Var("max_layer")).AsString();
+    config.max_temporal_layer = std::stoi(layer_str);
+  }
+  if (dict.HasKey(pp::Var("layers"))) {
+    std::string layers_str = dict.Get(pp::Var("layers")).AsString();
+    config.multicast_layers = std::stoi(layers_str);
+  }
 
   InitializeDecoder();
+  join_ticks_ = core_if_->GetTimeTicks();
   StartNetwork(config);
   is_listening_ = true;
   SharerMessage(cmd_id, true, pp::Var());
@@ -364,10 +450,40 @@ void MyInstance::StartSharer(int cmd_id, const pp::Var& payload) {
     config.initial_bitrate = std::stoi(dict.Get(pp::Var("bitrate")).AsString());
   if (dict.HasKey(pp::Var("fps")))
     config.frame_rate = std::stoi(dict.Get(pp::Var("fps")).AsString());
+  if (dict.HasKey(pp::Var("keyframe_window")))
+    config.key_frame_coalesce_ms =
+        std::stoi(dict.Get(pp::Var("keyframe_window")).AsString());
+  if (dict.HasKey(pp::Var("keyframe_interval")))
+    config.min_key_frame_interval_ms =
+        std::stoi(dict.Get(pp::Var("keyframe_interval")).AsString());
+  if (dict.HasKey(pp::Var("simulcast")))
+    config.simulcast_layers =
+        std::stoi(dict.Get(pp::Var("simulcast")).AsString());
+  if (dict.HasKey(pp::Var("layered")))
+    config.layered_multicast =
+        std::stoi(dict.Get(pp::Var("layered")).AsString()) != 0;
+  if (dict.HasKey(pp::Var("static_keepalive")))
+    config.static_keepalive_ms =
+        std::stoi(dict.Get(pp::Var("static_keepalive")).AsString());
+  if (dict.HasKey(pp::Var("lock_clock")))
+    config.lock_capture_clock =
+        std::stoi(dict.Get(pp::Var("lock_clock")).AsString()) != 0;
+  if (dict.HasKey(pp::Var("weight")))
+    config.pacing_weight = std::stoi(dict.Get(pp::Var("weight")).AsString());
+  if (dict.HasKey(pp::Var("uplink")))
+    config.uplink_kbps = std::stoi(dict.Get(pp::Var("uplink")).AsString());
+  if (dict.HasKey(pp::Var("queue_delay")))
+    config.max_queue_delay_ms =
+        std::stoi(dict.Get(pp::Var("queue_delay")).AsString());
 
   INF() << "Starting content sharing.";
 
-  auto sender = make_unique<sharer::SharerSender>(this, next_sender_id_++);
+  // The uplink is the same for every sender, the last one started sets it.
+  if (config.uplink_kbps) pacer_group_.SetUplinkBitrate(config.uplink_kbps);
+
+  auto sender = make_unique<sharer::SharerSender>(this, next_sender_id_++,
+                                                  &pacer_group_);
+  if (trace_recorder_) sender->logger()->Subscribe(trace_recorder_.get());
   auto inserted =
       senders_.insert(std::make_pair(sender->id(), std::move(sender)));
 
@@ -380,7 +496,13 @@ void MyInstance::StartSharer(int cmd_id, const pp::Var& payload) {
       SharerMessage(cmd_id, true, dict);
     } else {
       ERR() << "Could not initialize sender: " << id << ", error: " << result;
-      senders_.erase(id);
+      auto it = senders_.find(id);
+      if (it != senders_.end()) {
+        // Its logger goes away with it.
+        if (trace_recorder_)
+          it->second->logger()->Unsubscribe(trace_recorder_.get());
+        senders_.erase(it);
+      }
       SharerMessage(cmd_id, false, pp::Var());
     }
   };
@@ -486,14 +608,92 @@ void MyInstance::HandleMessage(const pp::Var& var_message) {
     StopSharer(cmd_id, var_payload);
   } else if (cmd == "changeEncoding") {
     ChangeEncoding(cmd_id, var_payload);
+  } else if (cmd == "getMetrics") {
+    GetMetrics(cmd_id, var_payload);
+  } else if (cmd == "startTrace") {
+    StartTrace(cmd_id);
+  } else if (cmd == "stopTrace") {
+    StopTrace(cmd_id);
   } else {
     ERR() << "Unknown command: " << cmd;
   }
 }
 
+void MyInstance::GetMetrics(int cmd_id, const pp::Var& payload) {
+  sharer::MetricsSnapshot snapshot;
+  receiver_env_.metrics()->Snapshot(sharer::MetricLabels(), &snapshot);
+  for (const auto& sender : senders_) {
+    sender.second->metrics()->Snapshot(
+        {{"sender", std::to_string(sender.first)}}, &snapshot);
+  }
+
+  std::string format;
+  if (payload.is_dictionary()) {
+    pp::Var var_format = pp::VarDictionary(payload).Get("format");
+    if (var_format.is_string()) format = var_format.AsString();
+  }
+
+  if (format == "prometheus")
+    SharerMessage(cmd_id, true, sharer::MetricsToPrometheusText(snapshot));
+  else
+    SharerMessage(cmd_id, true, MetricsToVar(snapshot));
+}
+
+void MyInstance::StartTrace(int cmd_id) {
+  if (trace_recorder_) {
+    ERR() << "Already tracing.";
+    SharerMessage(cmd_id, false, pp::Var());
+    return;
+  }
+
+  auto post_chunk = [this](const void* data, size_t size) {
+    pp::VarArrayBuffer buffer(size);
+    memcpy(buffer.Map(), data, size);
+    buffer.Unmap();
+    pp::VarDictionary dict;
+    dict.Set("trace", buffer);
+    this->PostMessage(dict);
+  };
+  trace_recorder_ = make_unique<sharer::TraceRecorder>(post_chunk);
+  receiver_env_.logger()->Subscribe(trace_recorder_.get());
+  for (const auto& sender : senders_)
+    sender.second->logger()->Subscribe(trace_recorder_.get());
+
+  INF() << "Tracing started.";
+  SharerMessage(cmd_id, true, pp::Var());
+}
+
+void MyInstance::StopTrace(int cmd_id) {
+  if (!trace_recorder_) {
+    ERR() << "Not tracing.";
+    SharerMessage(cmd_id, false, pp::Var());
+    return;
+  }
+
+  const double records = StopTraceRecorder();
+  INF() << "Tracing stopped after " << records << " events.";
+  // Every chunk was posted before this reply.
+  SharerMessage(cmd_id, true, pp::Var(records));
+}
+
+uint64_t MyInstance::StopTraceRecorder() {
+  if (!trace_recorder_) return 0;
+
+  receiver_env_.logger()->DispatchPendingEvents();
+  receiver_env_.logger()->Unsubscribe(trace_recorder_.get());
+  for (const auto& sender : senders_) {
+    sender.second->logger()->DispatchPendingEvents();
+    sender.second->logger()->Unsubscribe(trace_recorder_.get());
+  }
+  trace_recorder_->Flush();
+  const uint64_t records = trace_recorder_->records();
+  trace_recorder_ = nullptr;
+  return records;
+}
+
 void MyInstance::InitializeDecoder() {
   assert(video_decoder_ == nullptr);
-  video_decoder_ = make_unique<Decoder>(this, 0, *context_);
+  video_decoder_ = make_unique<Decoder>(&receiver_env_, 0, *context_);
   video_decoder_->SetPictureReadyCb([this](
       Decoder* decoder,
       PP_VideoPicture picture) { this->PaintPicture(decoder, picture); });
@@ -540,7 +740,9 @@ void MyInstance::StartNetwork(const sharer::ReceiverNetConfig& config) {
   video_config.sender_ssrc = 11;
 
   network_handler_ =
-      make_unique<NetworkHandler>(this, audio_config, video_config, config);
+      make_unique<NetworkHandler>(&receiver_env_, audio_config, video_config,
+                                  config);
+  network_handler_->SetDisplaySize(plugin_size_);
   RequestFrame();
 }
 
@@ -604,6 +806,11 @@ void MyInstance::PaintFinished(int32_t result) {
   swap_ticks_ += core_if_->GetTimeTicks() - last_swap_request_ticks_;
   is_painting_ = false;
   ++num_frames_rendered_;
+  if (join_ticks_ >= 0) {
+    INF() << "Join to first picture: "
+          << (core_if_->GetTimeTicks() - join_ticks_) * 1000 << " ms.";
+    join_ticks_ = -1;
+  }
   if (num_frames_rendered_ % 500 == 0) {
     double elapsed = core_if_->GetTimeTicks() - first_frame_delivered_ticks_;
     double fps = (elapsed > 0) ? num_frames_rendered_ / elapsed : 1000;
@@ -617,6 +824,7 @@ void MyInstance::PaintFinished(int32_t result) {
                        << ", with average ms/swap of: " << ms_per_swap
                        << ", with average latency (ms) of: "
                        << ms_average_latency;
+    receiver_latency_.PrintAndReset();
   }
 
   // If the decoders were reset, this will be empty.
@@ -625,6 +833,7 @@ void MyInstance::PaintFinished(int32_t result) {
   const PendingPicture& next = pending_pictures_.front();
   Decoder* decoder = next.decoder;
   const PP_VideoPicture& picture = next.picture;
+  decoder->OnPicturePainted(picture);
   decoder->RecyclePicture(picture);
   pending_pictures_.pop();
 
@@ -7,13 +7,17 @@
 
 #include "base/big_endian.h"
 #include "base/logger.h"
-#include "base/ptr_utils.h"
+#include "sharer_defines.h"
+
+#include "ppapi/cpp/module.h"
+
+#include <algorithm>
 
 namespace sharer {
 
 namespace {
 
-static const int64_t kPacingIntervalMs = 10;
+static const int64_t kPacingIntervalMs = PacerGroup::kBurstIntervalMs;
 
 static const size_t kPacingMaxBurstsPerFrame = 3;
 static const size_t kMaxDedupeWindowMs = 500;
@@ -21,9 +25,24 @@ static const size_t kMaxDedupeWindowMs = 500;
 static const size_t kTargetBurstSize = 10;
 static const size_t kMaxBurstSize = 20;
 
+// Fast start packets sent per burst on top of the live stream, ~12Mbit/s.
+static const size_t kMaxFastStartBurstSize = 10;
+
+// While multicast packets wait, resends to single receivers take at most
+// this share of a burst, so that repairing a receiver behind a congested
+// link doesn't hold up the stream of all the others.
+static const size_t kMaxResendBurstShareDivisor = 2;
+
+// Queued enhancement layer packets are dropped once the live queue can't be
+// flushed within this many bursts.
+static const size_t kMaxBurstsBeforeDroppingEnhancement =
+    2 * kPacingMaxBurstsPerFrame;
+
 static const size_t kHugeQueueLengthSeconds = 10;
 static const size_t kRidiculousNumberOfPackets =
     kHugeQueueLengthSeconds * (kMaxBurstSize * 1000 / kPacingIntervalMs);
+
+const std::vector<int64_t> kBurstSizeBounds = {1, 2, 5, 10, 15, 20, 30, 50};
 }
 
 DedupInfo::DedupInfo() : last_byte_acked_for_audio(0) {}
@@ -41,29 +60,93 @@ PacedSender::PacedSender(SharerEnvironment* env, UdpTransport* udp_sender)
     : env_(env),
       callback_factory_(this),
       transport_(udp_sender),
+      group_(nullptr),
       audio_ssrc_(0),
-      video_ssrc_(0),
       current_max_burst_size_(kTargetBurstSize),
       next_max_burst_size_(kTargetBurstSize),
       next_next_max_burst_size_(kTargetBurstSize),
       current_burst_size_(0),
+      current_fast_start_burst_size_(0),
+      current_resend_burst_size_(0),
       state_(State::Unblocked),
-      has_reached_upper_bound_once_(false) {}
-
-PacedSender::~PacedSender() {}
+      has_reached_upper_bound_once_(false),
+      packets_sent_metric_(env->metrics()->Counter(
+          "sharer_pacer_packets_sent_total",
+          "Packets sent to the multicast groups.")),
+      packets_retransmitted_metric_(env->metrics()->Counter(
+          "sharer_pacer_packets_retransmitted_total",
+          "Packets resent to a single receiver, including fast starts.")),
+      rtx_rejected_metric_(env->metrics()->Counter(
+          "sharer_pacer_rtx_rejected_total",
+          "Retransmissions not done because the packet was just sent.")),
+      nacks_received_metric_(env->metrics()->Counter(
+          "sharer_pacer_nacks_received_total",
+          "Packets receivers asked to be resent.")),
+      packets_dropped_metric_(env->metrics()->Counter(
+          "sharer_pacer_packets_dropped_total",
+          "Enhancement layer packets dropped from a backed up queue.")),
+      burst_size_metric_(env->metrics()->Histogram(
+          "sharer_pacer_burst_packets", "Packets sent in each burst.",
+          kBurstSizeBounds)),
+      metrics_collector_(env->metrics()->AddCollector(
+          [this](MetricsSnapshot* snapshot) { CollectMetrics(snapshot); })) {}
+
+PacedSender::~PacedSender() {
+  env_->metrics()->RemoveCollector(metrics_collector_);
+  if (group_) group_->RemovePacer(this);
+}
 
 void PacedSender::RegisterAudioSsrc(uint32_t audio_ssrc) {
   audio_ssrc_ = audio_ssrc;
 }
 
 void PacedSender::RegisterVideoSsrc(uint32_t video_ssrc) {
-  video_ssrc_ = video_ssrc;
+  video_ssrcs_.insert(video_ssrc);
 }
 
 void PacedSender::RegisterPrioritySsrc(uint32_t ssrc) {
   priority_ssrcs_.push_back(ssrc);
 }
 
+void PacedSender::JoinGroup(
+    PacerGroup* group, int weight,
+    const PacerGroup::BitrateShareCb& bitrate_share_cb) {
+  PP_DCHECK(!group_);
+  group_ = group;
+  group_->AddPacer(this, weight, bitrate_share_cb);
+}
+
+size_t PacedSender::NextGroupBurstDemand() {
+  return HasLivePackets() ? NextBurstSize() : 0;
+}
+
+void PacedSender::StartGroupBurst(size_t max_packets) {
+  RecordBurstSize();
+  current_burst_size_ = 0;
+  current_fast_start_burst_size_ = 0;
+  current_resend_burst_size_ = 0;
+  current_max_burst_size_ = max_packets;
+  burst_end_ = env_->clock()->NowTicks() +
+               base::TimeDelta::FromMilliseconds(kPacingIntervalMs);
+  // A blocked transport calls back once it can send again.
+  if (state_ != State::TransportBlocked) SendStoredPackets(PP_OK);
+}
+
+size_t PacedSender::QueuedLiveBytes() const {
+  size_t bytes = 0;
+  for (const auto& packet : packet_list_) bytes += packet.second.second->size();
+  for (const auto& packet : priority_packet_list_)
+    bytes += packet.second.second->size();
+  return bytes;
+}
+
+double PacedSender::LiveDrainRate() const {
+  // Outside of a group, NextBurstSize() never goes above the target size.
+  const double packets_per_burst =
+      group_ ? group_->GuaranteedPacketsPerBurst(this) : kTargetBurstSize;
+  return packets_per_burst * kMaxIpPacketSize * 1000 / kPacingIntervalMs;
+}
+
 int64_t PacedSender::GetLastByteSentForPacket(const PacketKey& packet_key) {
   return 0;
 }
@@ -74,22 +157,28 @@ int64_t PacedSender::GetLastByteSentForSsrc(uint32_t ssrc) {
   return it->second;
 }
 
-bool PacedSender::SendPackets(const SendPacketVector& packets) {
+bool PacedSender::SendPackets(const SendPacketVector& packets,
+                              bool droppable) {
   if (packets.empty()) {
     return true;
   }
-  std::string addr = "multicast";
+  const std::string addr =
+      MulticastAddrForSsrc(packets.begin()->first.second.first);
   const bool high_priority = IsHighPriority(packets.begin()->first);
+  const PacketType type =
+      droppable ? PacketType::Enhancement : PacketType::Normal;
   for (size_t i = 0; i < packets.size(); i++) {
     PP_DCHECK(IsHighPriority(packets[i].first) == high_priority);
     if (high_priority) {
       priority_packet_list_[std::make_pair(addr, packets[i].first)] =
-          make_pair(PacketType::Normal, packets[i].second);
+          make_pair(type, packets[i].second);
     } else {
       packet_list_[std::make_pair(addr, packets[i].first)] =
-          make_pair(PacketType::Normal, packets[i].second);
+          make_pair(type, packets[i].second);
     }
   }
+  if (packet_list_.size() > kMaxBurstSize * kMaxBurstsBeforeDroppingEnhancement)
+    DropEnhancementPackets();
   if (state_ == State::Unblocked) {
     SendStoredPackets(PP_OK);
   }
@@ -123,7 +212,8 @@ bool PacedSender::ShouldResend(const PacketWithIP& packet_key,
 
 bool PacedSender::ResendPackets(const std::string& addr,
                                 const SendPacketVector& packets,
-                                const DedupInfo& dedup_info) {
+                                const DedupInfo& dedup_info,
+                                std::vector<PacketKey>* queued_packets) {
   if (packets.empty()) {
     return true;
   }
@@ -131,11 +221,18 @@ bool PacedSender::ResendPackets(const std::string& addr,
   const base::TimeTicks now = env_->clock()->NowTicks();
   for (size_t i = 0; i < packets.size(); i++) {
     PacketWithIP packet_key = std::make_pair(addr, packets[i].first);
+    LogPacketEvent(packets[i].second, PACKET_NACK_RECEIVED, addr);
+    nacks_received_metric_->Increment();
+    if (fast_start_packet_list_.count(packet_key)) {
+      // Still queued in a fast start burst to this receiver.
+      continue;
+    }
     if (!ShouldResend(packet_key, dedup_info, now)) {
-      LogPacketEvent(packets[i].second, PACKET_RTX_REJECTED);
-      DWRN() << ">> Not resending to: " << addr << ", ["
-             << packets[i].first.second.first << ":"
-             << packets[i].first.second.second << "]";
+      LogPacketEvent(packets[i].second, PACKET_RTX_REJECTED, addr);
+      rtx_rejected_metric_->Increment();
+      DWRN_EVERY_MS(1000) << ">> Not resending to: " << addr << ", ["
+                          << packets[i].first.second.first << ":"
+                          << packets[i].first.second.second << "]";
       continue;
     }
 
@@ -144,13 +241,29 @@ bool PacedSender::ResendPackets(const std::string& addr,
       priority_packet_list_[std::make_pair(addr, packets[i].first)] =
           make_pair(PacketType::Resend, packets[i].second);
     } else {
-      DINF() << ">>> Add resend: addr: " << addr << ", ["
-             << packets[i].first.second.first << ":"
-             << packets[i].first.second.second
-             << "]; list size: " << packet_list_.size();
+      DINF_EVERY_MS(1000) << ">>> Add resend: addr: " << addr << ", ["
+                          << packets[i].first.second.first << ":"
+                          << packets[i].first.second.second
+                          << "]; list size: " << packet_list_.size();
       packet_list_[std::make_pair(addr, packets[i].first)] =
           make_pair(PacketType::Resend, packets[i].second);
     }
+    if (queued_packets) queued_packets->push_back(packets[i].first);
+  }
+  if (state_ == State::Unblocked) {
+    SendStoredPackets(PP_OK);
+  }
+  return true;
+}
+
+bool PacedSender::SendFastStartPackets(const std::string& addr,
+                                       const SendPacketVector& packets) {
+  if (packets.empty()) {
+    return true;
+  }
+  for (size_t i = 0; i < packets.size(); i++) {
+    fast_start_packet_list_[std::make_pair(addr, packets[i].first)] =
+        make_pair(PacketType::FastStart, packets[i].second);
   }
   if (state_ == State::Unblocked) {
     SendStoredPackets(PP_OK);
@@ -159,7 +272,7 @@ bool PacedSender::ResendPackets(const std::string& addr,
 }
 
 bool PacedSender::SendRtcpPacket(uint32_t ssrc, PacketRef packet) {
-  std::string addr = "multicast";
+  const std::string addr = MulticastAddrForSsrc(ssrc);
   if (state_ == State::TransportBlocked) {
     priority_packet_list_[std::make_pair(
         addr, PacedSender::MakePacketKey(base::TimeTicks(), ssrc, 0))] =
@@ -179,14 +292,27 @@ void PacedSender::CancelSendingPacket(const std::string& addr,
                                       const PacketKey& packet_key) {
   packet_list_.erase(std::make_pair(addr, packet_key));
   priority_packet_list_.erase(std::make_pair(addr, packet_key));
+  fast_start_packet_list_.erase(std::make_pair(addr, packet_key));
 }
 
-PacketRef PacedSender::PopNextPacket(PacketType* packet_type,
+PacketRef PacedSender::PopNextPacket(bool fast_start, PacketType* packet_type,
                                      PacketWithIP* packet_key) {
-  PacketList* list =
-      !priority_packet_list_.empty() ? &priority_packet_list_ : &packet_list_;
+  PacketList* list = fast_start ? &fast_start_packet_list_
+                                : !priority_packet_list_.empty()
+                                      ? &priority_packet_list_
+                                      : &packet_list_;
   PP_DCHECK(!list->empty());
   PacketList::iterator i = list->begin();
+  // Resends sort first, their receiver addresses coming before the
+  // "multicast" destinations. Past their share of the burst, the multicast
+  // packets go first.
+  if (!fast_start && i->second.first == PacketType::Resend &&
+      current_resend_burst_size_ >=
+          current_max_burst_size_ / kMaxResendBurstShareDivisor) {
+    PacketList::iterator multicast = list->lower_bound(
+        std::make_pair(std::string("multicast"), PacketKey()));
+    if (multicast != list->end()) i = multicast;
+  }
   *packet_type = i->second.first;
   *packet_key = i->first;
   PacketRef ret = i->second.second;
@@ -194,17 +320,66 @@ PacketRef PacedSender::PopNextPacket(PacketType* packet_type,
   return ret;
 }
 
+// static
+std::string PacedSender::MulticastAddrForSsrc(uint32_t ssrc) {
+  const int layer = SimulcastLayerForSsrc(ssrc);
+  return layer < 0 ? "multicast" : MulticastAddrForLayer(layer);
+}
+
 bool PacedSender::IsHighPriority(const PacketKey& packet_key) const {
   return std::find(priority_ssrcs_.begin(), priority_ssrcs_.end(),
                    packet_key.second.first) != priority_ssrcs_.end();
 }
 
 bool PacedSender::empty() const {
-  return packet_list_.empty() && priority_packet_list_.empty();
+  return !HasLivePackets() && fast_start_packet_list_.empty();
 }
 
 size_t PacedSender::size() const {
-  return packet_list_.size() + priority_packet_list_.size();
+  return packet_list_.size() + priority_packet_list_.size() +
+         fast_start_packet_list_.size();
+}
+
+bool PacedSender::HasLivePackets() const {
+  return !packet_list_.empty() || !priority_packet_list_.empty();
+}
+
+void PacedSender::DropEnhancementPackets() {
+  size_t dropped = 0;
+  for (auto it = packet_list_.begin(); it != packet_list_.end();) {
+    if (it->second.first == PacketType::Enhancement) {
+      LogPacketEvent(it->second.second, PACKET_DROPPED, std::string());
+      it = packet_list_.erase(it);
+      ++dropped;
+    } else {
+      ++it;
+    }
+  }
+  packets_dropped_metric_->Increment(dropped);
+  if (dropped)
+    DWRN() << "Queue backed up, dropped " << dropped
+           << " enhancement layer packets.";
+}
+
+size_t PacedSender::NextBurstSize() {
+  // The goal here is to try to send out the queued packets over the next
+  // three bursts, while trying to keep the burst size below 10 if possible.
+  // We have some evidence that sending more than 12 packets in a row doesn't
+  // work very well, but we don't actually know why yet. Sending out packets
+  // sooner is better than sending out packets later as that gives us more
+  // time to re-send them if needed. So if we have less than 30 packets, just
+  // send 10 at a time. If we have less than 60 packets, send n / 3 at a time.
+  // if we have more than 60, we send 20 at a time. 20 packets is ~24Mbit/s
+  // which is more bandwidth than the cast library should need, and sending
+  // out more data per second is unlikely to be helpful.
+  size_t max_burst_size = std::min(
+      kTargetBurstSize,  // FIXME: Should set a target_burst_size_ and use it
+                         // here. See original implementation for reference.
+      std::max(kTargetBurstSize, size() / kPacingMaxBurstsPerFrame));
+  const size_t burst_size = std::max(next_max_burst_size_, max_burst_size);
+  next_max_burst_size_ = std::max(next_next_max_burst_size_, max_burst_size);
+  next_next_max_burst_size_ = max_burst_size;
+  return burst_size;
 }
 
 // This function can be called from three places:
@@ -233,51 +408,58 @@ void PacedSender::SendStoredPackets(int32_t result) {
   // I don't actually trust that PostDelayTask(x - now) will mean that
   // now >= x when the call happens, so check if the previous state was
   // State_BurstFull too.
-  if (now >= burst_end_ || previous_state == State::BurstFull) {
+  // In a group, bursts only start from StartGroupBurst().
+  if (!group_ && (now >= burst_end_ || previous_state == State::BurstFull)) {
     // Start a new burst.
+    RecordBurstSize();
     current_burst_size_ = 0;
+    current_fast_start_burst_size_ = 0;
+    current_resend_burst_size_ = 0;
     burst_end_ = now + base::TimeDelta::FromMilliseconds(kPacingIntervalMs);
-
-    // The goal here is to try to send out the queued packets over the next
-    // three bursts, while trying to keep the burst size below 10 if possible.
-    // We have some evidence that sending more than 12 packets in a row doesn't
-    // work very well, but we don't actually know why yet. Sending out packets
-    // sooner is better than sending out packets later as that gives us more
-    // time to re-send them if needed. So if we have less than 30 packets, just
-    // send 10 at a time. If we have less than 60 packets, send n / 3 at a time.
-    // if we have more than 60, we send 20 at a time. 20 packets is ~24Mbit/s
-    // which is more bandwidth than the cast library should need, and sending
-    // out more data per second is unlikely to be helpful.
-    size_t max_burst_size = std::min(
-        kTargetBurstSize,  // FIXME: Should set a target_burst_size_ and use it
-                           // here. See original implementation for reference.
-        std::max(kTargetBurstSize, size() / kPacingMaxBurstsPerFrame));
-    current_max_burst_size_ = std::max(next_max_burst_size_, max_burst_size);
-    next_max_burst_size_ = std::max(next_next_max_burst_size_, max_burst_size);
-    next_next_max_burst_size_ = max_burst_size;
+    current_max_burst_size_ = NextBurstSize();
   }
 
   auto cb = callback_factory_.NewCallback(&PacedSender::SendStoredPackets);
 
+  // In a group, what is left of a grant expires with its burst, and there is
+  // nothing to send before the first one.
+  const bool burst_open = !group_ || now < burst_end_;
+
   while (!empty()) {
-    if (current_burst_size_ >= current_max_burst_size_) {
+    // Live packets always go first; fast start bursts only use their own
+    // budget.
+    const bool send_live = burst_open && HasLivePackets() &&
+                           current_burst_size_ < current_max_burst_size_;
+    const bool send_fast_start =
+        !send_live && !fast_start_packet_list_.empty() &&
+        current_fast_start_burst_size_ < kMaxFastStartBurstSize;
+    if (!send_live && !send_fast_start) {
+      state_ = State::BurstFull;
+      if (group_) {
+        group_->Wake();
+        return;
+      }
       const base::TimeDelta sched = burst_end_ - now;
       pp::Module::Get()->core()->CallOnMainThread(sched.InMilliseconds(), cb);
-      state_ = State::BurstFull;
       return;
     }
     PacketType packet_type;
     PacketWithIP packet_key;
-    PacketRef packet = PopNextPacket(&packet_type, &packet_key);
+    PacketRef packet = PopNextPacket(send_fast_start, &packet_type, &packet_key);
     PacketSendRecord send_record;
     send_record.time = now;
 
     switch (packet_type) {
       case PacketType::Resend:
-        LogPacketEvent(packet, PACKET_RETRANSMITTED);
+      case PacketType::FastStart:
+        LogPacketEvent(packet, PACKET_RETRANSMITTED, packet_key.first);
+        packets_retransmitted_metric_->Increment();
         break;
       case PacketType::Normal:
-        LogPacketEvent(packet, PACKET_SENT_TO_NETWORK);
+      case PacketType::Enhancement:
+        // Multicast.
+        LogPacketEvent(packet, PACKET_SENT_TO_NETWORK, std::string());
+        packets_sent_metric_->Increment();
         break;
       case PacketType::RTCP:
         break;
@@ -294,11 +476,17 @@ void PacedSender::SendStoredPackets(int32_t result) {
     last_byte_sent_[packet_key.second.second.first] =
         send_record.last_byte_sent;
 
+    // Sent either way: a blocked transport only means the send completes
+    // later, which with PPAPI is always the case.
+    if (send_fast_start)
+      current_fast_start_burst_size_++;
+    else
+      current_burst_size_++;
+    if (packet_type == PacketType::Resend) current_resend_burst_size_++;
     if (socket_blocked) {
       state_ = State::TransportBlocked;
       return;
     }
-    current_burst_size_++;
   }
 
   // Keep ~0.5 seconds of data (1000 packets).
@@ -312,32 +500,53 @@ void PacedSender::SendStoredPackets(int32_t result) {
   state_ = State::Unblocked;
 }
 
-void PacedSender::LogPacketEvent(PacketRef packet, SharerLoggingEvent type) {
-  auto event = make_unique<PacketEvent>();
-  event->timestamp = env_->clock()->NowTicks();
-  event->type = type;
+void PacedSender::CollectMetrics(MetricsSnapshot* snapshot) {
+  snapshot->AddGauge("sharer_pacer_queue_packets",
+                     "Packets waiting to be sent, including fast starts.",
+                     MetricLabels(), size());
+  snapshot->AddGauge("sharer_pacer_queue_bytes",
+                     "Bytes of the live stream waiting to be sent.",
+                     MetricLabels(), QueuedLiveBytes());
+}
+
+void PacedSender::RecordBurstSize() {
+  const size_t burst_size =
+      current_burst_size_ + current_fast_start_burst_size_;
+  // Idle pacers don't make bursts.
+  if (burst_size) burst_size_metric_->Add(burst_size);
+}
+
+void PacedSender::LogPacketEvent(PacketRef packet, SharerLoggingEvent type,
+                                 const std::string& addr) {
+  PacketEvent event;
+  event.timestamp = env_->clock()->NowTicks();
+  event.type = type;
+  event.receiver_id = ReceiverIdForAddress(addr);
 
   BigEndianReader reader(reinterpret_cast<const char*>(packet->data()),
                                packet->size());
   bool success = reader.Skip(4);
-  success &= reader.ReadU32(&event->rtp_timestamp);
+  success &= reader.ReadU32(&event.rtp_timestamp);
   uint32_t ssrc;
   success &= reader.ReadU32(&ssrc);
   if (ssrc == audio_ssrc_) {
-    event->media_type = AUDIO_EVENT;
-  } else if (ssrc == video_ssrc_) {
-    event->media_type = VIDEO_EVENT;
+    event.media_type = AUDIO_EVENT;
+  } else if (video_ssrcs_.count(ssrc)) {
+    event.media_type = VIDEO_EVENT;
   } else {
     DWRN() << "Got unknown ssrc " << ssrc << " when logging packet event";
     return;
   }
-  success &= reader.Skip(2);
-  success &= reader.ReadU16(&event->packet_id);
-  success &= reader.ReadU16(&event->max_packet_id);
-  event->size = packet->size();
+  event.ssrc = ssrc;
+  // Sharer header: flags, frame id, packet id, max packet id.
+  success &= reader.Skip(1);
+  success &= reader.ReadU32(&event.frame_id);
+  success &= reader.ReadU16(&event.packet_id);
+  success &= reader.ReadU16(&event.max_packet_id);
+  event.size = packet->size();
   PP_DCHECK(success);
 
-  env_->logger()->DispatchPacketEvent(std::move(event));
+  env_->logger()->DispatchPacketEvent(event);
 }
 
 }  // namespace sharer
@@ -8,6 +8,7 @@
 
 #include "base/macros.h"
 #include "base/time/time.h"
+#include "net/pacing/pacer_group.h"
 #include "net/sharer_transport_config.h"
 #include "net/rtp/rtp_receiver_defines.h"
 #include "net/udp_transport.h"
@@ -15,6 +16,7 @@
 
 #include "ppapi/utility/completion_callback_factory.h"
 
+#include <set>
 #include <vector>
 
 namespace sharer {
@@ -41,12 +43,41 @@ class PacedSender {
 
   void RegisterPrioritySsrc(uint32_t ssrc);
 
+  // Lets |group| schedule the bursts of this pacer together with the other
+  // senders of the instance, see PacerGroup.
+  void JoinGroup(PacerGroup* group, int weight,
+                 const PacerGroup::BitrateShareCb& bitrate_share_cb);
+
+  // Called by the group on each burst: the number of live packets this pacer
+  // would like to send in the burst, then the number it may send.
+  size_t NextGroupBurstDemand();
+  void StartGroupBurst(size_t max_packets);
+  bool HasQueuedPackets() const { return !empty(); }
+
+  // Bytes of the live stream waiting to be sent, i.e. not counting fast start
+  // bursts.
+  size_t QueuedLiveBytes() const;
+  // Rate at which the live queue drains when backed up, in bytes per second.
+  // Assumes full packets, as most packets of a large frame are.
+  double LiveDrainRate() const;
+
   int64_t GetLastByteSentForPacket(const PacketKey& packet_key);
   int64_t GetLastByteSentForSsrc(uint32_t ssrc);
 
-  bool SendPackets(const SendPacketVector& packets);
+  // |droppable| packets belong to frames nothing else depends on, e.g.
+  // enhancement temporal layers. They are discarded rather than sent late
+  // when the queue backs up.
+  bool SendPackets(const SendPacketVector& packets, bool droppable);
+  // Adds the keys of the packets actually queued to |queued_packets| if not
+  // null: the others were resent too recently, or are still queued in a fast
+  // start burst to |addr|.
   bool ResendPackets(const std::string& addr, const SendPacketVector& packets,
-                     const DedupInfo& dedup_info);
+                     const DedupInfo& dedup_info,
+                     std::vector<PacketKey>* queued_packets = nullptr);
+  // Queues a unicast burst for a receiver that just joined. These packets use
+  // their own per-burst budget, so they never delay the live stream.
+  bool SendFastStartPackets(const std::string& addr,
+                            const SendPacketVector& packets);
   bool SendRtcpPacket(uint32_t ssrc, PacketRef packet);
   void CancelSendingPacket(const std::string& addr,
                            const PacketKey& packet_key);
@@ -59,30 +90,43 @@ class PacedSender {
 
   bool ShouldResend(const PacketWithIP& packet_key, const DedupInfo& dedup_info,
                     const base::TimeTicks& now);
-  void LogPacketEvent(PacketRef packet, SharerLoggingEvent type);
+  // |addr| is the receiver the packet is for, empty if multicast.
+  void LogPacketEvent(PacketRef packet, SharerLoggingEvent type,
+                      const std::string& addr);
+  void CollectMetrics(MetricsSnapshot* snapshot);
+  // Records the size of the burst that just ended.
+  void RecordBurstSize();
 
-  enum class PacketType { RTCP, Resend, Normal };
+  enum class PacketType { RTCP, Resend, Normal, Enhancement, FastStart };
 
   enum class State { Unblocked, TransportBlocked, BurstFull };
 
   bool empty() const;
   size_t size() const;
+  bool HasLivePackets() const;
+  void DropEnhancementPackets();
+  size_t NextBurstSize();
 
-  PacketRef PopNextPacket(PacketType* packet_type, PacketWithIP* packet_key);
+  PacketRef PopNextPacket(bool fast_start, PacketType* packet_type,
+                          PacketWithIP* packet_key);
 
   bool IsHighPriority(const PacketKey& packet_key) const;
+  static std::string MulticastAddrForSsrc(uint32_t ssrc);
 
   SharerEnvironment* const env_;
   pp::CompletionCallbackFactory<PacedSender> callback_factory_;
   UdpTransport* transport_;
+  PacerGroup* group_;
 
   uint32_t audio_ssrc_;
-  uint32_t video_ssrc_;
+  // One per video simulcast layer.
+  std::set<uint32_t> video_ssrcs_;
   std::vector<uint32_t> priority_ssrcs_;
 
   using PacketList = std::map<PacketWithIP, std::pair<PacketType, PacketRef>>;
   PacketList packet_list_;
   PacketList priority_packet_list_;
+  PacketList fast_start_packet_list_;
 
   struct PacketSendRecord {
     PacketSendRecord();
@@ -107,12 +151,23 @@ class PacedSender {
   size_t next_next_max_burst_size_;
 
   size_t current_burst_size_;
+  size_t current_fast_start_burst_size_;
+  // Of |current_burst_size_|.
+  size_t current_resend_burst_size_;
 
   base::TimeTicks burst_end_;
   State state_;
 
   bool has_reached_upper_bound_once_;
 
+  MetricCounter* const packets_sent_metric_;
+  MetricCounter* const packets_retransmitted_metric_;
+  MetricCounter* const rtx_rejected_metric_;
+  MetricCounter* const nacks_received_metric_;
+  MetricCounter* const packets_dropped_metric_;
+  MetricHistogram* const burst_size_metric_;
+  const int metrics_collector_;
+
   DISALLOW_COPY_AND_ASSIGN(PacedSender);
 };
 
@@ -0,0 +1,240 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/pacing/pacer_group.h"
+
+#include "base/logger.h"
+#include "net/pacing/paced_sender.h"
+#include "net/rtcp/rtcp_defines.h"
+
+#include "ppapi/cpp/module.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sharer {
+
+namespace {
+
+// Budget of a burst without an uplink bitrate, what a single pacer used to
+// allow itself.
+const double kDefaultPacketsPerBurst = 20;
+
+// The rate goes down in proportion to the losses above kHighLoss, and up by
+// kRateIncrease per update below kLowLoss, as in the loss based part of
+// WebRTC's congestion control. In between it holds.
+const double kHighLoss = 0.1;
+const double kLowLoss = 0.02;
+const double kRateIncrease = 1.05;
+
+// A packet per burst.
+const double kMinRateKbps =
+    kMaxIpPacketSize * 8.0 / PacerGroup::kBurstIntervalMs;
+
+}  // namespace
+
+const int64_t PacerGroup::kBurstIntervalMs;
+const int64_t PacerGroup::kRateUpdateIntervalMs;
+
+PacerGroup::PacerGroup()
+    : factory_(this),
+      clock_(&default_clock_),
+      uplink_kbps_(0),
+      rate_kbps_(MaxRateKbps()),
+      budget_carry_(0),
+      burst_scheduled_(false) {}
+
+PacerGroup::~PacerGroup() {}
+
+void PacerGroup::AddPacer(PacedSender* pacer, int weight,
+                          const BitrateShareCb& bitrate_share_cb) {
+  Member member;
+  member.pacer = pacer;
+  member.weight = std::max(1, weight);
+  member.bitrate_share_cb = bitrate_share_cb;
+  member.credit = 0;
+  member.demand = 0;
+  member.grant = 0;
+  member.fraction_lost = -1;
+  members_.push_back(member);
+  INF() << "Pacing " << members_.size() << " sender(s) together.";
+  UpdateBitrateShares();
+}
+
+void PacerGroup::RemovePacer(PacedSender* pacer) {
+  members_.erase(std::remove_if(members_.begin(), members_.end(),
+                                [pacer](const Member& member) {
+                                  return member.pacer == pacer;
+                                }),
+                 members_.end());
+  UpdateBitrateShares();
+}
+
+void PacerGroup::SetUplinkBitrate(uint32_t kbps) {
+  if (kbps == uplink_kbps_) return;
+  INF() << "Uplink shared by all senders: " << kbps << " kbps.";
+  uplink_kbps_ = kbps;
+  // Start over from the new uplink, the losses seen so far were against the
+  // old one.
+  rate_kbps_ = MaxRateKbps();
+  UpdateBitrateShares();
+}
+
+void PacerGroup::OnLossReport(const PacedSender* pacer, double fraction_lost) {
+  for (Member& member : members_) {
+    if (member.pacer == pacer) member.fraction_lost = fraction_lost;
+  }
+
+  const base::TimeTicks now = clock_->NowTicks();
+  if (now - last_rate_update_ <
+      base::TimeDelta::FromMilliseconds(kRateUpdateIntervalMs)) {
+    return;
+  }
+  last_rate_update_ = now;
+
+  // The senders share the uplink, so the worst losses are the ones it causes.
+  double worst = -1;
+  for (Member& member : members_) {
+    worst = std::max(worst, member.fraction_lost);
+    member.fraction_lost = -1;
+  }
+  if (worst >= 0) UpdateRate(worst);
+}
+
+void PacerGroup::Wake() {
+  if (burst_scheduled_) return;
+
+  burst_scheduled_ = true;
+  const base::TimeTicks now = clock_->NowTicks();
+  const base::TimeDelta delay =
+      last_burst_ + base::TimeDelta::FromMilliseconds(kBurstIntervalMs) - now;
+  pp::Module::Get()->core()->CallOnMainThread(
+      std::max<int64_t>(0, delay.InMillisecondsRoundedUp()),
+      factory_.NewCallback(&PacerGroup::RunBurst));
+}
+
+void PacerGroup::RunBurst(int32_t result) {
+  burst_scheduled_ = false;
+  last_burst_ = clock_->NowTicks();
+
+  double active_weight = 0;
+  bool queued = false;
+  for (Member& member : members_) {
+    member.demand = member.pacer->NextGroupBurstDemand();
+    member.grant = 0;
+    if (member.demand)
+      active_weight += member.weight;
+    else
+      member.credit = 0;
+    queued |= member.pacer->HasQueuedPackets();
+  }
+  // Nothing queued anywhere: the next packet wakes the group up again.
+  if (!queued) return;
+
+  budget_carry_ += PacketsPerBurst();
+  const size_t budget = static_cast<size_t>(budget_carry_);
+  budget_carry_ -= budget;
+
+  // Signed, and no grant goes past it: the grants of a burst never add up to
+  // more than its budget, whatever the pacers banked.
+  int64_t left = budget;
+  if (active_weight > 0) {
+    for (Member& member : members_) {
+      if (!member.demand) continue;
+      member.credit += budget * member.weight / active_weight;
+      const int64_t owed =
+          static_cast<int64_t>(std::max(0.0, std::floor(member.credit)));
+      member.grant = static_cast<size_t>(std::min(
+          {static_cast<int64_t>(member.demand), owed, left}));
+      member.credit -= member.grant;
+      left -= member.grant;
+    }
+
+    // Whatever is left goes a packet at a time to the pacers that want more,
+    // most owed first. They pay it back out of their next shares.
+    while (left > 0) {
+      Member* next = nullptr;
+      for (Member& member : members_) {
+        if (member.grant < member.demand &&
+            (!next || member.credit > next->credit)) {
+          next = &member;
+        }
+      }
+      if (!next) break;
+      ++next->grant;
+      next->credit -= 1;
+      --left;
+    }
+
+    // Don't let a pacer bank more than a burst either way.
+    for (Member& member : members_) {
+      member.credit = std::max(-static_cast<double>(budget),
+                               std::min(member.credit, 1.0));
+    }
+  }
+
+  // Granting may send packets and queue more on other pacers, but doesn't add
+  // or remove members.
+  for (Member& member : members_) member.pacer->StartGroupBurst(member.grant);
+
+  Wake();
+}
+
+double PacerGroup::GuaranteedPacketsPerBurst(const PacedSender* pacer) const {
+  int total_weight = 0;
+  int weight = 0;
+  for (const Member& member : members_) {
+    total_weight += member.weight;
+    if (member.pacer == pacer) weight = member.weight;
+  }
+  return total_weight ? PacketsPerBurst() * weight / total_weight : 0;
+}
+
+double PacerGroup::PacketsPerBurst() const {
+  // kbps * ms gives bits.
+  return std::max(1.0, rate_kbps_ * kBurstIntervalMs / 8.0 /
+                           static_cast<double>(kMaxIpPacketSize));
+}
+
+double PacerGroup::MaxRateKbps() const {
+  if (uplink_kbps_) return uplink_kbps_;
+  return kDefaultPacketsPerBurst * kMaxIpPacketSize * 8.0 / kBurstIntervalMs;
+}
+
+void PacerGroup::UpdateRate(double fraction_lost) {
+  const double max_rate = MaxRateKbps();
+  double rate = rate_kbps_;
+  if (fraction_lost > kHighLoss)
+    rate *= 1 - fraction_lost / 2;
+  else if (fraction_lost < kLowLoss)
+    rate *= kRateIncrease;
+  rate = std::max(std::min(kMinRateKbps, max_rate), std::min(rate, max_rate));
+  if (rate == rate_kbps_) return;
+
+  if (rate < rate_kbps_) {
+    INF() << "Receivers lost " << static_cast<int>(fraction_lost * 100)
+          << "% of the packets, pacing all senders at "
+          << static_cast<int>(rate) << " kbps.";
+  }
+  rate_kbps_ = rate;
+  UpdateBitrateShares();
+}
+
+void PacerGroup::UpdateBitrateShares() {
+  int total_weight = 0;
+  for (const Member& member : members_) total_weight += member.weight;
+
+  // Without an uplink, the encoders are only limited once losses brought the
+  // rate down.
+  const bool limited = uplink_kbps_ || rate_kbps_ < MaxRateKbps();
+  for (const Member& member : members_) {
+    const uint32_t share =
+        limited ? static_cast<uint32_t>(rate_kbps_ * member.weight /
+                                        total_weight)
+                : 0;
+    if (member.bitrate_share_cb) member.bitrate_share_cb(share);
+  }
+}
+
+}  // namespace sharer
@@ -0,0 +1,116 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_PACING_PACER_GROUP_H_
+#define NET_PACING_PACER_GROUP_H_
+
+#include "base/macros.h"
+#include "base/time/default_tick_clock.h"
+#include "base/time/time.h"
+
+#include "ppapi/utility/completion_callback_factory.h"
+
+#include <functional>
+#include <vector>
+
+namespace sharer {
+
+class PacedSender;
+
+// Paces the packets of several senders running side by side (e.g. a screen
+// and a camera, or several displays) against one uplink.
+//
+// Every PacedSender of the group stops running its own burst timer. Instead,
+// the group runs a single one, and on each burst splits one packet budget
+// between the pacers that have packets queued: each gets a share in
+// proportion to its weight, the fractions being carried over to the next
+// bursts, and whatever a pacer doesn't need goes to the ones that want more.
+// The same uplink bitrate is split by weight into a bitrate for each sender's
+// encoder.
+//
+// The senders also share one congestion controller. Each reports the losses
+// its receivers see, and the group lowers the rate it paces at, and with it
+// the encoder bitrates, when they go up, and raises it back towards the
+// uplink bitrate once they go away.
+class PacerGroup {
+ public:
+  using BitrateShareCb = std::function<void(uint32_t kbps)>;
+
+  static const int64_t kBurstIntervalMs = 10;
+  static const int64_t kRateUpdateIntervalMs = 1000;
+
+  PacerGroup();
+  ~PacerGroup();
+
+  // |bitrate_share_cb| is called with the encoder bitrate of the pacer's
+  // sender every time the shares change, including from this call. A share of
+  // 0 means unlimited.
+  void AddPacer(PacedSender* pacer, int weight,
+                const BitrateShareCb& bitrate_share_cb);
+  void RemovePacer(PacedSender* pacer);
+
+  // Bitrate of the uplink shared by the group, in kbps. 0, the default,
+  // sends up to 20 packets per burst (~24 Mbit/s) and only limits the
+  // encoders once losses brought the rate down.
+  void SetUplinkBitrate(uint32_t kbps);
+
+  // Fraction of the packets lost by the receivers of |pacer|, in [0, 1], as
+  // of their latest reports. The rate is updated from the worst report of
+  // all the pacers at most every kRateUpdateIntervalMs.
+  void OnLossReport(const PacedSender* pacer, double fraction_lost);
+
+  // Replaces the system clock, e.g. with simulated time in tests. |clock|
+  // must outlive the group.
+  void set_clock(base::TickClock* clock) { clock_ = clock; }
+
+  // A pacer of the group is waiting for budget.
+  void Wake();
+
+  // Packets |pacer| may send per burst even when all the other pacers are
+  // busy too.
+  double GuaranteedPacketsPerBurst(const PacedSender* pacer) const;
+
+ private:
+  struct Member {
+    PacedSender* pacer;
+    int weight;
+    BitrateShareCb bitrate_share_cb;
+    // Fraction of a packet owed to the pacer, or taken in advance when
+    // negative.
+    double credit;
+    size_t demand;
+    size_t grant;
+    // Latest loss report, or negative if there was none since the last rate
+    // update.
+    double fraction_lost;
+  };
+
+  void RunBurst(int32_t result);
+  double PacketsPerBurst() const;
+  // Most the rate can go up to: the uplink bitrate, or the default burst
+  // budget without one.
+  double MaxRateKbps() const;
+  void UpdateRate(double fraction_lost);
+  void UpdateBitrateShares();
+
+  pp::CompletionCallbackFactory<PacerGroup> factory_;
+  base::DefaultTickClock default_clock_;
+  base::TickClock* clock_;
+
+  std::vector<Member> members_;
+  uint32_t uplink_kbps_;
+  // Rate the group paces at, at most MaxRateKbps().
+  double rate_kbps_;
+  base::TimeTicks last_rate_update_;
+  double budget_carry_;
+
+  bool burst_scheduled_;
+  base::TimeTicks last_burst_;
+
+  DISALLOW_COPY_AND_ASSIGN(PacerGroup);
+};
+
+}  // namespace sharer
+
+#endif  // NET_PACING_PACER_GROUP_H_
@@ -18,6 +18,8 @@
 static const double kMagicFractionalUnit = 4.294967296E3;
 static const int64_t kUnixEpochInNtpSeconds = INT64_C(2208988800);
 static const int32_t kStatsHistoryWindowMs = 10000;
+// Receivers that haven't reported for this long are forgotten.
+static const int32_t kReceiverReportTimeoutMs = 10000;
 
 static uint32_t ConvertToNtpDiff(uint32_t delay_seconds,
                                  uint32_t delay_fraction) {
@@ -105,6 +107,9 @@ RtcpHandler::RtcpHandler(const RtcpSharerMessageCallback& sharer_callback,
 
 RtcpHandler::~RtcpHandler() {}
 
+RtcpHandler::ReceiverReport::ReceiverReport()
+    : fraction_lost(0), cumulative_lost(0) {}
+
 bool RtcpHandler::IncomingRtcpPausedPacket(
     const std::unique_ptr<RTCP>& packet) {
   DINF() << "Sender is paused";
@@ -126,7 +131,10 @@ bool RtcpHandler::IncomingRtcpPacket(const std::unique_ptr<RTCP>& packet) {
     return false;
   }
 
-  OnReceivedNtp(packet->ntpSeconds(), packet->ntpFraction());
+  const base::TimeTicks arrival_time = packet->arrival_time().is_null()
+                                           ? env_->clock()->NowTicks()
+                                           : packet->arrival_time();
+  OnReceivedNtp(packet->ntpSeconds(), packet->ntpFraction(), arrival_time);
   OnReceivedLipSyncInfo(packet);
   return true;
 }
@@ -149,14 +157,17 @@ bool RtcpHandler::IncomingRtcpPacket(const std::string& addr,
   if (parser.Parse(&reader)) {
     if (parser.has_sender_report()) {
       OnReceivedNtp(parser.sender_report().ntp_seconds,
-                    parser.sender_report().ntp_fraction);
+                    parser.sender_report().ntp_fraction,
+                    env_->clock()->NowTicks());
       OnReceivedLipSyncInfo(parser.sender_report().rtp_timestamp,
                             parser.sender_report().ntp_seconds,
                             parser.sender_report().ntp_fraction);
     }
     if (parser.has_last_report()) {
-      OnReceivedDelaySinceLastReport(parser.last_report(),
+      OnReceivedDelaySinceLastReport(addr, parser.last_report(),
                                      parser.delay_since_last_report());
+      OnReceivedLossReport(addr, parser.fraction_lost(),
+                           parser.cumulative_lost());
     }
     if (parser.has_sharer_message()) {
       OnReceivedSharerFeedback(addr, parser.sharer_message());
@@ -165,10 +176,10 @@ bool RtcpHandler::IncomingRtcpPacket(const std::string& addr,
   return true;
 }
 
-void RtcpHandler::OnReceivedNtp(uint32_t ntp_seconds, uint32_t ntp_fraction) {
+void RtcpHandler::OnReceivedNtp(uint32_t ntp_seconds, uint32_t ntp_fraction,
+                                base::TimeTicks now) {
   last_report_truncated_ntp_ = ConvertToNtpDiff(ntp_seconds, ntp_fraction);
 
-  const base::TimeTicks now = env_->clock()->NowTicks();
   time_last_report_received_ = now;
 
   const base::TimeDelta measured_offset =
@@ -205,7 +216,8 @@ void RtcpHandler::OnReceivedLipSyncInfo(uint32_t rtp_timestamp,
 }
 
 void RtcpHandler::OnReceivedDelaySinceLastReport(
-    uint32_t last_report, uint32_t delay_since_last_report) {
+    const std::string& addr, uint32_t last_report,
+    uint32_t delay_since_last_report) {
   auto it = last_reports_sent_map_.find(last_report);
   if (it == last_reports_sent_map_.end()) {
     return;  // Feedback on another report
@@ -218,10 +230,30 @@ void RtcpHandler::OnReceivedDelaySinceLastReport(
 
   current_round_trip_time_ =
       std::max(current_round_trip_time_, base::TimeDelta::FromMilliseconds(1));
+  receiver_reports_[addr].round_trip_time = current_round_trip_time_;
 
   if (rtt_callback_) rtt_callback_(current_round_trip_time_);
 }
 
+void RtcpHandler::OnReceivedLossReport(const std::string& addr,
+                                       uint8_t fraction_lost,
+                                       uint32_t cumulative_lost) {
+  const base::TimeTicks now = env_->clock()->NowTicks();
+  ReceiverReport& report = receiver_reports_[addr];
+  report.fraction_lost = fraction_lost;
+  report.cumulative_lost = cumulative_lost;
+  report.time = now;
+
+  const base::TimeDelta timeout =
+      base::TimeDelta::FromMilliseconds(kReceiverReportTimeoutMs);
+  for (auto it = receiver_reports_.begin(); it != receiver_reports_.end();) {
+    if (now - it->second.time > timeout)
+      it = receiver_reports_.erase(it);
+    else
+      ++it;
+  }
+}
+
 void RtcpHandler::OnReceivedSharerFeedback(
     const std::string& addr, const RtcpSharerMessage& sharer_message) {
   DINF() << "Received cast feedback. Missing frames: "
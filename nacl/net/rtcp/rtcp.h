@@ -15,8 +15,10 @@
 #include "common/clock_drift_smoother.h"
 #include "sharer_environment.h"
 
+#include <map>
 #include <memory>
 #include <queue>
+#include <string>
 
 class RTCP;
 
@@ -26,6 +28,18 @@ using RtcpSendTimeQueue = std::queue<RtcpSendTimePair>;
 
 class RtcpHandler {
  public:
+  // Latest receiver report of a receiver.
+  struct ReceiverReport {
+    ReceiverReport();
+
+    base::TimeDelta round_trip_time;
+    // Fraction of the packets lost since the previous report, in 1/256.
+    uint8_t fraction_lost;
+    uint32_t cumulative_lost;
+    base::TimeTicks time;
+  };
+  using ReceiverReportMap = std::map<std::string, ReceiverReport>;
+
   static bool IsRtcpPacket(const uint8_t* packet, size_t length);
   static uint32_t GetSsrcOfSender(const uint8_t* rtcp_bufer, size_t length);
 
@@ -57,16 +71,25 @@ class RtcpHandler {
   base::TimeDelta current_round_trip_time() const {
     return current_round_trip_time_;
   }
+  // Keyed by the address of the receivers that reported recently.
+  const ReceiverReportMap& receiver_reports() const {
+    return receiver_reports_;
+  }
 
  private:
-  void OnReceivedNtp(uint32_t ntp_seconds, uint32_t ntp_fraction);
+  // |now| is when the report arrived.
+  void OnReceivedNtp(uint32_t ntp_seconds, uint32_t ntp_fraction,
+                     base::TimeTicks now);
   void OnReceivedLipSyncInfo(const std::unique_ptr<RTCP>& packet);
   void OnReceivedLipSyncInfo(uint32_t rtp_timestamp, uint32_t ntp_seconds,
                              uint32_t ntp_fraction);
   void OnReceivedSharerFeedback(const std::string& addr,
                                 const RtcpSharerMessage& sharer_message);
-  void OnReceivedDelaySinceLastReport(uint32_t last_report,
+  void OnReceivedDelaySinceLastReport(const std::string& addr,
+                                      uint32_t last_report,
                                       uint32_t delay_since_last_report);
+  void OnReceivedLossReport(const std::string& addr, uint8_t fraction_lost,
+                            uint32_t cumulative_lost);
   void SaveLastSentNtpTime(const base::TimeTicks& now,
                            uint32_t last_ntp_seconds,
                            uint32_t last_ntp_fraction);
@@ -92,6 +115,7 @@ class RtcpHandler {
   uint64_t lip_sync_ntp_timestamp_;
 
   base::TimeDelta current_round_trip_time_;
+  ReceiverReportMap receiver_reports_;
 
   base::TimeTicks largest_seen_timestamp_;
 
@@ -231,7 +231,8 @@ void RtcpBuilder::AddSharer(const RtcpSharerMessage* cast,
   writer_.WriteU32(static_cast<uint32_t>(cast->ack_frame_id));
   uint8_t* sharer_loss_field_pos = reinterpret_cast<uint8_t*>(writer_.ptr());
   writer_.WriteU8(0);  // Overwritten with number_of_loss_fields.
-  writer_.WriteU8(0);  // padding
+  writer_.WriteU8(cast->request_key_frame ? kRtcpSharerFlagKeyFrameRequest
+                                          : 0);  // flags
   PP_DCHECK(target_delay.InMilliseconds() <=
             std::numeric_limits<uint16_t>::max());
   writer_.WriteU16(target_delay.InMilliseconds());
@@ -13,6 +13,7 @@
 
 #include "ppapi/c/ppb_net_address.h"
 
+#include <functional>
 #include <list>
 #include <map>
 #include <memory>
@@ -30,6 +31,10 @@ using MissingFramesAndPacketsMap = std::map<uint32_t, PacketIdSet>;
 
 static const uint16_t kRtcpSharerAllPacketsLost = 0xffff;
 
+// Bits carried in the flags byte that follows the number of loss fields in the
+// Sharer feedback message.
+static const uint8_t kRtcpSharerFlagKeyFrameRequest = 0x01;
+
 // Handle the per frame ACK and NACK messages.
 struct RtcpSharerMessage {
   explicit RtcpSharerMessage(uint32_t ssrc);
@@ -139,6 +144,7 @@ struct RtpReceiverStatistics {
   uint8_t fraction_lost;
   uint32_t cumulative_lost;  // 24 bits valid.
   uint32_t extended_high_sequence_number;
+  // Interarrival jitter, in RTP timestamp units.
   uint32_t jitter;
 };
 
@@ -14,6 +14,10 @@ RtcpParser::RtcpParser(uint32_t local_ssrc, uint32_t remote_ssrc)
     : local_ssrc_(local_ssrc),
       remote_ssrc_(remote_ssrc),
       has_sender_report_(false),
+      last_report_(0),
+      delay_since_last_report_(0),
+      fraction_lost_(0),
+      cumulative_lost_(0),
       has_last_report_(false),
       has_sharer_message_(false),
       has_receiver_reference_time_report_(false) {}
@@ -122,14 +126,17 @@ bool RtcpParser::ParseRR(BigEndianReader* reader,
 }
 
 bool RtcpParser::ParseReportBlock(BigEndianReader* reader) {
-  uint32_t ssrc, last_report, delay;
-  if (!reader->ReadU32(&ssrc) || !reader->Skip(12) ||
-      !reader->ReadU32(&last_report) || !reader->ReadU32(&delay))
+  uint32_t ssrc, lost, last_report, delay;
+  if (!reader->ReadU32(&ssrc) || !reader->ReadU32(&lost) ||
+      !reader->Skip(8) || !reader->ReadU32(&last_report) ||
+      !reader->ReadU32(&delay))
     return false;
 
   if (ssrc == local_ssrc_) {
     last_report_ = last_report;
     delay_since_last_report_ = delay;
+    fraction_lost_ = lost >> 24;
+    cumulative_lost_ = lost & 0xffffff;
     has_last_report_ = true;
   }
 
@@ -161,15 +168,18 @@ bool RtcpParser::ParseFeedbackCommon(BigEndianReader* reader,
 
   uint32_t last_frame_id;
   uint8_t number_of_lost_fields;
+  uint8_t flags;
   uint8_t padding;
   if (!reader->ReadU32(&last_frame_id) ||
       !reader->ReadU8(&number_of_lost_fields) ||
-      !reader->ReadU8(&padding) ||  // padding
+      !reader->ReadU8(&flags) ||
       !reader->ReadU16(&sharer_message_.target_delay_ms))
     return false;
 
   // Please note, this frame_id is still only 8-bit!
   sharer_message_.ack_frame_id = last_frame_id;
+  sharer_message_.request_key_frame =
+      (flags & kRtcpSharerFlagKeyFrameRequest) != 0;
 
   for (size_t i = 0; i < number_of_lost_fields; i++) {
     uint32_t frame_id;
@@ -45,6 +45,9 @@ class RtcpParser {
   bool has_last_report() const { return has_last_report_; }
   uint32_t last_report() const { return last_report_; }
   uint32_t delay_since_last_report() const { return delay_since_last_report_; }
+  // Loss reported along with the last report, see RtcpReportBlock.
+  uint8_t fraction_lost() const { return fraction_lost_; }
+  uint32_t cumulative_lost() const { return cumulative_lost_; }
 
   /* bool has_receiver_log() const { return !receiver_log_.empty(); } */
   /* const RtcpReceiverLogMessage& receiver_log() const { return receiver_log_;
@@ -91,6 +94,8 @@ class RtcpParser {
 
   uint32_t last_report_;
   uint32_t delay_since_last_report_;
+  uint8_t fraction_lost_;
+  uint32_t cumulative_lost_;
   bool has_last_report_;
 
   // |receiver_log_| is a vector vector, no need for has_*.
@@ -18,6 +18,7 @@ FrameBuffer::FrameBuffer()
       is_key_frame_(0),
       total_data_size_(0),
       last_referenced_frame_id_(0),
+      temporal_layer_id_(0),
       packets_() {}
 
 FrameBuffer::~FrameBuffer() {}
@@ -33,6 +34,7 @@ bool FrameBuffer::InsertPacket(std::unique_ptr<RTP> packet) {
       PP_DCHECK(packet->frameId() == packet->referenceFrameId());
     }
     last_referenced_frame_id_ = packet->referenceFrameId();
+    temporal_layer_id_ = packet->temporalLayerId();
     rtp_timestamp_ = packet->timestamp();
   }
 
@@ -68,6 +70,7 @@ bool FrameBuffer::AssembleEncodedFrame(EncodedFrame* frame) const {
     frame->dependency = EncodedFrame::DEPENDENT;
   frame->frame_id = frame_id_;
   frame->referenced_frame_id = last_referenced_frame_id_;
+  frame->temporal_layer_id = temporal_layer_id_;
   frame->rtp_timestamp = rtp_timestamp_;
   frame->new_playout_delay_ms = new_playout_delay_ms_;
 
@@ -34,6 +34,7 @@ class FrameBuffer {
     return last_referenced_frame_id_;
   }
   uint32_t frame_id() const { return frame_id_; }
+  uint8_t temporal_layer_id() const { return temporal_layer_id_; }
 
  private:
   uint32_t frame_id_;
@@ -44,6 +45,7 @@ class FrameBuffer {
   bool is_key_frame_;
   size_t total_data_size_;
   uint32_t last_referenced_frame_id_;
+  uint8_t temporal_layer_id_;
   uint32_t rtp_timestamp_;
   PacketMap packets_;
 };
@@ -15,6 +15,9 @@
 
 static const uint32_t kOldFrameThreshold = 120;
 
+// How far back a frame may reference a decoded frame.
+static const uint32_t kMaxReferenceDistance = 256;
+
 Framer::Framer(sharer::SharerEnvironment* env,
                RtpPayloadFeedback* incoming_payload_feedback, uint32_t ssrc,
                bool decoder_faster_than_max_frame_rate, int max_unacked_frames)
@@ -25,7 +28,8 @@ Framer::Framer(sharer::SharerEnvironment* env,
       waiting_for_key_(true),
       last_released_frame_(sharer::kStartFrameId),
       last_key_frame_received_(sharer::kStartFrameId),
-      newest_frame_id_(sharer::kStartFrameId) {}
+      newest_frame_id_(sharer::kStartFrameId),
+      max_temporal_layer_(0xff) {}
 
 Framer::~Framer() {}
 
@@ -43,7 +47,8 @@ bool Framer::InsertPacket(std::unique_ptr<RTP> packet, bool* duplicate) {
            << ", last released: " << last_released_frame_
            << ", last key: " << last_key_frame_received_;
     if (IsOlderFrameId(last_key_frame_received_ + kOldFrameThreshold,
-                       frame_id)) {
+                       frame_id) ||
+        !IsDecoded(last_key_frame_received_)) {
       waiting_for_key_ = true;
     } else {
       last_released_frame_ = last_key_frame_received_;
@@ -72,6 +77,11 @@ bool Framer::InsertPacket(std::unique_ptr<RTP> packet, bool* duplicate) {
     newest_frame_id_ = frame_id;
   }
 
+  if (packet->temporalLayerId() > max_temporal_layer_) {
+    skipped_frames_.insert(frame_id);
+    return false;
+  }
+
   // Does this packet belong to a new frame?
   auto it = frames_.find(frame_id);
   if (it == frames_.end()) {
@@ -187,6 +197,24 @@ bool Framer::NextFrameAllowingSkippingFrames(uint32_t* frame_id) const {
 
 void Framer::AckFrame(uint32_t frame_id) {
   sharer_msg_builder_->CompleteFrameReceived(frame_id);
+
+  // A key frame buffered before we started waiting can end the wait too, as
+  // can a frame resent from the last one we decoded.
+  auto frame_it = frames_.find(frame_id);
+  if (frame_it != frames_.end() &&
+      (frame_it->second->is_key_frame() ||
+       IsDecoded(frame_it->second->last_referenced_frame_id()))) {
+    waiting_for_key_ = false;
+  }
+
+  decoded_frames_.insert(frame_id);
+  const uint32_t oldest_reference = frame_id - kMaxReferenceDistance;
+  for (auto it = decoded_frames_.begin(); it != decoded_frames_.end();) {
+    if (IsOlderFrameId(*it, oldest_reference))
+      decoded_frames_.erase(it++);
+    else
+      ++it;
+  }
 }
 
 void Framer::ReleaseFrame(uint32_t frame_id) {
@@ -205,6 +233,13 @@ void Framer::ReleaseFrame(uint32_t frame_id) {
 
   last_released_frame_ = frame_id;
 
+  for (auto it = skipped_frames_.begin(); it != skipped_frames_.end();) {
+    if (IsOlderFrameId(*it, frame_id))
+      skipped_frames_.erase(it++);
+    else
+      ++it;
+  }
+
   if (skipped_old_frame) {
     sharer_msg_builder_->UpdateSharerMessage();
   }
@@ -215,9 +250,15 @@ void Framer::Reset() {
   last_released_frame_ = sharer::kStartFrameId;
   newest_frame_id_ = sharer::kStartFrameId;
   frames_.clear();
+  decoded_frames_.clear();
+  skipped_frames_.clear();
   sharer_msg_builder_->Reset();
 }
 
+bool Framer::IsSkippedFrame(uint32_t frame_id) const {
+  return skipped_frames_.find(frame_id) != skipped_frames_.end();
+}
+
 bool Framer::TimeToSendNextSharerMessage(base::TimeTicks* time_to_send) {
   return sharer_msg_builder_->TimeToSendNextSharerMessage(time_to_send);
 }
@@ -225,22 +266,29 @@ bool Framer::TimeToSendNextSharerMessage(base::TimeTicks* time_to_send) {
 void Framer::SendSharerMessage() { sharer_msg_builder_->UpdateSharerMessage(); }
 
 bool Framer::ContinuousFrame(const FrameBuffer& frame) const {
-  if (waiting_for_key_ && !frame.is_key_frame()) {
+  // Decoding resumes from a key frame, or from a frame that references one we
+  // decoded before losing track, e.g. when the sender recovers us by resending
+  // the frames after our last ack.
+  if (waiting_for_key_) return DecodableFrame(frame);
+
+  if (static_cast<uint32_t>(last_released_frame_ + 1) != frame.frame_id())
     return false;
-  }
 
-  return static_cast<uint32_t>(last_released_frame_ + 1) == frame.frame_id();
+  return DecodableFrame(frame);
 }
 
 bool Framer::DecodableFrame(const FrameBuffer& frame) const {
   if (frame.is_key_frame()) return true;
 
-  if (waiting_for_key_ && !frame.is_key_frame()) return false;
+  if (frame.last_referenced_frame_id() == frame.frame_id())
+    return !waiting_for_key_;
 
-  if (frame.last_referenced_frame_id() == frame.frame_id()) return true;
-
-  if (IsOlderFrameId(frame.last_referenced_frame_id(), last_released_frame_))
-    return true;
+  // Frames may reference any earlier frame, not only the previous one, e.g.
+  // when enhancement layer frames were dropped. Only the real reference
+  // matters.
+  return IsDecoded(frame.last_referenced_frame_id());
+}
 
-  return frame.last_referenced_frame_id() == last_released_frame_;
+bool Framer::IsDecoded(uint32_t frame_id) const {
+  return decoded_frames_.find(frame_id) != decoded_frames_.end();
 }
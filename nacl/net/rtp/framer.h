@@ -12,6 +12,7 @@
 
 #include <map>
 #include <memory>
+#include <set>
 
 class SharerMessageBuilder;
 class RTP;
@@ -37,6 +38,8 @@ class Framer {
   uint32_t NewestFrameId() const;
 
   int NumberOfCompleteFrames() const;
+  // Frames being received or waiting to be released.
+  size_t NumberOfFrames() const { return frames_.size(); }
 
   bool NextContinuousFrame(uint32_t* frame_id) const;
 
@@ -54,12 +57,21 @@ class Framer {
                          PacketIdSet* missing_packets) const;
   void ResetMsgBuilder();
   bool IsWaitingForKey() const { return waiting_for_key_; }
+  // Stops releasing frames until the next key frame arrives, or a frame that
+  // references a frame decoded before.
+  void RequestKeyFrame() { waiting_for_key_ = true; }
+
+  // Frames of temporal layers above |layer| are dropped as they arrive and
+  // never NACKed.
+  void SetMaxTemporalLayer(uint8_t layer) { max_temporal_layer_ = layer; }
+  bool IsSkippedFrame(uint32_t frame_id) const;
   int GetFrame() const { return last_key_frame_received_; }
   int GetKeyFrame() const { return last_key_frame_received_; }
 
  private:
   bool ContinuousFrame(const FrameBuffer& frame) const;
   bool DecodableFrame(const FrameBuffer& frame) const;
+  bool IsDecoded(uint32_t frame_id) const;
 
   const bool decoder_faster_than_max_frame_rate_;
 
@@ -73,6 +85,12 @@ class Framer {
   uint32_t last_released_frame_;
   uint32_t last_key_frame_received_;
   uint32_t newest_frame_id_;
+
+  uint8_t max_temporal_layer_;
+  // Frames handed to the decoder, which later frames can reference.
+  std::set<uint32_t> decoded_frames_;
+  // Frames dropped because of |max_temporal_layer_|.
+  std::set<uint32_t> skipped_frames_;
 };
 
 #endif  // _FRAMER_H_
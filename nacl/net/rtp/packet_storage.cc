@@ -11,7 +11,11 @@
 
 namespace sharer {
 
-PacketStorage::PacketStorage() : first_frame_id_in_list_(0), zombie_count_(0) {}
+PacketStorage::PacketStorage()
+    : first_frame_id_in_list_(0),
+      has_key_frame_(false),
+      last_key_frame_id_(0),
+      zombie_count_(0) {}
 
 PacketStorage::~PacketStorage() {}
 
@@ -19,8 +23,16 @@ size_t PacketStorage::GetNumberOfStoredFrames() const {
   return frames_.size() - zombie_count_;
 }
 
+size_t PacketStorage::GetStoredBytes() const {
+  size_t bytes = 0;
+  for (const auto& frame : frames_)
+    for (const auto& packet : frame) bytes += packet.second->size();
+  return bytes;
+}
+
 void PacketStorage::StoreFrame(uint32_t frame_id,
-                               const SendPacketVector& packets) {
+                               const SendPacketVector& packets,
+                               bool is_key_frame) {
   if (packets.empty()) {
     PP_NOTREACHED();
     return;
@@ -45,6 +57,11 @@ void PacketStorage::StoreFrame(uint32_t frame_id,
 
   // Save new frame to the end of the list.
   frames_.push_back(packets);
+
+  if (is_key_frame) {
+    has_key_frame_ = true;
+    last_key_frame_id_ = frame_id;
+  }
 }
 
 void PacketStorage::ReleaseFrame(uint32_t frame_id) {
@@ -65,6 +82,23 @@ void PacketStorage::ReleaseFrame(uint32_t frame_id) {
   }
 }
 
+bool PacketStorage::GetLatestGop(uint32_t* key_frame_id,
+                                 uint32_t* newest_frame_id) const {
+  if (!has_key_frame_ || frames_.empty()) return false;
+
+  const uint32_t offset = last_key_frame_id_ - first_frame_id_in_list_;
+  if (offset >= frames_.size()) return false;
+
+  // Released frames leave holes that would make the GOP undecodable.
+  for (size_t i = offset; i < frames_.size(); ++i) {
+    if (frames_[i].empty()) return false;
+  }
+
+  *key_frame_id = last_key_frame_id_;
+  *newest_frame_id = first_frame_id_in_list_ + frames_.size() - 1;
+  return true;
+}
+
 const SendPacketVector* PacketStorage::GetFrame32(uint32_t frame_id) const {
   uint32_t index = frame_id - first_frame_id_in_list_;
   if (index >= frames_.size()) return NULL;
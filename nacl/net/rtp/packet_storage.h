@@ -18,7 +18,8 @@ class PacketStorage {
   virtual ~PacketStorage();
 
   // Store all the packets for a frame
-  void StoreFrame(uint32_t frame_id, const SendPacketVector& packets);
+  void StoreFrame(uint32_t frame_id, const SendPacketVector& packets,
+                  bool is_key_frame);
 
   // Release all the packets for a frame
   void ReleaseFrame(uint32_t frame_id);
@@ -30,11 +31,21 @@ class PacketStorage {
 
   // Get the number of stored frames
   size_t GetNumberOfStoredFrames() const;
+  // Bytes of all the stored packets.
+  size_t GetStoredBytes() const;
+
+  // Gets the frame ids of the latest key frame and of the newest frame stored
+  // after it (its GOP). Returns false if the key frame, or any frame after it,
+  // is no longer stored.
+  bool GetLatestGop(uint32_t* key_frame_id, uint32_t* newest_frame_id) const;
 
  private:
   std::deque<SendPacketVector> frames_;
   uint32_t first_frame_id_in_list_;
 
+  bool has_key_frame_;
+  uint32_t last_key_frame_id_;
+
   // The number of frames whose packets have been released, but the entry in
   // the |frames_| queue has not yet been popped.
   size_t zombie_count_;
@@ -8,16 +8,19 @@
 #include "net/rtp/rtp.h"
 #include "net/rtp/rtp_receiver_defines.h"
 
-#include "ppapi/cpp/core.h"
-#include "ppapi/cpp/module.h"
+#include "ppapi/cpp/logging.h"
 
 #include <cstdlib>
 
-ReceiverStats::ReceiverStats()
+ReceiverStats::ReceiverStats(int rtp_timebase)
     : min_sequence_number_(0),
       max_sequence_number_(0),
       total_number_packets_(0),
       sequence_number_cycles_(0),
+      rtp_timebase_(rtp_timebase),
+      have_transit_(false),
+      last_transit_(0),
+      jitter_q4_(0),
       interval_min_sequence_number_(0),
       interval_number_packets_(0),
       interval_wrap_count_(0) {}
@@ -62,9 +65,7 @@ RtpReceiverStatistics ReceiverStats::GetStatistics() {
   ret.extended_high_sequence_number =
       (sequence_number_cycles_ << 16) + max_sequence_number_;
 
-  // Jitter in milliseconds
-  int jit_ms = jitter_ * 1000;
-  ret.jitter = static_cast<uint32_t>(std::abs(jit_ms));
+  ret.jitter = jitter();
 
   // Reset interval values.
   interval_min_sequence_number_ = 0;
@@ -77,16 +78,19 @@ RtpReceiverStatistics ReceiverStats::GetStatistics() {
 void ReceiverStats::UpdateStatistics(const RTP& packet) {
   const uint16_t new_seq_num = packet.sequence();
 
-  if (interval_number_packets_ == 0) {
-    // First packet in the interval.
-    interval_min_sequence_number_ = new_seq_num;
-  }
   if (total_number_packets_ == 0) {
     // First incoming packet.
     min_sequence_number_ = new_seq_num;
     max_sequence_number_ = new_seq_num;
   }
 
+  // Packets resent or reordered would measure the repair, not the network.
+  const bool in_order = total_number_packets_ == 0 ||
+                        IsNewerSequenceNumber(new_seq_num, max_sequence_number_);
+  if (in_order && interval_number_packets_ == 0) {
+    // First packet in the interval.
+    interval_min_sequence_number_ = new_seq_num;
+  }
   if (IsNewerSequenceNumber(new_seq_num, max_sequence_number_)) {
     // Check wrap.
     if (new_seq_num < max_sequence_number_) {
@@ -96,21 +100,27 @@ void ReceiverStats::UpdateStatistics(const RTP& packet) {
     max_sequence_number_ = new_seq_num;
   }
 
-  // Compute Jitter.
-  const PP_Time now = pp::Module::Get()->core()->GetTime();
-  PP_TimeDelta delta_new_timestamp = packet.timestamp();
-  delta_new_timestamp /= 1000;  // store in seconds, not milisecods
-  if (total_number_packets_ > 0) {
-    // Update jitter.
-    PP_TimeDelta delta =
-        (now - last_received_packet_time_) -
-        ((delta_new_timestamp - last_received_timestamp_) / 90);
-    jitter_ += (delta - jitter_) / 16;
+  // Compute jitter, in integers as RFC 3550 A.8 does. The arrival time is
+  // converted to RTP units modulo 2^32, like the timestamps.
+  PP_DCHECK(!packet.arrival_time().is_null());
+  const int64_t arrival_us =
+      (packet.arrival_time() - base::TimeTicks()).InMicroseconds();
+  const uint32_t arrival =
+      static_cast<uint32_t>(arrival_us * rtp_timebase_ /
+                            base::Time::kMicrosecondsPerSecond);
+  const uint32_t transit = arrival - packet.timestamp();
+  if (in_order) {
+    if (have_transit_) {
+      const int32_t d = static_cast<int32_t>(transit - last_transit_);
+      const uint32_t abs_d = d < 0 ? -static_cast<uint32_t>(d) : d;
+      jitter_q4_ += abs_d - ((jitter_q4_ + 8) >> 4);
+    }
+    last_transit_ = transit;
+    have_transit_ = true;
   }
-  last_received_timestamp_ = delta_new_timestamp;
-  last_received_packet_time_ = now;
 
-  // Increment counters.
+  // Increment counters. Resent packets keep their sequence number, so the
+  // fraction lost of the interval is the loss before repairs.
   ++total_number_packets_;
-  ++interval_number_packets_;
+  if (in_order) ++interval_number_packets_;
 }
@@ -6,16 +6,20 @@
 #ifndef _RECEIVER_STATS_H_
 #define _RECEIVER_STATS_H_
 
+#include "base/time/time.h"
 #include "net/rtp/rtp.h"
 
-#include "ppapi/c/pp_time.h"
-
 class ReceiverStats {
  public:
-  explicit ReceiverStats();
+  // |rtp_timebase| is the clock rate of the RTP timestamps, in Hz.
+  explicit ReceiverStats(int rtp_timebase);
 
   RtpReceiverStatistics GetStatistics();
-  void UpdateStatistics(const RTP& header);
+  // |packet| must have its arrival time.
+  void UpdateStatistics(const RTP& packet);
+
+  // Interarrival jitter, in RTP timestamp units.
+  uint32_t jitter() const { return jitter_q4_ >> 4; }
 
  private:
   // Global metrics.
@@ -23,9 +27,13 @@ class ReceiverStats {
   uint16_t max_sequence_number_;
   uint32_t total_number_packets_;
   uint16_t sequence_number_cycles_;
-  PP_TimeDelta last_received_timestamp_;
-  PP_Time last_received_packet_time_;
-  PP_TimeDelta jitter_;
+
+  // RFC 3550 A.8, in RTP timestamp units: the relative transit time of the
+  // last packet, and the jitter times 16.
+  const int rtp_timebase_;
+  bool have_transit_;
+  uint32_t last_transit_;
+  uint32_t jitter_q4_;
 
   // Intermediate metrics - between RTCP reports.
   int interval_min_sequence_number_;
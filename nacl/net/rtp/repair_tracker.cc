@@ -0,0 +1,225 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/rtp/repair_tracker.h"
+
+#include "logging/logging_defines.h"
+#include "net/rtp/rtp_receiver_defines.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sharer {
+
+namespace {
+
+// Receivers NACK nothing older than 120 frames behind the newest one they
+// have seen (see Framer), so the losses of a frame are known by then.
+const uint32_t kWindowFrames = 120;
+
+// Bounds the memory used by the packets of the window, e.g. with large key
+// frames: the oldest frames are retired early past this.
+const size_t kMaxTrackedPackets = 8192;
+
+// Receivers tracked one by one, and NACKs kept per receiver.
+const size_t kMaxReceivers = 64;
+const size_t kMaxPendingNacks = 1024;
+
+// Bits of the linear counting bitmap of the receivers that lost a packet.
+const int kLossPeersBits = 64;
+
+const uint16_t kMaxPacketId = 0xffff;
+
+const std::vector<int64_t> kLossPeersBounds = {1, 2, 4, 8, 16, 32, 64};
+
+uint64_t LossPeerBit(const std::string& addr) {
+  // Fibonacci hashing, so that similar addresses spread over the bitmap.
+  const uint32_t hash = ReceiverIdForAddress(addr) * 2654435761u;
+  return uint64_t(1) << (hash >> 26);
+}
+
+// Linear counting: with |n| receivers hashed to |kLossPeersBits| bits, the
+// expected fraction of zero bits is exp(-n / kLossPeersBits).
+int EstimateLossPeers(uint64_t bitmap) {
+  int zero_bits = kLossPeersBits;
+  for (; bitmap; bitmap &= bitmap - 1) --zero_bits;
+  if (zero_bits == kLossPeersBits) return 0;
+  // Saturated, about as many receivers as the bitmap can tell apart.
+  if (zero_bits == 0) zero_bits = 1;
+  const double estimate =
+      -kLossPeersBits *
+      std::log(static_cast<double>(zero_bits) / kLossPeersBits);
+  return std::max(1, static_cast<int>(estimate + 0.5));
+}
+
+}  // namespace
+
+RepairTracker::ReceiverCounts::ReceiverCounts()
+    : nacked(0), resent(0), repaired(0), late_repairs(0) {}
+
+RepairTracker::PendingNack::PendingNack() : resent(false) {}
+
+RepairTracker::Receiver::Receiver() : error(0) {}
+
+RepairTracker::Receiver::~Receiver() {}
+
+RepairTracker::RepairTracker(MetricHistogram* loss_peers_metric)
+    : tracked_packets_(0),
+      has_newest_frame_id_(false),
+      newest_frame_id_(0),
+      receiver_count_(0),
+      lost_packets_(0),
+      packet_losses_(0),
+      shared_losses_(0),
+      upstream_losses_(0),
+      loss_peers_metric_(loss_peers_metric) {}
+
+RepairTracker::~RepairTracker() {}
+
+// static
+std::vector<int64_t> RepairTracker::LossPeersBounds() {
+  return kLossPeersBounds;
+}
+
+void RepairTracker::OnNack(const std::string& addr, uint32_t frame_id,
+                           uint16_t packet_id, bool resent,
+                           base::TimeTicks now,
+                           base::TimeDelta resend_interval) {
+  Receiver* receiver = GetReceiver(addr);
+  ++receiver->counts.nacked;
+  if (resent) ++receiver->counts.resent;
+
+  if (has_newest_frame_id_ &&
+      IsOlderFrameId(frame_id, newest_frame_id_ - kWindowFrames)) {
+    // Already retired, or too old to be told apart from the retired frames.
+    return;
+  }
+  AdvanceWindow(frame_id);
+
+  uint64_t& peers = loss_peers_[frame_id][packet_id];
+  if (!peers) ++tracked_packets_;
+  peers |= LossPeerBit(addr);
+
+  const auto key = std::make_pair(frame_id, packet_id);
+  auto it = receiver->pending.find(key);
+  if (it == receiver->pending.end()) {
+    if (receiver->pending.size() >= kMaxPendingNacks)
+      receiver->pending.erase(receiver->pending.begin());
+    it = receiver->pending.insert(std::make_pair(key, PendingNack())).first;
+  } else if (it->second.resent &&
+             now - it->second.resent_time >= resend_interval) {
+    // Asked again after the repair should have arrived.
+    ++receiver->counts.late_repairs;
+  }
+
+  if (resent) {
+    it->second.resent = true;
+    it->second.resent_time = now;
+  }
+
+  while (tracked_packets_ > kMaxTrackedPackets)
+    RetireFrame(loss_peers_.begin()->first);
+}
+
+void RepairTracker::OnAck(const std::string& addr, uint32_t frame_id) {
+  AdvanceWindow(frame_id);
+
+  auto receiver = receivers_.find(addr);
+  if (receiver == receivers_.end()) return;
+
+  auto& pending = receiver->second.pending;
+  for (auto it = pending.begin(); it != pending.end();) {
+    if (IsOlderFrameId(it->first.first, frame_id)) {
+      if (it->second.resent) ++receiver->second.counts.repaired;
+      pending.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+int RepairTracker::LossPeers(uint32_t frame_id, uint16_t packet_id) const {
+  auto frame = loss_peers_.find(frame_id);
+  if (frame == loss_peers_.end()) return 0;
+  auto packet = frame->second.find(packet_id);
+  if (packet == frame->second.end()) return 0;
+  return EstimateLossPeers(packet->second);
+}
+
+std::map<std::string, RepairTracker::ReceiverCounts>
+RepairTracker::GetReceiverCounts() const {
+  std::map<std::string, ReceiverCounts> counts;
+  for (const auto& receiver : receivers_)
+    counts[receiver.first] = receiver.second.counts;
+  return counts;
+}
+
+RepairTracker::Receiver* RepairTracker::GetReceiver(const std::string& addr) {
+  auto it = receivers_.find(addr);
+  if (it != receivers_.end()) return &it->second;
+
+  int64_t error = 0;
+  if (receivers_.size() >= kMaxReceivers) {
+    // Space-Saving: replace the receiver with the fewest NACKs, counting
+    // them for the new one since it may have had as many before.
+    auto evicted = receivers_.begin();
+    for (auto candidate = receivers_.begin(); candidate != receivers_.end();
+         ++candidate) {
+      if (candidate->second.counts.nacked + candidate->second.error <
+          evicted->second.counts.nacked + evicted->second.error) {
+        evicted = candidate;
+      }
+    }
+    const ReceiverCounts& counts = evicted->second.counts;
+    other_.nacked += counts.nacked;
+    other_.resent += counts.resent;
+    other_.repaired += counts.repaired;
+    other_.late_repairs += counts.late_repairs;
+    error = counts.nacked + evicted->second.error;
+    receivers_.erase(evicted);
+  }
+
+  Receiver* receiver = &receivers_[addr];
+  receiver->error = error;
+  return receiver;
+}
+
+void RepairTracker::AdvanceWindow(uint32_t frame_id) {
+  if (has_newest_frame_id_ && !IsNewerFrameId(frame_id, newest_frame_id_))
+    return;
+  has_newest_frame_id_ = true;
+  newest_frame_id_ = frame_id;
+
+  while (!loss_peers_.empty() &&
+         IsOlderFrameId(loss_peers_.begin()->first,
+                        newest_frame_id_ - kWindowFrames)) {
+    RetireFrame(loss_peers_.begin()->first);
+  }
+}
+
+void RepairTracker::RetireFrame(uint32_t frame_id) {
+  auto frame = loss_peers_.find(frame_id);
+  if (frame == loss_peers_.end()) return;
+
+  for (const auto& packet : frame->second) {
+    const int peers = EstimateLossPeers(packet.second);
+    ++lost_packets_;
+    packet_losses_ += peers;
+    if (peers >= 2) shared_losses_ += peers;
+    if (peers >= 2 && static_cast<size_t>(peers) * 2 >= receiver_count_)
+      upstream_losses_ += peers;
+    if (loss_peers_metric_) loss_peers_metric_->Add(peers);
+  }
+  tracked_packets_ -= frame->second.size();
+  loss_peers_.erase(frame);
+
+  // Whatever the receivers still miss of it, they won't ask for it again.
+  for (auto& receiver : receivers_) {
+    auto& pending = receiver.second.pending;
+    pending.erase(pending.lower_bound(std::make_pair(frame_id, uint16_t(0))),
+                  pending.upper_bound(std::make_pair(frame_id, kMaxPacketId)));
+  }
+}
+
+}  // namespace sharer
@@ -0,0 +1,133 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_RTP_REPAIR_TRACKER_H_
+#define NET_RTP_REPAIR_TRACKER_H_
+
+#include "base/macros.h"
+#include "base/time/time.h"
+#include "logging/metrics_registry.h"
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace sharer {
+
+// Loss and repair accounting of one stream on the sender, from the NACKs and
+// acks of its receivers.
+//
+// Per receiver, counts the packets it NACKed, those resent to it, those it
+// acked after NACKing them (repaired), and those it NACKed again more than a
+// resend interval after they were resent (the repair was lost or came too
+// late). Per packet, estimates how many receivers lost it: a loss shared by
+// many receivers happened upstream and is best repaired by multicast, one
+// lost by a single receiver happened on its last hop.
+//
+// Memory is bounded whatever the number of receivers: the |kMaxReceivers|
+// receivers with the most NACKs are tracked one by one (Space-Saving), the
+// others are added up together, and the receivers that lost a packet are
+// counted with a small bitmap (linear counting) over the recent frames only.
+class RepairTracker {
+ public:
+  struct ReceiverCounts {
+    ReceiverCounts();
+
+    int64_t nacked;
+    int64_t resent;
+    int64_t repaired;
+    int64_t late_repairs;
+  };
+
+  // |loss_peers_metric|, if not null, gets the estimated number of receivers
+  // that lost each packet, see LossPeers().
+  explicit RepairTracker(MetricHistogram* loss_peers_metric);
+  ~RepairTracker();
+
+  // |addr| NACKed |packet_id| of |frame_id|, and it was queued to be resent
+  // to it if |resent|. A NACK less than |resend_interval| after the last
+  // resend is taken as sent before the repair could arrive.
+  void OnNack(const std::string& addr, uint32_t frame_id, uint16_t packet_id,
+              bool resent, base::TimeTicks now,
+              base::TimeDelta resend_interval);
+  // |addr| has every frame up to |frame_id|.
+  void OnAck(const std::string& addr, uint32_t frame_id);
+
+  // Used to tell losses of most receivers apart, see upstream_losses().
+  void set_receiver_count(size_t receiver_count) {
+    receiver_count_ = receiver_count;
+  }
+
+  // Estimated number of receivers that NACKed |packet_id| of |frame_id|, 0 if
+  // none did or the frame is too old to be tracked. For the repair policy.
+  int LossPeers(uint32_t frame_id, uint16_t packet_id) const;
+
+  // Receivers tracked one by one, and the sum of the others.
+  std::map<std::string, ReceiverCounts> GetReceiverCounts() const;
+  const ReceiverCounts& other_receivers() const { return other_; }
+
+  // Of the frames that left the tracking window: packets NACKed by at least
+  // one receiver, and the sum over these of the receivers that lost them.
+  int64_t lost_packets() const { return lost_packets_; }
+  int64_t packet_losses() const { return packet_losses_; }
+  // Of |packet_losses()|, those of packets lost by two receivers or more, and
+  // by at least half of the receivers.
+  int64_t shared_losses() const { return shared_losses_; }
+  int64_t upstream_losses() const { return upstream_losses_; }
+
+  // Buckets for |loss_peers_metric|.
+  static std::vector<int64_t> LossPeersBounds();
+
+ private:
+  struct PendingNack {
+    PendingNack();
+
+    bool resent;
+    base::TimeTicks resent_time;
+  };
+
+  struct Receiver {
+    Receiver();
+    ~Receiver();
+
+    ReceiverCounts counts;
+    // NACKs of the first tracked receiver evicted to make room for this one,
+    // so that it is not evicted before catching up (Space-Saving).
+    int64_t error;
+    // Keyed by frame id and packet id.
+    std::map<std::pair<uint32_t, uint16_t>, PendingNack> pending;
+  };
+
+  Receiver* GetReceiver(const std::string& addr);
+  // Makes |frame_id| the newest frame if it is, moving the frames that leave
+  // the window to the loss statistics.
+  void AdvanceWindow(uint32_t frame_id);
+  // Adds the losses of |frame_id| to the statistics, and forgets the NACKs of
+  // the receivers for it.
+  void RetireFrame(uint32_t frame_id);
+
+  std::map<std::string, Receiver> receivers_;
+  ReceiverCounts other_;
+
+  // Bitmaps of the receivers that NACKed each packet of the recent frames.
+  std::map<uint32_t, std::map<uint16_t, uint64_t>> loss_peers_;
+  size_t tracked_packets_;
+  bool has_newest_frame_id_;
+  uint32_t newest_frame_id_;
+
+  size_t receiver_count_;
+  int64_t lost_packets_;
+  int64_t packet_losses_;
+  int64_t shared_losses_;
+  int64_t upstream_losses_;
+  MetricHistogram* const loss_peers_metric_;
+
+  DISALLOW_COPY_AND_ASSIGN(RepairTracker);
+};
+
+}  // namespace sharer
+
+#endif  // NET_RTP_REPAIR_TRACKER_H_
@@ -41,7 +41,8 @@ RTP::RTP(const unsigned char* data, int32_t size, unsigned char pt)
       max_packet_id_(0),
       frame_id_(0),
       reference_frame_id_(0),
-      new_playout_delay_ms_(0) {
+      new_playout_delay_ms_(0),
+      temporal_layer_id_(0) {
   BigEndianReader reader(reinterpret_cast<const char*>(buffer_.data()), size);
   reader.Skip(2);
 
@@ -60,7 +61,7 @@ RTP::RTP(const unsigned char* data, int32_t size, unsigned char pt)
     return;
   }
 
-  if (payloadType_ == RTP::VIDEO && ssrc_ != 11) {
+  if (payloadType_ == RTP::VIDEO && sharer::SimulcastLayerForSsrc(ssrc_) < 0) {
     valid_ = false;
     return;
   }
@@ -124,6 +125,13 @@ RTP::RTP(const unsigned char* data, int32_t size, unsigned char pt)
           valid_ = false;
           return;
         }
+        break;
+      case 2:
+        if (!chunk.ReadU8(&temporal_layer_id_)) {
+          valid_ = false;
+          return;
+        }
+        break;
     }
   }
 
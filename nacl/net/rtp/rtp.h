@@ -6,6 +6,7 @@
 #ifndef _RTP_
 #define _RTP_
 
+#include "base/time/time.h"
 #include "net/rtcp/rtcp_defines.h"
 
 #include "ppapi/cpp/instance.h"
@@ -43,9 +44,15 @@ class RTPBase {
   bool isRTP() const { return !rtcp_; }
   bool isRTCP() const { return rtcp_; }
 
+  // When the packet came off the socket, before it waited to be parsed and
+  // handled. Null if the transport didn't say.
+  base::TimeTicks arrival_time() const { return arrival_time_; }
+  void set_arrival_time(base::TimeTicks time) { arrival_time_ = time; }
+
  protected:
   std::vector<uint8_t> buffer_;
   bool rtcp_;
+  base::TimeTicks arrival_time_;
 };
 
 class RTP : public RTPBase {
@@ -67,6 +74,7 @@ class RTP : public RTPBase {
   uint32_t frameId() const { return frame_id_; }
   uint32_t referenceFrameId() const { return reference_frame_id_; }
   uint16_t newPlayoutDelayMs() const { return new_playout_delay_ms_; }
+  uint8_t temporalLayerId() const { return temporal_layer_id_; }
 
  private:
   unsigned char payloadType_;
@@ -84,6 +92,7 @@ class RTP : public RTPBase {
   uint32_t frame_id_;
   uint32_t reference_frame_id_;
   uint16_t new_playout_delay_ms_;
+  uint8_t temporal_layer_id_;
 };
 
 class RTCP : public RTPBase {
@@ -18,6 +18,7 @@ static const uint8_t kSharerExtensionCountmask = 0x3f;
 
 // Sharer RTP extensions.
 static const uint8_t kSharerRtpExtensionAdaptiveLatency = 1;
+static const uint8_t kSharerRtpExtensionTemporalLayer = 2;
 
 }  // namespace sharer
 
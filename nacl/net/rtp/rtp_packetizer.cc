@@ -8,6 +8,7 @@
 #include "base/big_endian.h"
 #include "net/rtp/packet_storage.h"
 #include "net/rtp/rtp_defines.h"
+#include "sharer_environment.h"
 
 #include "ppapi/cpp/logging.h"
 
@@ -23,10 +24,12 @@ RtpPacketizerConfig::~RtpPacketizerConfig() {}
 
 RtpPacketizer::RtpPacketizer(PacedSender* const transport,
                              PacketStorage* packet_storage,
-                             RtpPacketizerConfig rtp_packetizer_config)
+                             RtpPacketizerConfig rtp_packetizer_config,
+                             SharerEnvironment* env)
     : config_(rtp_packetizer_config),
       transport_(transport),
       packet_storage_(packet_storage),
+      env_(env),
       sequence_number_(config_.sequence_number),
       rtp_timestamp_(0),
       packet_id_(0),
@@ -70,6 +73,7 @@ void RtpPacketizer::SendFrameAsPackets(const EncodedFrame& frame) {
     PP_DCHECK(frame.dependency != EncodedFrame::UNKNOWN_DEPENDENCY);
     uint8_t num_extensions = 0;
     if (frame.new_playout_delay_ms) num_extensions++;
+    if (frame.temporal_layer_id) num_extensions++;
     uint8_t byte0 = kSharerReferenceFrameIdBitMask;
     if (frame.dependency == EncodedFrame::KEY) byte0 |= kSharerKeyFrameBitMask;
     PP_DCHECK(num_extensions <= kSharerExtensionCountmask);
@@ -89,6 +93,11 @@ void RtpPacketizer::SendFrameAsPackets(const EncodedFrame& frame) {
       packet->push_back(static_cast<uint8_t>(frame.new_playout_delay_ms >> 8));
       packet->push_back(static_cast<uint8_t>(frame.new_playout_delay_ms));
     }
+    if (frame.temporal_layer_id) {
+      packet->push_back(kSharerRtpExtensionTemporalLayer << 2);
+      packet->push_back(1);  // 1 byte
+      packet->push_back(frame.temporal_layer_id);
+    }
 
     // Copy payload data.
     packet->insert(packet->end(), data_iter, data_iter + payload_length);
@@ -104,10 +113,22 @@ void RtpPacketizer::SendFrameAsPackets(const EncodedFrame& frame) {
   }
   PP_DCHECK(packet_id_ == num_packets);  // Invalid state;
 
-  packet_storage_->StoreFrame(frame.frame_id, packets);
+  // Logged before the pacer sends the first packets.
+  FrameEvent event;
+  event.timestamp = env_->clock()->NowTicks();
+  event.type = FRAME_PACKETIZED;
+  event.media_type = VIDEO_EVENT;
+  event.ssrc = config_.ssrc;
+  event.rtp_timestamp = frame.rtp_timestamp;
+  event.frame_id = frame.frame_id;
+  event.size = frame.data.size();
+  env_->logger()->DispatchFrameEvent(event);
+
+  packet_storage_->StoreFrame(frame.frame_id, packets,
+                              frame.dependency == EncodedFrame::KEY);
 
   // Send to network.
-  transport_->SendPackets(packets);
+  transport_->SendPackets(packets, frame.temporal_layer_id > 0);
 
   // Prepare for next frame.
   packet_id_ = 0;
@@ -15,6 +15,7 @@ namespace sharer {
 
 class PacedSender;
 class PacketStorage;
+class SharerEnvironment;
 
 struct RtpPacketizerConfig {
   RtpPacketizerConfig();
@@ -29,8 +30,10 @@ struct RtpPacketizerConfig {
 
 class RtpPacketizer {
  public:
+  // Logs a FRAME_PACKETIZED event to the logger of |env| for every frame.
   RtpPacketizer(PacedSender* const transport, PacketStorage* packet_storage,
-                RtpPacketizerConfig rtp_packetizer_config);
+                RtpPacketizerConfig rtp_packetizer_config,
+                SharerEnvironment* env);
   ~RtpPacketizer();
 
   void SendFrameAsPackets(const EncodedFrame& frame);
@@ -46,6 +49,7 @@ class RtpPacketizer {
   RtpPacketizerConfig config_;
   PacedSender* const transport_;
   PacketStorage* packet_storage_;
+  SharerEnvironment* const env_;
 
   uint16_t sequence_number_;
   uint32_t rtp_timestamp_;
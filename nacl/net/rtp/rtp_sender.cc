@@ -5,7 +5,6 @@
 
 #include "net/rtp/rtp_sender.h"
 
-#include "base/big_endian.h"
 #include "base/logger.h"
 #include "base/ptr_utils.h"
 #include "base/rand_util.h"
@@ -13,19 +12,8 @@
 
 namespace sharer {
 
-namespace {
-
-// If there is only one reference to the packet then copy the
-// reference and return.
-// Otherwise return a deep copy of the packet.
-PacketRef FastCopyPacket(const PacketRef& packet) {
-  if (packet.unique()) return packet;
-  return std::make_shared<Packet>(*packet);
-}
-
-}  // namespace
-
-RtpSender::RtpSender(PacedSender* const transport) : transport_(transport) {
+RtpSender::RtpSender(PacedSender* const transport, SharerEnvironment* env)
+    : transport_(transport), env_(env) {
   // Randomly set sequence number start value.
   config_.sequence_number = base::RandInt(0, 65535);
 }
@@ -35,7 +23,8 @@ RtpSender::~RtpSender() {}
 bool RtpSender::Initialize(const SharerTransportRtpConfig& config) {
   config_.ssrc = config.ssrc;
   config_.payload_type = config.rtp_payload_type;
-  packetizer_ = make_unique<RtpPacketizer>(transport_, &storage_, config_);
+  packetizer_ =
+      make_unique<RtpPacketizer>(transport_, &storage_, config_, env_);
   return true;
 }
 
@@ -52,7 +41,9 @@ void RtpSender::SendFrame(const EncodedFrame& frame) {
 void RtpSender::ResendPackets(
     const std::string& addr,
     const MissingFramesAndPacketsMap& missing_frames_and_packets,
-    bool cancel_rtx_if_not_in_list, const DedupInfo& dedup_info) {
+    bool cancel_rtx_if_not_in_list, const DedupInfo& dedup_info,
+    RepairTracker* repairs) {
+  const base::TimeTicks now = env_->clock()->NowTicks();
   // Iterate over all frames in the list.
   for (MissingFramesAndPacketsMap::const_iterator it =
            missing_frames_and_packets.begin();
@@ -70,8 +61,8 @@ void RtpSender::ResendPackets(
 
     const SendPacketVector* stored_packets = storage_.GetFrame32(frame_id);
     if (!stored_packets) {
-      DERR() << "Can't resend " << missing_packet_set.size()
-             << " packets for frame:" << frame_id;
+      DERR_EVERY_MS(1000) << "Can't resend " << missing_packet_set.size()
+                          << " packets for frame:" << frame_id;
       continue;
     }
 
@@ -97,20 +88,92 @@ void RtpSender::ResendPackets(
 
       if (resend) {
         // Resend packet to the network.
-        DINF() << "Resend " << static_cast<int>(frame_id) << ":" << packet_id
-               << ", dest: " << addr;
-        // Set a unique incremental sequence number for every packet.
-        PacketRef packet_copy = FastCopyPacket(it->second);
-        UpdateSequenceNumber(packet_copy);
-        packets_to_resend.push_back(std::make_pair(packet_key, packet_copy));
+        DINF_EVERY_MS(1000) << "Resend " << static_cast<int>(frame_id) << ":"
+                            << packet_id << ", dest: " << addr;
+        // Resent packets keep their sequence number: the stream is shared by
+        // all the receivers of the group, and a new one would be a loss for
+        // those that don't get the repair.
+        packets_to_resend.push_back(std::make_pair(packet_key, it->second));
       } else if (cancel_rtx_if_not_in_list) {
         transport_->CancelSendingPacket(addr, it->first);
       }
     }
-    transport_->ResendPackets(addr, packets_to_resend, dedup_info);
+    std::vector<PacketKey> queued_packets;
+    transport_->ResendPackets(addr, packets_to_resend, dedup_info,
+                              repairs ? &queued_packets : nullptr);
+    if (!repairs) continue;
+
+    // The queued packets keep their order in |packets_to_resend|.
+    size_t queued = 0;
+    for (const auto& packet : packets_to_resend) {
+      const bool resent = queued < queued_packets.size() &&
+                          queued_packets[queued] == packet.first;
+      if (resent) ++queued;
+      repairs->OnNack(addr, frame_id, packet.first.second.second, resent, now,
+                      dedup_info.resend_interval);
+    }
   }
 }
 
+bool RtpSender::SendGopToReceiver(const std::string& addr,
+                                  size_t max_frames) {
+  uint32_t key_frame_id;
+  uint32_t newest_frame_id;
+  if (!storage_.GetLatestGop(&key_frame_id, &newest_frame_id)) {
+    DWRN() << "No GOP stored, can't fast start " << addr;
+    return false;
+  }
+
+  const size_t gop_frames = newest_frame_id - key_frame_id + 1;
+  if (gop_frames > max_frames) {
+    DWRN() << "GOP of " << gop_frames << " frames is too long to fast start "
+           << addr;
+    return false;
+  }
+
+  SendPacketVector packets;
+  for (uint32_t frame_id = key_frame_id;
+       !IsNewerFrameId(frame_id, newest_frame_id); ++frame_id) {
+    const SendPacketVector* stored_packets = storage_.GetFrame32(frame_id);
+    PP_DCHECK(stored_packets);
+    packets.insert(packets.end(), stored_packets->begin(),
+                   stored_packets->end());
+  }
+
+  INF() << "Fast starting " << addr << " with frames " << key_frame_id << "-"
+        << newest_frame_id << " (" << packets.size() << " packets).";
+  return transport_->SendFastStartPackets(addr, packets);
+}
+
+bool RtpSender::SendRecoveryToReceiver(const std::string& addr,
+                                       uint32_t acked_frame_id) {
+  uint32_t key_frame_id;
+  uint32_t newest_frame_id;
+  if (!storage_.GetLatestGop(&key_frame_id, &newest_frame_id)) return false;
+
+  // Only worth it when resuming after the key frame. Before it, the GOP is
+  // both shorter and independent of the receiver's state.
+  if (!IsNewerFrameId(acked_frame_id, key_frame_id) ||
+      !IsNewerFrameId(newest_frame_id, acked_frame_id)) {
+    return false;
+  }
+
+  SendPacketVector packets;
+  for (uint32_t frame_id = acked_frame_id + 1;
+       !IsNewerFrameId(frame_id, newest_frame_id); ++frame_id) {
+    const SendPacketVector* stored_packets = storage_.GetFrame32(frame_id);
+    if (!stored_packets) return false;
+    packets.insert(packets.end(), stored_packets->begin(),
+                   stored_packets->end());
+  }
+
+  INF() << "Recovering " << addr << " from frame " << acked_frame_id << " with "
+        << newest_frame_id - acked_frame_id << " frames (" << packets.size()
+        << " packets) instead of " << newest_frame_id - key_frame_id + 1
+        << ".";
+  return transport_->SendFastStartPackets(addr, packets);
+}
+
 void RtpSender::ResendFrameForKickstart(uint32_t frame_id,
                                         base::TimeDelta dedupe_window) {
   // Send the last packet of the encoded frame to kick start
@@ -128,16 +191,6 @@ void RtpSender::ResendFrameForKickstart(uint32_t frame_id,
   // ResendPackets(missing_frames_and_packets, false, dedup_info);
 }
 
-void RtpSender::UpdateSequenceNumber(PacketRef packet) {
-  // TODO(miu): This is an abstraction violation.  This needs to be a part of
-  // the overall packet (de)serialization consolidation.
-  static const int kByteOffsetToSequenceNumber = 2;
-  BigEndianWriter big_endian_writer(
-      reinterpret_cast<char*>((packet->data()) + kByteOffsetToSequenceNumber),
-      sizeof(uint16_t));
-  big_endian_writer.WriteU16(packetizer_->NextSequenceNumber());
-}
-
 int64_t RtpSender::GetLastByteSentForFrame(uint32_t frame_id) {
   const SendPacketVector* stored_packets = storage_.GetFrame32(frame_id);
   if (!stored_packets) return 0;
@@ -14,6 +14,7 @@
 /* #include "net/sharer_transport_sender.h" */
 #include "net/pacing/paced_sender.h"
 #include "net/rtp/packet_storage.h"
+#include "net/rtp/repair_tracker.h"
 #include "net/rtp/rtp_packetizer.h"
 
 #include <map>
@@ -27,7 +28,7 @@ namespace sharer {
 // acknowledged by the remote peer or timed out.
 class RtpSender {
  public:
-  RtpSender(PacedSender* const transport);
+  RtpSender(PacedSender* const transport, SharerEnvironment* env);
 
   ~RtpSender();
 
@@ -37,10 +38,26 @@ class RtpSender {
 
   void SendFrame(const EncodedFrame& frame);
 
+  // Counts each packet asked for in |repairs| if not null, and whether it
+  // was resent.
   void ResendPackets(const std::string& addr,
                      const MissingFramesAndPacketsMap& missing_packets,
                      bool cancel_rtx_if_not_in_list,
-                     const DedupInfo& dedup_info);
+                     const DedupInfo& dedup_info,
+                     RepairTracker* repairs = nullptr);
+
+  // Sends the stored packets of the latest key frame and every frame after it
+  // to |addr|, so a receiver that just joined can start decoding without
+  // waiting for the next key frame. Returns false if the GOP is no longer
+  // stored or spans more than |max_frames| frames.
+  bool SendGopToReceiver(const std::string& addr, size_t max_frames);
+
+  // Sends the stored packets of every frame after |acked_frame_id| to |addr|,
+  // so a receiver that lost track can resume from the last frame it decoded.
+  // Returns false if that is no less than the latest GOP, or some of these
+  // frames are no longer stored.
+  bool SendRecoveryToReceiver(const std::string& addr,
+                              uint32_t acked_frame_id);
 
   // Returns the total number of bytes sent to the socket when the specified
   // frame was just sent.
@@ -60,14 +77,15 @@ class RtpSender {
     return packetizer_ ? packetizer_->send_octet_count() : 0;
   }
   uint32_t ssrc() const { return config_.ssrc; }
+  size_t stored_frames() const { return storage_.GetNumberOfStoredFrames(); }
+  size_t stored_bytes() const { return storage_.GetStoredBytes(); }
 
  private:
-  void UpdateSequenceNumber(PacketRef packet);
-
   RtpPacketizerConfig config_;
   PacketStorage storage_;
   std::unique_ptr<RtpPacketizer> packetizer_;
   PacedSender* const transport_;
+  SharerEnvironment* const env_;
 
   DISALLOW_COPY_AND_ASSIGN(RtpSender);
 };
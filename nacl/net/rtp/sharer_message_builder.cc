@@ -13,6 +13,8 @@
 
 static const int64_t kSharerMessageUpdateIntervalMs = 33;
 static const int64_t kNackRepeatIntervalMs = 30;
+// Minimum interval between feedback messages carrying only a new ack.
+static const int64_t kAckReportIntervalMs = 1000;
 
 SharerMessageBuilder::SharerMessageBuilder(
     sharer::SharerEnvironment* env, RtpPayloadFeedback* incoming_payload_feedback,
@@ -28,7 +30,12 @@ SharerMessageBuilder::SharerMessageBuilder(
       sharer_msg_(media_ssrc),
       /* slowing_down_ack_(false), */
       /* acked_last_frame_(true), */
-      last_completed_frame_id_(sharer::kStartFrameId) {
+      last_completed_frame_id_(sharer::kStartFrameId),
+      last_reported_ack_frame_id_(sharer::kStartFrameId),
+      nacks_sent_metric_(env_->metrics()->Counter(
+          "sharer_receiver_nacks_sent_total",
+          "Packets asked to be resent, a whole frame counting as one.",
+          {{"ssrc", std::to_string(media_ssrc)}})) {
   sharer_msg_.ack_frame_id = sharer::kStartFrameId;
 }
 
@@ -77,8 +84,21 @@ void SharerMessageBuilder::UpdateSharerMessage() {
   RtcpSharerMessage message(media_ssrc_);
   if (!UpdateSharerMessageInternal(&message)) return;
 
-  // Do not send cast message if no packet is missing
-  if (message.missing_frames_and_packets.empty()) return;
+  // Do not send cast message if no packet is missing, we are not waiting
+  // for a key frame and the sender heard about our last frame recently.
+  const base::TimeTicks now = env_->clock()->NowTicks();
+  const bool report_ack =
+      message.ack_frame_id != last_reported_ack_frame_id_ &&
+      now - last_ack_report_time_ >=
+          base::TimeDelta::FromMilliseconds(kAckReportIntervalMs);
+  if (message.missing_frames_and_packets.empty() &&
+      !message.request_key_frame && !report_ack)
+    return;
+
+  last_reported_ack_frame_id_ = message.ack_frame_id;
+  last_ack_report_time_ = now;
+  for (const auto& frame : message.missing_frames_and_packets)
+    nacks_sent_metric_->Increment(frame.second.size());
 
   // Send cast message.
   sharer_feedback_->SharerFeedback(message);
@@ -128,13 +148,15 @@ void SharerMessageBuilder::BuildPacketList() {
 
   // Clear message NACK list.
   sharer_msg_.missing_frames_and_packets.clear();
+  sharer_msg_.request_key_frame = false;
 
   // Are we missing packets?
   if (framer_->Empty()) return;
 
-  sharer_msg_.request_key_frame = framer_->IsWaitingForKey();
-
+  // Packets can't be NACKed before we have a key frame to decode from, so just
+  // ask the sender for one.
   if (framer_->IsWaitingForKey()) {
+    sharer_msg_.request_key_frame = true;
     return;
   }
 
@@ -144,6 +166,9 @@ void SharerMessageBuilder::BuildPacketList() {
   // Iterate over all frames.
   for (; !IsNewerFrameId(next_expected_frame_id, newest_frame_id);
        ++next_expected_frame_id) {
+    // We dropped this frame on purpose.
+    if (framer_->IsSkippedFrame(next_expected_frame_id)) continue;
+
     auto it = time_last_nacked_map_.find(next_expected_frame_id);
     if (it != time_last_nacked_map_.end()) {
       // We have sent a NACK in this frame before, make sure enough time have
@@ -57,6 +57,14 @@ class SharerMessageBuilder {
   /* bool acked_last_frame_; */
   uint32_t last_completed_frame_id_;
   std::deque<uint32_t> ack_queue_;
+
+  // Acks also go out on their own now and then, so that the sender knows
+  // where each receiver could resume from after losing track.
+  uint32_t last_reported_ack_frame_id_;
+  base::TimeTicks last_ack_report_time_;
+
+  // Packets asked for again, a whole frame counting as one.
+  sharer::MetricCounter* const nacks_sent_metric_;
 };
 
 #endif  // _CAST_MESSAGE_BUILDER_H_
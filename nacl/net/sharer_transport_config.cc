@@ -16,6 +16,7 @@ EncodedFrame::EncodedFrame()
     : dependency(UNKNOWN_DEPENDENCY),
       frame_id(0),
       referenced_frame_id(0),
+      temporal_layer_id(0),
       rtp_timestamp(0),
       new_playout_delay_ms(0) {}
 
@@ -26,6 +27,7 @@ void EncodedFrame::CopyMetadataTo(EncodedFrame* dest) const {
   dest->dependency = this->dependency;
   dest->frame_id = this->frame_id;
   dest->referenced_frame_id = this->referenced_frame_id;
+  dest->temporal_layer_id = this->temporal_layer_id;
   dest->rtp_timestamp = this->rtp_timestamp;
   dest->reference_time = this->reference_time;
 }
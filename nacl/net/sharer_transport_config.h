@@ -89,6 +89,11 @@ struct EncodedFrame {
   // (e.g., key frames), |referenced_frame_id| must equal |frame_id|.
   uint32_t referenced_frame_id;
 
+  // Temporal layer of this frame. Frames of the base layer (0) only reference
+  // base layer frames, so any frame of a higher layer can be dropped without
+  // breaking the decoding of the layers below it.
+  uint8_t temporal_layer_id;
+
   // The stream timestamp, on the timeline of the signal data.  For example, RTP
   // timestamps for audio are usually defined as the total number of audio
   // samples encoded in all prior frames.  A playback system uses this value to
@@ -11,6 +11,7 @@
 
 #include <stdint.h>
 
+#include <functional>
 #include <map>
 #include <set>
 #include <string>
@@ -74,6 +75,14 @@ class FrameIdWrapHelper {
 
 using TransportInitializedCb = std::function<void(bool result)>;
 
+// Destination the pacer uses for video packets of simulcast layer |layer|.
+// With layered multicast each layer is sent to its own group, see
+// UdpTransport; otherwise it resolves to the configured group like
+// "multicast" does.
+inline std::string MulticastAddrForLayer(int layer) {
+  return "multicast/" + std::to_string(layer);
+}
+
 }  // namespace sharer
 
 #endif  // NET_CAST_TRANSPORT_DEFINES_H_
@@ -8,31 +8,68 @@
 #include "base/logger.h"
 #include "base/ptr_utils.h"
 #include "net/rtcp/rtcp.h"
+#include "sharer_defines.h"
 
 #include "ppapi/cpp/logging.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace sharer {
 
-TransportSender::TransportSender(SharerEnvironment* env,
-                                 const SenderConfig& config,
-                                 const TransportInitializedCb& cb)
+namespace {
+
+// Receivers drop everything older than 120 frames behind the newest one they
+// have seen (see Framer), so longer GOPs can't be used to fast start.
+const size_t kMaxFastStartFrames = 90;
+
+// Key frame requests from a receiver are ignored for this long after sending
+// it a GOP, since they were most likely sent before the burst arrived.
+const int64_t kFastStartIntervalMs = 2000;
+
+// Receivers send RTCP every 500 ms, so one silent for this long has left,
+// as RtcpHandler also assumes of its reports. It is fast started again if it
+// comes back.
+const int64_t kReceiverTimeoutMs = 10000;
+const int64_t kReceiverExpiryIntervalMs = 1000;
+
+// Receivers tracked at once. Past this, a new one replaces the one silent
+// for the longest time.
+const size_t kMaxReceivers = 4096;
+
+}  // namespace
+
+TransportSender::TransportSender(
+    SharerEnvironment* env, const SenderConfig& config,
+    PacerGroup* pacer_group, const PacerGroup::BitrateShareCb& bitrate_share_cb,
+    const TransportInitializedCb& cb)
     : env_(env),
       // TODO: Figure out the correct send_buffer_size
-      transport_(env_, config.remote_address, config.remote_port, 4096, cb),
-      pacer_(env_, &transport_) {
+      transport_(env_, config.remote_address, config.remote_port,
+                 config.layered_multicast ? config.simulcast_layers : 1, 4096,
+                 cb),
+      pacer_(env_, &transport_),
+      pacer_group_(pacer_group),
+      metrics_collector_(env_->metrics()->AddCollector(
+          [this](MetricsSnapshot* snapshot) { CollectMetrics(snapshot); })) {
   PP_DCHECK(env_->clock());
   if (!env_->clock()) {
     ERR() << "Clock can't be null.";
     return;
   }
 
+  if (pacer_group)
+    pacer_.JoinGroup(pacer_group, config.pacing_weight, bitrate_share_cb);
+
   transport_.StartReceiving(
       [this](const std::string& addr, std::unique_ptr<Packet> packet) {
         this->OnReceivedPacket(addr, std::move(packet));
       });
 }
 
-TransportSender::~TransportSender() {}
+TransportSender::~TransportSender() {
+  env_->metrics()->RemoveCollector(metrics_collector_);
+}
 
 void TransportSender::AddValidSsrc(uint32_t ssrc) { valid_ssrcs_.insert(ssrc); }
 
@@ -53,10 +90,20 @@ void TransportSender::OnReceivedPacket(const std::string& addr,
     return;
   }
 
-  if (video_rtcp_session_ &&
-      video_rtcp_session_->IncomingRtcpPacket(addr, data, length)) {
-    // Received and correctly processed RTCP packet
-    return;
+  if (UpdateReceiver(addr, env_->clock()->NowTicks())) {
+    INF() << "New receiver: " << addr;
+    // Fast start the layer the receiver sends feedback for, e.g. the
+    // smallest one with layered multicast: it sends it on the SSRC right
+    // after the one of the layer.
+    if (SimulcastLayerForSsrc(ssrc - 1) >= 0) FastStartReceiver(ssrc - 1, addr);
+  }
+
+  for (const auto& session : video_rtcp_sessions_) {
+    if (session.second->IncomingRtcpPacket(addr, data, length)) {
+      // Received and correctly processed RTCP packet
+      MaybeReportLosses(env_->clock()->NowTicks());
+      return;
+    }
   }
 }
 
@@ -64,18 +111,25 @@ void TransportSender::InitializeVideo(
     const SharerTransportRtpConfig& config,
     const RtcpSharerMessageCallback& sharer_message_cb,
     const RtcpRttCallback& rtt_cb) {
-  video_sender_ = make_unique<RtpSender>(&pacer_);
-  if (!video_sender_->Initialize(config)) {
-    video_sender_ = nullptr;
-    ERR() << "Could not initialize video sender.";
+  auto video_sender = make_unique<RtpSender>(&pacer_, env_);
+  if (!video_sender->Initialize(config)) {
+    ERR() << "Could not initialize video sender for ssrc " << config.ssrc;
     return;
   }
+  video_senders_[config.ssrc] = std::move(video_sender);
+  repair_trackers_[config.ssrc] = make_unique<RepairTracker>(
+      env_->metrics()->Histogram(
+          "sharer_loss_peers",
+          "Estimated number of receivers that NACKed each lost packet.",
+          RepairTracker::LossPeersBounds(),
+          {{"ssrc", std::to_string(config.ssrc)}}));
+  repair_trackers_[config.ssrc]->set_receiver_count(receivers_.size());
 
   auto sharer_cb = [this, config, sharer_message_cb](
       const std::string& addr, const RtcpSharerMessage& msg) {
     this->OnReceivedSharerMessage(config.ssrc, addr, sharer_message_cb, msg);
   };
-  video_rtcp_session_ =
+  video_rtcp_sessions_[config.ssrc] =
       make_unique<RtcpHandler>(sharer_cb, rtt_cb, env_, nullptr, &pacer_,
                                config.ssrc, config.feedback_ssrc);
   pacer_.RegisterVideoSsrc(config.ssrc);
@@ -86,13 +140,28 @@ void TransportSender::OnReceivedSharerMessage(
     uint32_t ssrc, const std::string& addr,
     const RtcpSharerMessageCallback& sharer_message_cb,
     const RtcpSharerMessage& sharer_message) {
-  if (sharer_message_cb) sharer_message_cb(addr, sharer_message);
+  if (sharer_message.ack_frame_id != kStartFrameId) {
+    receiver_acks_[std::make_pair(ssrc, addr)] = sharer_message.ack_frame_id;
+    auto tracker = repair_trackers_.find(ssrc);
+    if (tracker != repair_trackers_.end())
+      tracker->second->OnAck(addr, sharer_message.ack_frame_id);
+  }
 
-  DedupInfo dedup_info;
-  if (video_sender_ && video_sender_->ssrc() == ssrc) {
-    dedup_info.resend_interval = video_rtcp_session_->current_round_trip_time();
+  if (sharer_message.request_key_frame && FastStartReceiver(ssrc, addr)) {
+    // The receiver will be able to decode from the GOP we sent it, so don't
+    // make everybody else pay for a new key frame.
+    RtcpSharerMessage message = sharer_message;
+    message.request_key_frame = false;
+    if (sharer_message_cb) sharer_message_cb(addr, message);
+  } else if (sharer_message_cb) {
+    sharer_message_cb(addr, sharer_message);
   }
 
+  DedupInfo dedup_info;
+  RtcpHandler* rtcp_session = GetVideoRtcpSession(ssrc);
+  if (rtcp_session)
+    dedup_info.resend_interval = rtcp_session->current_round_trip_time();
+
   if (sharer_message.missing_frames_and_packets.empty()) return;
 
   ResendPackets(ssrc, addr, sharer_message.missing_frames_and_packets, true,
@@ -103,25 +172,160 @@ void TransportSender::ResendPackets(
     uint32_t ssrc, const std::string& addr,
     const MissingFramesAndPacketsMap& missing_packets,
     bool cancel_rtx_if_not_in_list, const DedupInfo& dedup_info) {
-  if (video_sender_ && ssrc == video_sender_->ssrc()) {
-    video_sender_->ResendPackets(addr, missing_packets,
-                                 cancel_rtx_if_not_in_list, dedup_info);
+  RtpSender* video_sender = GetVideoSender(ssrc);
+  if (video_sender) {
+    auto tracker = repair_trackers_.find(ssrc);
+    video_sender->ResendPackets(
+        addr, missing_packets, cancel_rtx_if_not_in_list, dedup_info,
+        tracker == repair_trackers_.end() ? nullptr : tracker->second.get());
+  }
+}
+
+bool TransportSender::FastStartReceiver(uint32_t ssrc,
+                                        const std::string& addr) {
+  const base::TimeTicks now = env_->clock()->NowTicks();
+  const auto key = std::make_pair(ssrc, addr);
+  auto it = last_fast_start_.find(key);
+  if (it != last_fast_start_.end() &&
+      now - it->second <
+          base::TimeDelta::FromMilliseconds(kFastStartIntervalMs)) {
+    return true;
+  }
+
+  RtpSender* video_sender = GetVideoSender(ssrc);
+  if (!video_sender) return false;
+
+  auto ack = receiver_acks_.find(key);
+  const bool recovered =
+      ack != receiver_acks_.end() &&
+      video_sender->SendRecoveryToReceiver(addr, ack->second);
+  if (!recovered &&
+      !video_sender->SendGopToReceiver(addr, kMaxFastStartFrames)) {
+    return false;
+  }
+
+  last_fast_start_[key] = now;
+  return true;
+}
+
+bool TransportSender::UpdateReceiver(const std::string& addr,
+                                     base::TimeTicks now) {
+  if (now >= next_receiver_expiry_) {
+    ExpireReceivers(now);
+    next_receiver_expiry_ =
+        now + base::TimeDelta::FromMilliseconds(kReceiverExpiryIntervalMs);
+  }
+
+  auto it = receivers_.find(addr);
+  if (it != receivers_.end()) {
+    it->second = now;
+    return false;
+  }
+
+  if (receivers_.size() >= kMaxReceivers) {
+    auto oldest = receivers_.begin();
+    for (auto candidate = receivers_.begin(); candidate != receivers_.end();
+         ++candidate) {
+      if (candidate->second < oldest->second) oldest = candidate;
+    }
+    WRN() << "Too many receivers, forgetting " << oldest->first;
+    ForgetReceiver(oldest->first);
   }
+  receivers_[addr] = now;
+  UpdateReceiverCount();
+  return true;
+}
+
+void TransportSender::ExpireReceivers(base::TimeTicks now) {
+  const base::TimeDelta timeout =
+      base::TimeDelta::FromMilliseconds(kReceiverTimeoutMs);
+  bool expired = false;
+  for (auto it = receivers_.begin(); it != receivers_.end();) {
+    if (now - it->second > timeout) {
+      INF() << "Receiver left: " << it->first;
+      const std::string addr = it->first;
+      ++it;
+      ForgetReceiver(addr);
+      expired = true;
+    } else {
+      ++it;
+    }
+  }
+  if (expired) UpdateReceiverCount();
+
+  const base::TimeDelta fast_start_interval =
+      base::TimeDelta::FromMilliseconds(kFastStartIntervalMs);
+  for (auto it = last_fast_start_.begin(); it != last_fast_start_.end();) {
+    if (now - it->second >= fast_start_interval)
+      it = last_fast_start_.erase(it);
+    else
+      ++it;
+  }
+}
+
+void TransportSender::ForgetReceiver(const std::string& addr) {
+  receivers_.erase(addr);
+  for (const auto& sender : video_senders_) {
+    const auto key = std::make_pair(sender.first, addr);
+    last_fast_start_.erase(key);
+    receiver_acks_.erase(key);
+  }
+}
+
+void TransportSender::UpdateReceiverCount() {
+  for (const auto& tracker : repair_trackers_)
+    tracker.second->set_receiver_count(receivers_.size());
+}
+
+void TransportSender::MaybeReportLosses(base::TimeTicks now) {
+  if (!pacer_group_ || now < next_loss_report_) return;
+
+  std::vector<uint8_t> losses;
+  for (const auto& session : video_rtcp_sessions_) {
+    for (const auto& report : session.second->receiver_reports())
+      losses.push_back(report.second.fraction_lost);
+  }
+  if (losses.empty()) return;
+  next_loss_report_ = now + base::TimeDelta::FromMilliseconds(
+                                 PacerGroup::kRateUpdateIntervalMs);
+
+  // The median, so that a few receivers on a bad link don't bring the rate
+  // down for everybody.
+  auto median = losses.begin() + losses.size() / 2;
+  std::nth_element(losses.begin(), median, losses.end());
+  pacer_group_->OnLossReport(&pacer_, *median / 256.0);
+}
+
+RtpSender* TransportSender::GetVideoSender(uint32_t ssrc) const {
+  auto it = video_senders_.find(ssrc);
+  return it == video_senders_.end() ? nullptr : it->second.get();
+}
+
+RtcpHandler* TransportSender::GetVideoRtcpSession(uint32_t ssrc) const {
+  auto it = video_rtcp_sessions_.find(ssrc);
+  return it == video_rtcp_sessions_.end() ? nullptr : it->second.get();
+}
+
+const RepairTracker* TransportSender::GetRepairTracker(uint32_t ssrc) const {
+  auto it = repair_trackers_.find(ssrc);
+  return it == repair_trackers_.end() ? nullptr : it->second.get();
 }
 
 void TransportSender::InsertFrame(uint32_t ssrc, const EncodedFrame& frame) {
-  if (video_sender_ && ssrc == video_sender_->ssrc()) {
-    video_sender_->SendFrame(frame);
+  RtpSender* video_sender = GetVideoSender(ssrc);
+  if (video_sender) {
+    video_sender->SendFrame(frame);
   }
 }
 
 void TransportSender::SendSenderReport(uint32_t ssrc,
                                        base::TimeTicks current_time,
                                        uint32_t current_time_as_rtp_timestamp) {
-  if (video_sender_ && ssrc == video_sender_->ssrc()) {
-    video_rtcp_session_->SendRtcpFromRtpSender(
+  RtpSender* video_sender = GetVideoSender(ssrc);
+  if (video_sender) {
+    GetVideoRtcpSession(ssrc)->SendRtcpFromRtpSender(
         current_time, current_time_as_rtp_timestamp,
-        video_sender_->send_packet_count(), video_sender_->send_octet_count());
+        video_sender->send_packet_count(), video_sender->send_octet_count());
   } else {
     PP_NOTREACHED();
   }
@@ -131,9 +335,10 @@ void TransportSender::SendSenderPauseResume(uint32_t ssrc,
                                             uint32_t last_sent_frame_id_,
                                             uint32_t local_pause_id_) {
   DINF() << "Sending RTCP Pause Resume...";
-  if (video_sender_ && ssrc == video_sender_->ssrc()) {
-    video_rtcp_session_->SendRtcpPauseResumeFromRtpSender(last_sent_frame_id_,
-                                                          local_pause_id_);
+  RtcpHandler* rtcp_session = GetVideoRtcpSession(ssrc);
+  if (rtcp_session) {
+    rtcp_session->SendRtcpPauseResumeFromRtpSender(last_sent_frame_id_,
+                                                   local_pause_id_);
   } else {
     PP_NOTREACHED();
   }
@@ -141,13 +346,93 @@ void TransportSender::SendSenderPauseResume(uint32_t ssrc,
 
 void TransportSender::ResendFrameForKickstart(uint32_t ssrc,
                                               uint32_t frame_id) {
-  if (video_sender_ && ssrc == video_sender_->ssrc()) {
-    PP_DCHECK(video_rtcp_session_);
-    video_sender_->ResendFrameForKickstart(
-        frame_id, video_rtcp_session_->current_round_trip_time());
+  RtpSender* video_sender = GetVideoSender(ssrc);
+  if (video_sender) {
+    PP_DCHECK(GetVideoRtcpSession(ssrc));
+    video_sender->ResendFrameForKickstart(
+        frame_id, GetVideoRtcpSession(ssrc)->current_round_trip_time());
   } else {
     PP_NOTREACHED();
   }
 }
 
+void TransportSender::CollectMetrics(MetricsSnapshot* snapshot) const {
+  for (const auto& sender : video_senders_) {
+    const MetricLabels labels = {{"ssrc", std::to_string(sender.first)}};
+    snapshot->AddGauge("sharer_storage_frames",
+                       "Frames kept for retransmission.", labels,
+                       sender.second->stored_frames());
+    snapshot->AddGauge("sharer_storage_bytes",
+                       "Bytes of the packets kept for retransmission.", labels,
+                       sender.second->stored_bytes());
+  }
+
+  for (const auto& tracker : repair_trackers_) {
+    const RepairTracker& repairs = *tracker.second;
+    const std::string ssrc = std::to_string(tracker.first);
+    auto add_counts = [snapshot, &ssrc](
+        const std::string& receiver,
+        const RepairTracker::ReceiverCounts& counts) {
+      const MetricLabels labels = {{"ssrc", ssrc}, {"receiver", receiver}};
+      snapshot->AddGauge("sharer_receiver_packets_nacked",
+                         "Packets the receiver asked to be resent.", labels,
+                         counts.nacked);
+      snapshot->AddGauge("sharer_receiver_packets_resent",
+                         "Packets resent to the receiver.", labels,
+                         counts.resent);
+      snapshot->AddGauge("sharer_receiver_packets_repaired",
+                         "Packets resent to the receiver that it then acked.",
+                         labels, counts.repaired);
+      snapshot->AddGauge("sharer_receiver_late_repairs",
+                         "Packets the receiver asked for again after they "
+                         "were resent, lost or too late.",
+                         labels, counts.late_repairs);
+    };
+    for (const auto& receiver : repairs.GetReceiverCounts())
+      add_counts(receiver.first, receiver.second);
+    // The receivers with the fewest NACKs, when there are too many to track.
+    if (repairs.other_receivers().nacked)
+      add_counts("other", repairs.other_receivers());
+
+    const MetricLabels labels = {{"ssrc", ssrc}};
+    snapshot->AddGauge("sharer_lost_packets",
+                       "Packets NACKed by at least one receiver.", labels,
+                       repairs.lost_packets());
+    if (repairs.packet_losses()) {
+      snapshot->AddGauge(
+          "sharer_loss_shared_fraction",
+          "Fraction of the packet losses shared with other receivers.",
+          labels, static_cast<double>(repairs.shared_losses()) /
+                      repairs.packet_losses());
+      snapshot->AddGauge(
+          "sharer_loss_upstream_fraction",
+          "Fraction of the packet losses shared with at least half of the "
+          "receivers.",
+          labels, static_cast<double>(repairs.upstream_losses()) /
+                      repairs.packet_losses());
+    }
+  }
+
+  for (const auto& session : video_rtcp_sessions_) {
+    for (const auto& report : session.second->receiver_reports()) {
+      const MetricLabels labels = {{"ssrc", std::to_string(session.first)},
+                                   {"receiver", report.first}};
+      const RtcpHandler::ReceiverReport& receiver = report.second;
+      // Not measured until the receiver answers a sender report.
+      if (receiver.round_trip_time > base::TimeDelta()) {
+        snapshot->AddGauge("sharer_receiver_rtt_ms",
+                           "Round trip time to the receiver.", labels,
+                           receiver.round_trip_time.InMillisecondsF());
+      }
+      snapshot->AddGauge("sharer_receiver_fraction_lost",
+                         "Fraction of the packets lost in the last report "
+                         "interval of the receiver.",
+                         labels, receiver.fraction_lost / 256.0);
+      snapshot->AddGauge("sharer_receiver_packets_lost",
+                         "Packets the receiver lost since it started.", labels,
+                         receiver.cumulative_lost);
+    }
+  }
+}
+
 }  // namespace sharer
@@ -11,9 +11,10 @@
 //                                      UdpTransport (Shared)
 //
 // There are objects of TransportEncryptionHandler, RtpSender and Rtcp
-// for each audio and video stream.
+// for each audio and video stream, and for each video simulcast layer.
 // PacedSender and UdpTransport are shared between all RTP and RTCP
-// streams
+// streams. The PacedSenders of all TransportSenders of an instance take
+// their bursts from a single PacerGroup.
 
 #ifndef NET_TRANSPORT_SENDER_H_
 #define NET_TRANSPORT_SENDER_H_
@@ -25,11 +26,14 @@
 #include "net/sharer_transport_defines.h"
 #include "net/udp_transport.h"
 #include "net/pacing/paced_sender.h"
+#include "net/rtp/repair_tracker.h"
 #include "net/rtp/rtp_sender.h"
 
 #include "ppapi/cpp/instance.h"
 
+#include <map>
 #include <set>
+#include <string>
 
 class RtcpHandler;
 
@@ -39,8 +43,12 @@ class UdpTransport;
 
 class TransportSender {
  public:
-  TransportSender(SharerEnvironment* env,
-                  const SenderConfig& config, const TransportInitializedCb& cb);
+  // Paces together with the other senders of |pacer_group| if not null, see
+  // PacerGroup.
+  TransportSender(SharerEnvironment* env, const SenderConfig& config,
+                  PacerGroup* pacer_group,
+                  const PacerGroup::BitrateShareCb& bitrate_share_cb,
+                  const TransportInitializedCb& cb);
   ~TransportSender();
 
   void AddValidSsrc(uint32_t ssrc);
@@ -58,6 +66,15 @@ class TransportSender {
 
   void ResendFrameForKickstart(uint32_t ssrc, uint32_t frame_id);
 
+  // Bytes of all streams waiting in the pacer, and the rate at which they
+  // leave when backed up, in bytes per second.
+  size_t GetQueuedBytes() const { return pacer_.QueuedLiveBytes(); }
+  double GetSendRate() const { return pacer_.LiveDrainRate(); }
+
+  // Losses and repairs of the stream |ssrc| per receiver, and how many
+  // receivers lost each recent packet. Null if |ssrc| is not a video stream.
+  const RepairTracker* GetRepairTracker(uint32_t ssrc) const;
+
  private:
   void OnReceivedPacket(const std::string& addr,
                         std::unique_ptr<Packet> packet);
@@ -71,17 +88,57 @@ class TransportSender {
                      bool cancel_rtx_if_not_in_list,
                      const DedupInfo& dedup_info);
 
+  // Sends |addr| by unicast what it needs to decode the stream |ssrc|: the
+  // frames after its last ack if it acked a frame of the current GOP, else the
+  // whole GOP. Returns true if a burst was sent now or recently enough that it
+  // is still on its way.
+  bool FastStartReceiver(uint32_t ssrc, const std::string& addr);
+
+  // Keeps track of the receivers sending RTCP. Returns true if |addr| is a
+  // new one, or one that was silent long enough to be forgotten.
+  bool UpdateReceiver(const std::string& addr, base::TimeTicks now);
+  // Forgets the receivers silent for too long, and the fast starts that no
+  // longer matter.
+  void ExpireReceivers(base::TimeTicks now);
+  void ForgetReceiver(const std::string& addr);
+  void UpdateReceiverCount();
+  // Tells the pacer group the median loss of the receiver reports of all
+  // layers, at most every PacerGroup::kRateUpdateIntervalMs.
+  void MaybeReportLosses(base::TimeTicks now);
+
+  RtpSender* GetVideoSender(uint32_t ssrc) const;
+  RtcpHandler* GetVideoRtcpSession(uint32_t ssrc) const;
+
+  // Packet storage and repairs of each layer, and the latest report of each
+  // receiver.
+  void CollectMetrics(MetricsSnapshot* snapshot) const;
+
   SharerEnvironment* env_;
 
   UdpTransport transport_;
   PacedSender pacer_;
+  PacerGroup* const pacer_group_;
+  base::TimeTicks next_loss_report_;
 
-  std::unique_ptr<RtpSender> video_sender_;
-
-  std::unique_ptr<RtcpHandler> video_rtcp_session_;
+  // Keyed by the SSRC of each video simulcast layer.
+  std::map<uint32_t, std::unique_ptr<RtpSender>> video_senders_;
+  std::map<uint32_t, std::unique_ptr<RtcpHandler>> video_rtcp_sessions_;
+  std::map<uint32_t, std::unique_ptr<RepairTracker>> repair_trackers_;
 
   std::set<uint32_t> valid_ssrcs_;
 
+  // Time of the last RTCP packet of each active receiver. There are at most
+  // kMaxReceivers of them, and the per receiver state below only exists for
+  // them.
+  std::map<std::string, base::TimeTicks> receivers_;
+  base::TimeTicks next_receiver_expiry_;
+  std::map<std::pair<uint32_t, std::string>, base::TimeTicks>
+      last_fast_start_;
+  // Last frame each receiver acked, per SSRC.
+  std::map<std::pair<uint32_t, std::string>, uint32_t> receiver_acks_;
+
+  const int metrics_collector_;
+
   DISALLOW_COPY_AND_ASSIGN(TransportSender);
 };
 
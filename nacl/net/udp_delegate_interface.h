@@ -5,9 +5,13 @@
 #ifndef _UDP_DELEGATE_INTERFACE_
 #define _UDP_DELEGATE_INTERFACE_
 
+#include "base/time/time.h"
+
 class UDPDelegateInterface {
  public:
-  virtual void OnReceived(const char* buffer, int32_t size) = 0;
+  // |arrival_time| is when the receive completed, before anything else ran.
+  virtual void OnReceived(const char* buffer, int32_t size,
+                          base::TimeTicks arrival_time) = 0;
 };
 
 #endif  // _UDP_DELEGATE_INTERFACE_
@@ -17,6 +17,9 @@
 #pragma warning(disable : 4355)
 #endif
 
+// Layer number used in group operations for the group given at construction.
+static const int kBaseGroup = -1;
+
 static uint16_t Htons(uint16_t hostshort) {
   uint8_t result_bytes[2];
   result_bytes[0] = (uint8_t)((hostshort >> 8) & 0xFF);
@@ -27,13 +30,18 @@ static uint16_t Htons(uint16_t hostshort) {
   return result;
 }
 
-UDPListener::UDPListener(pp::Instance* instance, UDPDelegateInterface* delegate,
+UDPListener::UDPListener(pp::Instance* instance, base::TickClock* clock,
+                         UDPDelegateInterface* delegate,
                          const std::string& host, uint16_t port)
     : instance_(instance),
+      clock_(clock),
       delegate_(delegate),
       callback_factory_(this),
       network_monitor_(instance_),
-      stop_listening_(false) {
+      send_outstanding_(false),
+      stop_listening_(false),
+      group_op_pending_(false),
+      joined_(false) {
   Start(host, port);
 }
 
@@ -109,6 +117,8 @@ void UDPListener::OnJoinedCompletion(int32_t result) {
   pp::NetAddress addr = udp_socket_.GetBoundAddress();
   INF() << "Bound to: " << addr.DescribeAsString(true).AsString();
 
+  joined_ = true;
+  RunNextGroupOp();
   Receive();
 }
 
@@ -248,21 +258,24 @@ void UDPListener::OnConnectCompletion(int32_t result) {
 
 void UDPListener::OnReceiveFromCompletion(int32_t result,
                                           pp::NetAddress source) {
+  // PPAPI has no kernel timestamps: this is the earliest we hear of it.
+  const base::TimeTicks arrival_time = clock_->NowTicks();
   if (!remote_host_) {
     INF() << "Setting remote host to: "
           << source.DescribeAsString(true).AsString();
     remote_host_ = make_unique<pp::NetAddress>(source);
   }
-  OnReceiveCompletion(result);
+  OnReceiveCompletion(result, arrival_time);
 }
 
-void UDPListener::OnReceiveCompletion(int32_t result) {
+void UDPListener::OnReceiveCompletion(int32_t result,
+                                      base::TimeTicks arrival_time) {
   if (result < 0) {
     ERR() << "Receive failed with error: " << result;
     return;
   }
 
-  delegate_->OnReceived(receive_buffer_, result);
+  delegate_->OnReceived(receive_buffer_, result, arrival_time);
   /* PostMessage(std::string("Received: ") + std::string(receive_buffer_,
    * result)); */
   if (!stop_listening_) Receive();
@@ -288,27 +301,80 @@ void UDPListener::OnSendPacketCompletion(int32_t result) {
   SendPacketsInternal();
 }
 
-void UDPListener::OnLeaveCompletion(int32_t result) {
-  if (result != PP_OK) {
-    ERR() << "Could not rejoin multicast group: " << result;
-    return;
+void UDPListener::OnNetworkTimeout() {
+  // Nothing arrived for a while, refresh every membership in case the
+  // network dropped it.
+  QueueGroupOp(false, kBaseGroup);
+  QueueGroupOp(true, kBaseGroup);
+  for (int layer : joined_layers_) {
+    QueueGroupOp(false, layer);
+    QueueGroupOp(true, layer);
   }
-  auto rejoinCallback =
-      callback_factory_.NewCallback(&UDPListener::OnRejoinCompletion);
-  udp_socket_.JoinGroup(group_addr_, rejoinCallback);
 }
 
-void UDPListener::OnRejoinCompletion(int32_t result) {
-  if (result != PP_OK) {
-    ERR() << "Could not leave multicast group: " << result;
-    return;
+void UDPListener::JoinLayer(int layer) {
+  INF() << "Joining group of simulcast layer " << layer;
+  QueueGroupOp(true, layer);
+}
+
+void UDPListener::LeaveLayer(int layer) {
+  INF() << "Leaving group of simulcast layer " << layer;
+  QueueGroupOp(false, layer);
+}
+
+bool UDPListener::LayerGroupAddress(int layer, pp::NetAddress* addr) const {
+  if (layer == kBaseGroup) {
+    *addr = group_addr_;
+    return true;
+  }
+
+  PP_NetAddress_IPv4 ipv4_addr;
+  if (!group_addr_.DescribeAsIPv4Address(&ipv4_addr) ||
+      ipv4_addr.addr[3] + layer + 1 > 0xff) {
+    return false;
   }
+  ipv4_addr.addr[3] += layer + 1;
+  *addr = pp::NetAddress(instance_, ipv4_addr);
+  return true;
 }
 
-void UDPListener::OnNetworkTimeout() {
-  auto leaveCallback =
-      callback_factory_.NewCallback(&UDPListener::OnLeaveCompletion);
-  udp_socket_.LeaveGroup(group_addr_, leaveCallback);
+void UDPListener::QueueGroupOp(bool join, int layer) {
+  group_ops_.push(std::make_pair(join, layer));
+  RunNextGroupOp();
+}
+
+void UDPListener::RunNextGroupOp() {
+  while (joined_ && !group_op_pending_ && !group_ops_.empty()) {
+    const bool join = group_ops_.front().first;
+    const int layer = group_ops_.front().second;
+    group_ops_.pop();
+
+    pp::NetAddress addr;
+    if (!LayerGroupAddress(layer, &addr)) {
+      ERR() << "No multicast group for simulcast layer " << layer;
+      continue;
+    }
+
+    auto callback = callback_factory_.NewCallback(
+        &UDPListener::OnGroupOpCompletion, join, layer);
+    int32_t result = join ? udp_socket_.JoinGroup(addr, callback)
+                          : udp_socket_.LeaveGroup(addr, callback);
+    if (result == PP_OK_COMPLETIONPENDING) group_op_pending_ = true;
+  }
+}
+
+void UDPListener::OnGroupOpCompletion(int32_t result, bool join, int layer) {
+  group_op_pending_ = false;
+  if (result != PP_OK) {
+    ERR() << "Could not " << (join ? "join" : "leave") << " multicast group "
+          << layer << ": " << result;
+  } else if (layer != kBaseGroup) {
+    if (join)
+      joined_layers_.insert(layer);
+    else
+      joined_layers_.erase(layer);
+  }
+  RunNextGroupOp();
 }
 
 void UDPListener::StopListening() { stop_listening_ = true; }
@@ -5,6 +5,7 @@
 #ifndef _UDP_LISTENER_
 #define _UDP_LISTENER_
 
+#include "base/time/tick_clock.h"
 #include "net/udp_delegate_interface.h"
 #include "net/rtp/rtp_receiver_defines.h"
 
@@ -16,13 +17,17 @@
 #include "ppapi/cpp/network_monitor.h"
 
 #include <queue>
+#include <set>
+#include <utility>
 
 static const int kBufferSize = 4096;
 
 class UDPListener : public UDPSender {
  public:
-  explicit UDPListener(pp::Instance* instance, UDPDelegateInterface* delegate,
-                       const std::string& host, uint16_t port);
+  // |clock| stamps the arrival time of the packets, and must outlive us.
+  explicit UDPListener(pp::Instance* instance, base::TickClock* clock,
+                       UDPDelegateInterface* delegate, const std::string& host,
+                       uint16_t port);
   virtual ~UDPListener();
 
   void SendPacket(PacketRef packet) override;
@@ -30,6 +35,14 @@ class UDPListener : public UDPSender {
   void StopListening();
   void StartListening();
 
+  // Join or leave the multicast group carrying the video of simulcast |layer|
+  // when the sender uses layered multicast: the group address is the one
+  // given to the constructor with |layer| + 1 added to the last octet. Group
+  // changes are queued until the socket has joined its own group and then
+  // run one at a time.
+  void JoinLayer(int layer);
+  void LeaveLayer(int layer);
+
  private:
   void Start(const std::string& host, uint16_t port);
   bool IsConnected();
@@ -42,17 +55,20 @@ class UDPListener : public UDPSender {
   void OnJoinedCompletion(int32_t result);
   void OnConnectCompletion(int32_t result);
   void OnResolveCompletion(int32_t result);
-  void OnReceiveCompletion(int32_t result);
+  void OnReceiveCompletion(int32_t result, base::TimeTicks arrival_time);
   void OnReceiveFromCompletion(int32_t result, pp::NetAddress source);
   void OnSendCompletion(int32_t result);
   void OnSendPacketCompletion(int32_t result);
   void OnNetworkListCompletion(int32_t result, pp::NetworkList network_list);
   void OnSetOptionCompletion(int32_t result);
 
-  void OnLeaveCompletion(int32_t result);
-  void OnRejoinCompletion(int32_t result);
+  bool LayerGroupAddress(int layer, pp::NetAddress* addr) const;
+  void QueueGroupOp(bool join, int layer);
+  void RunNextGroupOp();
+  void OnGroupOpCompletion(int32_t result, bool join, int layer);
 
   pp::Instance* instance_;
+  base::TickClock* clock_;
   UDPDelegateInterface* delegate_;
   pp::CompletionCallbackFactory<UDPListener> callback_factory_;
   pp::UDPSocket udp_socket_;
@@ -69,6 +85,13 @@ class UDPListener : public UDPSender {
   bool send_outstanding_;
   std::queue<PacketRef> packets_;
   bool stop_listening_;
+
+  // Pending joins (true) and leaves (false) of a layer's group, see
+  // JoinLayer(). kBaseGroup stands for |group_addr_|.
+  std::queue<std::pair<bool, int>> group_ops_;
+  bool group_op_pending_;
+  bool joined_;
+  std::set<int> joined_layers_;
 };
 
 #endif  // _UDP_LISTENER_
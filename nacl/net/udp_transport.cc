@@ -26,9 +26,10 @@ UdpTransport::UdpTransport(SharerEnvironment* env,
                            /* const std::string& local_host, */
                            /* uint16_t local_port, */
                            const std::string& remote_host, uint16_t remote_port,
-                           int32_t send_buffer_size,
+                           int multicast_layers, int32_t send_buffer_size,
                            const TransportInitializedCb& cb)
     : env_(env),
+      multicast_layers_(multicast_layers),
       resolved_(false),
       send_pending_(false),
       receive_pending_(false),
@@ -72,10 +73,34 @@ void UdpTransport::OnResolveCompletion(int32_t result,
   pp::NetAddress addr = resolver_.GetNetAddress(0);
   INF() << "Resolved: " << addr.DescribeAsString(true).AsString();
   remote_addr_ = addr;
-  resolved_ = true;
+  resolved_ = multicast_layers_ <= 1 || AddLayerGroups();
   cb(resolved_);
 }
 
+bool UdpTransport::AddLayerGroups() {
+  PP_NetAddress_IPv4 ipv4_addr;
+  if (!remote_addr_.DescribeAsIPv4Address(&ipv4_addr)) {
+    ERR() << "Layered multicast needs an IPv4 group address.";
+    return false;
+  }
+  if (ipv4_addr.addr[3] + multicast_layers_ > 0xff) {
+    ERR() << "Not enough group addresses after "
+          << remote_addr_.DescribeAsString(false).AsString() << " for "
+          << multicast_layers_ << " layers.";
+    return false;
+  }
+
+  const uint8_t first = ipv4_addr.addr[3];
+  for (int layer = 0; layer < multicast_layers_; ++layer) {
+    ipv4_addr.addr[3] = first + layer + 1;
+    pp::NetAddress group(env_->instance(), ipv4_addr);
+    INF() << "Layer " << layer << " group: "
+          << group.DescribeAsString(true).AsString();
+    addr_from_str_[MulticastAddrForLayer(layer)] = group;
+  }
+  return true;
+}
+
 void UdpTransport::StartReceiving(const PacketReceiverCallback& cb) {
   packet_receiver_ = cb;
 
@@ -139,15 +164,15 @@ bool UdpTransport::SendPacket(const std::string& addr, PacketRef packet,
 
   pp::NetAddress net_addr;
 
-  if (addr == "multicast") {
+  auto it = addr_from_str_.find(addr);
+  if (it != addr_from_str_.end()) {
+    net_addr = it->second;
+  } else if (addr.compare(0, 9, "multicast") == 0) {
+    // Any video layer when not using layered multicast.
     net_addr = remote_addr_;
   } else {
-    auto it = addr_from_str_.find(addr);
-    if (it == addr_from_str_.end()) {
-      DERR() << "Can't find address for: " << addr;
-      return true;
-    }
-    net_addr = it->second;
+    DERR() << "Can't find address for: " << addr;
+    return true;
   }
 
   auto callback =
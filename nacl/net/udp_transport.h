@@ -22,11 +22,15 @@ using PacketReceiverCallback =
 
 class UdpTransport : public PacketSender {
  public:
+  // With |multicast_layers| > 1, video of simulcast layer N is sent to the
+  // group whose address is |remote_host| with N + 1 added to the last octet.
+  // Everything else, e.g. audio, keeps going to |remote_host|.
   UdpTransport(SharerEnvironment* env,
                /* const std::string& local_host, */
                /* uint16_t local_port, */
                const std::string& remote_host, uint16_t remote_port,
-               int32_t send_buffer_size, const TransportInitializedCb& cb);
+               int multicast_layers, int32_t send_buffer_size,
+               const TransportInitializedCb& cb);
   ~UdpTransport() final;
 
   bool SendPacket(const std::string& addr, PacketRef packet,
@@ -37,6 +41,7 @@ class UdpTransport : public PacketSender {
 
  private:
   void OnResolveCompletion(int32_t result, const TransportInitializedCb& cb);
+  bool AddLayerGroups();
   void OnSent(int32_t result, PacketRef packet, pp::CompletionCallback cb);
   void OnBound(int32_t result);
 
@@ -48,6 +53,7 @@ class UdpTransport : public PacketSender {
   /* uint16_t local_port_; */
   pp::UDPSocket udp_socket_;
   pp::NetAddress remote_addr_;
+  const int multicast_layers_;
   bool resolved_;
   bool send_pending_;
   bool receive_pending_;
@@ -5,15 +5,29 @@
 
 #include "decoder.h"
 
+#include "logging/log_event_dispatcher.h"
 #include "net/sharer_transport_config.h"
+#include "sharer_environment.h"
 
 #include <stdio.h>
 #include <sstream>
 
-Decoder::Decoder(pp::Instance* instance, int id,
+namespace {
+
+const std::vector<int64_t> kLatencyBoundsMs = {1,  2,  5,   10,  20,
+                                               30, 50, 100, 200, 500};
+
+}  // namespace
+
+Decoder::Decoder(sharer::SharerEnvironment* env, int id,
                  const pp::Graphics3D& graphics_3d)
     : id_(id),
-      decoder_(new pp::VideoDecoder(instance)),
+      logger_(env->logger()),
+      latency_metric_(env->metrics()->Histogram(
+          "sharer_decode_latency_ms",
+          "Time from submitting a frame to the decoder to its picture.",
+          kLatencyBoundsMs)),
+      decoder_(new pp::VideoDecoder(env->instance())),
       callback_factory_(this),
       encoded_data_next_pos_to_decode_(0),
       next_picture_id_(0),
@@ -78,6 +92,10 @@ void Decoder::DecodeNextFrame(std::shared_ptr<EncodedFrame> encoded,
   decodeDone_ = cb;
   encodedFrame_ = encoded;
   decode_time_[next_picture_id_ % kMaxDecodeDelay] = core_if_->GetTimeTicks();
+  decode_rtp_timestamp_[next_picture_id_ % kMaxDecodeDelay] =
+      encoded->rtp_timestamp;
+  decode_frame_id_[next_picture_id_ % kMaxDecodeDelay] = encoded->frame_id;
+  LogFrameEvent(sharer::FRAME_DECODE_BEGIN, next_picture_id_);
   decoder_->Decode(next_picture_id_++, encoded->data.length(),
                    encoded->data.data(),
                    callback_factory_.NewCallback(&Decoder::DecodeDone));
@@ -112,6 +130,8 @@ void Decoder::PictureReady(int32_t result, PP_VideoPicture picture) {
   PP_TimeTicks latency = core_if_->GetTimeTicks() -
                          decode_time_[picture.decode_id % kMaxDecodeDelay];
   total_latency_ += latency;
+  latency_metric_->Add(static_cast<int64_t>(latency * 1000));
+  LogFrameEvent(sharer::FRAME_DECODED, picture.decode_id);
 
   decoder_->GetPicture(
       callback_factory_.NewCallbackWithOutput(&Decoder::PictureReady));
@@ -120,6 +140,21 @@ void Decoder::PictureReady(int32_t result, PP_VideoPicture picture) {
   }
 }
 
+void Decoder::OnPicturePainted(const PP_VideoPicture& picture) {
+  LogFrameEvent(sharer::FRAME_PLAYOUT, picture.decode_id);
+}
+
+void Decoder::LogFrameEvent(sharer::SharerLoggingEvent type,
+                            uint32_t decode_id) {
+  sharer::FrameEvent event;
+  event.timestamp = base::TimeTicks::Now();
+  event.type = type;
+  event.media_type = sharer::VIDEO_EVENT;
+  event.rtp_timestamp = decode_rtp_timestamp_[decode_id % kMaxDecodeDelay];
+  event.frame_id = decode_frame_id_[decode_id % kMaxDecodeDelay];
+  logger_->DispatchFrameEvent(event);
+}
+
 void Decoder::FlushDone(int32_t result) {
   assert(decoder_);
   assert(result == PP_OK || result == PP_ERROR_ABORTED);
@@ -5,6 +5,8 @@
 #ifndef _DECODER_
 #define _DECODER_
 
+#include "logging/logging_defines.h"
+
 #include "ppapi/cpp/instance.h"
 #include "ppapi/cpp/video_decoder.h"
 #include "ppapi/utility/completion_callback_factory.h"
@@ -13,13 +15,22 @@
 
 struct EncodedFrame;
 
+namespace sharer {
+class LogEventDispatcher;
+class MetricHistogram;
+class SharerEnvironment;
+}
+
 class Decoder {
  public:
   using DecodeDoneCb = std::function<void()>;
   using ResetDoneCb = std::function<void()>;
   using PictureReadyCb = std::function<void(Decoder*, PP_VideoPicture)>;
 
-  Decoder(pp::Instance* instance, int id, const pp::Graphics3D& graphics_3d);
+  // Logs when each frame is submitted, decoded and painted to the logger of
+  // |env|.
+  Decoder(sharer::SharerEnvironment* env, int id,
+          const pp::Graphics3D& graphics_3d);
   ~Decoder();
 
   int id() const { return id_; }
@@ -28,6 +39,8 @@ class Decoder {
 
   void Reset();
   void RecyclePicture(const PP_VideoPicture& picture);
+  // Called once |picture| is on screen.
+  void OnPicturePainted(const PP_VideoPicture& picture);
   void DecodeNextFrame(std::shared_ptr<EncodedFrame> encoded, DecodeDoneCb cb);
   void SetPictureReadyCb(PictureReadyCb cb);
   void SetResetCb(ResetDoneCb cb);
@@ -46,8 +59,11 @@ class Decoder {
   void PictureReady(int32_t result, PP_VideoPicture picture);
   void FlushDone(int32_t result);
   void ResetDone(int32_t result);
+  void LogFrameEvent(sharer::SharerLoggingEvent type, uint32_t decode_id);
 
   int id_;
+  sharer::LogEventDispatcher* const logger_;
+  sharer::MetricHistogram* const latency_metric_;
 
   pp::VideoDecoder* decoder_;
   pp::CompletionCallbackFactory<Decoder> callback_factory_;
@@ -67,6 +83,9 @@ class Decoder {
   const PPB_Core* core_if_;
   static const int kMaxDecodeDelay = 128;
   PP_TimeTicks decode_time_[kMaxDecodeDelay];
+  // Frame being decoded under each decode id, for logging.
+  sharer::RtpTimestamp decode_rtp_timestamp_[kMaxDecodeDelay];
+  uint32_t decode_frame_id_[kMaxDecodeDelay];
   PP_TimeTicks total_latency_;
   int num_pictures_;
 };
@@ -8,6 +8,7 @@
 #include "base/logger.h"
 #include "base/ptr_utils.h"
 #include "sharer_config.h"
+#include "sharer_defines.h"
 #include "net/sharer_transport_config.h"
 #include "net/rtp/framer.h"
 #include "net/rtp/rtp.h"
@@ -18,6 +19,9 @@
 static const int kMinSchedulingDelayMs = 1;
 static const int kDefaultRtcpIntervalMs = 500;
 static const int kMaxNetworkTimeoutMs = 2000;
+// Base layer frames are decoded late rather than skipped, up to this much
+// behind. Must cover the longest GOP a sender uses to fast start us.
+static const int kMaxCatchUpDelayMs = 5000;
 
 static inline base::TimeDelta RtpDeltaToTimeDelta(int64_t rtp_delta,
                                                   int rtp_timebase) {
@@ -29,6 +33,10 @@ FrameReceiver::FrameReceiver(sharer::SharerEnvironment* env,
                              const ReceiverConfig& config, UDPSender* transport)
     /* : senderSsrc_(sender_ssrc) { */
     : rtp_timebase_(config.rtp_timebase),
+      sender_ssrc_(config.sender_ssrc),
+      media_type_(sharer::SimulcastLayerForSsrc(config.sender_ssrc) >= 0
+                      ? sharer::VIDEO_EVENT
+                      : sharer::AUDIO_EVENT),
       target_playout_delay_(
           base::TimeDelta::FromMilliseconds(config.rtp_max_delay_ms)),
       expected_frame_duration_(base::TimeDelta::FromSeconds(1) /
@@ -37,16 +45,31 @@ FrameReceiver::FrameReceiver(sharer::SharerEnvironment* env,
       env_(env),
       rtcp_(nullptr, nullptr, env_, transport, nullptr, config.receiver_ssrc,
             config.sender_ssrc),
-      stats_(),
+      stats_(config.rtp_timebase),
       reports_are_scheduled_(false),
       framer_(make_unique<Framer>(
           env_, this, config.sender_ssrc, true,
           config.rtp_max_delay_ms* config.target_frame_rate / 1000)),
       is_waiting_for_consecutive_frame_(false),
+      is_catching_up_(false),
       lip_sync_drift_(ClockDriftSmoother::GetDefaultTimeConstant()),
-      network_timeouts_count_(0) {}
-
-FrameReceiver::~FrameReceiver() {}
+      network_timeouts_count_(0),
+      first_frame_emitted_(false),
+      fraction_lost_(0),
+      late_frames_(0),
+      late_frames_metric_(env_->metrics()->Counter(
+          "sharer_receiver_late_frames_total",
+          "Frames that missed their playout time: skipped, given up on, or "
+          "starting a catch-up.",
+          {{"ssrc", std::to_string(sender_ssrc_)}})),
+      metrics_collector_(env_->metrics()->AddCollector(
+          [this](sharer::MetricsSnapshot* snapshot) {
+            CollectMetrics(snapshot);
+          })) {}
+
+FrameReceiver::~FrameReceiver() {
+  env_->metrics()->RemoveCollector(metrics_collector_);
+}
 
 void FrameReceiver::FlushFrames() {
   std::queue<ReceiveEncodedFrameCallback> empty;
@@ -65,6 +88,9 @@ void FrameReceiver::SetOnNetworkTimeout(
 }
 
 bool FrameReceiver::ProcessPacket(std::unique_ptr<RTPBase> packet) {
+  if (packet->arrival_time().is_null())
+    packet->set_arrival_time(env_->clock()->NowTicks());
+
   if (packet->isRTCP()) {
     // No way to convert from std::unique_ptr<RTPBase> to std::unique_ptr<RTP>,
     // so do this ugly hack.
@@ -95,16 +121,22 @@ bool FrameReceiver::ProcessPacket(std::unique_ptr<RTPBase> packet) {
 
 void FrameReceiver::ProcessParsedPacket(std::unique_ptr<RTP> packet) {
   uint16_t packet_id = packet->packetId();
+  uint16_t max_packet_id = packet->maxPacketId();
   uint32_t frame_id = packet->frameId();
   RtpTimestamp timestamp = packet->timestamp();
   if (packet->isKeyFrame())
-    DINF() << "Received key packet: " << frame_id << ":" << packet_id;
+    DINF_EVERY_MS(1000) << "Received key packet: " << frame_id << ":"
+                        << packet_id;
   else
-    DINF() << "Received packet: " << frame_id << ":" << packet_id;
+    DINF_EVERY_MS(1000) << "Received packet: " << frame_id << ":"
+                        << packet_id;
 
-  const base::TimeTicks now = env_->clock()->NowTicks();
+  // Network timing comes from the arrival time, so that the time the packet
+  // waited to be handled doesn't show up in it.
+  const base::TimeTicks now = packet->arrival_time();
 
   last_received_time_ = now;
+  if (first_received_time_.is_null()) first_received_time_ = now;
   network_timeouts_count_ = 0;
 
   frame_id_to_rtp_timestamp_[frame_id & 0xff] = packet->timestamp();
@@ -114,6 +146,17 @@ void FrameReceiver::ProcessParsedPacket(std::unique_ptr<RTP> packet) {
 
   if (duplicate) return;
 
+  sharer::PacketEvent event;
+  event.timestamp = now;
+  event.type = sharer::PACKET_RECEIVED;
+  event.media_type = media_type_;
+  event.ssrc = sender_ssrc_;
+  event.rtp_timestamp = timestamp;
+  event.frame_id = frame_id;
+  event.packet_id = packet_id;
+  event.max_packet_id = max_packet_id;
+  env_->logger()->DispatchPacketEvent(event);
+
   if (packet_id == 0 || lip_sync_reference_time_.is_null()) {
     RtpTimestamp fresh_sync_rtp;
     base::TimeTicks fresh_sync_reference;
@@ -140,6 +183,22 @@ void FrameReceiver::ProcessParsedPacket(std::unique_ptr<RTP> packet) {
 
 int FrameReceiver::getLastFrameAck() { return last_frame_id_; }
 
+void FrameReceiver::SetMaxTemporalLayer(uint8_t layer) {
+  framer_->SetMaxTemporalLayer(layer);
+}
+
+bool FrameReceiver::HasFrameReady() const {
+  uint32_t frame_id;
+  return framer_->NextContinuousFrame(&frame_id);
+}
+
+void FrameReceiver::MoveFrameRequestsTo(FrameReceiver* other) {
+  while (!frame_request_queue_.empty()) {
+    other->RequestEncodedFrame(frame_request_queue_.front());
+    frame_request_queue_.pop();
+  }
+}
+
 void FrameReceiver::ScheduleNextRtcpReport() {
   pp::CompletionCallback cc =
       callback_factory_.NewCallback(&FrameReceiver::SendNextRtcpReport);
@@ -157,12 +216,27 @@ void FrameReceiver::CheckNetworkTimeout(const base::TimeTicks& now) {
   }
 }
 
+void FrameReceiver::CollectMetrics(sharer::MetricsSnapshot* snapshot) const {
+  const sharer::MetricLabels labels = {{"ssrc", std::to_string(sender_ssrc_)}};
+  snapshot->AddGauge("sharer_receiver_framer_frames",
+                     "Frames being received or waiting to be decoded.",
+                     labels, framer_->NumberOfFrames());
+  snapshot->AddGauge("sharer_receiver_fraction_lost",
+                     "Fraction of the packets lost in the last report "
+                     "interval of the receiver.",
+                     labels, fraction_lost_ / 256.0);
+  snapshot->AddGauge("sharer_receiver_jitter_seconds",
+                     "Interarrival jitter of the packets, RFC 3550.", labels,
+                     static_cast<double>(stats_.jitter()) / rtp_timebase_);
+}
+
 void FrameReceiver::SendNextRtcpReport(int result) {
   const base::TimeTicks now = env_->clock()->NowTicks();
 
   CheckNetworkTimeout(now);
 
   RtpReceiverStatistics stats = stats_.GetStatistics();
+  fraction_lost_ = stats.fraction_lost;
   rtcp_.SendRtcpFromRtpReceiver(rtcp_.ConvertToNTPAndSave(now), nullptr,
                                 base::TimeDelta(), &stats);
   ScheduleNextRtcpReport();
@@ -217,9 +291,42 @@ void FrameReceiver::EmitAvailableEncodedFrames() {
     const base::TimeTicks now = env_->clock()->NowTicks();
     const base::TimeTicks playout_time = GetPlayoutTime(*encoded_frame);
 
-    if (have_multiple_complete_frames && now > playout_time) {
-      framer_->ReleaseFrame(encoded_frame->frame_id);
-      continue;
+    // When running late, skip enhancement layer frames: nothing below them
+    // references them. Skipping a base layer frame would break the reference
+    // chain, so those are decoded as fast as possible until we are back in
+    // time, e.g. after joining with a GOP sent by the sender.
+    const bool is_late = now > playout_time;
+    if (is_late && have_multiple_complete_frames) {
+      if (encoded_frame->temporal_layer_id > 0) {
+        ++late_frames_;
+        late_frames_metric_->Increment();
+        LogFrameEvent(sharer::FRAME_DROPPED, *encoded_frame, now);
+        framer_->ReleaseFrame(encoded_frame->frame_id);
+        continue;
+      }
+
+      if (now - playout_time >
+          base::TimeDelta::FromMilliseconds(kMaxCatchUpDelayMs)) {
+        WRN() << "Too late to catch up at frame " << encoded_frame->frame_id
+              << ", waiting for a key frame.";
+        is_catching_up_ = false;
+        ++late_frames_;
+        late_frames_metric_->Increment();
+        LogFrameEvent(sharer::FRAME_DROPPED, *encoded_frame, now);
+        framer_->ReleaseFrame(encoded_frame->frame_id);
+        framer_->RequestKeyFrame();
+        continue;
+      }
+
+      if (!is_catching_up_) {
+        INF() << "Catching up from frame " << encoded_frame->frame_id;
+        is_catching_up_ = true;
+        ++late_frames_;
+        late_frames_metric_->Increment();
+      }
+    } else if (is_catching_up_ && !is_late) {
+      INF() << "Caught up at frame " << encoded_frame->frame_id;
+      is_catching_up_ = false;
     }
 
     if (!is_consecutively_next_frame) {
@@ -237,6 +344,17 @@ void FrameReceiver::EmitAvailableEncodedFrames() {
       }
     }
 
+    if (!first_frame_emitted_) {
+      first_frame_emitted_ = true;
+      INF() << "First frame " << encoded_frame->frame_id << " ready "
+            << (now - first_received_time_).InMilliseconds()
+            << " ms after the first packet.";
+    }
+
+    LogFrameEvent(sharer::FRAME_CAPTURE_END, *encoded_frame,
+                  GetCaptureTime(*encoded_frame));
+    LogFrameEvent(sharer::FRAME_COMPLETE, *encoded_frame, now);
+
     last_frame_id_ = encoded_frame->frame_id;
     framer_->AckFrame(encoded_frame->frame_id);
 
@@ -270,6 +388,13 @@ void FrameReceiver::EmitAvailableEncodedFramesAfterWaiting(int result) {
   EmitAvailableEncodedFrames();
 }
 
+base::TimeTicks FrameReceiver::GetCaptureTime(const EncodedFrame& frame) const {
+  return lip_sync_reference_time_ + lip_sync_drift_.Current() +
+         RtpDeltaToTimeDelta(static_cast<int32_t>(frame.rtp_timestamp -
+                                                  lip_sync_rtp_timestamp_),
+                             rtp_timebase_);
+}
+
 base::TimeTicks FrameReceiver::GetPlayoutTime(const EncodedFrame& frame) const {
   base::TimeDelta target_playout_delay = target_playout_delay_;
   if (frame.new_playout_delay_ms) {
@@ -277,9 +402,20 @@ base::TimeTicks FrameReceiver::GetPlayoutTime(const EncodedFrame& frame) const {
         base::TimeDelta::FromMilliseconds(frame.new_playout_delay_ms);
   }
 
-  return lip_sync_reference_time_ + lip_sync_drift_.Current() +
-         RtpDeltaToTimeDelta(static_cast<int32_t>(frame.rtp_timestamp -
-                                                  lip_sync_rtp_timestamp_),
-                             rtp_timebase_) +
-         target_playout_delay;
+  return GetCaptureTime(frame) + target_playout_delay;
+}
+
+void FrameReceiver::LogFrameEvent(sharer::SharerLoggingEvent type,
+                                  const EncodedFrame& frame,
+                                  base::TimeTicks time) const {
+  sharer::FrameEvent event;
+  event.timestamp = time;
+  event.type = type;
+  event.media_type = media_type_;
+  event.ssrc = sender_ssrc_;
+  event.rtp_timestamp = frame.rtp_timestamp;
+  event.frame_id = frame.frame_id;
+  event.size = frame.data.size();
+  event.key_frame = frame.dependency == EncodedFrame::KEY;
+  env_->logger()->DispatchFrameEvent(event);
 }
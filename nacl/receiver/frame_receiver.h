@@ -45,6 +45,18 @@ class FrameReceiver : public RtpPayloadFeedback {
   void FlushFrames();
   void SendPausedIndication(int last_frame, int pause_id);
   int getLastFrameAck();
+  void SetMaxTemporalLayer(uint8_t layer);
+
+  // True once the next frame to decode is complete, e.g. the first key frame
+  // after joining a stream.
+  bool HasFrameReady() const;
+  // Hands the pending frame requests over to |other|, when switching streams.
+  void MoveFrameRequestsTo(FrameReceiver* other);
+  // Loss in the last RTCP report interval, as the RTCP fraction lost.
+  uint8_t fraction_lost() const { return fraction_lost_; }
+  // Frames that missed their playout time so far: skipped, given up on, or
+  // starting a catch-up.
+  int late_frames() const { return late_frames_; }
 
  private:
   void ProcessParsedPacket(std::unique_ptr<RTP> packet);
@@ -57,11 +69,18 @@ class FrameReceiver : public RtpPayloadFeedback {
   void EmitAvailableEncodedFrames();
   void EmitAvailableEncodedFramesAfterWaiting(int result);
 
+  // Capture time of |frame| on the sender, in our clock.
+  base::TimeTicks GetCaptureTime(const EncodedFrame& frame) const;
   base::TimeTicks GetPlayoutTime(const EncodedFrame& frame) const;
+  void LogFrameEvent(sharer::SharerLoggingEvent type, const EncodedFrame& frame,
+                     base::TimeTicks time) const;
 
   void CheckNetworkTimeout(const base::TimeTicks& now);
+  void CollectMetrics(sharer::MetricsSnapshot* snapshot) const;
 
   const int rtp_timebase_;
+  const uint32_t sender_ssrc_;
+  const sharer::EventMediaType media_type_;
   base::TimeDelta target_playout_delay_;
   const base::TimeDelta expected_frame_duration_;
 
@@ -79,6 +98,10 @@ class FrameReceiver : public RtpPayloadFeedback {
 
   bool is_waiting_for_consecutive_frame_;
 
+  // Set while decoding late base layer frames back to back to catch up with
+  // the live stream.
+  bool is_catching_up_;
+
   std::array<RtpTimestamp, 256> frame_id_to_rtp_timestamp_;
 
   RtpTimestamp lip_sync_rtp_timestamp_;
@@ -88,7 +111,13 @@ class FrameReceiver : public RtpPayloadFeedback {
   OnNetworkTimeoutCallback on_network_timeout_;
   int network_timeouts_count_;
   base::TimeTicks last_received_time_;
+  base::TimeTicks first_received_time_;
+  bool first_frame_emitted_;
   int last_frame_id_;
+  uint8_t fraction_lost_;
+  int late_frames_;
+  sharer::MetricCounter* const late_frames_metric_;
+  const int metrics_collector_;
   /* uint32_t senderSsrc_; */
   /* uint32_t receiverSsrc_; */
 };
@@ -0,0 +1,212 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "receiver/layer_selector.h"
+
+#include <algorithm>
+
+#include "base/logger.h"
+#include "net/sharer_transport_config.h"
+
+// A layer is considered gone if no packet of it arrived for this long.
+static const int kLayerTimeoutMs = 2000;
+// Fraction lost above which a report counts as congested, ~10%.
+static const uint8_t kHighLossFraction = 26;
+// Late frames in a report above which it counts as congested.
+static const int kMaxLateFrames = 2;
+// Consecutive congested reports before leaving a settled layer.
+static const int kCongestedReportsToLeave = 2;
+// How long a joined layer must stay clean for the experiment to succeed.
+static const int kExperimentMs = 5000;
+// Experiments whose layer never started decoding are abandoned after this.
+static const int kExperimentTimeoutMs = 3 * kExperimentMs;
+// Bounds of the per layer join timer.
+static const int kMinJoinTimerMs = 5000;
+static const int kMaxJoinTimerMs = 160000;
+
+// Reads the picture size from the header of a VP8 key frame (RFC 6386,
+// section 9.1). Returns false for inter frames.
+static bool ParseVp8KeyFrameSize(const std::string& data, int* width,
+                                 int* height) {
+  if (data.size() < 10) return false;
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data());
+  if (p[0] & 0x01) return false;  // Inter frame.
+  if (p[3] != 0x9d || p[4] != 0x01 || p[5] != 0x2a) return false;
+  *width = (p[6] | (p[7] << 8)) & 0x3fff;
+  *height = (p[8] | (p[9] << 8)) & 0x3fff;
+  return *width > 0 && *height > 0;
+}
+
+LayerSelector::LayerSelector(base::TickClock* clock)
+    : clock_(clock),
+      layer_count_(0),
+      display_width_(0),
+      display_height_(0),
+      current_layer_(-1),
+      target_layer_(-1),
+      experiment_layer_(-1),
+      experiment_fallback_(-1),
+      congested_reports_(0),
+      step_down_(false) {
+  for (int i = 0; i < sharer::kMaxSimulcastLayers; ++i) {
+    widths_[i] = 0;
+    heights_[i] = 0;
+    join_timer_[i] = base::TimeDelta::FromMilliseconds(kMinJoinTimerMs);
+  }
+}
+
+LayerSelector::~LayerSelector() {}
+
+void LayerSelector::SetLayerCount(int count) { layer_count_ = count; }
+
+void LayerSelector::OnLayerSeen(int layer) {
+  last_seen_[layer] = clock_->NowTicks();
+}
+
+void LayerSelector::OnFrame(int layer, const EncodedFrame& frame) {
+  int width, height;
+  if (!ParseVp8KeyFrameSize(frame.data, &width, &height)) return;
+  if (width != widths_[layer] || height != heights_[layer]) {
+    DINF() << "Simulcast layer " << layer << " is " << width << "x" << height;
+    widths_[layer] = width;
+    heights_[layer] = height;
+  }
+}
+
+void LayerSelector::SetDisplaySize(int width, int height) {
+  display_width_ = width;
+  display_height_ = height;
+}
+
+void LayerSelector::OnLayerSwitched(int layer) {
+  current_layer_ = layer;
+  if (target_layer_ < 0) target_layer_ = layer;
+}
+
+void LayerSelector::OnReceptionReport(uint8_t fraction_lost, int late_frames) {
+  const base::TimeTicks now = clock_->NowTicks();
+  const bool congested =
+      fraction_lost > kHighLossFraction || late_frames > kMaxLateFrames;
+
+  if (experiment_layer_ >= 0) {
+    const base::TimeDelta elapsed = now - experiment_start_;
+    if (congested ||
+        elapsed > base::TimeDelta::FromMilliseconds(kExperimentTimeoutMs)) {
+      WRN() << "Join experiment of simulcast layer " << experiment_layer_
+            << " failed (loss: " << fraction_lost * 100 / 256
+            << "%, late frames: " << late_frames << ").";
+      BackOff(experiment_layer_, now);
+      target_layer_ = experiment_fallback_;
+      experiment_layer_ = -1;
+    } else if (current_layer_ == experiment_layer_ &&
+               elapsed >= base::TimeDelta::FromMilliseconds(kExperimentMs)) {
+      INF() << "Join experiment of simulcast layer " << experiment_layer_
+            << " succeeded.";
+      join_timer_[experiment_layer_] = std::max(
+          join_timer_[experiment_layer_] / 2,
+          base::TimeDelta::FromMilliseconds(kMinJoinTimerMs));
+      experiment_layer_ = -1;
+    }
+    congested_reports_ = 0;
+    return;
+  }
+
+  // Until the switch to the target layer, the report is about the layer being
+  // left, e.g. the one that was congested.
+  if (!congested || current_layer_ != target_layer_) {
+    congested_reports_ = 0;
+    return;
+  }
+  if (++congested_reports_ < kCongestedReportsToLeave) return;
+
+  WRN() << "Congestion on simulcast layer " << target_layer_ << " (loss: "
+        << fraction_lost * 100 / 256 << "%, late frames: " << late_frames
+        << "), stepping down.";
+  congested_reports_ = 0;
+  if (target_layer_ >= 0) BackOff(target_layer_, now);
+  step_down_ = true;
+}
+
+int LayerSelector::SelectLayer() {
+  const base::TimeTicks now = clock_->NowTicks();
+  const int size_layer = SizeLayer(now);
+  if (target_layer_ < 0) return size_layer;
+
+  if (step_down_) {
+    step_down_ = false;
+    int next = target_layer_ + 1;
+    while (next < sharer::kMaxSimulcastLayers && !IsAvailable(next, now))
+      ++next;
+    if (next < sharer::kMaxSimulcastLayers) target_layer_ = next;
+  } else if (experiment_layer_ < 0) {
+    if (target_layer_ < size_layer) {
+      // Never decode more than the display needs.
+      target_layer_ = size_layer;
+    } else if (target_layer_ > size_layer) {
+      int next = target_layer_ - 1;
+      while (next > size_layer && !IsAvailable(next, now)) --next;
+      if (IsAvailable(next, now) && now >= next_join_[next]) {
+        INF() << "Join experiment of simulcast layer " << next;
+        experiment_layer_ = next;
+        experiment_fallback_ = target_layer_;
+        experiment_start_ = now;
+        target_layer_ = next;
+      }
+    }
+  }
+  return target_layer_;
+}
+
+int LayerSelector::SizeLayer(const base::TimeTicks& now) const {
+  // Smallest available layer still covering the display, or the largest
+  // available one if none does.
+  int size_layer = -1;
+  int largest = -1;
+  for (int layer = 0; layer < sharer::kMaxSimulcastLayers; ++layer) {
+    if (!IsAvailable(layer, now)) continue;
+    if (largest < 0) largest = layer;
+
+    int width, height;
+    if (!display_width_ || !EstimateSize(layer, &width, &height)) continue;
+    if (width >= display_width_ && height >= display_height_)
+      size_layer = layer;
+  }
+  if (largest < 0) return 0;
+  return size_layer < 0 ? largest : size_layer;
+}
+
+void LayerSelector::BackOff(int layer, const base::TimeTicks& now) {
+  next_join_[layer] = now + join_timer_[layer];
+  join_timer_[layer] = std::min(
+      join_timer_[layer] * 2,
+      base::TimeDelta::FromMilliseconds(kMaxJoinTimerMs));
+  DINF() << "Next join of simulcast layer " << layer << " in "
+         << (next_join_[layer] - now).InMilliseconds() << " ms";
+}
+
+bool LayerSelector::IsAvailable(int layer, const base::TimeTicks& now) const {
+  if (layer_count_ > 0) return layer < layer_count_;
+  return !last_seen_[layer].is_null() &&
+         now - last_seen_[layer] <
+             base::TimeDelta::FromMilliseconds(kLayerTimeoutMs);
+}
+
+bool LayerSelector::EstimateSize(int layer, int* width, int* height) const {
+  if (widths_[layer]) {
+    *width = widths_[layer];
+    *height = heights_[layer];
+    return true;
+  }
+
+  // Every layer has half the resolution of the one before it.
+  for (int known = 0; known < sharer::kMaxSimulcastLayers; ++known) {
+    if (!widths_[known]) continue;
+    *width = known > layer ? widths_[known] << (known - layer)
+                           : widths_[known] >> (layer - known);
+    *height = known > layer ? heights_[known] << (known - layer)
+                            : heights_[known] >> (layer - known);
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,87 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef _LAYER_SELECTOR_
+#define _LAYER_SELECTOR_
+
+#include "base/macros.h"
+#include "base/time/tick_clock.h"
+#include "base/time/time.h"
+#include "sharer_defines.h"
+
+#include <stdint.h>
+
+struct EncodedFrame;
+
+// Picks the simulcast layer a receiver should decode.
+//
+// The smallest layer that still covers the display is preferred, so a small
+// window doesn't decode and repair a stream it will only downscale. Layer
+// sizes are learned from the key frames of the layers decoded so far.
+//
+// Within that limit the receiver probes for capacity like receiver-driven
+// layered multicast: it starts low and every so often runs a join experiment,
+// moving one layer up. If loss or late frames show up during the experiment
+// the layer is left right away and the time before trying it again doubles.
+// Sustained congestion on a settled layer moves one layer down the same way.
+class LayerSelector {
+ public:
+  explicit LayerSelector(base::TickClock* clock);
+  ~LayerSelector();
+
+  // Number of layers the sender puts on separate multicast groups. Their
+  // packets only arrive once joined, so they are assumed to exist. 0 means
+  // all layers share one group and are available once seen.
+  void SetLayerCount(int count);
+  // A packet of |layer| was received, so the sender is producing it.
+  void OnLayerSeen(int layer);
+  // |frame| of |layer| is about to be decoded.
+  void OnFrame(int layer, const EncodedFrame& frame);
+  void SetDisplaySize(int width, int height);
+  // The receiver started decoding |layer|.
+  void OnLayerSwitched(int layer);
+  // Reception of the layer being decoded since the last report: the RTCP
+  // fraction lost, and the number of frames that missed their playout time.
+  void OnReceptionReport(uint8_t fraction_lost, int late_frames);
+
+  int SelectLayer();
+
+ private:
+  bool IsAvailable(int layer, const base::TimeTicks& now) const;
+  bool EstimateSize(int layer, int* width, int* height) const;
+  int SizeLayer(const base::TimeTicks& now) const;
+  // Don't try to join |layer| again before its join timer expires, and double
+  // the timer for the time after.
+  void BackOff(int layer, const base::TimeTicks& now);
+
+  base::TickClock* const clock_;
+
+  int layer_count_;
+  base::TimeTicks last_seen_[sharer::kMaxSimulcastLayers];
+  int widths_[sharer::kMaxSimulcastLayers];
+  int heights_[sharer::kMaxSimulcastLayers];
+
+  int display_width_;
+  int display_height_;
+
+  // Layer being decoded, and the one we want to decode.
+  int current_layer_;
+  int target_layer_;
+
+  // Layer being tried by a join experiment, -1 if none, and the target to go
+  // back to if it fails.
+  int experiment_layer_;
+  int experiment_fallback_;
+  base::TimeTicks experiment_start_;
+
+  int congested_reports_;
+  bool step_down_;
+
+  base::TimeDelta join_timer_[sharer::kMaxSimulcastLayers];
+  base::TimeTicks next_join_[sharer::kMaxSimulcastLayers];
+
+  DISALLOW_COPY_AND_ASSIGN(LayerSelector);
+};
+
+#endif  // _LAYER_SELECTOR_
@@ -9,40 +9,85 @@
 #include "sharer_config.h"
 #include "net/rtp/rtp.h"
 
+#include "ppapi/cpp/module.h"
+
+#include <algorithm>
 #include <sstream>
 #include <stdio.h>
 
-NetworkHandler::NetworkHandler(pp::Instance* instance,
+static const int kLayerSelectionIntervalMs = 1000;
+
+NetworkHandler::NetworkHandler(sharer::SharerEnvironment* env,
                                const ReceiverConfig& audio_config,
                                const ReceiverConfig& video_config,
                                const sharer::ReceiverNetConfig& net_config)
-    : env_(instance),
-      udp_listener_(instance, this, net_config.address, net_config.port),
-      videoReceiver_(&env_, video_config, &udp_listener_),
-      audioReceiver_(&env_, audio_config, &udp_listener_),
+    : env_(env),
+      udp_listener_(env->instance(), env->clock(), this, net_config.address,
+                    net_config.port),
+      factory_(this),
+      videoConfig_(video_config),
+      maxTemporalLayer_(net_config.max_temporal_layer),
+      videoLayer_(sharer::SimulcastLayerForSsrc(video_config.sender_ssrc)),
+      pendingVideoLayer_(-1),
+      layerSelector_(env_->clock()),
+      layeredMulticast_(net_config.multicast_layers > 1),
+      reportedLateFrames_(0),
+      audioReceiver_(env_, audio_config, &udp_listener_),
       frameRequested_(false) {
+  PP_DCHECK(videoLayer_ >= 0);
+  if (layeredMulticast_) {
+    // Start from the smallest layer and let join experiments work up from
+    // there.
+    const int layers =
+        std::min(net_config.multicast_layers, sharer::kMaxSimulcastLayers);
+    layerSelector_.SetLayerCount(layers);
+    videoLayer_ = layers - 1;
+    JoinLayer(videoLayer_);
+  }
+  layerSelector_.OnLayerSwitched(videoLayer_);
+  videoReceiver_ = CreateVideoReceiver(videoLayer_);
   auto cb = [this]() { udp_listener_.OnNetworkTimeout(); };
-  videoReceiver_.SetOnNetworkTimeout(cb);
+  videoReceiver_->SetOnNetworkTimeout(cb);
+  ScheduleLayerSelection();
 }
 
 NetworkHandler::~NetworkHandler() {}
 
-void NetworkHandler::OnReceived(const char* buffer, int32_t size) {
+void NetworkHandler::OnReceived(const char* buffer, int32_t size,
+                                base::TimeTicks arrival_time) {
   const unsigned char* data = reinterpret_cast<const unsigned char*>(buffer);
   uint32_t ssrc;
-  std::unique_ptr<RTPBase> packet = rtpParse(env_.instance(), data, size, &ssrc);
+  std::unique_ptr<RTPBase> packet = rtpParse(env_->instance(), data, size, &ssrc);
   if (!packet) {
     return;
   }
+  packet->set_arrival_time(arrival_time);
 
   storePacket(ssrc, std::move(packet));
 }
 
+std::unique_ptr<FrameReceiver> NetworkHandler::CreateVideoReceiver(int layer) {
+  ReceiverConfig config = videoConfig_;
+  config.sender_ssrc = sharer::VideoSsrcForLayer(layer);
+  config.receiver_ssrc = sharer::VideoFeedbackSsrcForLayer(layer);
+  auto receiver = make_unique<FrameReceiver>(env_, config, &udp_listener_);
+  receiver->SetMaxTemporalLayer(maxTemporalLayer_);
+  return receiver;
+}
+
 void NetworkHandler::storePacket(uint32_t ssrc,
                                  std::unique_ptr<RTPBase> packet) {
-  if (ssrc == 11)
-    videoReceiver_.ProcessPacket(std::move(packet));
-  else if (ssrc == 1) {
+  const int layer = sharer::SimulcastLayerForSsrc(ssrc);
+  if (layer >= 0) {
+    layerSelector_.OnLayerSeen(layer);
+    if (layer == videoLayer_) {
+      videoReceiver_->ProcessPacket(std::move(packet));
+    } else if (layer == pendingVideoLayer_) {
+      pendingVideoReceiver_->ProcessPacket(std::move(packet));
+      if (pendingVideoReceiver_->HasFrameReady()) SwitchToPendingLayer();
+    }
+    // Other simulcast layers are not for us.
+  } else if (ssrc == 1) {
     /* audioReceiver_.ProcessPacket(std::move(packet)); */
   } else {
     ERR() << "Packet from unknown source: " << ssrc;
@@ -53,15 +98,94 @@ void NetworkHandler::storePacket(uint32_t ssrc,
 void NetworkHandler::GetNextFrame(const ReceiveEncodedFrameCallback& callback) {
   frameRequested_ = true;
 
-  videoReceiver_.RequestEncodedFrame(callback);
+  auto frame_cb = [this, callback](std::shared_ptr<EncodedFrame> frame) {
+    layerSelector_.OnFrame(videoLayer_, *frame);
+    callback(frame);
+  };
+  videoReceiver_->RequestEncodedFrame(frame_cb);
+}
+
+void NetworkHandler::SetDisplaySize(const pp::Size& size) {
+  layerSelector_.SetDisplaySize(size.width(), size.height());
+}
+
+void NetworkHandler::ScheduleLayerSelection() {
+  auto cc = factory_.NewCallback(&NetworkHandler::SelectVideoLayer);
+  pp::Module::Get()->core()->CallOnMainThread(kLayerSelectionIntervalMs, cc);
+}
+
+void NetworkHandler::SelectVideoLayer(int32_t result) {
+  retiredVideoReceiver_ = nullptr;
+
+  const int late_frames = videoReceiver_->late_frames();
+  layerSelector_.OnReceptionReport(videoReceiver_->fraction_lost(),
+                                   late_frames - reportedLateFrames_);
+  reportedLateFrames_ = late_frames;
+
+  const int layer = layerSelector_.SelectLayer();
+  if (layer == videoLayer_) {
+    if (pendingVideoReceiver_) {
+      INF() << "Staying on simulcast layer " << videoLayer_;
+      LeaveLayer(pendingVideoLayer_);
+      if (pendingVideoLayer_ > videoLayer_) JoinLayer(videoLayer_);
+      pendingVideoReceiver_ = nullptr;
+      pendingVideoLayer_ = -1;
+    }
+  } else if (layer != pendingVideoLayer_) {
+    // The new receiver asks for a key frame as soon as it gets a packet. We
+    // switch once it is complete, so the decoder never waits.
+    INF() << "Selected simulcast layer " << layer << ", waiting for a key frame.";
+    const bool left_current =
+        pendingVideoReceiver_ && pendingVideoLayer_ > videoLayer_;
+    if (pendingVideoReceiver_) LeaveLayer(pendingVideoLayer_);
+    JoinLayer(layer);
+    // Stepping down to a smaller layer, usually because the link is
+    // congested: the current layer is left right away, or the key frame of
+    // the new one could not make it through the same congested link. The
+    // decoder waits for it instead.
+    if (layer > videoLayer_ && !left_current) {
+      LeaveLayer(videoLayer_);
+    } else if (layer < videoLayer_ && left_current) {
+      JoinLayer(videoLayer_);
+    }
+    pendingVideoReceiver_ = CreateVideoReceiver(layer);
+    pendingVideoLayer_ = layer;
+  }
+
+  ScheduleLayerSelection();
+}
+
+void NetworkHandler::SwitchToPendingLayer() {
+  INF() << "Switching from simulcast layer " << videoLayer_ << " to "
+        << pendingVideoLayer_;
+  videoReceiver_->MoveFrameRequestsTo(pendingVideoReceiver_.get());
+  // Already left when stepping down, see SelectVideoLayer().
+  if (pendingVideoLayer_ < videoLayer_) LeaveLayer(videoLayer_);
+  retiredVideoReceiver_ = std::move(videoReceiver_);
+  videoReceiver_ = std::move(pendingVideoReceiver_);
+  videoLayer_ = pendingVideoLayer_;
+  pendingVideoLayer_ = -1;
+  reportedLateFrames_ = videoReceiver_->late_frames();
+  layerSelector_.OnLayerSwitched(videoLayer_);
+
+  auto cb = [this]() { udp_listener_.OnNetworkTimeout(); };
+  videoReceiver_->SetOnNetworkTimeout(cb);
+}
+
+void NetworkHandler::JoinLayer(int layer) {
+  if (layeredMulticast_) udp_listener_.JoinLayer(layer);
+}
+
+void NetworkHandler::LeaveLayer(int layer) {
+  if (layeredMulticast_) udp_listener_.LeaveLayer(layer);
 }
 
 void NetworkHandler::ReleaseFrame() {}
 
 void NetworkHandler::OnPaused() {
   udp_listener_.StopListening();
-  videoReceiver_.FlushFrames();
-  // videoReceiver_.SendPausedIndication(videoReceiver_.getLastFrameAck(), 0);
+  videoReceiver_->FlushFrames();
+  // videoReceiver_->SendPausedIndication(videoReceiver_->getLastFrameAck(), 0);
 }
 
 void NetworkHandler::OnResumed() { udp_listener_.StartListening(); }
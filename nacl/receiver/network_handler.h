@@ -6,16 +6,19 @@
 #define _NETWORK_HANDLER_
 
 #include "receiver/frame_receiver.h"
+#include "receiver/layer_selector.h"
+#include "sharer_config.h"
 #include "net/udp_delegate_interface.h"
 #include "net/udp_listener.h"
 #include "sharer_environment.h"
 
 #include "ppapi/cpp/instance.h"
+#include "ppapi/utility/completion_callback_factory.h"
 
+#include <memory>
 #include <queue>
 
 class RTP;
-struct ReceiverConfig;
 
 namespace sharer {
   struct ReceiverNetConfig;
@@ -23,7 +26,9 @@ namespace sharer {
 
 class NetworkHandler : public UDPDelegateInterface {
  public:
-  explicit NetworkHandler(pp::Instance* instance,
+  // Logs the events of the received streams to the logger of |env|, which
+  // must outlive us.
+  explicit NetworkHandler(sharer::SharerEnvironment* env,
                           const ReceiverConfig& audio_config,
                           const ReceiverConfig& video_config,
                           const sharer::ReceiverNetConfig& config);
@@ -33,11 +38,21 @@ class NetworkHandler : public UDPDelegateInterface {
   void ReleaseFrame();
   void OnPaused();
   void OnResumed();
+  void SetDisplaySize(const pp::Size& size);
+  // Simulcast layer being decoded.
+  int video_layer() const { return videoLayer_; }
 
-  virtual void OnReceived(const char* buffer, int32_t size);
+  virtual void OnReceived(const char* buffer, int32_t size,
+                          base::TimeTicks arrival_time);
 
  private:
   void storePacket(uint32_t ssrc, std::unique_ptr<RTPBase> packet);
+  std::unique_ptr<FrameReceiver> CreateVideoReceiver(int layer);
+  void ScheduleLayerSelection();
+  void SelectVideoLayer(int32_t result);
+  void SwitchToPendingLayer();
+  void JoinLayer(int layer);
+  void LeaveLayer(int layer);
   /* void checkFlush(std::queue<RTP*>& queue); */
   /* int checkSequence(RTP* received, RTP* last); */
   /* bool ParseFrame(); */
@@ -47,11 +62,29 @@ class NetworkHandler : public UDPDelegateInterface {
   /* void FillBuffer(const RTP* packet, int32_t start, int32_t size); */
   /* void DropFrame(); */
 
-  sharer::SharerEnvironment env_;
+  sharer::SharerEnvironment* const env_;
   /* NetworkDelegateInterface* delegate_; */
   UDPListener udp_listener_;
 
-  FrameReceiver videoReceiver_;
+  pp::CompletionCallbackFactory<NetworkHandler> factory_;
+  ReceiverConfig videoConfig_;
+  uint8_t maxTemporalLayer_;
+
+  // Receiver of the simulcast layer being decoded. When switching layers, the
+  // new one is received by |pendingVideoReceiver_| until its first key frame
+  // is complete. The previous receiver is kept until the next layer selection,
+  // so that frames it already posted are still delivered.
+  std::unique_ptr<FrameReceiver> videoReceiver_;
+  std::unique_ptr<FrameReceiver> pendingVideoReceiver_;
+  std::unique_ptr<FrameReceiver> retiredVideoReceiver_;
+  int videoLayer_;
+  int pendingVideoLayer_;
+  LayerSelector layerSelector_;
+  // Layers are on separate multicast groups, and only the groups of the
+  // layers being received are joined.
+  const bool layeredMulticast_;
+  int reportedLateFrames_;
+
   FrameReceiver audioReceiver_;
   /* SourceHandler srcVideo_; */
   /* SourceHandler srcAudio_; */
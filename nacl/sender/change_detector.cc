@@ -0,0 +1,182 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sender/change_detector.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+// PNaCl is portable bitcode, so only the C hash is available there.
+#if !defined(__pnacl__) && defined(__x86_64__)
+#define CHANGE_DETECTOR_SSE42 1
+#include <cpuid.h>
+#include <nmmintrin.h>
+#elif !defined(__pnacl__) && defined(__ARM_FEATURE_CRC32)
+#define CHANGE_DETECTOR_ARM_CRC32 1
+#include <arm_acle.h>
+#endif
+
+namespace sharer {
+
+namespace {
+
+// Folds each |segment| bytes of |row| into the matching entry of |hashes|.
+using HashRowFunction = void (*)(const uint8_t* row, int width, int segment,
+                                 uint32_t* hashes);
+
+inline uint32_t MixWord(uint32_t hash, uint64_t word) {
+  const uint64_t mixed = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+  return static_cast<uint32_t>(mixed >> 32) ^ static_cast<uint32_t>(mixed);
+}
+
+void HashRowC(const uint8_t* row, int width, int segment, uint32_t* hashes) {
+  for (int x = 0; x < width; x += segment, ++hashes) {
+    const int end = std::min(x + segment, width);
+    uint32_t hash = *hashes;
+    int i = x;
+    for (; i + 8 <= end; i += 8) {
+      uint64_t word;
+      memcpy(&word, row + i, 8);
+      hash = MixWord(hash, word);
+    }
+    for (; i < end; ++i) hash = MixWord(hash, row[i]);
+    *hashes = hash;
+  }
+}
+
+#if defined(CHANGE_DETECTOR_SSE42)
+
+__attribute__((target("sse4.2"))) void HashRowSse42(const uint8_t* row,
+                                                      int width, int segment,
+                                                      uint32_t* hashes) {
+  for (int x = 0; x < width; x += segment, ++hashes) {
+    const int end = std::min(x + segment, width);
+    uint64_t hash = *hashes;
+    int i = x;
+    for (; i + 8 <= end; i += 8) {
+      uint64_t word;
+      memcpy(&word, row + i, 8);
+      hash = _mm_crc32_u64(hash, word);
+    }
+    uint32_t hash32 = static_cast<uint32_t>(hash);
+    for (; i < end; ++i) hash32 = _mm_crc32_u8(hash32, row[i]);
+    *hashes = hash32;
+  }
+}
+
+bool CpuHasSse42() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+  return (ecx & bit_SSE4_2) != 0;
+}
+
+#elif defined(CHANGE_DETECTOR_ARM_CRC32)
+
+void HashRowArmCrc32(const uint8_t* row, int width, int segment,
+                     uint32_t* hashes) {
+  for (int x = 0; x < width; x += segment, ++hashes) {
+    const int end = std::min(x + segment, width);
+    uint32_t hash = *hashes;
+    int i = x;
+    for (; i + 8 <= end; i += 8) {
+      uint64_t word;
+      memcpy(&word, row + i, 8);
+      hash = __crc32cd(hash, word);
+    }
+    for (; i < end; ++i) hash = __crc32cb(hash, row[i]);
+    *hashes = hash;
+  }
+}
+
+#endif
+
+HashRowFunction PreferredHashRow() {
+#if defined(CHANGE_DETECTOR_SSE42)
+  if (CpuHasSse42()) return &HashRowSse42;
+#elif defined(CHANGE_DETECTOR_ARM_CRC32)
+  return &HashRowArmCrc32;
+#endif
+  return &HashRowC;
+}
+
+// Hashes a |width| x |height| plane into blocks of |block_size| pixels, one
+// row of blocks after the other.
+void HashPlane(const uint8_t* plane, int width, int height, int block_size,
+               int blocks_wide, uint32_t* hashes) {
+  static const HashRowFunction hash_row = PreferredHashRow();
+  for (int y = 0; y < height; ++y) {
+    hash_row(plane + static_cast<size_t>(y) * width, width, block_size,
+             hashes + (y / block_size) * blocks_wide);
+  }
+}
+
+}  // namespace
+
+ChangeDetector::ChangeDetector()
+    : width_(0),
+      height_(0),
+      blocks_wide_(0),
+      blocks_high_(0),
+      changed_blocks_(0) {}
+
+ChangeDetector::~ChangeDetector() {}
+
+void ChangeDetector::Reset() {
+  width_ = 0;
+  height_ = 0;
+  previous_hashes_.clear();
+}
+
+bool ChangeDetector::DetectChanges(const uint8_t* frame, int width,
+                                   int height, Region* changed) {
+  const bool size_changed = width != width_ || height != height_;
+  if (size_changed) {
+    width_ = width;
+    height_ = height;
+    blocks_wide_ = (width + kBlockSize - 1) / kBlockSize;
+    blocks_high_ = (height + kBlockSize - 1) / kBlockSize;
+    previous_hashes_.clear();
+  }
+
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  const uint8_t* u = frame + static_cast<size_t>(width) * height;
+  const uint8_t* v = u + static_cast<size_t>(chroma_width) * chroma_height;
+
+  // Chroma blocks line up with the luma ones, so they fold into the same
+  // hashes.
+  hashes_.assign(blocks_wide_ * blocks_high_, 0);
+  HashPlane(frame, width, height, kBlockSize, blocks_wide_, hashes_.data());
+  HashPlane(u, chroma_width, chroma_height, kBlockSize / 2, blocks_wide_,
+            hashes_.data());
+  HashPlane(v, chroma_width, chroma_height, kBlockSize / 2, blocks_wide_,
+            hashes_.data());
+
+  const bool all_changed = previous_hashes_.empty();
+  int min_x = blocks_wide_, min_y = blocks_high_, max_x = -1, max_y = -1;
+  changed_blocks_ = 0;
+  for (int by = 0; by < blocks_high_; ++by) {
+    for (int bx = 0; bx < blocks_wide_; ++bx) {
+      const int i = by * blocks_wide_ + bx;
+      if (!all_changed && hashes_[i] == previous_hashes_[i]) continue;
+      ++changed_blocks_;
+      min_x = std::min(min_x, bx);
+      max_x = std::max(max_x, bx);
+      min_y = std::min(min_y, by);
+      max_y = std::max(max_y, by);
+    }
+  }
+  previous_hashes_.swap(hashes_);
+
+  if (!changed_blocks_) return false;
+
+  changed->x = min_x * kBlockSize;
+  changed->y = min_y * kBlockSize;
+  changed->width = std::min((max_x + 1) * kBlockSize, width) - changed->x;
+  changed->height = std::min((max_y + 1) * kBlockSize, height) - changed->y;
+  return true;
+}
+
+}  // namespace sharer
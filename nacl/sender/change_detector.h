@@ -0,0 +1,64 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SENDER_CHANGE_DETECTOR_H_
+#define SENDER_CHANGE_DETECTOR_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/macros.h"
+
+namespace sharer {
+
+// Finds the parts of a captured frame that changed since the previous one.
+//
+// The frame is split into 16x16 luma blocks (with their 8x8 chroma blocks),
+// and a CRC of every block is compared with the one of the previous frame.
+// The CRC uses the SSE4.2 or ARMv8 CRC32 instructions when available. Only the
+// hashes of the previous frame are kept, not the frame itself.
+class ChangeDetector {
+ public:
+  static const int kBlockSize = 16;
+
+  // Bounding box of the changed blocks, in pixels.
+  struct Region {
+    int x;
+    int y;
+    int width;
+    int height;
+  };
+
+  ChangeDetector();
+  ~ChangeDetector();
+
+  // Hashes the tightly packed I420 |frame| and compares it with the previous
+  // one. Returns true and sets |changed| if any block differs. The first
+  // frame, and every frame after a size change or Reset(), is all changed.
+  bool DetectChanges(const uint8_t* frame, int width, int height,
+                     Region* changed);
+
+  // Forgets the previous frame.
+  void Reset();
+
+  // Blocks that changed in the last DetectChanges(), and blocks per frame.
+  int changed_blocks() const { return changed_blocks_; }
+  int total_blocks() const { return blocks_wide_ * blocks_high_; }
+
+ private:
+  int width_;
+  int height_;
+  int blocks_wide_;
+  int blocks_high_;
+  int changed_blocks_;
+  std::vector<uint32_t> hashes_;
+  std::vector<uint32_t> previous_hashes_;
+
+  DISALLOW_COPY_AND_ASSIGN(ChangeDetector);
+};
+
+}  // namespace sharer
+
+#endif  // SENDER_CHANGE_DETECTOR_H_
@@ -0,0 +1,66 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sender/encoded_frame_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "net/sharer_transport_config.h"
+
+namespace sharer {
+
+EncodedFramePool::EncodedFramePool(size_t max_frames)
+    : max_frames_(max_frames),
+      max_key_frame_size_(0),
+      max_delta_frame_size_(0),
+      buffers_grown_(0) {
+  frames_.reserve(max_frames_);
+}
+
+EncodedFramePool::~EncodedFramePool() {}
+
+std::shared_ptr<EncodedFrame> EncodedFramePool::Acquire(bool key_frame,
+                                                        size_t size) {
+  size_t& max_size = key_frame ? max_key_frame_size_ : max_delta_frame_size_;
+  max_size = std::max(max_size, size);
+
+  // Best fit among the free frames, or else the largest one.
+  std::shared_ptr<EncodedFrame>* best = nullptr;
+  for (auto& frame : frames_) {
+    if (frame.use_count() != 1) continue;
+    if (!best) {
+      best = &frame;
+      continue;
+    }
+    const size_t capacity = frame->data.capacity();
+    const size_t best_capacity = (*best)->data.capacity();
+    const bool fits = capacity >= size;
+    const bool best_fits = best_capacity >= size;
+    if (fits ? !best_fits || capacity < best_capacity
+             : !best_fits && capacity > best_capacity) {
+      best = &frame;
+    }
+  }
+
+  if (!best) {
+    if (frames_.size() >= max_frames_) return nullptr;
+    frames_.push_back(std::make_shared<EncodedFrame>());
+    best = &frames_.back();
+  }
+
+  // Whoever dropped the frame last may have done so on another thread: see
+  // its writes before reusing the frame.
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  EncodedFrame* frame = best->get();
+  frame->data.clear();
+  if (frame->data.capacity() < size) {
+    ++buffers_grown_;
+    frame->data.reserve(max_size);
+  }
+  return *best;
+}
+
+}  // namespace sharer
@@ -0,0 +1,57 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SENDER_ENCODED_FRAME_POOL_H_
+#define SENDER_ENCODED_FRAME_POOL_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/macros.h"
+
+struct EncodedFrame;
+
+namespace sharer {
+
+// A fixed set of reusable encoded frames, so that the encoder thread doesn't
+// allocate a frame and its data for every bitstream buffer.
+//
+// The pool keeps a reference to each of its frames, and a frame is free again
+// once the pool holds the only reference, i.e. once the packetizer and
+// everything else downstream dropped it. Frames are handed out on a single
+// thread, and may be dropped on any thread.
+//
+// A frame goes to the free frame of the smallest sufficient capacity, so key
+// frames end up reusing the large buffers. When a frame must grow, it reserves
+// the largest size seen for its type, so it grows at most once per type.
+class EncodedFramePool {
+ public:
+  explicit EncodedFramePool(size_t max_frames);
+  ~EncodedFramePool();
+
+  // Returns a frame with room for |size| bytes of data, or nullptr if all
+  // |max_frames| frames are in use. The frame data is empty, its other
+  // fields are left as they were.
+  std::shared_ptr<EncodedFrame> Acquire(bool key_frame, size_t size);
+
+  // Frames allocated and data buffers grown since creation. Both stop
+  // increasing once the pool is warm.
+  int frames_allocated() const { return static_cast<int>(frames_.size()); }
+  int buffers_grown() const { return buffers_grown_; }
+
+ private:
+  const size_t max_frames_;
+  std::vector<std::shared_ptr<EncodedFrame>> frames_;
+  size_t max_key_frame_size_;
+  size_t max_delta_frame_size_;
+  int buffers_grown_;
+
+  DISALLOW_COPY_AND_ASSIGN(EncodedFramePool);
+};
+
+}  // namespace sharer
+
+#endif  // SENDER_ENCODED_FRAME_POOL_H_
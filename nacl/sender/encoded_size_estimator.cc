@@ -0,0 +1,49 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sender/encoded_size_estimator.h"
+
+namespace sharer {
+
+namespace {
+
+// Weight of a new frame size in the average, when larger or smaller than it.
+const double kIncreaseWeight = 0.5;
+const double kDecreaseWeight = 0.125;
+
+// Until the first key frame is seen, expect it to be this many delta frames.
+const double kKeyToDeltaRatio = 8;
+
+double Update(double average, double bytes) {
+  if (!average) return bytes;
+  const double weight = bytes > average ? kIncreaseWeight : kDecreaseWeight;
+  return average + weight * (bytes - average);
+}
+
+}  // namespace
+
+EncodedSizeEstimator::EncodedSizeEstimator() { Reset(); }
+
+EncodedSizeEstimator::~EncodedSizeEstimator() {}
+
+void EncodedSizeEstimator::OnEncodedFrame(bool key_frame, size_t bytes) {
+  double& average = key_frame ? key_frame_bytes_ : delta_frame_bytes_;
+  average = Update(average, static_cast<double>(bytes));
+}
+
+size_t EncodedSizeEstimator::Predict(bool key_frame) const {
+  double bytes = key_frame ? key_frame_bytes_ : delta_frame_bytes_;
+  if (!bytes) {
+    bytes = key_frame ? delta_frame_bytes_ * kKeyToDeltaRatio
+                      : key_frame_bytes_ / kKeyToDeltaRatio;
+  }
+  return static_cast<size_t>(bytes);
+}
+
+void EncodedSizeEstimator::Reset() {
+  key_frame_bytes_ = 0;
+  delta_frame_bytes_ = 0;
+}
+
+}  // namespace sharer
@@ -0,0 +1,42 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SENDER_ENCODED_SIZE_ESTIMATOR_H_
+#define SENDER_ENCODED_SIZE_ESTIMATOR_H_
+
+#include <stddef.h>
+
+#include "base/macros.h"
+
+namespace sharer {
+
+// Predicts the size of the next encoded frame of each type from the sizes the
+// encoder actually produced.
+//
+// Sizes are averaged separately for key and delta frames. The average follows
+// increases quickly and decreases slowly, so that the first frames of complex
+// content, e.g. scrolling, are enough to expect large frames from then on.
+class EncodedSizeEstimator {
+ public:
+  EncodedSizeEstimator();
+  ~EncodedSizeEstimator();
+
+  void OnEncodedFrame(bool key_frame, size_t bytes);
+
+  // Expected size of the next frame of this type, in bytes. 0 until a frame
+  // of any type was encoded.
+  size_t Predict(bool key_frame) const;
+
+  void Reset();
+
+ private:
+  double key_frame_bytes_;
+  double delta_frame_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(EncodedSizeEstimator);
+};
+
+}  // namespace sharer
+
+#endif  // SENDER_ENCODED_SIZE_ESTIMATOR_H_
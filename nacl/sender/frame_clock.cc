@@ -0,0 +1,107 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sender/frame_clock.h"
+
+#include <algorithm>
+
+namespace sharer {
+
+// A track frame this early, in intervals, still counts for its deadline, so
+// that capture jitter doesn't make the clock skip frames.
+const double kTrackFrameTolerance = 0.25;
+
+FrameClock::FrameClock(base::TickClock* clock, double frame_rate,
+                       bool lock_to_track)
+    : clock_(clock),
+      interval_(base::TimeDelta::FromSecondsD(1.0 / frame_rate)),
+      lock_to_track_(lock_to_track),
+      has_track_deadline_(false),
+      next_track_deadline_(0),
+      captures_(0),
+      intervals_(0),
+      missed_ticks_(0) {}
+
+FrameClock::~FrameClock() {}
+
+void FrameClock::Start() {
+  next_deadline_ = clock_->NowTicks() + interval_;
+  has_track_deadline_ = false;
+  last_capture_ = base::TimeTicks();
+}
+
+void FrameClock::OnTick() {
+  const base::TimeTicks now = clock_->NowTicks();
+  RecordCapture(now);
+
+  next_deadline_ += interval_;
+  if (next_deadline_ <= now) {
+    // Too late to catch up: drop the ticks that passed and start over from
+    // now rather than bursting through them.
+    missed_ticks_ += (now - next_deadline_) / interval_ + 1;
+    next_deadline_ = now + interval_;
+  }
+}
+
+int32_t FrameClock::DelayUntilNextTick() const {
+  // Never wake up before the deadline: the rounding error goes into the
+  // following delay, since deadlines don't depend on wakeup times.
+  return static_cast<int32_t>(std::max<int64_t>(
+      0, (next_deadline_ - clock_->NowTicks()).InMillisecondsRoundedUp()));
+}
+
+bool FrameClock::ShouldCaptureTrackFrame(PP_TimeDelta timestamp) {
+  const double interval = interval_.InSecondsF();
+  // Also restart when the track timestamps jump back.
+  if (!has_track_deadline_ || timestamp < next_track_deadline_ - 2 * interval) {
+    has_track_deadline_ = true;
+    next_track_deadline_ = timestamp;
+  }
+
+  if (timestamp < next_track_deadline_ - kTrackFrameTolerance * interval)
+    return false;
+
+  next_track_deadline_ += interval;
+  if (next_track_deadline_ <= timestamp) {
+    missed_ticks_ += static_cast<int>((timestamp - next_track_deadline_) /
+                                      interval) + 1;
+    next_track_deadline_ = timestamp + interval;
+  }
+  RecordCapture(clock_->NowTicks());
+  return true;
+}
+
+FrameClock::Stats FrameClock::TakeStats() {
+  Stats stats;
+  stats.captures = captures_;
+  stats.missed_ticks = missed_ticks_;
+  stats.mean_interval_ms =
+      intervals_ ? total_interval_.InMillisecondsF() / intervals_ : 0;
+  stats.jitter_ms =
+      intervals_ ? total_deviation_.InMillisecondsF() / intervals_ : 0;
+  stats.max_deviation_ms = max_deviation_.InMillisecondsF();
+
+  captures_ = 0;
+  intervals_ = 0;
+  missed_ticks_ = 0;
+  total_interval_ = base::TimeDelta();
+  total_deviation_ = base::TimeDelta();
+  max_deviation_ = base::TimeDelta();
+  return stats;
+}
+
+void FrameClock::RecordCapture(base::TimeTicks now) {
+  ++captures_;
+  if (!last_capture_.is_null()) {
+    const base::TimeDelta interval = now - last_capture_;
+    const base::TimeDelta deviation = (interval - interval_).magnitude();
+    ++intervals_;
+    total_interval_ += interval;
+    total_deviation_ += deviation;
+    max_deviation_ = std::max(max_deviation_, deviation);
+  }
+  last_capture_ = now;
+}
+
+}  // namespace sharer
@@ -0,0 +1,84 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SENDER_FRAME_CLOCK_H_
+#define SENDER_FRAME_CLOCK_H_
+
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "base/time/tick_clock.h"
+#include "base/time/time.h"
+
+#include "ppapi/c/pp_time.h"
+
+namespace sharer {
+
+// Paces the capture of frames from the video track at the configured frame
+// rate.
+//
+// Ticks are scheduled against absolute deadlines one frame interval apart, so
+// neither rounding the interval to whole milliseconds nor a late wakeup shifts
+// the ticks after it: a late tick just makes the next delay shorter. When
+// locked to the track, there is no timer and frames are picked by their own
+// timestamps instead, one per interval.
+class FrameClock {
+ public:
+  // Capture intervals since the last TakeStats().
+  struct Stats {
+    int captures;
+    // Deadlines passed by more than a whole interval, so never ticked.
+    int missed_ticks;
+    double mean_interval_ms;
+    // Mean and maximum distance of an interval from the nominal one.
+    double jitter_ms;
+    double max_deviation_ms;
+  };
+
+  FrameClock(base::TickClock* clock, double frame_rate, bool lock_to_track);
+  ~FrameClock();
+
+  bool locked_to_track() const { return lock_to_track_; }
+  base::TimeDelta interval() const { return interval_; }
+
+  // Starts ticking one interval from now.
+  void Start();
+
+  // To call on each tick.
+  void OnTick();
+
+  // Delay from now until the next tick, in ms.
+  int32_t DelayUntilNextTick() const;
+
+  // When locked to the track, returns true if the track frame with
+  // |timestamp| is the one to capture for the current interval.
+  bool ShouldCaptureTrackFrame(PP_TimeDelta timestamp);
+
+  Stats TakeStats();
+
+ private:
+  void RecordCapture(base::TimeTicks now);
+
+  base::TickClock* const clock_;
+  const base::TimeDelta interval_;
+  const bool lock_to_track_;
+
+  base::TimeTicks next_deadline_;
+  bool has_track_deadline_;
+  PP_TimeDelta next_track_deadline_;
+
+  base::TimeTicks last_capture_;
+  int captures_;
+  int intervals_;
+  int missed_ticks_;
+  base::TimeDelta total_interval_;
+  base::TimeDelta total_deviation_;
+  base::TimeDelta max_deviation_;
+
+  DISALLOW_COPY_AND_ASSIGN(FrameClock);
+};
+
+}  // namespace sharer
+
+#endif  // SENDER_FRAME_CLOCK_H_
@@ -0,0 +1,217 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sender/frame_copy.h"
+
+#include <string.h>
+
+// PNaCl is portable bitcode, so only the plain copy is available there.
+#if !defined(__pnacl__) && (defined(__x86_64__) || defined(__i386__))
+#define FRAME_COPY_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#elif !defined(__pnacl__) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#define FRAME_COPY_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace sharer {
+
+namespace {
+
+// Below this, source and destination likely fit in the last level cache
+// together and memcpy() wins over bypassing it (see bench/).
+const size_t kNonTemporalCopyMinSize = 2 * 1024 * 1024;
+
+void CopyMemcpy(void* dst, const void* src, size_t size) {
+  memcpy(dst, src, size);
+}
+
+#if defined(FRAME_COPY_X86)
+
+// Copies up to the first |alignment| aligned byte of |dst| with memcpy(), so
+// the vector loop can use aligned stores. Returns the bytes copied.
+size_t CopyHead(uint8_t* dst, const uint8_t* src, size_t size,
+                size_t alignment) {
+  size_t head = (alignment - reinterpret_cast<uintptr_t>(dst) % alignment) %
+                alignment;
+  if (head > size) head = size;
+  memcpy(dst, src, head);
+  return head;
+}
+
+__attribute__((target("sse2"))) void CopySse2Stream(void* dst_ptr,
+                                                      const void* src_ptr,
+                                                      size_t size) {
+  uint8_t* dst = static_cast<uint8_t*>(dst_ptr);
+  const uint8_t* src = static_cast<const uint8_t*>(src_ptr);
+  const size_t head = CopyHead(dst, src, size, 16);
+  dst += head;
+  src += head;
+  size -= head;
+
+  for (; size >= 64; size -= 64, src += 64, dst += 64) {
+    const __m128i a =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+    const __m128i c =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+    const __m128i d =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst), a);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), b);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), c);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), d);
+  }
+  // Non-temporal stores are weakly ordered, publish them before returning.
+  _mm_sfence();
+  memcpy(dst, src, size);
+}
+
+__attribute__((target("avx2"))) void CopyAvx2Stream(void* dst_ptr,
+                                                      const void* src_ptr,
+                                                      size_t size) {
+  uint8_t* dst = static_cast<uint8_t*>(dst_ptr);
+  const uint8_t* src = static_cast<const uint8_t*>(src_ptr);
+  const size_t head = CopyHead(dst, src, size, 32);
+  dst += head;
+  src += head;
+  size -= head;
+
+  for (; size >= 128; size -= 128, src += 128, dst += 128) {
+    const __m256i a =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+    const __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+    const __m256i c =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 64));
+    const __m256i d =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 96));
+    _mm256_stream_si256(reinterpret_cast<__m256i*>(dst), a);
+    _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 32), b);
+    _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 64), c);
+    _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 96), d);
+  }
+  _mm_sfence();
+  memcpy(dst, src, size);
+}
+
+bool CpuHasSse2() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+  return (edx & bit_SSE2) != 0;
+}
+
+bool CpuHasAvx2() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+  // The OS must save the YMM registers on context switches.
+  if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX)) return false;
+#if !defined(__native_client__)
+  uint32_t xcr0_lo, xcr0_hi;
+  __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+  if ((xcr0_lo & 0x6) != 0x6) return false;
+#endif
+  if (__get_cpuid_max(0, nullptr) < 7) return false;
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  return (ebx & bit_AVX2) != 0;
+}
+
+#elif defined(FRAME_COPY_NEON)
+
+// NEON has no non-temporal stores; wide loads and stores still beat the
+// byte-oriented copy of some libc implementations.
+void CopyNeon(void* dst_ptr, const void* src_ptr, size_t size) {
+  uint8_t* dst = static_cast<uint8_t*>(dst_ptr);
+  const uint8_t* src = static_cast<const uint8_t*>(src_ptr);
+  for (; size >= 64; size -= 64, src += 64, dst += 64) {
+    const uint8x16_t a = vld1q_u8(src);
+    const uint8x16_t b = vld1q_u8(src + 16);
+    const uint8x16_t c = vld1q_u8(src + 32);
+    const uint8x16_t d = vld1q_u8(src + 48);
+    vst1q_u8(dst, a);
+    vst1q_u8(dst + 16, b);
+    vst1q_u8(dst + 32, c);
+    vst1q_u8(dst + 48, d);
+  }
+  memcpy(dst, src, size);
+}
+
+#endif
+
+FrameCopyFunction PreferredFrameCopy() {
+  return SupportedFrameCopyKernels().back().function;
+}
+
+// Copies a |src_width| x |src_height| plane into a larger one, repeating the
+// last column and row.
+void CopyPlane(const uint8_t* src, int src_width, int src_height, uint8_t* dst,
+               int dst_width, int dst_height) {
+  uint8_t* dst_row = dst;
+  for (int y = 0; y < src_height; ++y, dst_row += dst_width) {
+    CopyFrameData(dst_row, src + static_cast<size_t>(y) * src_width,
+                  src_width);
+    if (dst_width > src_width) {
+      memset(dst_row + src_width, dst_row[src_width - 1],
+             dst_width - src_width);
+    }
+  }
+  const uint8_t* last_row = dst_row - dst_width;
+  for (int y = src_height; y < dst_height; ++y, dst_row += dst_width)
+    CopyFrameData(dst_row, last_row, dst_width);
+}
+
+}  // namespace
+
+std::vector<FrameCopyKernel> SupportedFrameCopyKernels() {
+  std::vector<FrameCopyKernel> kernels;
+  kernels.push_back({"memcpy", &CopyMemcpy});
+#if defined(FRAME_COPY_X86)
+  if (CpuHasSse2()) kernels.push_back({"sse2-stream", &CopySse2Stream});
+  if (CpuHasAvx2()) kernels.push_back({"avx2-stream", &CopyAvx2Stream});
+#elif defined(FRAME_COPY_NEON)
+  kernels.push_back({"neon", &CopyNeon});
+#endif
+  return kernels;
+}
+
+void CopyFrameData(void* dst, const void* src, size_t size) {
+  static const FrameCopyFunction copy = PreferredFrameCopy();
+  if (size < kNonTemporalCopyMinSize)
+    memcpy(dst, src, size);
+  else
+    copy(dst, src, size);
+}
+
+void CopyI420(const uint8_t* src, int src_width, int src_height, uint8_t* dst,
+              int dst_width, int dst_height) {
+  const int src_chroma_width = (src_width + 1) / 2;
+  const int src_chroma_height = (src_height + 1) / 2;
+  const int dst_chroma_width = (dst_width + 1) / 2;
+  const int dst_chroma_height = (dst_height + 1) / 2;
+
+  if (src_width == dst_width && src_height == dst_height) {
+    CopyFrameData(dst, src,
+                  static_cast<size_t>(src_width) * src_height +
+                      2 * static_cast<size_t>(src_chroma_width) *
+                          src_chroma_height);
+    return;
+  }
+
+  const uint8_t* src_u = src + static_cast<size_t>(src_width) * src_height;
+  const uint8_t* src_v =
+      src_u + static_cast<size_t>(src_chroma_width) * src_chroma_height;
+  uint8_t* dst_u = dst + static_cast<size_t>(dst_width) * dst_height;
+  uint8_t* dst_v =
+      dst_u + static_cast<size_t>(dst_chroma_width) * dst_chroma_height;
+
+  CopyPlane(src, src_width, src_height, dst, dst_width, dst_height);
+  CopyPlane(src_u, src_chroma_width, src_chroma_height, dst_u,
+            dst_chroma_width, dst_chroma_height);
+  CopyPlane(src_v, src_chroma_width, src_chroma_height, dst_v,
+            dst_chroma_width, dst_chroma_height);
+}
+
+}  // namespace sharer
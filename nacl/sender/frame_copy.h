@@ -0,0 +1,41 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SENDER_FRAME_COPY_H_
+#define SENDER_FRAME_COPY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace sharer {
+
+using FrameCopyFunction = void (*)(void* dst, const void* src, size_t size);
+
+struct FrameCopyKernel {
+  const char* name;
+  FrameCopyFunction function;
+};
+
+// Copy kernels usable on this CPU, from plain memcpy() to the preferred one.
+// The SIMD kernels write with non-temporal stores where the CPU has them: a
+// raw frame is only read again by the encoder, so it shouldn't evict
+// everything else from the cache on the way.
+std::vector<FrameCopyKernel> SupportedFrameCopyKernels();
+
+// Copies |size| bytes of frame data with the preferred kernel, or memcpy() for
+// sizes that stay in the cache anyway.
+void CopyFrameData(void* dst, const void* src, size_t size);
+
+// Copies a tightly packed I420 image into a buffer of the same or a larger
+// size, e.g. the 16 aligned coded size of the encoder. Pixels past the source
+// image repeat its last column and row, so the encoder doesn't spend bits on
+// an edge.
+void CopyI420(const uint8_t* src, int src_width, int src_height, uint8_t* dst,
+              int dst_width, int dst_height);
+
+}  // namespace sharer
+
+#endif  // SENDER_FRAME_COPY_H_
@@ -0,0 +1,412 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sender/frame_scaler.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+// PNaCl is portable bitcode, so only the C kernels are available there.
+#if !defined(__pnacl__) && (defined(__x86_64__) || defined(__i386__))
+#define FRAME_SCALER_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#elif !defined(__pnacl__) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#define FRAME_SCALER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace sharer {
+
+size_t I420BufferSize(int width, int height) {
+  const size_t chroma_width = (width + 1) / 2;
+  const size_t chroma_height = (height + 1) / 2;
+  return static_cast<size_t>(width) * height +
+         2 * chroma_width * chroma_height;
+}
+
+namespace {
+
+// Averages each 2x2 block of |row0| and |row1| into |dst|, rounding like the
+// box filter.
+using ScaleRowDown2Function = void (*)(const uint8_t* row0,
+                                       const uint8_t* row1, uint8_t* dst,
+                                       int dst_width);
+// Blends |row0| and |row1| as (row0 * (256 - fraction) + row1 * fraction) /
+// 256 into |dst|.
+using BlendRowsFunction = void (*)(const uint8_t* row0, const uint8_t* row1,
+                                   uint8_t* dst, int width, int fraction);
+
+struct ScaleRowKernels {
+  ScaleRowDown2Function down2;
+  BlendRowsFunction blend_rows;
+};
+
+void ScaleRowDown2C(const uint8_t* row0, const uint8_t* row1, uint8_t* dst,
+                    int dst_width) {
+  for (int x = 0; x < dst_width; ++x) {
+    dst[x] = static_cast<uint8_t>(
+        (row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1] + 2) >>
+        2);
+  }
+}
+
+void BlendRowsC(const uint8_t* row0, const uint8_t* row1, uint8_t* dst,
+                int width, int fraction) {
+  for (int x = 0; x < width; ++x) {
+    dst[x] = static_cast<uint8_t>(
+        (row0[x] * (256 - fraction) + row1[x] * fraction + 128) >> 8);
+  }
+}
+
+const ScaleRowKernels kScaleRowC = {&ScaleRowDown2C, &BlendRowsC};
+
+#if defined(FRAME_SCALER_X86)
+
+__attribute__((target("sse2"))) void ScaleRowDown2Sse2(const uint8_t* row0,
+                                                         const uint8_t* row1,
+                                                         uint8_t* dst,
+                                                         int dst_width) {
+  const __m128i low_bytes = _mm_set1_epi16(0x00ff);
+  const __m128i two = _mm_set1_epi16(2);
+  int x = 0;
+  for (; x + 16 <= dst_width; x += 16) {
+    __m128i sums[2];
+    for (int half = 0; half < 2; ++half) {
+      const __m128i a = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(row0 + 2 * x + 16 * half));
+      const __m128i b = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(row1 + 2 * x + 16 * half));
+      // Even and odd columns as 16 bit lanes.
+      __m128i sum = _mm_add_epi16(_mm_and_si128(a, low_bytes),
+                                  _mm_srli_epi16(a, 8));
+      sum = _mm_add_epi16(sum, _mm_and_si128(b, low_bytes));
+      sum = _mm_add_epi16(sum, _mm_srli_epi16(b, 8));
+      sums[half] = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x),
+                     _mm_packus_epi16(sums[0], sums[1]));
+  }
+  ScaleRowDown2C(row0 + 2 * x, row1 + 2 * x, dst + x, dst_width - x);
+}
+
+__attribute__((target("avx2"))) void ScaleRowDown2Avx2(const uint8_t* row0,
+                                                         const uint8_t* row1,
+                                                         uint8_t* dst,
+                                                         int dst_width) {
+  const __m256i ones = _mm256_set1_epi8(1);
+  const __m256i two = _mm256_set1_epi16(2);
+  int x = 0;
+  for (; x + 32 <= dst_width; x += 32) {
+    __m256i sums[2];
+    for (int half = 0; half < 2; ++half) {
+      const __m256i a = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(row0 + 2 * x + 32 * half));
+      const __m256i b = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(row1 + 2 * x + 32 * half));
+      // Horizontal pair sums as 16 bit lanes.
+      const __m256i sum = _mm256_add_epi16(_mm256_maddubs_epi16(a, ones),
+                                           _mm256_maddubs_epi16(b, ones));
+      sums[half] = _mm256_srli_epi16(_mm256_add_epi16(sum, two), 2);
+    }
+    // packus works within 128 bit lanes, put the quadwords back in order.
+    const __m256i packed = _mm256_packus_epi16(sums[0], sums[1]);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x),
+                        _mm256_permute4x64_epi64(packed, 0xd8));
+  }
+  ScaleRowDown2C(row0 + 2 * x, row1 + 2 * x, dst + x, dst_width - x);
+}
+
+__attribute__((target("sse2"))) void BlendRowsSse2(const uint8_t* row0,
+                                                     const uint8_t* row1,
+                                                     uint8_t* dst, int width,
+                                                     int fraction) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i f1 = _mm_set1_epi16(fraction);
+  const __m128i f0 = _mm_set1_epi16(256 - fraction);
+  const __m128i round = _mm_set1_epi16(128);
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const __m128i a =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x));
+    const __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x));
+    // 255 * 256 + 128 doesn't fit a signed 16 bit lane, but the shift is
+    // logical, so unsigned wrap-around is fine.
+    __m128i lo = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), f0),
+        _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), f1));
+    __m128i hi = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), f0),
+        _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), f1));
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x),
+                     _mm_packus_epi16(lo, hi));
+  }
+  BlendRowsC(row0 + x, row1 + x, dst + x, width - x, fraction);
+}
+
+bool CpuHasAvx2() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+  if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX)) return false;
+#if !defined(__native_client__)
+  uint32_t xcr0_lo, xcr0_hi;
+  __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+  if ((xcr0_lo & 0x6) != 0x6) return false;
+#endif
+  if (__get_cpuid_max(0, nullptr) < 7) return false;
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  return (ebx & bit_AVX2) != 0;
+}
+
+#elif defined(FRAME_SCALER_NEON)
+
+void ScaleRowDown2Neon(const uint8_t* row0, const uint8_t* row1, uint8_t* dst,
+                       int dst_width) {
+  int x = 0;
+  for (; x + 8 <= dst_width; x += 8) {
+    const uint16x8_t sum =
+        vaddq_u16(vpaddlq_u8(vld1q_u8(row0 + 2 * x)),
+                  vpaddlq_u8(vld1q_u8(row1 + 2 * x)));
+    // Rounding shift: (sum + 2) >> 2.
+    vst1_u8(dst + x, vrshrn_n_u16(sum, 2));
+  }
+  ScaleRowDown2C(row0 + 2 * x, row1 + 2 * x, dst + x, dst_width - x);
+}
+
+void BlendRowsNeon(const uint8_t* row0, const uint8_t* row1, uint8_t* dst,
+                   int width, int fraction) {
+  // 256 - fraction doesn't fit a byte for fraction 0.
+  if (fraction == 0) {
+    memcpy(dst, row0, width);
+    return;
+  }
+  const uint8x8_t f0 = vdup_n_u8(256 - fraction);
+  const uint8x8_t f1 = vdup_n_u8(fraction);
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    uint16x8_t sum = vmull_u8(vld1_u8(row0 + x), f0);
+    sum = vmlal_u8(sum, vld1_u8(row1 + x), f1);
+    vst1_u8(dst + x, vrshrn_n_u16(sum, 8));
+  }
+  BlendRowsC(row0 + x, row1 + x, dst + x, width - x, fraction);
+}
+
+#endif
+
+ScaleRowKernels PreferredScaleRowKernels() {
+  ScaleRowKernels kernels = kScaleRowC;
+#if defined(FRAME_SCALER_X86)
+  kernels.down2 = &ScaleRowDown2Sse2;
+  kernels.blend_rows = &BlendRowsSse2;
+  if (CpuHasAvx2()) kernels.down2 = &ScaleRowDown2Avx2;
+#elif defined(FRAME_SCALER_NEON)
+  kernels.down2 = &ScaleRowDown2Neon;
+  kernels.blend_rows = &BlendRowsNeon;
+#endif
+  return kernels;
+}
+
+ScaleRowKernels& ScaleRowKernelsStorage() {
+  static ScaleRowKernels kernels = PreferredScaleRowKernels();
+  return kernels;
+}
+
+const ScaleRowKernels& GetScaleRowKernels() { return ScaleRowKernelsStorage(); }
+
+void ScalePlaneBox(const uint8_t* src, int src_stride, int src_width,
+                   int src_height, uint8_t* dst, int dst_stride, int dst_width,
+                   int dst_height) {
+  // Source columns covered by each destination column, computed once per
+  // plane instead of once per row.
+  std::vector<int> x_begin(dst_width + 1);
+  for (int x = 0; x <= dst_width; ++x)
+    x_begin[x] = static_cast<int64_t>(x) * src_width / dst_width;
+
+  // Sums of the source rows covered by the current destination row, so each
+  // source pixel is read once.
+  std::vector<uint32_t> column_sums(src_width);
+  // Dividing by the box area is done as a multiplication by 2^40 / area,
+  // rounded up, which is exact for sums up to 256 * area. Rows cover at most
+  // two different heights, so these are rarely recomputed.
+  std::vector<uint64_t> reciprocals(dst_width);
+  int reciprocals_height = 0;
+  for (int y = 0; y < dst_height; ++y) {
+    const int y0 = static_cast<int64_t>(y) * src_height / dst_height;
+    int y1 = static_cast<int64_t>(y + 1) * src_height / dst_height;
+    if (y1 <= y0) y1 = y0 + 1;
+
+    if (y1 - y0 != reciprocals_height) {
+      reciprocals_height = y1 - y0;
+      for (int x = 0; x < dst_width; ++x) {
+        const uint64_t width = std::max(x_begin[x + 1] - x_begin[x], 1);
+        const uint64_t area = width * reciprocals_height;
+        reciprocals[x] = ((static_cast<uint64_t>(1) << 40) + area - 1) / area;
+      }
+    }
+
+    std::fill(column_sums.begin(), column_sums.end(), 0);
+    for (int sy = y0; sy < y1; ++sy) {
+      const uint8_t* src_row = src + static_cast<size_t>(sy) * src_stride;
+      for (int sx = 0; sx < src_width; ++sx) column_sums[sx] += src_row[sx];
+    }
+
+    uint8_t* dst_row = dst + static_cast<size_t>(y) * dst_stride;
+    for (int x = 0; x < dst_width; ++x) {
+      const int x0 = x_begin[x];
+      const int x1 = x_begin[x + 1] > x0 ? x_begin[x + 1] : x0 + 1;
+
+      uint32_t sum = 0;
+      for (int sx = x0; sx < x1; ++sx) sum += column_sums[sx];
+      const uint32_t count = (y1 - y0) * (x1 - x0);
+      dst_row[x] = static_cast<uint8_t>(
+          ((sum + count / 2) * reciprocals[x]) >> 40);
+    }
+  }
+}
+
+void ScalePlaneBilinear(const uint8_t* src, int src_stride, int src_width,
+                        int src_height, uint8_t* dst, int dst_stride,
+                        int dst_width, int dst_height) {
+  // Source positions of the destination pixel centers, as the left source
+  // pixel and the weights of it and its right neighbour, in 1/256.
+  struct Tap {
+    int offset;
+    int weight0;
+    int weight1;
+  };
+  std::vector<Tap> taps(dst_width);
+  for (int x = 0; x < dst_width; ++x) {
+    int position = static_cast<int>(
+        ((2 * x + 1) * static_cast<int64_t>(src_width) * 256 / dst_width -
+         256) / 2);
+    position = std::max(0, std::min(position, (src_width - 1) * 256));
+    taps[x].offset = std::min(position >> 8, src_width - 2);
+    taps[x].weight1 = position - taps[x].offset * 256;
+    taps[x].weight0 = 256 - taps[x].weight1;
+  }
+
+  std::vector<uint8_t> row(src_width + 1);
+  const ScaleRowKernels& kernels = GetScaleRowKernels();
+  for (int y = 0; y < dst_height; ++y) {
+    int position = static_cast<int>(
+        ((2 * y + 1) * static_cast<int64_t>(src_height) * 256 / dst_height -
+         256) / 2);
+    position = std::max(0, std::min(position, (src_height - 1) * 256));
+    const int y0 = position >> 8;
+    const int y1 = std::min(y0 + 1, src_height - 1);
+
+    kernels.blend_rows(src + static_cast<size_t>(y0) * src_stride,
+                       src + static_cast<size_t>(y1) * src_stride, row.data(),
+                       src_width, position & 0xff);
+    row[src_width] = row[src_width - 1];
+
+    uint8_t* dst_row = dst + static_cast<size_t>(y) * dst_stride;
+    const uint8_t* row_data = row.data();
+    const Tap* tap = taps.data();
+    for (int x = 0; x < dst_width; ++x, ++tap) {
+      const uint8_t* p = row_data + tap->offset;
+      dst_row[x] = static_cast<uint8_t>(
+          (p[0] * tap->weight0 + p[1] * tap->weight1 + 128) >> 8);
+    }
+  }
+}
+
+void ScalePlaneDown2(const uint8_t* src, int src_stride, uint8_t* dst,
+                     int dst_stride, int dst_width, int dst_height) {
+  const ScaleRowKernels& kernels = GetScaleRowKernels();
+  for (int y = 0; y < dst_height; ++y) {
+    const uint8_t* row0 = src + static_cast<size_t>(2 * y) * src_stride;
+    kernels.down2(row0, row0 + src_stride,
+                  dst + static_cast<size_t>(y) * dst_stride, dst_width);
+  }
+}
+
+// Fills the |coded_width| x |coded_height| plane |dst| past its top left
+// |width| x |height| pixels with their last column and row.
+void PadPlane(uint8_t* dst, int width, int height, int coded_width,
+              int coded_height) {
+  if (coded_width > width) {
+    uint8_t* row = dst;
+    for (int y = 0; y < height; ++y, row += coded_width)
+      memset(row + width, row[width - 1], coded_width - width);
+  }
+  const uint8_t* last_row = dst + static_cast<size_t>(height - 1) * coded_width;
+  for (int y = height; y < coded_height; ++y) {
+    memcpy(dst + static_cast<size_t>(y) * coded_width, last_row,
+           coded_width);
+  }
+}
+
+}  // namespace
+
+void DisableScalerSimdForTesting() { ScaleRowKernelsStorage() = kScaleRowC; }
+
+void ScalePlane(const uint8_t* src, int src_stride, int src_width,
+                int src_height, uint8_t* dst, int dst_stride, int dst_width,
+                int dst_height) {
+  if (src_width == 2 * dst_width && src_height == 2 * dst_height) {
+    ScalePlaneDown2(src, src_stride, dst, dst_stride, dst_width, dst_height);
+  } else if (src_width >= 2 * dst_width && src_height >= 2 * dst_height) {
+    // Halve with the fast 2:1 kernel first, e.g. 3:1 becomes 2:1 then 3:2.
+    const int half_width = src_width / 2;
+    const int half_height = src_height / 2;
+    std::vector<uint8_t> half(static_cast<size_t>(half_width) * half_height);
+    ScalePlaneDown2(src, src_stride, half.data(), half_width, half_width,
+                    half_height);
+    ScalePlane(half.data(), half_width, half_width, half_height, dst,
+               dst_stride, dst_width, dst_height);
+  } else if (src_width < 2 * dst_width && src_height < 2 * dst_height &&
+             src_width > 1 && src_height > 1) {
+    // Less than 2:1, e.g. 4:3: every source pixel contributes to at most two
+    // destination pixels per direction, so bilinear is as sharp as a box.
+    ScalePlaneBilinear(src, src_stride, src_width, src_height, dst, dst_stride,
+                       dst_width, dst_height);
+  } else {
+    ScalePlaneBox(src, src_stride, src_width, src_height, dst, dst_stride,
+                  dst_width, dst_height);
+  }
+}
+
+void ScaleI420(const uint8_t* src, int src_width, int src_height, uint8_t* dst,
+               int dst_width, int dst_height) {
+  ScaleI420(src, src_width, src_height, dst, dst_width, dst_height, dst_width,
+            dst_height);
+}
+
+void ScaleI420(const uint8_t* src, int src_width, int src_height, uint8_t* dst,
+               int dst_width, int dst_height, int coded_width,
+               int coded_height) {
+  const int src_chroma_width = (src_width + 1) / 2;
+  const int src_chroma_height = (src_height + 1) / 2;
+  const int dst_chroma_width = (dst_width + 1) / 2;
+  const int dst_chroma_height = (dst_height + 1) / 2;
+  const int coded_chroma_width = (coded_width + 1) / 2;
+  const int coded_chroma_height = (coded_height + 1) / 2;
+
+  const uint8_t* src_u = src + static_cast<size_t>(src_width) * src_height;
+  const uint8_t* src_v =
+      src_u + static_cast<size_t>(src_chroma_width) * src_chroma_height;
+  uint8_t* dst_u = dst + static_cast<size_t>(coded_width) * coded_height;
+  uint8_t* dst_v =
+      dst_u + static_cast<size_t>(coded_chroma_width) * coded_chroma_height;
+
+  ScalePlane(src, src_width, src_width, src_height, dst, coded_width,
+             dst_width, dst_height);
+  PadPlane(dst, dst_width, dst_height, coded_width, coded_height);
+  ScalePlane(src_u, src_chroma_width, src_chroma_width, src_chroma_height,
+             dst_u, coded_chroma_width, dst_chroma_width, dst_chroma_height);
+  PadPlane(dst_u, dst_chroma_width, dst_chroma_height, coded_chroma_width,
+           coded_chroma_height);
+  ScalePlane(src_v, src_chroma_width, src_chroma_width, src_chroma_height,
+             dst_v, coded_chroma_width, dst_chroma_width, dst_chroma_height);
+  PadPlane(dst_v, dst_chroma_width, dst_chroma_height, coded_chroma_width,
+           coded_chroma_height);
+}
+
+}  // namespace sharer
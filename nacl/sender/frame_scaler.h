@@ -0,0 +1,44 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SENDER_FRAME_SCALER_H_
+#define SENDER_FRAME_SCALER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sharer {
+
+// Returns the size in bytes of a tightly packed I420 image.
+size_t I420BufferSize(int width, int height);
+
+// Downscales one image plane. 2:1 is a box filter, where every destination
+// pixel is the average of the 2x2 source pixels it covers, and ratios below 2:1,
+// e.g. 4:3, are bilinear. Larger ratios are halved first. Both kernels are SIMD
+// (SSE2/AVX2, NEON), picked at runtime. Planes downscaled by 2:1 or more in
+// one direction only fall back to a plain box filter. Upscaling is not
+// supported.
+void ScalePlane(const uint8_t* src, int src_stride, int src_width,
+                int src_height, uint8_t* dst, int dst_stride, int dst_width,
+                int dst_height);
+
+// Downscales a tightly packed I420 image (Y, then U, then V, with no padding
+// between rows) into another one.
+void ScaleI420(const uint8_t* src, int src_width, int src_height, uint8_t* dst,
+               int dst_width, int dst_height);
+
+// Same, into the top left |dst_width| x |dst_height| of a tightly packed
+// |coded_width| x |coded_height| image, e.g. the 16 aligned coded size of the
+// encoder. Pixels past the scaled image repeat its last column and row, as
+// with CopyI420().
+void ScaleI420(const uint8_t* src, int src_width, int src_height, uint8_t* dst,
+               int dst_width, int dst_height, int coded_width,
+               int coded_height);
+
+// Makes the scaler use its C kernels only, to compare them with the SIMD ones.
+void DisableScalerSimdForTesting();
+
+}  // namespace sharer
+
+#endif  // SENDER_FRAME_SCALER_H_
@@ -11,6 +11,7 @@
 #include "sharer_defines.h"
 
 #include "ppapi/cpp/logging.h"
+#include "ppapi/cpp/module.h"
 
 namespace sharer {
 
@@ -32,6 +33,7 @@ FrameSender::FrameSender(base::TickClock* clock, bool is_audio,
                          int rtp_timebase, uint32_t ssrc, double max_frame_rate,
                          base::TimeDelta min_playout_delay,
                          base::TimeDelta max_playout_delay,
+                         base::TimeDelta max_queue_delay,
                          CongestionControl* congestion_control)
     : clock_(clock),
       callback_factory_(this),
@@ -45,6 +47,7 @@ FrameSender::FrameSender(base::TickClock* clock, bool is_audio,
                              : min_playout_delay),
       max_playout_delay_(max_playout_delay),
       max_frame_rate_(max_frame_rate),
+      max_queue_delay_(max_queue_delay),
       congestion_control_(congestion_control),
       rtp_timebase_(rtp_timebase),
       is_audio_(is_audio) {
@@ -225,6 +228,8 @@ void FrameSender::OnReceivedSharerFeedback(
 
   if (last_send_time_.is_null())
     return;  // Cannot get an ACK without having first sent a frame.
+
+  if (sharer_feedback.request_key_frame) OnKeyFrameRequested();
 }
 
 bool FrameSender::ShouldDropNextFrame(base::TimeDelta frame_duration) const {
@@ -261,8 +266,36 @@ bool FrameSender::ShouldDropNextFrame(base::TimeDelta frame_duration) const {
     return true;
   }
 
+  // Check that the network queue can take the next frame without it leaving
+  // too late.
+  if (WouldExceedQueueDelay()) return true;
+
   // Next frame is accepted.
   return false;
 }
 
+bool FrameSender::WouldExceedQueueDelay() const {
+  if (max_queue_delay_.is_zero()) return false;
+
+  // Whatever is ahead of it, a frame alone always goes.
+  const size_t ahead_bytes =
+      transport_sender_->GetQueuedBytes() + GetPredictedBytesInEncoder();
+  if (!ahead_bytes) return false;
+
+  const double send_rate = transport_sender_->GetSendRate();
+  if (send_rate <= 0) return false;
+
+  const size_t next_bytes = GetPredictedNextFrameBytes();
+  const base::TimeDelta queue_delay =
+      base::TimeDelta::FromSecondsD((ahead_bytes + next_bytes) / send_rate);
+  if (queue_delay <= max_queue_delay_) return false;
+
+  DWRN() << SENDER_SSRC << "Dropping: Frame would leave in "
+         << queue_delay.InMilliseconds() << "ms: "
+         << transport_sender_->GetQueuedBytes() << " bytes queued, "
+         << GetPredictedBytesInEncoder() << " in encoder, " << next_bytes
+         << " expected for the frame.";
+  return true;
+}
+
 }  // namespace sharer
@@ -27,6 +27,7 @@ class FrameSender {
                        int rtp_timebase, uint32_t ssrc, double max_frame_rate,
                        base::TimeDelta min_playout_delay,
                        base::TimeDelta max_playout_delay,
+                       base::TimeDelta max_queue_delay,
                        CongestionControl* congestion_control);
   virtual ~FrameSender();
 
@@ -48,7 +49,12 @@ class FrameSender {
  protected:
   virtual int GetNumberOfFramesInEncoder() const = 0;
   virtual base::TimeDelta GetInFlightMediaDuration() const = 0;
+  // Expected encoded sizes of the frames in the encoder and of the next frame,
+  // in bytes.
+  virtual size_t GetPredictedBytesInEncoder() const = 0;
+  virtual size_t GetPredictedNextFrameBytes() const = 0;
   virtual void OnAck(uint32_t frame_id) = 0;
+  virtual void OnKeyFrameRequested() = 0;
 
   void OnReceivedSharerFeedback(const RtcpSharerMessage& sharer_feedback);
   void ScheduleNextRtcpReport();
@@ -59,6 +65,9 @@ class FrameSender {
   int GetUnacknowledgedFrameCount() const;
   base::TimeTicks GetRecordedReferenceTime(uint32_t frame_id) const;
   bool ShouldDropNextFrame(base::TimeDelta frame_duration) const;
+  // Whether the next frame would leave later than |max_queue_delay_| behind
+  // what is queued in the pacer and the encoder.
+  bool WouldExceedQueueDelay() const;
 
   TransportSender* const transport_sender_;
 
@@ -88,6 +97,7 @@ class FrameSender {
   base::TimeDelta max_playout_delay_;
 
   double max_frame_rate_;
+  const base::TimeDelta max_queue_delay_;
   /* uint32_t latest_acked_frame_id_; */
 
   base::TimeDelta current_round_trip_time_;
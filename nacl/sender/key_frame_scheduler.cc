@@ -0,0 +1,71 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sender/key_frame_scheduler.h"
+
+#include "base/logger.h"
+
+namespace sharer {
+
+KeyFrameScheduler::KeyFrameScheduler(base::TickClock* clock,
+                                     base::TimeDelta coalesce_window,
+                                     base::TimeDelta min_interval)
+    : clock_(clock),
+      coalesce_window_(coalesce_window),
+      min_interval_(min_interval),
+      pending_(false),
+      requests_received_(0),
+      requests_coalesced_(0),
+      key_frames_forced_(0) {}
+
+KeyFrameScheduler::~KeyFrameScheduler() {}
+
+void KeyFrameScheduler::OnKeyFrameRequested() {
+  const base::TimeTicks now = clock_->NowTicks();
+  ++requests_received_;
+
+  if (pending_) {
+    ++requests_coalesced_;
+    return;
+  }
+
+  // The receiver most likely sent this before the last key frame reached it.
+  if (!last_key_frame_time_.is_null() &&
+      now - last_key_frame_time_ < coalesce_window_) {
+    ++requests_coalesced_;
+    return;
+  }
+
+  pending_ = true;
+  first_pending_request_time_ = now;
+}
+
+void KeyFrameScheduler::OnKeyFrameEncoded() {
+  last_key_frame_time_ = clock_->NowTicks();
+
+  if (pending_) {
+    // The encoder emitted a key frame on its own, no need to force another.
+    DINF() << "Pending key frame request satisfied by encoder key frame.";
+    pending_ = false;
+  }
+}
+
+bool KeyFrameScheduler::ShouldForceKeyFrame() {
+  if (!pending_) return false;
+
+  const base::TimeTicks now = clock_->NowTicks();
+  if (!last_forced_time_.is_null() && now - last_forced_time_ < min_interval_)
+    return false;
+
+  pending_ = false;
+  last_forced_time_ = now;
+  ++key_frames_forced_;
+  INF() << "Forcing key frame " << key_frames_forced_ << " after "
+        << (now - first_pending_request_time_).InMilliseconds()
+        << " ms (requests: " << requests_received_
+        << ", coalesced: " << requests_coalesced_ << ").";
+  return true;
+}
+
+}  // namespace sharer
@@ -0,0 +1,65 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SENDER_KEY_FRAME_SCHEDULER_H_
+#define SENDER_KEY_FRAME_SCHEDULER_H_
+
+#include "base/macros.h"
+#include "base/time/tick_clock.h"
+#include "base/time/time.h"
+
+namespace sharer {
+
+// Decides when a key frame must be forced in response to receiver requests.
+//
+// Every receiver that is waiting for a key frame keeps asking for one on each
+// feedback message, so in a large session the same loss produces many
+// requests. Requests that arrive while a forced key frame is already pending,
+// or within |coalesce_window| after the last key frame left the encoder, are
+// folded into that key frame. Forced key frames are never generated more often
+// than once every |min_interval|; a request arriving earlier is kept pending
+// until the interval has elapsed.
+class KeyFrameScheduler {
+ public:
+  KeyFrameScheduler(base::TickClock* clock, base::TimeDelta coalesce_window,
+                    base::TimeDelta min_interval);
+  ~KeyFrameScheduler();
+
+  // A receiver asked for a key frame.
+  void OnKeyFrameRequested();
+
+  // The encoder produced a key frame, either forced or on its own schedule.
+  void OnKeyFrameEncoded();
+
+  // Returns true if the next frame sent to the encoder must be a key frame.
+  // Consumes the pending request when it returns true.
+  bool ShouldForceKeyFrame();
+
+  // Returns true if a receiver is waiting for a key frame.
+  bool has_pending_request() const { return pending_; }
+
+  int requests_received() const { return requests_received_; }
+  int requests_coalesced() const { return requests_coalesced_; }
+  int key_frames_forced() const { return key_frames_forced_; }
+
+ private:
+  base::TickClock* const clock_;
+  const base::TimeDelta coalesce_window_;
+  const base::TimeDelta min_interval_;
+
+  bool pending_;
+  base::TimeTicks first_pending_request_time_;
+  base::TimeTicks last_forced_time_;
+  base::TimeTicks last_key_frame_time_;
+
+  int requests_received_;
+  int requests_coalesced_;
+  int key_frames_forced_;
+
+  DISALLOW_COPY_AND_ASSIGN(KeyFrameScheduler);
+};
+
+}  // namespace sharer
+
+#endif  // SENDER_KEY_FRAME_SCHEDULER_H_
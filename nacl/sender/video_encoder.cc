@@ -6,18 +6,38 @@
 
 #include "base/logger.h"
 #include "base/ptr_utils.h"
+#include "logging/log_event_dispatcher.h"
 #include "net/sharer_transport_config.h"
+#include "sender/frame_copy.h"
+#include "sender/frame_scaler.h"
 #include "sharer_defines.h"
+#include "sharer_environment.h"
 
 #include "ppapi/cpp/instance.h"
 
+#include <algorithm>
+
 namespace sharer {
 
+namespace {
+
+// Frames handed to the encoder thread and not yet released back.
+const size_t kMaxEncodesInFlight = 3;
+// Blank encoder frames the encoder thread keeps checked out, ready for copy.
+const size_t kEncoderFramesPrefetched = 2;
+// Capacity of the queues back to the main thread. Both only fill up if the
+// main thread stalls for this many frames.
+const size_t kThreadOutputQueueSize = 64;
+// Encoded frames alive at once, from the encoder thread to the packetizer.
+const size_t kEncodedFramePoolSize = 16;
+
+}  // namespace
+
 VideoEncoder::Request::Request() : type(RequestType::NONE) {}
 
 VideoEncoder::Request::~Request() {}
 
-VideoEncoder::RequestEncode::RequestEncode() {
+VideoEncoder::RequestEncode::RequestEncode() : force_key_frame(false) {
   type = RequestType::ENCODE;
 }
 
@@ -26,11 +46,32 @@ VideoEncoder::RequestResize::RequestResize(const pp::Size& size)
   type = RequestType::RESIZE;
 }
 
-VideoEncoder::VideoEncoder(pp::Instance* instance, const SenderConfig& config)
-    : instance_(instance),
+VideoEncoder::VideoEncoder(SharerEnvironment* env, const SenderConfig& config,
+                           uint32_t ssrc)
+    : instance_(env->instance()),
+      ssrc_(ssrc),
+      logger_(env->logger()),
+      queue_depth_metric_(env->metrics()->Gauge(
+          "sharer_encoder_queue_depth",
+          "Encode and resize requests waiting for the encoder or in it.",
+          {{"ssrc", std::to_string(ssrc)}})),
       factory_(this),
       config_(config),
       frame_format_(PP_VIDEOFRAME_FORMAT_I420),
+      released_requests_(kThreadOutputQueueSize),
+      encoded_output_(kThreadOutputQueueSize),
+      dropped_output_(0),
+      dropped_reference_time_(0),
+      output_posted_(false),
+      thread_frame_requested_(false),
+      thread_frame_pool_(kEncodedFramePoolSize),
+      thread_waiting_for_key_frame_(false),
+      thread_force_key_frame_(false),
+      thread_switch_pending_(false),
+      thread_encoder_generation_(0),
+      thread_encoder_ready_(false),
+      thread_bitrate_(config.initial_bitrate),
+      thread_frame_rate_(config.frame_rate),
       last_encoded_frame_id_(kStartFrameId),
       last_timestamp_(0),
       is_initialized_(false) {
@@ -38,13 +79,26 @@ VideoEncoder::VideoEncoder(pp::Instance* instance, const SenderConfig& config)
 }
 
 void VideoEncoder::Initialize() {
+  thread_pending_encodes_ = std::queue<RequestEncode*>();
+  thread_free_frames_ = std::queue<pp::VideoFrame>();
+  thread_frame_requested_ = false;
+  thread_encode_timings_.clear();
+  thread_waiting_for_key_frame_ = false;
+  thread_force_key_frame_ = false;
+  thread_switch_pending_ = false;
+  thread_encoder_ready_ = false;
+  thread_bitrate_ = config_.initial_bitrate;
+  thread_frame_rate_ = config_.frame_rate;
+
   thread_loop_ = pp::MessageLoop(instance_);
   encoder_thread_ = std::thread(&VideoEncoder::ThreadInitialize, this);
 }
 
 void VideoEncoder::InitializedThread(int32_t result) {
-  if (!current_request_)
+  if (!current_request_) {
     WRN() << "No current request. Stop requested during startup?";
+    return;
+  }
 
   if (current_request_->type != RequestType::RESIZE) {
     WRN() << "Wrong type of request after thread initialized: "
@@ -66,13 +120,15 @@ void VideoEncoder::InitializedThread(int32_t result) {
 
 void VideoEncoder::EncodeFrame(pp::VideoFrame frame,
                                const base::TimeTicks& reference_time,
-                               EncoderReleaseCb cb) {
+                               bool force_key_frame, EncoderReleaseCb cb) {
   auto req = make_unique<RequestEncode>();
   req->frame = frame;
   req->callback = cb;
   req->reference_time = reference_time;
+  req->force_key_frame = force_key_frame;
 
   requests_.push(std::move(req));
+  UpdateQueueDepth();
 
   ProcessNextRequest();
 }
@@ -92,12 +148,35 @@ void VideoEncoder::GetEncodedFrame(EncoderEncodedCb cb) {
   }
 }
 
+void VideoEncoder::SetDroppedCallback(EncoderDroppedCb cb) {
+  dropped_cb_ = cb;
+}
+
 void VideoEncoder::EncoderPauseDestructor() {
   uint32_t ret = thread_loop_.PostQuit(PP_TRUE);
   encoder_thread_.join();
   video_encoder_.Close();
+  thread_next_encoder_ = pp::VideoEncoder();
   DINF() << "Pausing encoder thread: " << ret;
   is_initialized_ = false;
+
+  if (pending_resize_) {
+    std::unique_ptr<Request> req = std::move(pending_resize_);
+    auto& resize = dynamic_cast<const RequestResize&>(*req);
+    if (resize.callback) resize.callback(false);
+  }
+
+  // The thread is gone, so whatever it didn't get to is dropped. Destroying
+  // the requests gives their source frames back.
+  RequestEncode* released;
+  while (released_requests_.Pop(&released)) {
+  }
+  std::shared_ptr<EncodedFrame> encoded;
+  while (encoded_output_.Pop(&encoded)) encoded_frames_.push(encoded);
+  // The sender forgets its frames in the encoder on stopping.
+  dropped_output_.store(0);
+  encodes_in_flight_.clear();
+  UpdateQueueDepth();
 }
 
 void VideoEncoder::Stop() { EncoderPauseDestructor(); }
@@ -123,6 +202,14 @@ void VideoEncoder::ProcessNextRequest() {
 
   bool keep_processing = true;
   while (!requests_.empty() && keep_processing) {
+    // One resize at a time.
+    if (requests_.front()->type == RequestType::RESIZE && pending_resize_)
+      return;
+    if (requests_.front()->type == RequestType::ENCODE &&
+        encodes_in_flight_.size() >= kMaxEncodesInFlight) {
+      return;
+    }
+
     current_request_ = std::move(requests_.front());
     requests_.pop();
 
@@ -146,21 +233,46 @@ void VideoEncoder::ProcessNextRequest() {
 // Returns true if we can continue and process another request
 bool VideoEncoder::ProcessResizeRequest() {
   auto req = dynamic_cast<const RequestResize&>(*current_request_);
-  if (req.size.width() != requested_size_.width() ||
-      req.size.height() != requested_size_.height()) {
-    if (is_initialized_) EncoderPauseDestructor();
-    requested_size_ = req.size;
-  }
-
   if (!is_initialized_) {
+    requested_size_ = req.size;
     Initialize();
     // Need to wait for the encoder initialization, so stop processing.
     return false;
   }
 
+  if (req.size == requested_size_) {
+    current_request_ = nullptr;
+    if (req.callback) req.callback(true);
+    return true;
+  }
+
+  // The current encoder keeps going until the one at the new size is ready.
+  requested_size_ = req.size;
+  pending_resize_ = std::move(current_request_);
+  auto cc = factory_.NewCallback(&VideoEncoder::ThreadReconfigure,
+                                 requested_size_);
+  thread_loop_.PostWork(cc);
   return true;
 }
 
+void VideoEncoder::OnReconfigured(int32_t result) {
+  if (!pending_resize_) return;
+
+  std::unique_ptr<Request> req = std::move(pending_resize_);
+  if (result != PP_OK) {
+    // Whatever size comes next, try it.
+    requested_size_ = pp::Size();
+  } else {
+    INF() << "Encoder switched to " << encoder_size_.width() << "x"
+          << encoder_size_.height();
+  }
+
+  auto& resize = dynamic_cast<const RequestResize&>(*req);
+  if (resize.callback) resize.callback(result == PP_OK);
+
+  ProcessNextRequest();
+}
+
 // Returns true if we can continue and process another request
 bool VideoEncoder::ProcessEncodeRequest() {
   if (!is_initialized_) {
@@ -169,26 +281,50 @@ bool VideoEncoder::ProcessEncodeRequest() {
     return true;
   }
 
-  auto cc = factory_.NewCallback(&VideoEncoder::ThreadEncode);
+  RequestEncode* req = dynamic_cast<RequestEncode*>(current_request_.get());
+  auto cc = factory_.NewCallback(&VideoEncoder::ThreadEncode, req);
   thread_loop_.PostWork(cc);
 
-  // Can't encode more than one frame at once, so stop processing.
-  return false;
+  encodes_in_flight_.push_back(std::move(current_request_));
+  return true;
 }
 
-void VideoEncoder::OnFrameReleased(int32_t result) {
-  RequestEncode* req = dynamic_cast<RequestEncode*>(current_request_.get());
+void VideoEncoder::OnFrameReleased(RequestEncode* req) {
+  // The thread works through the requests in order, so this is almost always
+  // the oldest one.
+  auto it = encodes_in_flight_.begin();
+  while (it != encodes_in_flight_.end() && it->get() != req) ++it;
+  if (it == encodes_in_flight_.end()) {
+    ERR() << "Released frame is not in flight.";
+    return;
+  }
+
+  std::unique_ptr<Request> released = std::move(*it);
+  encodes_in_flight_.erase(it);
+  UpdateQueueDepth();
   if (req->callback) {
     req->callback(req->frame);
   }
-  current_request_ = nullptr;
-
-  ProcessNextRequest();
 }
 
-void VideoEncoder::OnEncodedFrame(int32_t result,
-                                  std::shared_ptr<EncodedFrame> frame) {
-  encoded_frames_.push(frame);
+void VideoEncoder::DrainThreadOutput(int32_t result) {
+  // Clear the flag first: anything the thread pushes from now on either gets
+  // drained below or posts a new task.
+  output_posted_.store(false);
+
+  RequestEncode* released;
+  while (released_requests_.Pop(&released)) OnFrameReleased(released);
+
+  std::shared_ptr<EncodedFrame> encoded;
+  while (encoded_output_.Pop(&encoded)) encoded_frames_.push(encoded);
+
+  const int dropped = dropped_output_.exchange(0);
+  if (dropped && dropped_cb_) {
+    dropped_cb_(dropped, base::TimeTicks::FromInternalValue(
+                             dropped_reference_time_.load()));
+  }
+
+  ProcessNextRequest();
   EmitOneFrame(PP_OK);
 }
 
@@ -199,6 +335,7 @@ void VideoEncoder::FlushEncodedFrames() {
   while (!requests_.empty()) {
     requests_.pop();
   }
+  UpdateQueueDepth();
 
   encoded_cb_ = nullptr;
 }
@@ -207,8 +344,15 @@ void VideoEncoder::ChangeEncoding(const SenderConfig& config) {
   INF() << "Changing the encoding to " << config.initial_bitrate << " "
         << config.frame_rate;
 
-  video_encoder_.RequestEncodingParametersChange(config.initial_bitrate * 1000,
-                                                 config.frame_rate);
+  // Also for the next time the encoder thread starts.
+  config_.initial_bitrate = config.initial_bitrate;
+  config_.frame_rate = config.frame_rate;
+  if (!encoder_thread_.joinable()) return;
+
+  // The encoders belong to the encoder thread, which may be switching them.
+  auto cc = factory_.NewCallback(&VideoEncoder::ThreadChangeEncoding,
+                                 config.initial_bitrate, config.frame_rate);
+  thread_loop_.PostWork(cc);
 }
 
 void VideoEncoder::Resize(const pp::Size& size, EncoderResizedCb cb) {
@@ -216,9 +360,14 @@ void VideoEncoder::Resize(const pp::Size& size, EncoderResizedCb cb) {
   req->callback = cb;
 
   requests_.push(std::move(req));
+  UpdateQueueDepth();
   ProcessNextRequest();
 }
 
+void VideoEncoder::UpdateQueueDepth() {
+  queue_depth_metric_->Set(requests_.size() + encodes_in_flight_.size());
+}
+
 // Encoder thread methods
 void VideoEncoder::ThreadInitialize() {
   DINF() << "Thread starting.";
@@ -229,10 +378,11 @@ void VideoEncoder::ThreadInitialize() {
   auto cc = factory_.NewCallback(&VideoEncoder::ThreadInitialized);
 
   video_encoder_ = pp::VideoEncoder(instance_);
+  thread_visible_size_ = req.size;
   // Always use VP8 codec and hardware acceleration, if available
   video_encoder_.Initialize(
       frame_format_, req.size, PP_VIDEOPROFILE_VP8_ANY,
-      config_.initial_bitrate * 1000, PP_HARDWAREACCELERATION_WITHFALLBACK, cc);
+      thread_bitrate_ * 1000, PP_HARDWAREACCELERATION_WITHFALLBACK, cc);
 
   thread_loop_.Run();
 
@@ -255,16 +405,105 @@ void VideoEncoder::ThreadInitialized(int32_t result) {
   }
 
   DINF() << "Video encoder thread initialized.";
+  thread_encoder_ready_ = true;
+  // The encoding may have changed while it was initializing.
+  ThreadApplyEncoding(&video_encoder_);
   pp::Module::Get()->core()->CallOnMainThread(0, cc, PP_OK);
 
+  ThreadPumpEncodes();
+  ThreadRequestBitstreamBuffer();
+}
+
+void VideoEncoder::ThreadReconfigure(int32_t result, const pp::Size& size) {
+  DINF() << "Initializing encoder at " << size.width() << "x" << size.height()
+         << " next to the current one.";
+  thread_next_encoder_ = pp::VideoEncoder(instance_);
+  thread_next_visible_size_ = size;
+  auto cc = factory_.NewCallback(&VideoEncoder::ThreadOnNextEncoderInitialized);
+  thread_next_encoder_.Initialize(
+      frame_format_, size, PP_VIDEOPROFILE_VP8_ANY,
+      thread_bitrate_ * 1000, PP_HARDWAREACCELERATION_WITHFALLBACK, cc);
+}
+
+void VideoEncoder::ThreadChangeEncoding(int32_t result, uint32_t bitrate,
+                                        double frame_rate) {
+  thread_bitrate_ = bitrate;
+  thread_frame_rate_ = frame_rate;
+  // The encoders still initializing get it once ready, see
+  // ThreadInitialized() and ThreadOnNextEncoderInitialized().
+  if (thread_encoder_ready_) ThreadApplyEncoding(&video_encoder_);
+  if (thread_switch_pending_) ThreadApplyEncoding(&thread_next_encoder_);
+}
+
+void VideoEncoder::ThreadApplyEncoding(pp::VideoEncoder* encoder) {
+  encoder->RequestEncodingParametersChange(thread_bitrate_ * 1000,
+                                          thread_frame_rate_);
+}
+
+void VideoEncoder::ThreadOnNextEncoderInitialized(int32_t result) {
+  if (result != PP_OK) {
+    ERR() << "Could not initialize VideoEncoder at the new size: " << result;
+    thread_next_encoder_ = pp::VideoEncoder();
+    auto cc = factory_.NewCallback(&VideoEncoder::OnReconfigured);
+    pp::Module::Get()->core()->CallOnMainThread(0, cc, PP_ERROR_FAILED);
+    return;
+  }
+
+  thread_switch_pending_ = true;
+  ThreadApplyEncoding(&thread_next_encoder_);
+  ThreadMaybeSwitchEncoder();
+}
+
+bool VideoEncoder::ThreadMaybeSwitchEncoder() {
+  // Every frame submitted has a timing until its bitstream comes out: wait
+  // for all of them, so that frames stay in order and the new encoder's key
+  // frame follows the last frame of the current one.
+  if (!thread_switch_pending_ || !thread_encode_timings_.empty()) return false;
+  thread_switch_pending_ = false;
+
+  auto cc = factory_.NewCallback(&VideoEncoder::OnReconfigured);
+  pp::Size size;
+  if (thread_next_encoder_.GetFrameCodedSize(&size) != PP_OK) {
+    ERR() << "Could not get Frame Coded Size of the new encoder.";
+    thread_next_encoder_ = pp::VideoEncoder();
+    ThreadPumpEncodes();
+    pp::Module::Get()->core()->CallOnMainThread(0, cc, PP_ERROR_FAILED);
+    return false;
+  }
+
+  // The prefetched frames and pending callbacks belong to the current
+  // encoder, closing it aborts them.
+  thread_free_frames_ = std::queue<pp::VideoFrame>();
+  thread_frame_requested_ = false;
+  ++thread_encoder_generation_;
+  video_encoder_.Close();
+  video_encoder_ = thread_next_encoder_;
+  thread_next_encoder_ = pp::VideoEncoder();
+  encoder_size_ = size;
+  thread_visible_size_ = thread_next_visible_size_;
+  // A new encoder starts with one anyway, but the receivers must not take
+  // its first frame as depending on the previous encoder's frames.
+  thread_force_key_frame_ = true;
+
+  pp::Module::Get()->core()->CallOnMainThread(0, cc, PP_OK);
+
+  ThreadPumpEncodes();
+  ThreadRequestBitstreamBuffer();
+  return true;
+}
+
+void VideoEncoder::ThreadRequestBitstreamBuffer() {
   auto bitstream_cb = factory_.NewCallbackWithOutput(
-      &VideoEncoder::ThreadOnBitstreamBufferReceived);
+      &VideoEncoder::ThreadOnBitstreamBufferReceived,
+      thread_encoder_generation_);
   video_encoder_.GetBitstreamBuffer(bitstream_cb);
 }
 
 void VideoEncoder::ThreadOnBitstreamBufferReceived(int32_t result,
-                                                   PP_BitstreamBuffer buffer) {
-  if (result == PP_ERROR_ABORTED) return;
+                                                   PP_BitstreamBuffer buffer,
+                                                   uint32_t generation) {
+  if (result == PP_ERROR_ABORTED || generation != thread_encoder_generation_)
+    return;
 
   if (result != PP_OK) {
     ERR() << "Could not get bitstream buffer: " << result;
@@ -273,21 +512,59 @@ void VideoEncoder::ThreadOnBitstreamBufferReceived(int32_t result,
 
   auto encoded_frame = ThreadBitstreamToEncodedFrame(buffer);
   if (encoded_frame) {
-    auto encoded_main_cb =
-        factory_.NewCallback(&VideoEncoder::OnEncodedFrame, encoded_frame);
-    pp::Module::Get()->core()->CallOnMainThread(0, encoded_main_cb, PP_OK);
+    if (encoded_output_.Push(std::move(encoded_frame))) {
+      ThreadPostOutput();
+    } else {
+      ERR() << "Encoded frame queue full, dropping frame.";
+      // Give its id back, the key frame replaces it.
+      --last_encoded_frame_id_;
+      ThreadDropUntilKeyFrame();
+      ThreadPostDroppedFrame();
+    }
+  } else {
+    ThreadPostDroppedFrame();
   }
 
   video_encoder_.RecycleBitstreamBuffer(buffer);
 
-  auto bitstream_cb = factory_.NewCallbackWithOutput(
-      &VideoEncoder::ThreadOnBitstreamBufferReceived);
-  video_encoder_.GetBitstreamBuffer(bitstream_cb);
+  // Switching starts reading from the new encoder instead.
+  if (ThreadMaybeSwitchEncoder()) return;
+  ThreadRequestBitstreamBuffer();
+}
+
+void VideoEncoder::ThreadPostDroppedFrame() {
+  // The dropped frame is the one whose timing was popped last.
+  dropped_reference_time_.store(last_reference_time_.ToInternalValue());
+  dropped_output_.fetch_add(1);
+  ThreadPostOutput();
+}
+
+void VideoEncoder::ThreadDropUntilKeyFrame() {
+  thread_waiting_for_key_frame_ = true;
+  thread_force_key_frame_ = true;
 }
 
 std::shared_ptr<EncodedFrame> VideoEncoder::ThreadBitstreamToEncodedFrame(
     PP_BitstreamBuffer buffer) {
-  auto frame = std::make_shared<EncodedFrame>();
+  // Bitstream buffers carry no timestamp. VP8 has no frame reordering, so
+  // they come out in the order the frames went in.
+  if (!thread_encode_timings_.empty()) {
+    last_timestamp_ = thread_encode_timings_.front().timestamp;
+    last_reference_time_ = thread_encode_timings_.front().reference_time;
+    thread_encode_timings_.pop_front();
+  }
+
+  if (thread_waiting_for_key_frame_ && !buffer.key_frame) return nullptr;
+
+  auto frame = thread_frame_pool_.Acquire(buffer.key_frame, buffer.size);
+  if (!frame) {
+    WRN() << "All " << kEncodedFramePoolSize
+          << " encoded frames in use, dropping frames until a key frame.";
+    ThreadDropUntilKeyFrame();
+    return nullptr;
+  }
+  thread_waiting_for_key_frame_ = false;
+
   frame->frame_id = ++last_encoded_frame_id_;
   if (buffer.key_frame) {
     frame->dependency = EncodedFrame::KEY;
@@ -296,78 +573,196 @@ std::shared_ptr<EncodedFrame> VideoEncoder::ThreadBitstreamToEncodedFrame(
     frame->dependency = EncodedFrame::DEPENDENT;
     frame->referenced_frame_id = frame->frame_id - 1;
   }
-
+  // PPB_VideoEncoder gives no control over reference structure, so every frame
+  // is in the base layer and references the one before it.
+  frame->temporal_layer_id = 0;
   frame->rtp_timestamp =
       PP_TimeDeltaToRtpDelta(last_timestamp_, kVideoFrequency);
   frame->reference_time = last_reference_time_;
-  frame->data.clear();
-  frame->data.reserve(buffer.size);
-  frame->data.insert(0, static_cast<char*>(buffer.buffer), buffer.size);
+  frame->new_playout_delay_ms = 0;
+  // Fits in the pooled buffer, no allocation.
+  frame->data.assign(static_cast<char*>(buffer.buffer), buffer.size);
 
+  ThreadLogEncodedFrame(*frame);
   return frame;
 }
 
-void VideoEncoder::ThreadEncode(int32_t result) {
-  /* DINF() << "Request to encode frame."; */
-  auto cc = factory_.NewCallbackWithOutput(&VideoEncoder::ThreadOnEncoderFrame,
-                                           current_request_.get());
-  video_encoder_.GetVideoFrame(cc);
+void VideoEncoder::ThreadLogEncodeBegin(PP_TimeDelta timestamp) {
+  FrameEvent event;
+  event.timestamp = base::TimeTicks::Now();
+  event.type = FRAME_ENCODE_BEGIN;
+  event.media_type = VIDEO_EVENT;
+  event.ssrc = ssrc_;
+  event.rtp_timestamp = PP_TimeDeltaToRtpDelta(timestamp, kVideoFrequency);
+  logger_->DispatchFrameEvent(event);
 }
 
-void VideoEncoder::ThreadInformFrameRelease(int32_t result) {
-  auto cc = factory_.NewCallback(&VideoEncoder::OnFrameReleased);
-  pp::Module::Get()->core()->CallOnMainThread(0, cc, result);
+void VideoEncoder::ThreadLogEncodedFrame(const EncodedFrame& frame) {
+  FrameEvent event;
+  event.timestamp = base::TimeTicks::Now();
+  event.type = FRAME_ENCODED;
+  event.media_type = VIDEO_EVENT;
+  event.ssrc = ssrc_;
+  event.rtp_timestamp = frame.rtp_timestamp;
+  event.frame_id = frame.frame_id;
+  event.size = frame.data.size();
+  event.key_frame = frame.dependency == EncodedFrame::KEY;
+  event.target_bitrate = thread_bitrate_ * 1000;
+  logger_->DispatchFrameEvent(event);
 }
 
-void VideoEncoder::ThreadOnEncoderFrame(int32_t result,
-                                        pp::VideoFrame encoder_frame,
-                                        Request* req_base) {
-  if (result == PP_ERROR_ABORTED) {
-    ThreadInformFrameRelease(result);
-    return;
+void VideoEncoder::ThreadEncode(int32_t result, RequestEncode* req) {
+  thread_pending_encodes_.push(req);
+  ThreadPumpEncodes();
+}
+
+void VideoEncoder::ThreadPumpEncodes() {
+  // Frames wait for the new encoder while the current one finishes.
+  if (thread_switch_pending_) return;
+
+  while (!thread_pending_encodes_.empty() && !thread_free_frames_.empty()) {
+    RequestEncode* req = thread_pending_encodes_.front();
+    thread_pending_encodes_.pop();
+    pp::VideoFrame encoder_frame = thread_free_frames_.front();
+    thread_free_frames_.pop();
+    ThreadSubmitFrame(encoder_frame, req);
   }
 
-  if (result != PP_OK) {
-    ERR() << "Could not get frame from encoder: " << result;
-    ThreadInformFrameRelease(result);
+  // Only one GetVideoFrame() may be pending at a time.
+  if (thread_frame_requested_ ||
+      (thread_free_frames_.size() >= kEncoderFramesPrefetched &&
+       thread_pending_encodes_.empty())) {
     return;
   }
 
-  // TODO: Check for frame size
+  thread_frame_requested_ = true;
+  auto cc = factory_.NewCallbackWithOutput(
+      &VideoEncoder::ThreadOnEncoderFrame, thread_encoder_generation_);
+  video_encoder_.GetVideoFrame(cc);
+}
 
-  RequestEncode* req = dynamic_cast<RequestEncode*>(req_base);
+void VideoEncoder::ThreadSubmitFrame(pp::VideoFrame encoder_frame,
+                                     RequestEncode* req) {
   if (ThreadCopyVideoFrame(encoder_frame, req->frame) == PP_OK) {
     PP_TimeDelta timestamp = req->frame.GetTimestamp();
+    EncodeTiming timing = {timestamp, req->reference_time};
+    thread_encode_timings_.push_back(timing);
+    ThreadLogEncodeBegin(timestamp);
 
-    last_timestamp_ = timestamp;
-    last_reference_time_ = req->reference_time;
     auto cc =
-        factory_.NewCallback(&VideoEncoder::ThreadOnEncodeDone, timestamp, req);
-    video_encoder_.Encode(encoder_frame, PP_FALSE, cc);
+        factory_.NewCallback(&VideoEncoder::ThreadOnEncodeDone, timestamp);
+    const bool force_key_frame =
+        req->force_key_frame || thread_force_key_frame_;
+    thread_force_key_frame_ = false;
+    video_encoder_.Encode(encoder_frame, force_key_frame ? PP_TRUE : PP_FALSE,
+                          cc);
+  } else {
+    // Not consumed, keep it for the next request.
+    thread_free_frames_.push(encoder_frame);
   }
 
-  ThreadInformFrameRelease(PP_OK);
+  ThreadInformFrameRelease(req);
+}
+
+void VideoEncoder::ThreadInformFrameRelease(RequestEncode* req) {
+  if (released_requests_.Push(req))
+    ThreadPostOutput();
+  else
+    ERR() << "Released frame queue full.";
+}
+
+void VideoEncoder::ThreadPostOutput() {
+  if (output_posted_.exchange(true)) return;
+
+  auto cc = factory_.NewCallback(&VideoEncoder::DrainThreadOutput);
+  pp::Module::Get()->core()->CallOnMainThread(0, cc, PP_OK);
+}
+
+void VideoEncoder::ThreadOnEncoderFrame(int32_t result,
+                                        pp::VideoFrame encoder_frame,
+                                        uint32_t generation) {
+  // A frame of an encoder we switched away from.
+  if (generation != thread_encoder_generation_) return;
+
+  thread_frame_requested_ = false;
+
+  if (result == PP_ERROR_ABORTED) return;
+
+  if (result != PP_OK) {
+    ERR() << "Could not get frame from encoder: " << result;
+    // Give the waiting source frames back rather than holding them forever.
+    while (!thread_pending_encodes_.empty()) {
+      ThreadInformFrameRelease(thread_pending_encodes_.front());
+      thread_pending_encodes_.pop();
+    }
+    return;
+  }
+
+  thread_free_frames_.push(encoder_frame);
+  ThreadPumpEncodes();
 }
 
 int32_t VideoEncoder::ThreadCopyVideoFrame(pp::VideoFrame dst,
                                            pp::VideoFrame src) {
-  if (dst.GetDataBufferSize() < src.GetDataBufferSize()) {
-    ERR() << "Incorrect destination video frame buffer size: "
-          << dst.GetDataBufferSize() << " < " << src.GetDataBufferSize();
+  pp::Size src_size;
+  pp::Size dst_size;
+  if (!src.GetSize(&src_size) || !dst.GetSize(&dst_size) ||
+      src_size.IsEmpty() || dst_size.IsEmpty()) {
+    ERR() << "Could not get video frame sizes.";
+    return PP_ERROR_FAILED;
+  }
+
+  if (src.GetDataBufferSize() <
+          I420BufferSize(src_size.width(), src_size.height()) ||
+      dst.GetDataBufferSize() <
+          I420BufferSize(dst_size.width(), dst_size.height())) {
+    ERR() << "Video frame buffers too small for "
+          << src_size.width() << "x" << src_size.height() << " to "
+          << dst_size.width() << "x" << dst_size.height();
     return PP_ERROR_FAILED;
   }
 
   dst.SetTimestamp(src.GetTimestamp());
-  memcpy(dst.GetDataBuffer(), src.GetDataBuffer(), src.GetDataBufferSize());
+  const uint8_t* src_data = static_cast<const uint8_t*>(src.GetDataBuffer());
+  uint8_t* dst_data = static_cast<uint8_t*>(dst.GetDataBuffer());
+
+  // Simulcast layers encode a smaller copy of the shared track frame, scaled
+  // straight into the encoder's buffer. Only to the size asked for: the coded
+  // size may be larger, e.g. 16 aligned, and is padded like a copy.
+  const int visible_width =
+      std::min(thread_visible_size_.width(), dst_size.width());
+  const int visible_height =
+      std::min(thread_visible_size_.height(), dst_size.height());
+  if (visible_width > 0 && visible_height > 0 &&
+      (src_size.width() > visible_width ||
+       src_size.height() > visible_height)) {
+    ScaleI420(src_data, src_size.width(), src_size.height(), dst_data,
+              visible_width, visible_height, dst_size.width(),
+              dst_size.height());
+    return PP_OK;
+  }
+
+  // Same size, or the track frame is smaller than the encoder's coded size.
+  CopyI420(src_data, src_size.width(), src_size.height(), dst_data,
+           dst_size.width(), dst_size.height());
   return PP_OK;
 }
 
-void VideoEncoder::ThreadOnEncodeDone(int32_t result, PP_TimeDelta timestamp,
-                                      RequestEncode* req) {
+void VideoEncoder::ThreadOnEncodeDone(int32_t result,
+                                      PP_TimeDelta timestamp) {
   if (result == PP_ERROR_ABORTED) return;
 
   if (result != PP_OK) {
     ERR() << "Encode failed: " << result;
+    // No bitstream will come for this frame.
+    for (auto it = thread_encode_timings_.begin();
+         it != thread_encode_timings_.end(); ++it) {
+      if (it->timestamp == timestamp) {
+        thread_encode_timings_.erase(it);
+        break;
+      }
+    }
+    ThreadMaybeSwitchEncoder();
     return;
   }
 }
@@ -6,7 +6,9 @@
 #define SENDER_VIDEO_ENCODER_H_
 
 #include "base/macros.h"
+#include "base/spsc_queue.h"
 #include "base/time/time.h"
+#include "sender/encoded_frame_pool.h"
 #include "sharer_config.h"
 
 #include "ppapi/c/pp_time.h"
@@ -15,6 +17,8 @@
 #include "ppapi/cpp/video_encoder.h"
 #include "ppapi/utility/completion_callback_factory.h"
 
+#include <atomic>
+#include <deque>
 #include <queue>
 #include <thread>
 
@@ -22,8 +26,28 @@ struct EncodedFrame;
 
 namespace sharer {
 
+class LogEventDispatcher;
+class MetricGauge;
+class SharerEnvironment;
 struct SenderConfig;
 
+// Encodes video frames on a dedicated thread.
+//
+// Encoding is pipelined: up to kMaxEncodesInFlight frames can be handed to the
+// encoder thread at once, and the thread keeps blank encoder frames checked
+// out ahead of time, so the copy of the next frame overlaps the encode of the
+// previous one. Source frame releases and encoded frames come back to the main
+// thread through lock-free queues, drained by a single coalesced task.
+//
+// Encoded frames come from a fixed pool. If the main thread stalls long enough
+// to use them all up, the encoder drops frames until the next key frame, which
+// it forces, rather than piling up more frames.
+//
+// Resizing a running encoder doesn't stop the thread. A second encoder is
+// initialized at the new size on the same thread while the current one keeps
+// encoding. Once it is ready, the frames already submitted to the current
+// encoder are let out, and encoding switches over to the new one, starting
+// with a key frame.
 class VideoEncoder {
  public:
   using VideoEncoderInitializedCb = std::function<void(bool result)>;
@@ -31,15 +55,23 @@ class VideoEncoder {
   using EncoderEncodedCb =
       std::function<void(bool success, std::shared_ptr<EncodedFrame> frame)>;
   using EncoderResizedCb = std::function<void(bool success)>;
+  // |frames| encoded frames were dropped, the last of them captured at
+  // |reference_time|. They never reach the GetEncodedFrame() callback.
+  using EncoderDroppedCb =
+      std::function<void(int frames, base::TimeTicks reference_time)>;
 
-  explicit VideoEncoder(pp::Instance* instance, const SenderConfig& config);
+  // Logs the FRAME_ENCODE_BEGIN and FRAME_ENCODED events of every frame to
+  // the logger of |env| as frames of |ssrc|, from the encoder thread.
+  VideoEncoder(SharerEnvironment* env, const SenderConfig& config,
+               uint32_t ssrc);
 
   const pp::Size& size() { return encoder_size_; }
   const PP_VideoFrame_Format format() { return frame_format_; }
 
   void EncodeFrame(pp::VideoFrame frame, const base::TimeTicks& timestamp,
-                   EncoderReleaseCb cb);
+                   bool force_key_frame, EncoderReleaseCb cb);
   void GetEncodedFrame(EncoderEncodedCb cb);
+  void SetDroppedCallback(EncoderDroppedCb cb);
   void FlushEncodedFrames();
   void Stop();
   void ChangeEncoding(const SenderConfig& config);
@@ -63,6 +95,7 @@ class VideoEncoder {
     pp::VideoFrame frame;
     EncoderReleaseCb callback;
     base::TimeTicks reference_time;
+    bool force_key_frame;
   };
 
   struct RequestResize : Request {
@@ -71,49 +104,125 @@ class VideoEncoder {
     EncoderResizedCb callback;
   };
 
+  // Timestamps of a frame given to the encoder, waiting for its bitstream.
+  struct EncodeTiming {
+    PP_TimeDelta timestamp;
+    base::TimeTicks reference_time;
+  };
+
   void Initialize();
   void InitializedThread(int32_t result);
   void ProcessNextRequest();
   bool ProcessEncodeRequest();
   bool ProcessResizeRequest();
-  void EncodeOneFrame();
-  void OnFrameReleased(int32_t result);
-  void OnEncodedFrame(int32_t result, std::shared_ptr<EncodedFrame> frame);
+  void OnFrameReleased(RequestEncode* req);
   void EmitOneFrame(int32_t result);
+  void DrainThreadOutput(int32_t result);
   void EncoderPauseDestructor();
+  void OnReconfigured(int32_t result);
+  void UpdateQueueDepth();
 
   void ThreadInitialize();
   void ThreadInitialized(int32_t result);
-  void ThreadEncode(int32_t result);
-  void ThreadInformFrameRelease(int32_t result);
+  void ThreadReconfigure(int32_t result, const pp::Size& size);
+  void ThreadChangeEncoding(int32_t result, uint32_t bitrate,
+                            double frame_rate);
+  void ThreadApplyEncoding(pp::VideoEncoder* encoder);
+  void ThreadOnNextEncoderInitialized(int32_t result);
+  bool ThreadMaybeSwitchEncoder();
+  void ThreadRequestBitstreamBuffer();
+  void ThreadEncode(int32_t result, RequestEncode* req);
+  void ThreadPumpEncodes();
+  void ThreadSubmitFrame(pp::VideoFrame encoder_frame, RequestEncode* req);
+  void ThreadInformFrameRelease(RequestEncode* req);
+  void ThreadPostOutput();
+  void ThreadPostDroppedFrame();
+  void ThreadDropUntilKeyFrame();
   void ThreadOnEncoderFrame(int32_t result, pp::VideoFrame encoder_frame,
-                            Request* req);
+                            uint32_t generation);
   int32_t ThreadCopyVideoFrame(pp::VideoFrame dest, pp::VideoFrame src);
   void ThreadOnBitstreamBufferReceived(int32_t result,
-                                       PP_BitstreamBuffer buffer);
+                                       PP_BitstreamBuffer buffer,
+                                       uint32_t generation);
   std::shared_ptr<EncodedFrame> PauseStreamToEncodedFrame();
   std::shared_ptr<EncodedFrame> ThreadBitstreamToEncodedFrame(
       PP_BitstreamBuffer buffer);
-  void ThreadOnEncodeDone(int32_t result, PP_TimeDelta timestamp, RequestEncode* req);
+  void ThreadOnEncodeDone(int32_t result, PP_TimeDelta timestamp);
+  void ThreadLogEncodeBegin(PP_TimeDelta timestamp);
+  void ThreadLogEncodedFrame(const EncodedFrame& frame);
 
   pp::Instance* instance_;
-  pp::CompletionCallbackFactory<VideoEncoder> factory_;
+  const uint32_t ssrc_;
+  LogEventDispatcher* const logger_;
+  // Requests waiting for the encoder thread or being processed by it.
+  MetricGauge* const queue_depth_metric_;
+  // Callbacks are made on both the main and the encoder thread.
+  pp::CompletionCallbackFactory<VideoEncoder, pp::ThreadSafeThreadTraits>
+      factory_;
   SenderConfig config_;
   pp::Size encoder_size_;
 
   PP_VideoFrame_Format frame_format_;
 
   std::queue<std::unique_ptr<Request>> requests_;
+  // Resize request being processed. Encodes wait until it is done.
   std::unique_ptr<Request> current_request_;
+  // Resize of the running encoder, waiting for the encoder thread to switch.
+  // Encodes go on meanwhile, other resizes wait.
+  std::unique_ptr<Request> pending_resize_;
+  // Encode requests handed to the encoder thread whose source frame wasn't
+  // released yet, oldest first.
+  std::deque<std::unique_ptr<Request>> encodes_in_flight_;
   EncoderEncodedCb encoded_cb_;
+  EncoderDroppedCb dropped_cb_;
 
   std::queue<std::shared_ptr<EncodedFrame>> encoded_frames_;
 
+  // Encoder thread to main thread. |output_posted_| is set while a
+  // DrainThreadOutput() task is pending, so the thread posts at most one.
+  base::SpscQueue<RequestEncode*> released_requests_;
+  base::SpscQueue<std::shared_ptr<EncodedFrame>> encoded_output_;
+  // Frames the thread dropped since the last drain, and the reference time of
+  // the last one.
+  std::atomic<int> dropped_output_;
+  std::atomic<int64_t> dropped_reference_time_;
+  std::atomic<bool> output_posted_;
+
   pp::MessageLoop thread_loop_;
   std::thread encoder_thread_;
 
   pp::VideoEncoder video_encoder_;
 
+  // Only used on the encoder thread.
+  std::queue<RequestEncode*> thread_pending_encodes_;
+  std::queue<pp::VideoFrame> thread_free_frames_;
+  bool thread_frame_requested_;
+  std::deque<EncodeTiming> thread_encode_timings_;
+  EncodedFramePool thread_frame_pool_;
+  // Set after dropping an encoded frame: the frames depending on it are
+  // dropped too, and the next frame submitted is a key frame.
+  bool thread_waiting_for_key_frame_;
+  bool thread_force_key_frame_;
+  // Encoder being initialized at a new size, see ThreadReconfigure().
+  pp::VideoEncoder thread_next_encoder_;
+  // Sizes the current and next encoders were asked for. Their coded sizes may
+  // be larger.
+  pp::Size thread_visible_size_;
+  pp::Size thread_next_visible_size_;
+  // Set once |thread_next_encoder_| is ready: no more frames are submitted to
+  // the current encoder, and the switch happens once all its bitstream is out.
+  bool thread_switch_pending_;
+  // Incremented on each switch, so that callbacks from the previous encoder
+  // are told apart.
+  uint32_t thread_encoder_generation_;
+  // Set once |video_encoder_| is initialized.
+  bool thread_encoder_ready_;
+  // Encoding of the encoders, in kbps and frames per second. |config_| has
+  // the same for the next time the thread starts, but belongs to the main
+  // thread.
+  uint32_t thread_bitrate_;
+  double thread_frame_rate_;
+
   uint32_t last_encoded_frame_id_;
   PP_TimeDelta last_timestamp_;
   base::TimeTicks last_reference_time_;
@@ -9,6 +9,7 @@
 #include "net/sharer_transport_config.h"
 #include "net/transport_sender.h"
 #include "sender/congestion_control.h"
+#include "sender/frame_scaler.h"
 #include "sharer_defines.h"
 
 static int32_t roundTo4(int32_t value) {
@@ -21,30 +22,74 @@ namespace sharer {
 const int kRoundTripsNeeded = 4;
 const int kConstantTimeMs = 75;
 
+// Simulcast layers never get less than this, in kbps.
+const uint32_t kMinLayerBitrate = 150;
+
+// Encoded size steps, in quarters of the configured size: full, 3/4 and 1/2.
+const int kScaleSteps[] = {4, 3, 2};
+const int kNumScaleSteps = sizeof(kScaleSteps) / sizeof(kScaleSteps[0]);
+// Dropping more than a quarter of the frames over this window steps the
+// encoded size down.
+const int kScaleWindowMs = 2000;
+// Time without dropped frames before stepping the encoded size back up.
+const int kScaleUpDelayMs = 10000;
+
+// Frames still encoded after the last change in the captured content.
+const int kRefinementFrames = 4;
+// Weight of the last keep-alive in the average size of a static frame.
+const double kStaticFrameBytesWeight = 0.125;
+
 VideoSender::VideoSender(SharerEnvironment* env,
                          TransportSender* const transport_sender,
-                         const SenderConfig& config, SharerSuccessCb cb,
+                         const SenderConfig& config, int layer,
+                         SharerSuccessCb cb,
                          PlayoutDelayChangeCb playout_delay_change_cb)
     : FrameSender(env->clock(), false, transport_sender, kVideoFrequency,
-                  11, /* config.ssrc, */
+                  VideoSsrcForLayer(layer),
                   config.frame_rate,
                   base::TimeDelta(), /* config.min_playout_delay, */
                   base::TimeDelta::FromMilliseconds(
                       kDefaultRtpMaxDelayMs), /* config.max_playout_delay, */
+                  base::TimeDelta::FromMilliseconds(config.max_queue_delay_ms),
                   NewFixedCongestionControl(2000000)),
       env_(env),
+      layer_(layer),
       initialized_(false),
       initialized_cb_(cb),
       playout_delay_change_cb_(playout_delay_change_cb),
       factory_(this),
+      key_frame_scheduler_(
+          env->clock(),
+          base::TimeDelta::FromMilliseconds(config.key_frame_coalesce_ms),
+          base::TimeDelta::FromMilliseconds(config.min_key_frame_interval_ms)),
       frame_rate_(config.frame_rate),
+      frame_clock_(env->clock(), config.frame_rate,
+                   config.lock_capture_clock),
       frames_in_encoder_(0),
       pause_delta_(0.1),
       querying_size_(false),
-      skip_resize_(true),
+      scale_step_(0),
+      is_resizing_(false),
+      dropped_frames_(0),
+      static_keepalive_(
+          base::TimeDelta::FromMilliseconds(config.static_keepalive_ms)),
+      refinement_frames_left_(0),
+      static_frame_bytes_(0),
+      frames_captured_(0),
+      frames_skipped_(0),
+      changed_blocks_(0),
+      hashed_blocks_(0),
+      raw_bytes_skipped_(0),
       is_receiving_track_frames_(false),
       is_sending_(false) {
-  encoder_ = make_unique<VideoEncoder>(env->instance(), config);
+  SenderConfig layer_config = config;
+  layer_config.initial_bitrate = LayerBitrate(config.initial_bitrate, layer_);
+  encoder_ = make_unique<VideoEncoder>(env, layer_config,
+                                       VideoSsrcForLayer(layer_));
+  encoder_->SetDroppedCallback(
+      [this](int frames, base::TimeTicks reference_time) {
+        this->OnEncoderDroppedFrames(frames, reference_time);
+      });
 
   auto sharer_feedback_cb =
       [this](const std::string& addr, const RtcpSharerMessage& sharer_message) {
@@ -55,8 +100,8 @@ VideoSender::VideoSender(SharerEnvironment* env,
       [this](base::TimeDelta rtt) { this->OnMeasuredRoundTripTime(rtt); };
 
   SharerTransportRtpConfig transport_config;
-  transport_config.ssrc = 11;
-  transport_config.feedback_ssrc = 12;
+  transport_config.ssrc = VideoSsrcForLayer(layer_);
+  transport_config.feedback_ssrc = VideoFeedbackSsrcForLayer(layer_);
   transport_config.rtp_payload_type = 96;
   transport_sender->InitializeVideo(transport_config, sharer_feedback_cb,
                                     rtt_cb);
@@ -71,6 +116,49 @@ void VideoSender::SetSize(const pp::Size& size) {
   requested_size_ = size;
 }
 
+void VideoSender::AddSimulcastLayer(VideoSender* layer) {
+  PP_DCHECK(layer_ == 0 && layer->layer_ > 0);
+  simulcast_layers_.push_back(layer);
+}
+
+// static
+uint32_t VideoSender::LayerBitrate(uint32_t bitrate, int layer) {
+  // Each layer has a quarter of the pixels of the one above it.
+  return std::max(bitrate >> (2 * layer), std::min(bitrate, kMinLayerBitrate));
+}
+
+void VideoSender::ReportCaptureStats() {
+  const FrameClock::Stats clock_stats = frame_clock_.TakeStats();
+  if (clock_stats.captures) {
+    INF() << "Capture clock: " << clock_stats.captures << " ticks, interval "
+          << clock_stats.mean_interval_ms << " ms (nominal "
+          << frame_clock_.interval().InMillisecondsF() << "), jitter "
+          << clock_stats.jitter_ms << " ms, max "
+          << clock_stats.max_deviation_ms << " ms, "
+          << clock_stats.missed_ticks << " missed.";
+  }
+
+  if (!frames_captured_) return;
+
+  INF() << "Static content: skipped " << frames_skipped_ << " of "
+        << frames_captured_ << " frames ("
+        << frames_skipped_ * 100 / frames_captured_ << "%), "
+        << (hashed_blocks_ ? changed_blocks_ * 100 / hashed_blocks_ : 100)
+        << "% of blocks changed, detection "
+        << detection_time_.InMicroseconds() / frames_captured_
+        << " us/frame, " << raw_bytes_skipped_ / 1024
+        << " KB of raw frames not copied nor encoded, ~"
+        << static_cast<int64_t>(static_frame_bytes_ * frames_skipped_) / 1024
+        << " KB not sent on layer 0.";
+
+  frames_captured_ = 0;
+  frames_skipped_ = 0;
+  changed_blocks_ = 0;
+  hashed_blocks_ = 0;
+  raw_bytes_skipped_ = 0;
+  detection_time_ = base::TimeDelta();
+}
+
 int VideoSender::GetNumberOfFramesInEncoder() const {
   return frames_in_encoder_;
 }
@@ -85,8 +173,22 @@ base::TimeDelta VideoSender::GetInFlightMediaDuration() const {
   /* } */
 }
 
+size_t VideoSender::GetPredictedBytesInEncoder() const {
+  // Key frames are rare enough that the frames in the encoder are assumed to
+  // be delta frames.
+  return frames_in_encoder_ * size_estimator_.Predict(false);
+}
+
+size_t VideoSender::GetPredictedNextFrameBytes() const {
+  return size_estimator_.Predict(key_frame_scheduler_.has_pending_request());
+}
+
 void VideoSender::OnAck(uint32_t frame_id) {}
 
+void VideoSender::OnKeyFrameRequested() {
+  key_frame_scheduler_.OnKeyFrameRequested();
+}
+
 void VideoSender::StartSending(const pp::MediaStreamVideoTrack& video_track,
                                const SharerSuccessCb& cb) {
   if (!video_track_.is_null()) {
@@ -116,16 +218,23 @@ void VideoSender::StopSending(const SharerSuccessCb& cb) {
     return;
   }
 
+  for (VideoSender* layer : simulcast_layers_)
+    layer->StopSending([](bool success) {});
+
   StopTrackFrames();
-  encoder_->Stop();
+  // Simulcast layers only start their encoder once layer 0 got a frame.
+  if (layer_ == 0 || is_sending_) encoder_->Stop();
 
   video_track_.Close();
   video_track_ = pp::MediaStreamVideoTrack();
   frames_in_encoder_ = 0;
+  size_estimator_.Reset();
   encoder_->FlushEncodedFrames();
 
   last_reference_time_ = base::TimeTicks();
   duration_in_encoder_ = duration_in_encoder_.FromInternalValue(0);
+  change_detector_.Reset();
+  static_frame_times_.clear();
   DINF() << "Stopped sending frames.\n";
   is_sending_ = false;
   cb(true);
@@ -133,7 +242,9 @@ void VideoSender::StopSending(const SharerSuccessCb& cb) {
 
 void VideoSender::ChangeEncoding(const SenderConfig& config) {
   DINF() << "Changing encoding";
-  encoder_->ChangeEncoding(config);
+  SenderConfig layer_config = config;
+  layer_config.initial_bitrate = LayerBitrate(config.initial_bitrate, layer_);
+  encoder_->ChangeEncoding(layer_config);
 }
 
 void VideoSender::ConfigureForFirstFrame() {
@@ -176,19 +287,15 @@ void VideoSender::OnFirstFrame(int32_t result, pp::VideoFrame frame) {
 
   stream_size_ = size;
 
-  if (requested_size_.IsEmpty())
-    skip_resize_ = true;
-  else {
+  // The track keeps its capture size, the encoder downscales to this.
+  if (!requested_size_.IsEmpty()) {
     pp::Size calc_size = CalculateSize();
-    if (calc_size.width() == stream_size_.width() ||
-        calc_size.height() == stream_size_.height())
-      skip_resize_ = true;
-    else {
-      size = calc_size;
-      skip_resize_ = false;
-    }
+    if (!calc_size.IsEmpty()) size = calc_size;
   }
 
+  base_size_ = size;
+  scale_step_ = 0;
+  encoded_size_ = size;
   auto resized_cb = [this](bool success) {
     this->OnEncoderResized(success);
   };
@@ -231,25 +338,86 @@ void VideoSender::OnEncoderResized(bool success) {
     return;
   }
 
-  if (skip_resize_)
-    OnConfiguredTrack(PP_OK);
-  else
-    // Reconfigure stream
-    ConfigureTrack();
+  for (VideoSender* layer : simulcast_layers_) layer->StartLayer(encoded_size_);
+
+  OnConfiguredTrack(PP_OK);
 }
 
-void VideoSender::ConfigureTrack() {
-  int32_t attrib_list[]{
-      PP_MEDIASTREAMVIDEOTRACK_ATTRIB_FORMAT, encoder_->format(),
-      PP_MEDIASTREAMVIDEOTRACK_ATTRIB_WIDTH, encoder_->size().width(),
-      PP_MEDIASTREAMVIDEOTRACK_ATTRIB_HEIGHT, encoder_->size().height(),
-      PP_MEDIASTREAMVIDEOTRACK_ATTRIB_NONE};
+void VideoSender::StartLayer(const pp::Size& base_size) {
+  const pp::Size size(roundTo4(base_size.width() >> layer_),
+                      roundTo4(base_size.height() >> layer_));
+  INF() << "Starting simulcast layer " << layer_ << " at " << size.width()
+        << "x" << size.height();
 
-  DINF() << "Configuring track to: " << encoder_->size().width()
-         << "x" << encoder_->size().height();
+  auto resized_cb = [this](bool success) {
+    this->OnLayerEncoderResized(success);
+  };
+  encoder_->Resize(size, resized_cb);
+}
 
-  auto cc = factory_.NewCallback(&VideoSender::OnConfiguredTrack);
-  video_track_.Configure(attrib_list, cc);
+void VideoSender::OnLayerEncoderResized(bool success) {
+  if (!success) {
+    ERR() << "Could not start encoder for simulcast layer " << layer_;
+    return;
+  }
+
+  RequestEncodedFrame();
+  is_sending_ = true;
+}
+
+void VideoSender::SetScaleStep(int step) {
+  const pp::Size size(
+      roundTo4(base_size_.width() * kScaleSteps[step] / 4),
+      roundTo4(base_size_.height() * kScaleSteps[step] / 4));
+  scale_step_ = step;
+  last_scale_change_ = env_->clock()->NowTicks();
+  if (size.width() == encoded_size_.width() &&
+      size.height() == encoded_size_.height()) {
+    return;
+  }
+
+  INF() << "Encoding at " << size.width() << "x" << size.height();
+  encoded_size_ = size;
+  // Send the content again at the new size, even if it is static.
+  change_detector_.Reset();
+  is_resizing_ = true;
+  // The track keeps delivering frames at capture size, encoded at the old
+  // size until the encoder switches over with a key frame.
+  auto resized_cb = [this](bool success) {
+    if (!success) ERR() << "Could not change the encoded size.";
+    is_resizing_ = false;
+  };
+  encoder_->Resize(size, resized_cb);
+}
+
+void VideoSender::UpdateScaleStep(bool dropped) {
+  // Simulcast receivers pick a smaller layer instead.
+  if (layer_ != 0 || !simulcast_layers_.empty() || is_resizing_ ||
+      base_size_.IsEmpty()) {
+    return;
+  }
+
+  const base::TimeTicks now = env_->clock()->NowTicks();
+  if (scale_window_start_.is_null() ||
+      now - scale_window_start_ >
+          base::TimeDelta::FromMilliseconds(kScaleWindowMs)) {
+    scale_window_start_ = now;
+    dropped_frames_ = 0;
+  }
+
+  if (dropped) {
+    last_drop_time_ = now;
+    if (++dropped_frames_ > frame_rate_ * kScaleWindowMs / 1000 / 4 &&
+        scale_step_ + 1 < kNumScaleSteps) {
+      WRN() << "Dropping too many frames, stepping the encoded size down.";
+      dropped_frames_ = 0;
+      SetScaleStep(scale_step_ + 1);
+    }
+  } else if (scale_step_ > 0 &&
+             now - std::max(last_drop_time_, last_scale_change_) >
+                 base::TimeDelta::FromMilliseconds(kScaleUpDelayMs)) {
+    SetScaleStep(scale_step_ - 1);
+  }
 }
 
 void VideoSender::OnConfiguredTrack(int32_t result) {
@@ -262,7 +430,8 @@ void VideoSender::OnConfiguredTrack(int32_t result) {
 
   RequestEncodedFrame();
   StartTrackFrames();
-  ScheduleNextEncode();
+  frame_clock_.Start();
+  if (!frame_clock_.locked_to_track()) ScheduleNextEncode();
   if (start_sending_cb_) start_sending_cb_(true);
   start_sending_cb_ = nullptr;
 }
@@ -297,6 +466,10 @@ void VideoSender::OnTrackFrame(int32_t result, pp::VideoFrame frame) {
 
   if (is_receiving_track_frames_) {
     current_track_frame_ = frame;
+    if (frame_clock_.locked_to_track() &&
+        frame_clock_.ShouldCaptureTrackFrame(frame.GetTimestamp())) {
+      EncodeTrackFrame();
+    }
     auto cc = factory_.NewCallbackWithOutput(&VideoSender::OnTrackFrame);
     video_track_.GetFrame(cc);
   }
@@ -304,28 +477,99 @@ void VideoSender::OnTrackFrame(int32_t result, pp::VideoFrame frame) {
 
 void VideoSender::ScheduleNextEncode() {
   auto cc = factory_.NewCallback(&VideoSender::GetEncoderFrameTick);
-  pp::Module::Get()->core()->CallOnMainThread(1000 / frame_rate_, cc, 0);
+  pp::Module::Get()->core()->CallOnMainThread(
+      frame_clock_.DelayUntilNextTick(), cc, 0);
 }
 
 void VideoSender::GetEncoderFrameTick(int32_t result) {
-  if (!current_track_frame_.is_null()) {
-    pp::VideoFrame frame = current_track_frame_;
+  frame_clock_.OnTick();
+  EncodeTrackFrame();
+  ScheduleNextEncode();
+}
+
+void VideoSender::EncodeTrackFrame() {
+  bool is_static = false;
+  if (!current_track_frame_.is_null() && ShouldSkipStaticFrame(&is_static)) {
+    video_track_.RecycleFrame(current_track_frame_);
+    current_track_frame_.detach();
+  } else if (!current_track_frame_.is_null()) {
+    // All layers encode from the same track frame. It goes back to the track
+    // once the last encoder is done with it.
+    pp::MediaStreamVideoTrack track = video_track_;
+    auto frame = std::shared_ptr<pp::VideoFrame>(
+        new pp::VideoFrame(current_track_frame_),
+        [track](pp::VideoFrame* frame) mutable {
+          track.RecycleFrame(*frame);
+          delete frame;
+        });
     current_track_frame_.detach();
 
-    if (!InsertRawVideoFrame(frame)) {
-      RecycleFrame(frame);
-    }
+    if (InsertRawVideoFrame(frame) && is_static)
+      static_frame_times_.push_back(last_reference_time_);
+    for (VideoSender* layer : simulcast_layers_)
+      layer->InsertRawVideoFrame(frame);
   }
+}
 
-  ScheduleNextEncode();
+bool VideoSender::ShouldSkipStaticFrame(bool* is_static) {
+  ++frames_captured_;
+
+  pp::Size size;
+  if (static_keepalive_.is_zero() || !current_track_frame_.GetSize(&size) ||
+      current_track_frame_.GetDataBufferSize() <
+          I420BufferSize(size.width(), size.height())) {
+    return false;
+  }
+
+  const base::TimeTicks start = env_->clock()->NowTicks();
+  ChangeDetector::Region changed;
+  const bool has_changed = change_detector_.DetectChanges(
+      static_cast<const uint8_t*>(current_track_frame_.GetDataBuffer()),
+      size.width(), size.height(), &changed);
+  const base::TimeTicks now = env_->clock()->NowTicks();
+  detection_time_ += now - start;
+  hashed_blocks_ += change_detector_.total_blocks();
+  changed_blocks_ += change_detector_.changed_blocks();
+
+  // The encoder has no partial update input, so a changed region still means
+  // encoding the whole frame. Only skipping whole frames saves anything.
+  if (has_changed) {
+    DINF() << "Changed region: " << changed.width << "x" << changed.height
+           << " at " << changed.x << "," << changed.y;
+    refinement_frames_left_ = kRefinementFrames;
+  } else if (refinement_frames_left_ > 0) {
+    --refinement_frames_left_;
+  } else if (now - last_encoded_time_ < static_keepalive_ &&
+             !HasPendingKeyFrameRequest() && !is_resizing_) {
+    ++frames_skipped_;
+    raw_bytes_skipped_ += I420BufferSize(size.width(), size.height()) *
+                          (simulcast_layers_.size() + 1);
+    return true;
+  } else {
+    *is_static = true;
+  }
+
+  last_encoded_time_ = now;
+  return false;
+}
+
+bool VideoSender::HasPendingKeyFrameRequest() const {
+  if (key_frame_scheduler_.has_pending_request()) return true;
+  for (const VideoSender* layer : simulcast_layers_) {
+    if (layer->key_frame_scheduler_.has_pending_request()) return true;
+  }
+  return false;
 }
 
-bool VideoSender::InsertRawVideoFrame(const pp::VideoFrame& frame) {
+bool VideoSender::InsertRawVideoFrame(
+    const std::shared_ptr<pp::VideoFrame>& frame) {
   if (!encoder_) {
     PP_NOTREACHED();
     return false;
   }
-  PP_TimeTicks time_sticks = frame.GetTimestamp();
+  if (!is_sending_) return false;
+
+  PP_TimeTicks time_sticks = frame->GetTimestamp();
 
   const base::TimeTicks reference_time = env_->clock()->NowTicks();
 
@@ -346,7 +590,9 @@ bool VideoSender::InsertRawVideoFrame(const pp::VideoFrame& frame) {
           // when we decrease the fps.
           base::TimeDelta::FromSecondsD(0.01 / frame_rate_);
 
-  if (ShouldDropNextFrame(duration_added_by_next_frame)) {
+  const bool drop = ShouldDropNextFrame(duration_added_by_next_frame);
+  UpdateScaleStep(drop);
+  if (drop) {
     base::TimeDelta new_target_delay =
         std::min(current_round_trip_time_ * kRoundTripsNeeded +
                      base::TimeDelta::FromMilliseconds(kConstantTimeMs),
@@ -359,19 +605,35 @@ bool VideoSender::InsertRawVideoFrame(const pp::VideoFrame& frame) {
     return false;
   }
 
-  // Send frame to encoder, and add a callback to when it can be released.
-  auto release_cb = [this](pp::VideoFrame frame) { this->RecycleFrame(frame); };
+  // Send frame to encoder. The callback holds our reference to the shared
+  // track frame until the encoder has copied it.
+  auto release_cb = [frame](pp::VideoFrame released) {};
   frames_in_encoder_++;
   duration_in_encoder_ += duration_added_by_next_frame;
   last_reference_time_ = reference_time;
   last_enqueued_frame_rtp_timestamp_ = rtp_timestamp;
   pause_delta_ = time_sticks + 0.1;
-  encoder_->EncodeFrame(frame, reference_time, release_cb);
+  LogCapturedFrame(*frame, reference_time, rtp_timestamp);
+  encoder_->EncodeFrame(*frame, reference_time,
+                        key_frame_scheduler_.ShouldForceKeyFrame(), release_cb);
   return true;
 }
 
-void VideoSender::RecycleFrame(pp::VideoFrame frame) {
-  video_track_.RecycleFrame(frame);
+void VideoSender::LogCapturedFrame(const pp::VideoFrame& frame,
+                                   base::TimeTicks reference_time,
+                                   RtpTimestamp rtp_timestamp) {
+  FrameEvent event;
+  event.timestamp = reference_time;
+  event.type = FRAME_CAPTURE_END;
+  event.media_type = VIDEO_EVENT;
+  event.ssrc = ssrc_;
+  event.rtp_timestamp = rtp_timestamp;
+  pp::Size size;
+  if (frame.GetSize(&size)) {
+    event.width = size.width();
+    event.height = size.height();
+  }
+  env_->logger()->DispatchFrameEvent(event);
 }
 
 void VideoSender::RequestEncodedFrame() {
@@ -387,9 +649,40 @@ void VideoSender::OnEncodedFrame(bool success,
   duration_in_encoder_ = last_reference_time_ - frame->reference_time;
   frames_in_encoder_--;
 
+  const bool key_frame = frame->dependency == EncodedFrame::KEY;
+  if (key_frame) key_frame_scheduler_.OnKeyFrameEncoded();
+  size_estimator_.OnEncodedFrame(key_frame, frame->data.size());
+
+  // Learn what a skipped frame would have cost from the keep-alives.
+  while (!static_frame_times_.empty() &&
+         static_frame_times_.front() < frame->reference_time) {
+    static_frame_times_.pop_front();
+  }
+  if (!static_frame_times_.empty() &&
+      static_frame_times_.front() == frame->reference_time) {
+    static_frame_times_.pop_front();
+    const double bytes = frame->data.size();
+    static_frame_bytes_ =
+        static_frame_bytes_
+            ? static_frame_bytes_ +
+                  kStaticFrameBytesWeight * (bytes - static_frame_bytes_)
+            : bytes;
+  }
+
   SendEncodedFrame(frame);
 
   RequestEncodedFrame();
 }
 
+void VideoSender::OnEncoderDroppedFrames(int frames,
+                                         base::TimeTicks reference_time) {
+  DWRN() << "Encoder dropped " << frames << " frame(s).";
+  // They left the encoder just like encoded frames do, so they must not keep
+  // counting towards the frames in flight.
+  frames_in_encoder_ = std::max(0, frames_in_encoder_ - frames);
+  duration_in_encoder_ = frames_in_encoder_ > 0
+                             ? last_reference_time_ - reference_time
+                             : base::TimeDelta();
+}
+
 }  // namespace sharer
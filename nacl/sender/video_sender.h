@@ -6,13 +6,19 @@
 #define SENDER_VIDEO_SENDER_H_
 
 #include "base/macros.h"
+#include "sender/change_detector.h"
+#include "sender/encoded_size_estimator.h"
+#include "sender/frame_clock.h"
 #include "sender/frame_sender.h"
+#include "sender/key_frame_scheduler.h"
 #include "sender/video_encoder.h"
 #include "sharer_environment.h"
 
 #include "ppapi/cpp/media_stream_video_track.h"
 
+#include <deque>
 #include <memory>
+#include <vector>
 
 namespace sharer {
 
@@ -23,9 +29,13 @@ class VideoSender : public FrameSender {
   using PlayoutDelayChangeCb = std::function<void(base::TimeDelta)>;
   using SharerSuccessCb = std::function<void(bool success)>;
 
+  // Sends simulcast layer |layer| on its own SSRC. Layer 0 captures from the
+  // video track and feeds the other layers, which encode a downscaled copy of
+  // the same frames.
   explicit VideoSender(SharerEnvironment* env,
                        TransportSender* const transport_sender,
-                       const SenderConfig& config, SharerSuccessCb cb,
+                       const SenderConfig& config, int layer,
+                       SharerSuccessCb cb,
                        PlayoutDelayChangeCb playout_delay_change_cb);
   ~VideoSender();
 
@@ -35,10 +45,24 @@ class VideoSender : public FrameSender {
   void StopSending(const SharerSuccessCb& cb);
   void ChangeEncoding(const SenderConfig& config);
 
+  // Feeds every frame captured by this sender to |layer| too. Must be called
+  // before StartSending().
+  void AddSimulcastLayer(VideoSender* layer);
+
+  // Bitrate of simulcast layer |layer| when layer 0 uses |bitrate|, in kbps.
+  static uint32_t LayerBitrate(uint32_t bitrate, int layer);
+
+  // Logs the capture interval jitter, and how many captured frames were
+  // skipped as static and what that saved, since the last report.
+  void ReportCaptureStats();
+
  protected:
   int GetNumberOfFramesInEncoder() const final;
   base::TimeDelta GetInFlightMediaDuration() const final;
+  size_t GetPredictedBytesInEncoder() const final;
+  size_t GetPredictedNextFrameBytes() const final;
   void OnAck(uint32_t frame_id) final;
+  void OnKeyFrameRequested() final;
 
  private:
   void Initialized(bool result);
@@ -46,20 +70,30 @@ class VideoSender : public FrameSender {
   void OnConfiguredForFirstFrame(int32_t result);
   void OnFirstFrame(int32_t result, pp::VideoFrame frame);
   void OnEncoderResized(bool success);
+  void StartLayer(const pp::Size& base_size);
+  void OnLayerEncoderResized(bool success);
   pp::Size CalculateSize() const;
-  void ConfigureTrack();
+  void SetScaleStep(int step);
+  void UpdateScaleStep(bool dropped);
   void OnConfiguredTrack(int32_t result);
   void StartTrackFrames();
   void StopTrackFrames();
   void OnTrackFrame(int32_t result, pp::VideoFrame frame);
   void ScheduleNextEncode();
   void GetEncoderFrameTick(int32_t result);
-  void RecycleFrame(pp::VideoFrame frame);
+  void EncodeTrackFrame();
+  bool ShouldSkipStaticFrame(bool* is_static);
+  bool HasPendingKeyFrameRequest() const;
   void RequestEncodedFrame();
   void OnEncodedFrame(bool success, std::shared_ptr<EncodedFrame> frame);
-  bool InsertRawVideoFrame(const pp::VideoFrame& frame);
+  void OnEncoderDroppedFrames(int frames, base::TimeTicks reference_time);
+  bool InsertRawVideoFrame(const std::shared_ptr<pp::VideoFrame>& frame);
+  void LogCapturedFrame(const pp::VideoFrame& frame,
+                        base::TimeTicks reference_time,
+                        RtpTimestamp rtp_timestamp);
 
   SharerEnvironment* env_;
+  const int layer_;
 
   bool initialized_;
   SharerSuccessCb initialized_cb_;
@@ -68,9 +102,12 @@ class VideoSender : public FrameSender {
   pp::CompletionCallbackFactory<VideoSender> factory_;
 
   std::unique_ptr<VideoEncoder> encoder_;
+  KeyFrameScheduler key_frame_scheduler_;
 
   double frame_rate_;
+  FrameClock frame_clock_;
   int frames_in_encoder_;
+  EncodedSizeEstimator size_estimator_;
 
   base::TimeDelta duration_in_encoder_;
   base::TimeTicks last_reference_time_;
@@ -79,14 +116,45 @@ class VideoSender : public FrameSender {
 
   pp::Size requested_size_;
   pp::Size stream_size_;
+  pp::Size encoded_size_;
   bool querying_size_;
-  bool skip_resize_;
+
+  // The size to encode at when not congested, and the step down from it,
+  // see kScaleSteps.
+  pp::Size base_size_;
+  int scale_step_;
+  bool is_resizing_;
+  int dropped_frames_;
+  base::TimeTicks scale_window_start_;
+  base::TimeTicks last_drop_time_;
+  base::TimeTicks last_scale_change_;
+
+  // Static content detection, layer 0 only.
+  ChangeDetector change_detector_;
+  const base::TimeDelta static_keepalive_;
+  // Frames still to encode after the last change, so that the encoder can
+  // refine the changed region to full quality before it stops being sent.
+  int refinement_frames_left_;
+  base::TimeTicks last_encoded_time_;
+  // Reference times of static frames sent as keep-alives, to learn what a
+  // skipped frame would have cost once they come out of the encoder.
+  std::deque<base::TimeTicks> static_frame_times_;
+  double static_frame_bytes_;
+
+  int frames_captured_;
+  int frames_skipped_;
+  int64_t changed_blocks_;
+  int64_t hashed_blocks_;
+  uint64_t raw_bytes_skipped_;
+  base::TimeDelta detection_time_;
 
   bool is_receiving_track_frames_;
   bool is_sending_;
   pp::MediaStreamVideoTrack video_track_;
   pp::VideoFrame current_track_frame_;
 
+  std::vector<VideoSender*> simulcast_layers_;
+
   SharerSuccessCb start_sending_cb_;
 
   DISALLOW_COPY_AND_ASSIGN(VideoSender);
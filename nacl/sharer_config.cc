@@ -16,13 +16,24 @@ namespace sharer {
 
 ReceiverNetConfig::ReceiverNetConfig()
     : address("127.0.0.1"),
-      port(5004) {}
+      port(5004),
+      max_temporal_layer(0xff),
+      multicast_layers(1) {}
 
 ReceiverNetConfig::~ReceiverNetConfig() {}
 
 SenderConfig::SenderConfig()
     : initial_bitrate(1000),
       frame_rate(30),
+      key_frame_coalesce_ms(200),
+      min_key_frame_interval_ms(1000),
+      simulcast_layers(1),
+      layered_multicast(false),
+      static_keepalive_ms(1000),
+      lock_capture_clock(false),
+      pacing_weight(1),
+      uplink_kbps(0),
+      max_queue_delay_ms(100),
       remote_address("127.0.0.1"),
       remote_port(5004),
       multicast(false) {}
@@ -29,6 +29,12 @@ struct ReceiverNetConfig {
   ~ReceiverNetConfig();
   std::string address;
   uint16_t port;
+  // Highest temporal layer to decode. Frames above it are not reassembled,
+  // which lets slow receivers decode the base layer only.
+  uint8_t max_temporal_layer;
+  // Number of simulcast layers the sender spreads over consecutive multicast
+  // groups after |address|. 1 means everything comes on |address|.
+  int multicast_layers;
 };
 
 struct SenderConfig {
@@ -37,6 +43,36 @@ struct SenderConfig {
   uint32_t initial_bitrate;
   double frame_rate;
 
+  // Key frame requests from receivers arriving within this window after a key
+  // frame are folded into it.
+  uint32_t key_frame_coalesce_ms;
+  // Minimum time between two key frames forced by receiver requests.
+  uint32_t min_key_frame_interval_ms;
+
+  // Number of simulcast layers, each half the resolution of the previous one
+  // and sent on its own SSRC. Up to kMaxSimulcastLayers.
+  int simulcast_layers;
+  // Send each simulcast layer to its own multicast group, see UdpTransport.
+  bool layered_multicast;
+  // Captured frames that are identical to the previous one are not encoded,
+  // except once every this many ms so that late joiners and lost packets
+  // still get a picture. 0 encodes every frame.
+  uint32_t static_keepalive_ms;
+  // Pick captured frames by their track timestamps instead of a timer. Only
+  // useful when the track delivers frames at a steady rate.
+  bool lock_capture_clock;
+
+  // Share of the uplink this sender gets when several senders run at once,
+  // relative to the others, see PacerGroup.
+  int pacing_weight;
+  // Bitrate of the uplink shared by all senders, in kbps. 0 only limits them
+  // when their receivers lose packets, see PacerGroup.
+  uint32_t uplink_kbps;
+  // Captured frames are dropped rather than let the packets queued for the
+  // network, plus the frames in the encoder, take longer than this to send.
+  // 0 doesn't drop frames for the queue.
+  uint32_t max_queue_delay_ms;
+
   std::string remote_address;
   uint16_t remote_port;
   bool multicast;
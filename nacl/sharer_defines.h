@@ -38,6 +38,28 @@ enum DefaultSettings {
   kDefaultRtpMaxDelayMs = 100,
 };
 
+// Simulcast layer N is sent on SSRC kVideoSsrc + 2 * N, and receivers send
+// feedback for it on the SSRC right after. Layer 0 has full resolution and
+// each following layer halves it.
+const uint32_t kVideoSsrc = 11;
+const uint32_t kVideoFeedbackSsrc = 12;
+const int kMaxSimulcastLayers = 3;
+
+inline uint32_t VideoSsrcForLayer(int layer) {
+  return kVideoSsrc + 2 * layer;
+}
+
+inline uint32_t VideoFeedbackSsrcForLayer(int layer) {
+  return kVideoFeedbackSsrc + 2 * layer;
+}
+
+// Returns the simulcast layer sent on |ssrc|, or -1 if it isn't a video SSRC.
+inline int SimulcastLayerForSsrc(uint32_t ssrc) {
+  if (ssrc < kVideoSsrc || (ssrc - kVideoSsrc) % 2) return -1;
+  const int layer = (ssrc - kVideoSsrc) / 2;
+  return layer < kMaxSimulcastLayers ? layer : -1;
+}
+
 // kRtcpSharerLastPacket is used in PacketIDSet to ask for
 // the last packet of a frame to be retransmitted.
 const uint16_t kRtcpSharerLastPacket = 0xfffe;
@@ -7,6 +7,6 @@
 namespace sharer {
 
 SharerEnvironment::SharerEnvironment(pp::Instance* instance)
-    : instance_(instance) {}
+    : instance_(instance), clock_(&default_clock_) {}
 
 } // namespace sharer
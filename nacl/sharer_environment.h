@@ -8,6 +8,7 @@
 #include "base/macros.h"
 #include "base/time/default_tick_clock.h"
 #include "logging/log_event_dispatcher.h"
+#include "logging/metrics_registry.h"
 
 #include "ppapi/cpp/instance.h"
 
@@ -18,14 +19,20 @@ class SharerEnvironment {
   explicit SharerEnvironment(pp::Instance* instance);
 
   pp::Instance* instance() const { return instance_; }
-  base::TickClock* clock() { return &clock_; }
+  base::TickClock* clock() { return clock_; }
+  // Replaces the system clock for the components created afterwards, e.g.
+  // with simulated time in benchmarks. |clock| must outlive them.
+  void set_clock(base::TickClock* clock) { clock_ = clock; }
   LogEventDispatcher* logger() { return &logger_; }
+  MetricsRegistry* metrics() { return &metrics_; }
 
  private:
   pp::Instance* instance_;
-  base::DefaultTickClock clock_;
+  base::DefaultTickClock default_clock_;
+  base::TickClock* clock_;
 
   LogEventDispatcher logger_;
+  MetricsRegistry metrics_;
 
   DISALLOW_COPY_AND_ASSIGN(SharerEnvironment);
 };
@@ -7,52 +7,79 @@
 #include "base/logger.h"
 #include "base/ptr_utils.h"
 #include "sender/video_sender.h"
+#include "sharer_defines.h"
 
 #include "ppapi/cpp/instance.h"
 
+#include <algorithm>
 #include <string>
 
 static int kReportIntervalMs = 5000;
 
 namespace sharer {
 
-SharerSender::SharerSender(pp::Instance* instance, int id)
+SharerSender::SharerSender(pp::Instance* instance, int id,
+                           PacerGroup* pacer_group)
     : env_(instance),
+      latency_(kVideoSsrc),
       sender_id_(id),
+      pacer_group_(pacer_group),
       factory_(this),
       report_scheduled_(false),
       stream_sharing_(false),
       initialized_video_(false),
       /* initialized_audio_(false), */
       initialized_cb_(nullptr),
-      pauseID(0) {
+      pauseID(0),
+      bitrate_share_(0),
+      video_layers_(1),
+      initialized_video_senders_(0) {
   env_.logger()->Subscribe(&stats_);
+  env_.logger()->Subscribe(&latency_);
 }
 
-SharerSender::~SharerSender() { DINF() << "Destroying SharerSender."; }
+SharerSender::~SharerSender() {
+  DINF() << "Destroying SharerSender.";
+  env_.logger()->Unsubscribe(&stats_);
+  env_.logger()->Unsubscribe(&latency_);
+}
 
 void SharerSender::Initialize(const SenderConfig& config,
                               SharerSenderInitializedCb cb) {
   initialized_cb_ = cb;
+  config_ = config;
 
   auto transport_cb =
       [this](bool result) { this->InitializedTransport(result); };
-  transport_ = make_unique<TransportSender>(&env_, config, transport_cb);
+  auto bitrate_share_cb = [this](uint32_t kbps) { this->OnBitrateShare(kbps); };
+  transport_ = make_unique<TransportSender>(&env_, config, pacer_group_,
+                                            bitrate_share_cb, transport_cb);
 
   auto video_cb = [this](bool result) { this->InitializedVideo(result); };
   auto playout_changed_cb = [this](const base::TimeDelta& playout_delay) {
     this->SetTargetPlayoutDelay(playout_delay);
   };
-  video_sender_ =
-      make_unique<VideoSender>(&env_, transport_.get(),
-                               config, video_cb, playout_changed_cb);
-  video_sender_->SetSize(pp::Size(1920, 1080));
+
+  int layers = config.simulcast_layers;
+  if (layers < 1 || layers > kMaxSimulcastLayers) {
+    WRN() << "Unsupported number of simulcast layers: " << layers;
+    layers = std::max(1, std::min(layers, kMaxSimulcastLayers));
+  }
+  video_layers_ = layers;
+  for (int layer = 0; layer < layers; ++layer) {
+    video_senders_.push_back(
+        make_unique<VideoSender>(&env_, transport_.get(), EncodingConfig(),
+                                 layer, video_cb, playout_changed_cb));
+    if (layer > 0)
+      video_senders_[0]->AddSimulcastLayer(video_senders_[layer].get());
+  }
+  video_senders_[0]->SetSize(pp::Size(1920, 1080));
 }
 
 bool SharerSender::SetTracks(const pp::MediaStreamVideoTrack& video_track,
                              const SharerSuccessCb& cb) {
   DINF() << "Setting audio and video tracks.";
-  video_sender_->StartSending(video_track, cb);
+  video_senders_[0]->StartSending(video_track, cb);
   stream_sharing_ = true;
 
   ScheduleReport();
@@ -62,7 +89,7 @@ bool SharerSender::SetTracks(const pp::MediaStreamVideoTrack& video_track,
 
 bool SharerSender::StopTracks(const SharerSuccessCb& cb) {
   DINF() << "Stop sendng.";
-  video_sender_->StopSending(cb);
+  video_senders_[0]->StopSending(cb);
   stream_sharing_ = false;
   stats_.PrintPackets();
   return true;
@@ -75,6 +102,9 @@ void SharerSender::RunReport(int32_t result) {
     return;
 
   stats_.PrintPackets();
+  stats_.PrintFrames();
+  latency_.PrintAndReset();
+  if (!video_senders_.empty()) video_senders_[0]->ReportCaptureStats();
   ScheduleReport();
 }
 
@@ -89,8 +119,30 @@ void SharerSender::ScheduleReport() {
 
 void SharerSender::ChangeEncoding(const SenderConfig& config) {
   DINF() << "Changing encoding parameters";
-  video_sender_->ChangeEncoding(config);
-  return;
+  config_.initial_bitrate = config.initial_bitrate;
+  config_.frame_rate = config.frame_rate;
+  const SenderConfig encoding_config = EncodingConfig();
+  for (const auto& video_sender : video_senders_)
+    video_sender->ChangeEncoding(encoding_config);
+}
+
+void SharerSender::OnBitrateShare(uint32_t kbps) {
+  const uint32_t previous = EncodingConfig().initial_bitrate;
+  bitrate_share_ = kbps;
+  const SenderConfig encoding_config = EncodingConfig();
+  if (encoding_config.initial_bitrate == previous) return;
+
+  INF() << "Sender " << sender_id_ << " gets "
+        << encoding_config.initial_bitrate << " kbps of the uplink.";
+  for (const auto& video_sender : video_senders_)
+    video_sender->ChangeEncoding(encoding_config);
+}
+
+SenderConfig SharerSender::EncodingConfig() const {
+  SenderConfig config = config_;
+  if (bitrate_share_)
+    config.initial_bitrate = std::min(config.initial_bitrate, bitrate_share_);
+  return config;
 }
 
 void SharerSender::InitializedVideo(bool success) {
@@ -100,8 +152,11 @@ void SharerSender::InitializedVideo(bool success) {
     return;
   }
 
+  if (++initialized_video_senders_ < video_layers_) return;
+
   initialized_video_ = true;
-  INF() << "Successfully initialized video.";
+  INF() << "Successfully initialized video, " << video_layers_
+        << " simulcast layer(s).";
 
   CheckInitialized();
 }
@@ -128,9 +183,8 @@ void SharerSender::CheckInitialized() {
 }
 
 void SharerSender::SetTargetPlayoutDelay(const base::TimeDelta& playout_delay) {
-  if (video_sender_) {
-    video_sender_->SetTargetPlayoutDelay(playout_delay);
-  }
+  for (const auto& video_sender : video_senders_)
+    video_sender->SetTargetPlayoutDelay(playout_delay);
 }
 
 }  // namespace sharer
@@ -6,6 +6,7 @@
 #define SHARER_SENDER_H_
 
 #include "base/macros.h"
+#include "logging/latency_event_subscriber.h"
 #include "logging/stats_event_subscriber.h"
 #include "sharer_config.h"
 #include "sharer_environment.h"
@@ -15,6 +16,7 @@
 #include "ppapi/cpp/media_stream_video_track.h"
 
 #include <functional>
+#include <vector>
 
 namespace sharer {
 
@@ -32,7 +34,8 @@ class SharerSender {
       std::function<void(int id, InitResult result)>;
   using SharerSuccessCb = std::function<void(bool success)>;
 
-  explicit SharerSender(pp::Instance* instance, int id);
+  // Paces its packets together with the other senders of |pacer_group|.
+  SharerSender(pp::Instance* instance, int id, PacerGroup* pacer_group);
   ~SharerSender();
 
   void Initialize(const SenderConfig& config, SharerSenderInitializedCb cb);
@@ -43,6 +46,8 @@ class SharerSender {
   void ChangeEncoding(const SenderConfig& config);
 
   int id() const { return sender_id_; }
+  LogEventDispatcher* logger() { return env_.logger(); }
+  MetricsRegistry* metrics() { return env_.metrics(); }
   int SetPauseID() const { return pauseID; }
 
  private:
@@ -50,13 +55,18 @@ class SharerSender {
   void InitializedTransport(bool success);
   void CheckInitialized();
   void SetTargetPlayoutDelay(const base::TimeDelta& playout_delay);
+  void OnBitrateShare(uint32_t kbps);
+  SenderConfig EncodingConfig() const;
   void ScheduleReport();
   void RunReport(int32_t);
 
   SharerEnvironment env_;
   StatsEventSubscriber stats_;
+  // Stages of the full resolution layer.
+  LatencyEventSubscriber latency_;
 
   int sender_id_;
+  PacerGroup* const pacer_group_;
   pp::CompletionCallbackFactory<SharerSender> factory_;
   bool report_scheduled_;
   bool stream_sharing_;
@@ -71,10 +81,15 @@ class SharerSender {
   int pauseID;
 
   SenderConfig config_;
+  // Encoder bitrate allowed by the pacer group, 0 if unlimited.
+  uint32_t bitrate_share_;
 
   std::unique_ptr<TransportSender> transport_;
 
-  std::unique_ptr<VideoSender> video_sender_;
+  // One sender per simulcast layer. The first one captures from the track.
+  std::vector<std::unique_ptr<VideoSender>> video_senders_;
+  int video_layers_;
+  int initialized_video_senders_;
 
   DISALLOW_COPY_AND_ASSIGN(SharerSender);
 };
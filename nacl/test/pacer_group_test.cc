@@ -0,0 +1,293 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks that the bursts of a PacerGroup stay within its budget, by counting
+// the packets a PacedSender of the group sends to the host network of host/
+// in each burst, and that losses bring the rate of the group down.
+//
+//   pacer_group_test
+
+#include <arpa/inet.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <memory>
+
+#include "base/time/tick_clock.h"
+#include "net/pacing/paced_sender.h"
+#include "net/pacing/pacer_group.h"
+#include "net/udp_transport.h"
+#include "sharer_defines.h"
+#include "sharer_environment.h"
+
+#include "ppapi/cpp/instance.h"
+#include "ppapi/cpp/module.h"
+#include "ppapi/cpp/udp_socket.h"
+#include "ppapi/utility/completion_callback_factory.h"
+#include "ppapi_host.h"
+
+namespace {
+
+const char kGroupAddress[] = "239.255.0.1";
+const uint16_t kGroupPort = 5678;
+
+// Full packets of PacerGroup::kBurstIntervalMs worth of |kUplinkKbps|.
+const uint32_t kUplinkKbps = 4800;
+const size_t kUplinkPacketsPerBurst = 4;
+
+// Shorter than the burst interval, so that no two bursts end up in one step.
+const double kStepSeconds = 0.001;
+
+int g_failures = 0;
+
+// The time of pp::Core, simulated by ppapi_host.
+class PpapiTickClock : public base::TickClock {
+ public:
+  base::TimeTicks NowTicks() override {
+    return base::TimeTicks() + base::TimeDelta::FromSecondsD(
+                                   pp::Module::Get()->core()->GetTimeTicks());
+  }
+};
+
+PpapiTickClock g_clock;
+
+class SimulatedEnvironment : public sharer::SharerEnvironment {
+ public:
+  explicit SimulatedEnvironment(pp::Instance* instance)
+      : sharer::SharerEnvironment(instance) {
+    set_clock(&g_clock);
+  }
+};
+
+void Expect(bool condition, const char* test, const char* what) {
+  if (condition) return;
+  fprintf(stderr, "%s: FAILED: %s\n", test, what);
+  g_failures++;
+}
+
+// Counts the datagrams sent to the group.
+class PacketCounter {
+ public:
+  explicit PacketCounter(pp::Instance* instance)
+      : socket_(instance), factory_(this), packets_(0) {
+    const PP_NetAddress_IPv4 any = {htons(kGroupPort), {0, 0, 0, 0}};
+    const PP_NetAddress_IPv4 group = {htons(kGroupPort), {239, 255, 0, 1}};
+    socket_.Bind(pp::NetAddress(instance, any), pp::CompletionCallback());
+    socket_.JoinGroup(pp::NetAddress(instance, group),
+                      pp::CompletionCallback());
+    ReceiveNextPacket();
+  }
+
+  int64_t packets() const { return packets_; }
+
+ private:
+  void ReceiveNextPacket() {
+    socket_.RecvFrom(
+        buffer_, sizeof(buffer_),
+        factory_.NewCallbackWithOutput(&PacketCounter::OnReceived));
+  }
+
+  void OnReceived(int32_t result, pp::NetAddress source) {
+    if (result > 0) packets_++;
+    ReceiveNextPacket();
+  }
+
+  pp::UDPSocket socket_;
+  char buffer_[2048];
+  pp::CompletionCallbackFactory<PacketCounter> factory_;
+  int64_t packets_;
+
+  DISALLOW_COPY_AND_ASSIGN(PacketCounter);
+};
+
+// A single pacer in a group, sending video packets to the group address.
+class GroupedPacer {
+ public:
+  explicit GroupedPacer(pp::Instance* instance)
+      : env_(instance),
+        transport_(&env_, kGroupAddress, kGroupPort, 1, 0,
+                   [](bool result) {}),
+        pacer_(&env_, &transport_),
+        next_packet_id_(0),
+        bitrate_share_(0) {
+    group_.set_clock(&g_clock);
+    pacer_.RegisterVideoSsrc(sharer::kVideoSsrc);
+    pacer_.JoinGroup(&group_, 1,
+                     [this](uint32_t kbps) { bitrate_share_ = kbps; });
+  }
+
+  sharer::PacerGroup* group() { return &group_; }
+  // Latest encoder bitrate the group gave the pacer, 0 if unlimited.
+  uint32_t bitrate_share() const { return bitrate_share_; }
+
+  void ReportLoss(double fraction_lost) {
+    group_.OnLossReport(&pacer_, fraction_lost);
+  }
+
+  // Queues |count| full packets of a new frame.
+  void QueuePackets(size_t count) {
+    const base::TimeTicks now = env_.clock()->NowTicks();
+    sharer::SendPacketVector packets;
+    for (size_t i = 0; i < count; i++) {
+      packets.push_back(std::make_pair(
+          sharer::PacedSender::MakePacketKey(now, sharer::kVideoSsrc,
+                                             next_packet_id_++),
+          std::make_shared<Packet>(1400)));
+    }
+    pacer_.SendPackets(packets, false);
+  }
+
+ private:
+  SimulatedEnvironment env_;
+  sharer::UdpTransport transport_;
+  // Outlives |pacer_|, which leaves it when destroyed.
+  sharer::PacerGroup group_;
+  sharer::PacedSender pacer_;
+  uint16_t next_packet_id_;
+  uint32_t bitrate_share_;
+
+  DISALLOW_COPY_AND_ASSIGN(GroupedPacer);
+};
+
+// Runs for |seconds| in steps, returning the most packets sent in one step.
+int64_t RunCountingBursts(const PacketCounter& counter, double seconds) {
+  int64_t max_burst = 0;
+  for (double run = 0; run < seconds; run += kStepSeconds) {
+    const int64_t before = counter.packets();
+    ppapi_host::RunFor(kStepSeconds);
+    max_burst = std::max(max_burst, counter.packets() - before);
+  }
+  return max_burst;
+}
+
+// A pacer that wanted less than its share banks a packet of credit. Once the
+// budget drops below what it wants, the credit must not take its grant past
+// the budget.
+void TestSinglePacerStaysWithinBudget() {
+  const char kTest[] = "TestSinglePacerStaysWithinBudget";
+  pp::Instance instance(1);
+  PacketCounter counter(&instance);
+  GroupedPacer pacer(&instance);
+  // Resolves the address.
+  ppapi_host::RunUntilIdle();
+
+  // No uplink: a budget of 20 packets a burst, above what the pacer asks.
+  pacer.QueuePackets(60);
+  RunCountingBursts(counter, 0.025);
+  const int64_t sent_before = counter.packets();
+  Expect(sent_before < 60, kTest, "the queue drained before the change");
+
+  pacer.group()->SetUplinkBitrate(kUplinkKbps);
+  pacer.QueuePackets(200);
+  const int64_t max_burst = RunCountingBursts(counter, 1);
+  if (max_burst > static_cast<int64_t>(kUplinkPacketsPerBurst)) {
+    fprintf(stderr, "%s: %lld packets in one burst, budget %zu\n", kTest,
+            static_cast<long long>(max_burst), kUplinkPacketsPerBurst);
+  }
+  Expect(max_burst <= static_cast<int64_t>(kUplinkPacketsPerBurst), kTest,
+         "a burst went over the budget");
+  Expect(counter.packets() == 260, kTest, "not every packet was sent");
+}
+
+// A pacer that hasn't been granted a burst yet sends nothing on its own.
+void TestFirstBurstWaitsForGrant() {
+  const char kTest[] = "TestFirstBurstWaitsForGrant";
+  pp::Instance instance(1);
+  PacketCounter counter(&instance);
+  GroupedPacer pacer(&instance);
+  ppapi_host::RunUntilIdle();
+
+  pacer.group()->SetUplinkBitrate(kUplinkKbps);
+  pacer.QueuePackets(20);
+  const int64_t max_burst = RunCountingBursts(counter, 0.1);
+  Expect(max_burst <= static_cast<int64_t>(kUplinkPacketsPerBurst), kTest,
+         "the first burst went over the budget");
+  Expect(counter.packets() == 20, kTest, "not every packet was sent");
+}
+
+// Losses above 10% lower the rate, the encoder share and the bursts with it,
+// at most once per update interval. Once they go away, the rate climbs back
+// up to the uplink and no further.
+void TestLossesLowerRate() {
+  const char kTest[] = "TestLossesLowerRate";
+  const double kUpdateSeconds =
+      sharer::PacerGroup::kRateUpdateIntervalMs / 1000.0;
+  pp::Instance instance(1);
+  PacketCounter counter(&instance);
+  GroupedPacer pacer(&instance);
+  ppapi_host::RunUntilIdle();
+
+  pacer.group()->SetUplinkBitrate(kUplinkKbps);
+  Expect(pacer.bitrate_share() == kUplinkKbps, kTest,
+         "the share is not the uplink");
+
+  pacer.ReportLoss(0.3);
+  const uint32_t lowered = pacer.bitrate_share();
+  Expect(lowered < kUplinkKbps, kTest, "losses didn't lower the rate");
+  pacer.ReportLoss(0.3);
+  Expect(pacer.bitrate_share() == lowered, kTest,
+         "the rate went down twice in one interval");
+
+  // Down to a packet per burst.
+  for (int i = 0; i < 20; i++) {
+    ppapi_host::RunFor(kUpdateSeconds);
+    pacer.ReportLoss(0.5);
+  }
+  pacer.QueuePackets(20);
+  const int64_t max_burst = RunCountingBursts(counter, 0.5);
+  Expect(max_burst == 1, kTest, "the bursts didn't shrink with the rate");
+
+  // Losses between the thresholds hold the rate.
+  const uint32_t low = pacer.bitrate_share();
+  ppapi_host::RunFor(kUpdateSeconds);
+  pacer.ReportLoss(0.05);
+  Expect(pacer.bitrate_share() == low, kTest, "moderate losses moved the rate");
+
+  for (int i = 0; i < 60; i++) {
+    ppapi_host::RunFor(kUpdateSeconds);
+    pacer.ReportLoss(0);
+  }
+  Expect(pacer.bitrate_share() == kUplinkKbps, kTest,
+         "the rate didn't recover up to the uplink");
+}
+
+// Without an uplink the encoders are unlimited until losses lower the rate,
+// and again once it recovered.
+void TestRateRecoversWithoutUplink() {
+  const char kTest[] = "TestRateRecoversWithoutUplink";
+  const double kUpdateSeconds =
+      sharer::PacerGroup::kRateUpdateIntervalMs / 1000.0;
+  pp::Instance instance(1);
+  GroupedPacer pacer(&instance);
+  ppapi_host::RunUntilIdle();
+
+  Expect(pacer.bitrate_share() == 0, kTest, "the share is limited");
+  pacer.ReportLoss(0.2);
+  Expect(pacer.bitrate_share() > 0, kTest, "losses didn't limit the share");
+
+  for (int i = 0; i < 60; i++) {
+    ppapi_host::RunFor(kUpdateSeconds);
+    pacer.ReportLoss(0.01);
+  }
+  Expect(pacer.bitrate_share() == 0, kTest, "the share stayed limited");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ppapi_host::UseSimulatedTime();
+
+  TestSinglePacerStaysWithinBudget();
+  TestFirstBurstWaitsForGrant();
+  TestLossesLowerRate();
+  TestRateRecoversWithoutUplink();
+
+  if (g_failures) {
+    fprintf(stderr, "%d check(s) failed.\n", g_failures);
+    return 1;
+  }
+  printf("All checks passed.\n");
+  return 0;
+}
@@ -0,0 +1,786 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Replays the sharer traffic of a packet capture, pcap or pcapng, through the
+// receiver: NetworkHandler, its UDPListener and FrameReceivers, built over
+// the in-memory network of host/ and a simulated clock, so that a capture
+// from a problem room is reproduced exactly, run after run:
+//
+//   tools/out/packet_replay [--port=5004] [--address=239.255.1.1]
+//                           [--layers=1] [--fps=30] [--fast]
+//                           [--profile[=1000]] capture.pcap > frames.csv
+//
+// The UDP datagrams sent to |port| are sent again from their source address
+// to their destination, which NetworkHandler listens to: |address| is the
+// destination of the first of them unless given. Its feedback goes back to
+// the source and is counted. Captures of the bytes the module sends or
+// receives are needed: the traces of logging/trace_format.h only hold the
+// events, see trace_analyzer.
+//
+// The clock follows the times of the capture, so that the receiver's timers
+// run as they did, but doesn't wait for them: the replay takes the CPU time
+// it needs. Prints one CSV line per frame with what the receiver did of it:
+// complete, on time; late, decoded after its playout time while catching up;
+// or skipped. With --profile, prints instead the CPU time taken by the
+// receiver in each interval of that many ms of the capture. The summary, on
+// stderr, gives the Mbit/s of captured traffic one core receives.
+//
+// With --fast, the datagrams are sent back to back without advancing the
+// clock, so that no timer runs until the end: the frame decisions don't mean
+// anything, but the throughput is that of parsing and reassembling alone.
+// For where the time goes, run the replay under perf.
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/logger.h"
+#include "base/ptr_utils.h"
+#include "base/time/tick_clock.h"
+#include "logging/raw_event_subscriber.h"
+#include "net/rtp/rtp_receiver_defines.h"
+#include "receiver/network_handler.h"
+#include "sharer_config.h"
+#include "sharer_environment.h"
+
+#include "ppapi/cpp/instance.h"
+#include "ppapi/cpp/module.h"
+#include "ppapi/cpp/udp_socket.h"
+#include "ppapi/utility/completion_callback_factory.h"
+#include "ppapi_host.h"
+
+namespace {
+
+// CPU accounts, see ppapi_host::ScopedCpuAccount.
+const int kReplayAccount = 1;
+const int kReceiverAccount = 2;
+
+// Time given to the receiver after the last datagram, for its timers.
+const double kDrainSeconds = 1;
+
+// pcap link types.
+const uint32_t kLinkTypeNull = 0;
+const uint32_t kLinkTypeEthernet = 1;
+const uint32_t kLinkTypeRaw = 101;
+const uint32_t kLinkTypeLinuxSll = 113;
+const uint32_t kLinkTypeIpv4 = 228;
+const uint32_t kLinkTypeLinuxSll2 = 276;
+
+const uint16_t kEtherTypeIpv4 = 0x0800;
+const uint16_t kEtherTypeVlan = 0x8100;
+const uint16_t kEtherTypeQinQ = 0x88a8;
+const uint8_t kIpProtocolUdp = 17;
+
+// pcapng blocks.
+const uint32_t kSectionHeaderBlock = 0x0a0d0d0a;
+const uint32_t kInterfaceDescriptionBlock = 1;
+const uint32_t kEnhancedPacketBlock = 6;
+const uint32_t kByteOrderMagic = 0x1a2b3c4d;
+const uint16_t kOptionTsResolution = 9;
+
+struct Options {
+  Options()
+      : port(5004),
+        layers(1),
+        fps(30),
+        fast(false),
+        profile_ms(0) {}
+
+  std::string address;
+  uint16_t port;
+  int layers;
+  int fps;
+  bool fast;
+  // 0 to print the frames instead.
+  int profile_ms;
+  std::string path;
+};
+
+struct CapturedDatagram {
+  // Seconds since the first datagram of the capture.
+  double time;
+  PP_NetAddress_IPv4 source;
+  PP_NetAddress_IPv4 destination;
+  std::string payload;
+};
+
+// What was skipped while reading a capture.
+struct CaptureStats {
+  CaptureStats()
+      : frames(0),
+        not_ipv4_udp(0),
+        fragments(0),
+        truncated(0),
+        other_ports(0) {}
+
+  int64_t frames;
+  int64_t not_ipv4_udp;
+  int64_t fragments;
+  int64_t truncated;
+  int64_t other_ports;
+};
+
+uint16_t ReadBigEndian16(const uint8_t* data) {
+  return static_cast<uint16_t>(data[0] << 8 | data[1]);
+}
+
+// Reads the captured frames of one link type and keeps the UDP datagrams
+// sent to |port|.
+class DatagramExtractor {
+ public:
+  DatagramExtractor(uint16_t port, std::vector<CapturedDatagram>* datagrams,
+                    CaptureStats* stats)
+      : port_(port), datagrams_(datagrams), stats_(stats), first_time_(-1) {}
+
+  void OnFrame(uint32_t link_type, double time, const uint8_t* data,
+               size_t size, size_t original_size) {
+    stats_->frames++;
+    if (size < original_size) {
+      stats_->truncated++;
+      return;
+    }
+    size_t offset;
+    if (!SkipLinkLayer(link_type, data, size, &offset)) {
+      stats_->not_ipv4_udp++;
+      return;
+    }
+    OnIpv4(time, data + offset, size - offset);
+  }
+
+ private:
+  bool SkipLinkLayer(uint32_t link_type, const uint8_t* data, size_t size,
+                     size_t* offset) const {
+    uint16_t ether_type;
+    switch (link_type) {
+      case kLinkTypeNull: {
+        // AF_INET, in the byte order of the capturing machine.
+        if (size < 4) return false;
+        const uint32_t family = data[0] | data[1] << 8 | data[2] << 16 |
+                                static_cast<uint32_t>(data[3]) << 24;
+        *offset = 4;
+        return family == 2 || family == 0x02000000;
+      }
+      case kLinkTypeEthernet:
+        if (size < 14) return false;
+        *offset = 14;
+        ether_type = ReadBigEndian16(data + 12);
+        while (ether_type == kEtherTypeVlan || ether_type == kEtherTypeQinQ) {
+          if (size < *offset + 4) return false;
+          ether_type = ReadBigEndian16(data + *offset + 2);
+          *offset += 4;
+        }
+        return ether_type == kEtherTypeIpv4;
+      case kLinkTypeRaw:
+      case kLinkTypeIpv4:
+        *offset = 0;
+        return size > 0 && data[0] >> 4 == 4;
+      case kLinkTypeLinuxSll:
+        if (size < 16) return false;
+        *offset = 16;
+        return ReadBigEndian16(data + 14) == kEtherTypeIpv4;
+      case kLinkTypeLinuxSll2:
+        if (size < 20) return false;
+        *offset = 20;
+        return ReadBigEndian16(data) == kEtherTypeIpv4;
+      default:
+        return false;
+    }
+  }
+
+  void OnIpv4(double time, const uint8_t* data, size_t size) {
+    if (size < 20 || data[0] >> 4 != 4 || data[9] != kIpProtocolUdp) {
+      stats_->not_ipv4_udp++;
+      return;
+    }
+    const size_t header_size = (data[0] & 0x0f) * 4;
+    const size_t total_size = ReadBigEndian16(data + 2);
+    if (header_size < 20 || total_size < header_size + 8 || total_size > size) {
+      stats_->truncated++;
+      return;
+    }
+    // More fragments, or an offset.
+    if (ReadBigEndian16(data + 6) & 0x3fff) {
+      stats_->fragments++;
+      return;
+    }
+
+    const uint8_t* udp = data + header_size;
+    const uint16_t source_port = ReadBigEndian16(udp);
+    const uint16_t destination_port = ReadBigEndian16(udp + 2);
+    const size_t udp_size = ReadBigEndian16(udp + 4);
+    if (udp_size < 8 || header_size + udp_size > total_size) {
+      stats_->truncated++;
+      return;
+    }
+    if (destination_port != port_) {
+      stats_->other_ports++;
+      return;
+    }
+
+    if (first_time_ < 0) first_time_ = time;
+    CapturedDatagram datagram;
+    datagram.time = std::max(0.0, time - first_time_);
+    datagram.source.port = htons(source_port);
+    memcpy(datagram.source.addr, data + 12, 4);
+    datagram.destination.port = htons(destination_port);
+    memcpy(datagram.destination.addr, data + 16, 4);
+    datagram.payload.assign(reinterpret_cast<const char*>(udp + 8),
+                            udp_size - 8);
+    datagrams_->push_back(std::move(datagram));
+  }
+
+  const uint16_t port_;
+  std::vector<CapturedDatagram>* const datagrams_;
+  CaptureStats* const stats_;
+  double first_time_;
+};
+
+uint32_t Swap32(uint32_t value) { return __builtin_bswap32(value); }
+uint16_t Swap16(uint16_t value) { return __builtin_bswap16(value); }
+
+// Integers of a capture, in the byte order it was written in.
+class CaptureBytes {
+ public:
+  explicit CaptureBytes(bool swap) : swap_(swap) {}
+
+  uint16_t U16(const uint8_t* data) const {
+    uint16_t value;
+    memcpy(&value, data, sizeof(value));
+    return swap_ ? Swap16(value) : value;
+  }
+  uint32_t U32(const uint8_t* data) const {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return swap_ ? Swap32(value) : value;
+  }
+
+ private:
+  bool swap_;
+};
+
+bool ReadPcap(FILE* file, const uint8_t* magic_bytes,
+              DatagramExtractor* extractor) {
+  uint32_t magic;
+  memcpy(&magic, magic_bytes, sizeof(magic));
+  const bool swap = magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1;
+  const CaptureBytes bytes(swap);
+  const bool nanoseconds = bytes.U32(magic_bytes) == 0xa1b23c4d;
+
+  // The rest of the file header.
+  uint8_t header[20];
+  if (fread(header, sizeof(header), 1, file) != 1) return false;
+  const uint32_t link_type = bytes.U32(header + 16) & 0xffff;
+
+  std::vector<uint8_t> data;
+  uint8_t record[16];
+  while (fread(record, sizeof(record), 1, file) == 1) {
+    const double time =
+        bytes.U32(record) +
+        bytes.U32(record + 4) * (nanoseconds ? 1e-9 : 1e-6);
+    const uint32_t size = bytes.U32(record + 8);
+    const uint32_t original_size = bytes.U32(record + 12);
+    data.resize(size);
+    if (size && fread(data.data(), size, 1, file) != 1) return false;
+    extractor->OnFrame(link_type, time, data.data(), size, original_size);
+  }
+  return true;
+}
+
+bool ReadPcapng(FILE* file, const uint8_t* type_bytes,
+                DatagramExtractor* extractor) {
+  struct Interface {
+    uint32_t link_type;
+    // Seconds per unit of the timestamps.
+    double resolution;
+  };
+  std::vector<Interface> interfaces;
+  CaptureBytes bytes(false);
+
+  uint8_t header[8];
+  memcpy(header, type_bytes, 4);
+  if (fread(header + 4, 4, 1, file) != 1) return false;
+  std::vector<uint8_t> body;
+  for (;;) {
+    uint32_t type;
+    memcpy(&type, header, sizeof(type));
+    if (type == kSectionHeaderBlock) {
+      // The byte order of the section comes after its length.
+      uint8_t magic[4];
+      if (fread(magic, sizeof(magic), 1, file) != 1) return false;
+      uint32_t byte_order;
+      memcpy(&byte_order, magic, sizeof(byte_order));
+      bytes = CaptureBytes(byte_order != kByteOrderMagic);
+      interfaces.clear();
+      const uint32_t length = bytes.U32(header + 4);
+      if (length < 16 || length % 4) return false;
+      body.resize(length - 12);
+      if (fread(body.data(), body.size(), 1, file) != 1) return false;
+    } else {
+      type = bytes.U32(header);
+      const uint32_t length = bytes.U32(header + 4);
+      if (length < 12 || length % 4) return false;
+      body.resize(length - 8);
+      if (fread(body.data(), body.size(), 1, file) != 1) return false;
+      // Without the trailing length.
+      const size_t size = body.size() - 4;
+
+      if (type == kInterfaceDescriptionBlock && size >= 8) {
+        Interface interface = {bytes.U16(body.data()), 1e-6};
+        size_t option = 8;
+        while (option + 4 <= size) {
+          const uint16_t code = bytes.U16(&body[option]);
+          const uint16_t option_size = bytes.U16(&body[option + 2]);
+          if (!code || option + 4 + option_size > size) break;
+          if (code == kOptionTsResolution && option_size >= 1) {
+            const uint8_t value = body[option + 4];
+            interface.resolution = value & 0x80
+                                       ? 1.0 / (1ull << (value & 0x7f))
+                                       : std::pow(10.0, -value);
+          }
+          option += 4 + (option_size + 3) / 4 * 4;
+        }
+        interfaces.push_back(interface);
+      } else if (type == kEnhancedPacketBlock && size >= 20) {
+        const uint32_t id = bytes.U32(body.data());
+        if (id >= interfaces.size()) return false;
+        const uint64_t timestamp =
+            static_cast<uint64_t>(bytes.U32(&body[4])) << 32 |
+            bytes.U32(&body[8]);
+        const uint32_t captured = bytes.U32(&body[12]);
+        const uint32_t original = bytes.U32(&body[16]);
+        if (20 + static_cast<size_t>(captured) > size) return false;
+        extractor->OnFrame(interfaces[id].link_type,
+                           timestamp * interfaces[id].resolution, &body[20],
+                           captured, original);
+      }
+      // Other blocks don't carry what we need.
+    }
+
+    if (fread(header, sizeof(header), 1, file) != 1) return true;
+  }
+}
+
+bool ReadCapture(const Options& options,
+                 std::vector<CapturedDatagram>* datagrams,
+                 CaptureStats* stats) {
+  FILE* file = fopen(options.path.c_str(), "rb");
+  if (!file) {
+    perror(options.path.c_str());
+    return false;
+  }
+
+  DatagramExtractor extractor(options.port, datagrams, stats);
+  uint8_t magic[4];
+  bool ok = fread(magic, sizeof(magic), 1, file) == 1;
+  uint32_t value = 0;
+  if (ok) memcpy(&value, magic, sizeof(value));
+  if (ok && (value == 0xa1b2c3d4 || value == 0xd4c3b2a1 ||
+             value == 0xa1b23c4d || value == 0x4d3cb2a1)) {
+    ok = ReadPcap(file, magic, &extractor);
+  } else if (ok && value == kSectionHeaderBlock) {
+    ok = ReadPcapng(file, magic, &extractor);
+  } else {
+    fprintf(stderr, "%s: not a pcap or pcapng capture.\n",
+            options.path.c_str());
+    fclose(file);
+    return false;
+  }
+  fclose(file);
+  if (!ok) {
+    fprintf(stderr, "%s: truncated capture, replaying what was read.\n",
+            options.path.c_str());
+  }
+  return true;
+}
+
+std::string DescribeAddress(const PP_NetAddress_IPv4& addr) {
+  char buffer[16];
+  snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", addr.addr[0], addr.addr[1],
+           addr.addr[2], addr.addr[3]);
+  return buffer;
+}
+
+enum Decision { kComplete, kLate, kSkipped, kNumDecisions };
+
+const char* const kDecisionNames[kNumDecisions] = {"complete", "late",
+                                                   "skipped"};
+
+struct FrameDecision {
+  // Seconds since the start of the replay.
+  double time;
+  uint32_t frame_id;
+  Decision decision;
+  bool key_frame;
+  size_t size;
+  // How long after its playout time a late frame was ready.
+  double late_ms;
+};
+
+// The CPU time of the receiver in an interval of the capture.
+struct ProfileInterval {
+  ProfileInterval() : datagrams(0), bytes(0), cpu_seconds(0) {}
+
+  int64_t datagrams;
+  int64_t bytes;
+  double cpu_seconds;
+  int decisions[kNumDecisions] = {};
+};
+
+// The time of pp::Core, simulated by ppapi_host.
+class PpapiTickClock : public base::TickClock {
+ public:
+  base::TimeTicks NowTicks() override {
+    return base::TimeTicks() + base::TimeDelta::FromSecondsD(Now());
+  }
+
+  static double Now() { return pp::Module::Get()->core()->GetTimeTicks(); }
+};
+
+// Sends the captured datagrams from their source address, and counts the
+// feedback the receiver sends back there.
+class Replayer : public sharer::RawEventSubscriber {
+ public:
+  Replayer(pp::Instance* instance, const Options& options,
+           const PP_NetAddress_IPv4& group)
+      : instance_(instance),
+        env_(instance),
+        start_(PpapiTickClock::Now()),
+        feedback_packets_(0),
+        feedback_bytes_(0),
+        factory_(this) {
+    env_.set_clock(&clock_);
+    env_.logger()->Subscribe(this);
+
+    // As MyInstance::StartNetwork() does.
+    ReceiverConfig audio_config;
+    audio_config.target_frame_rate = 100;
+    audio_config.rtp_timebase = 48000;
+    audio_config.receiver_ssrc = 2;
+    audio_config.sender_ssrc = 1;
+    ReceiverConfig video_config;
+    video_config.target_frame_rate = options.fps;
+    video_config.rtp_timebase = 90000;
+    video_config.receiver_ssrc = 12;
+    video_config.sender_ssrc = 11;
+
+    sharer::ReceiverNetConfig net_config;
+    net_config.address = DescribeAddress(group);
+    net_config.port = options.port;
+    net_config.multicast_layers = options.layers;
+
+    ppapi_host::ScopedCpuAccount account(kReceiverAccount);
+    handler_ = make_unique<NetworkHandler>(&env_, audio_config, video_config,
+                                           net_config);
+    RequestFrame();
+  }
+
+  ~Replayer() { env_.logger()->Unsubscribe(this); }
+
+  void Send(const CapturedDatagram& datagram) {
+    ppapi_host::ScopedCpuAccount account(kReplayAccount);
+    uint64_t key;
+    memcpy(&key, &datagram.source, sizeof(datagram.source));
+    auto it = sources_.find(key);
+    if (it == sources_.end()) {
+      auto source = make_unique<Source>(instance_);
+      source->socket.Bind(pp::NetAddress(instance_, datagram.source),
+                          pp::CompletionCallback());
+      ReceiveFeedback(source.get());
+      it = sources_.insert(std::make_pair(key, std::move(source))).first;
+    }
+    it->second->socket.SendTo(datagram.payload.data(), datagram.payload.size(),
+                              pp::NetAddress(instance_, datagram.destination),
+                              pp::CompletionCallback());
+  }
+
+  // Hands the events logged so far to OnReceiveFrameEvent().
+  void Flush() { env_.logger()->DispatchPendingEvents(); }
+
+  double start() const { return start_; }
+  const std::vector<FrameDecision>& decisions() const { return decisions_; }
+  int64_t feedback_packets() const { return feedback_packets_; }
+  int64_t feedback_bytes() const { return feedback_bytes_; }
+
+  void OnReceiveFrameEvent(const sharer::FrameEvent& event) override {
+    if (event.type != sharer::FRAME_DROPPED) return;
+    const double time =
+        (event.timestamp - base::TimeTicks()).InSecondsF() - start_;
+    decisions_.push_back({time, event.frame_id, kSkipped, event.key_frame,
+                          event.size, 0});
+  }
+
+  void OnReceivePacketEvent(const sharer::PacketEvent& event) override {}
+
+ private:
+  struct Source {
+    explicit Source(pp::Instance* instance) : socket(instance) {}
+
+    pp::UDPSocket socket;
+    char buffer[4096];
+  };
+
+  void ReceiveFeedback(Source* source) {
+    source->socket.RecvFrom(
+        source->buffer, sizeof(source->buffer),
+        factory_.NewCallbackWithOutput(&Replayer::OnFeedback, source));
+  }
+
+  void OnFeedback(int32_t result, pp::NetAddress from,
+                  Source* source) {
+    if (result > 0) {
+      feedback_packets_++;
+      feedback_bytes_ += result;
+    }
+    ReceiveFeedback(source);
+  }
+
+  void RequestFrame() {
+    handler_->GetNextFrame(
+        [this](std::shared_ptr<EncodedFrame> frame) { OnFrame(*frame); });
+  }
+
+  void OnFrame(const EncodedFrame& frame) {
+    // The receiver sets the playout time as the reference time.
+    const base::TimeTicks now = clock_.NowTicks();
+    const double late_ms =
+        std::max(0.0, (now - frame.reference_time).InMillisecondsF());
+    decisions_.push_back({PpapiTickClock::Now() - start_, frame.frame_id,
+                          late_ms > 0 ? kLate : kComplete,
+                          frame.dependency == EncodedFrame::KEY,
+                          frame.data.size(), late_ms});
+    handler_->ReleaseFrame();
+    RequestFrame();
+  }
+
+  pp::Instance* const instance_;
+  PpapiTickClock clock_;
+  sharer::SharerEnvironment env_;
+  const double start_;
+
+  std::unique_ptr<NetworkHandler> handler_;
+  std::map<uint64_t, std::unique_ptr<Source>> sources_;
+  std::vector<FrameDecision> decisions_;
+  int64_t feedback_packets_;
+  int64_t feedback_bytes_;
+  pp::CompletionCallbackFactory<Replayer> factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(Replayer);
+};
+
+double ProcessCpuSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double WallSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void PrintDecisions(const std::vector<FrameDecision>& decisions) {
+  printf("time_ms,frame_id,decision,key_frame,size,late_ms\n");
+  for (const FrameDecision& decision : decisions) {
+    printf("%.3f,%u,%s,%d,%zu,%.3f\n", decision.time * 1000,
+           decision.frame_id, kDecisionNames[decision.decision],
+           decision.key_frame, decision.size, decision.late_ms);
+  }
+}
+
+void PrintProfile(const std::vector<ProfileInterval>& intervals,
+                  int interval_ms) {
+  printf(
+      "start_ms,datagrams,mbit,receiver_cpu_ms,complete,late,skipped\n");
+  for (size_t i = 0; i < intervals.size(); i++) {
+    const ProfileInterval& interval = intervals[i];
+    printf("%zu,%" PRId64 ",%.3f,%.3f,%d,%d,%d\n", i * interval_ms,
+           interval.datagrams, interval.bytes * 8 / 1e6,
+           interval.cpu_seconds * 1000, interval.decisions[kComplete],
+           interval.decisions[kLate], interval.decisions[kSkipped]);
+  }
+}
+
+bool ParseOptions(int argc, char* argv[], Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (strncmp(arg, "--", 2)) {
+      if (!options->path.empty()) return false;
+      options->path = arg;
+      continue;
+    }
+    const char* value = strchr(arg, '=');
+    const std::string name(arg, value ? value - arg : strlen(arg));
+    if (value) value++;
+
+    if (name == "--fast" && !value) {
+      options->fast = true;
+    } else if (name == "--profile") {
+      options->profile_ms = value ? atoi(value) : 1000;
+      if (options->profile_ms <= 0) return false;
+    } else if (!value) {
+      return false;
+    } else if (name == "--port") {
+      options->port = static_cast<uint16_t>(atoi(value));
+    } else if (name == "--address") {
+      options->address = value;
+    } else if (name == "--layers") {
+      options->layers = atoi(value);
+    } else if (name == "--fps") {
+      options->fps = atoi(value);
+    } else {
+      return false;
+    }
+  }
+  return !options->path.empty() && options->port && options->layers > 0 &&
+         options->fps > 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    fprintf(stderr,
+            "Usage: %s [--port=5004] [--address=239.255.1.1] [--layers=1] "
+            "[--fps=30] [--fast] [--profile[=1000]] capture.pcap\n",
+            argv[0]);
+    return 1;
+  }
+
+  std::vector<CapturedDatagram> datagrams;
+  CaptureStats stats;
+  if (!ReadCapture(options, &datagrams, &stats)) return 1;
+  if (datagrams.empty()) {
+    fprintf(stderr, "No UDP datagrams to port %u in %" PRId64 " frames.\n",
+            options.port, stats.frames);
+    return 1;
+  }
+
+  PP_NetAddress_IPv4 group = datagrams.front().destination;
+  if (!options.address.empty() &&
+      inet_pton(AF_INET, options.address.c_str(), group.addr) != 1) {
+    fprintf(stderr, "Bad address: %s\n", options.address.c_str());
+    return 1;
+  }
+
+  LogInit(nullptr, LOGERROR);
+  ppapi_host::UseSimulatedTime();
+
+  pp::Instance instance(1);
+  Replayer replayer(&instance, options, group);
+  // Lets the listener resolve, bind and join before the first datagram.
+  ppapi_host::RunFor(0);
+
+  const double wall_start = WallSeconds();
+  const double process_cpu_start = ProcessCpuSeconds();
+  const double receiver_cpu_start = ppapi_host::CpuSeconds(kReceiverAccount);
+  const double replay_cpu_start = ppapi_host::CpuSeconds(kReplayAccount);
+
+  std::vector<ProfileInterval> intervals;
+  const double interval_seconds = options.profile_ms / 1000.0;
+  double interval_cpu_start = receiver_cpu_start;
+  int64_t bytes = 0;
+  for (const CapturedDatagram& datagram : datagrams) {
+    if (!options.fast) {
+      ppapi_host::RunFor(replayer.start() + datagram.time -
+                         PpapiTickClock::Now());
+    }
+    if (options.profile_ms) {
+      const size_t index =
+          static_cast<size_t>(datagram.time / interval_seconds);
+      if (index >= intervals.size()) {
+        const double cpu = ppapi_host::CpuSeconds(kReceiverAccount);
+        if (!intervals.empty())
+          intervals.back().cpu_seconds = cpu - interval_cpu_start;
+        interval_cpu_start = cpu;
+        intervals.resize(index + 1);
+      }
+      intervals.back().datagrams++;
+      intervals.back().bytes += datagram.payload.size();
+    }
+    bytes += datagram.payload.size();
+    replayer.Send(datagram);
+    if (options.fast) ppapi_host::RunReadyCallbacks();
+  }
+  ppapi_host::RunFor(kDrainSeconds);
+  replayer.Flush();
+
+  const double receiver_cpu =
+      ppapi_host::CpuSeconds(kReceiverAccount) - receiver_cpu_start;
+  const double replay_cpu =
+      ppapi_host::CpuSeconds(kReplayAccount) - replay_cpu_start;
+  const double process_cpu = ProcessCpuSeconds() - process_cpu_start;
+  const double wall = WallSeconds() - wall_start;
+  if (!intervals.empty()) {
+    intervals.back().cpu_seconds =
+        ppapi_host::CpuSeconds(kReceiverAccount) - interval_cpu_start;
+  }
+
+  // Skips are reported in batches: in the order of the capture.
+  std::vector<FrameDecision> decisions = replayer.decisions();
+  std::stable_sort(decisions.begin(), decisions.end(),
+                   [](const FrameDecision& a, const FrameDecision& b) {
+                     return a.time < b.time;
+                   });
+  int counts[kNumDecisions] = {};
+  std::set<uint32_t> frame_ids;
+  for (const FrameDecision& decision : decisions) {
+    counts[decision.decision]++;
+    frame_ids.insert(decision.frame_id);
+    if (options.profile_ms && decision.time >= 0) {
+      const size_t index = std::min(
+          intervals.size() - 1,
+          static_cast<size_t>(decision.time / interval_seconds));
+      intervals[index].decisions[decision.decision]++;
+    }
+  }
+  // Frame ids are contiguous: the ones never decided on were never complete.
+  const int64_t missing =
+      frame_ids.empty() ? 0
+                        : static_cast<int64_t>(*frame_ids.rbegin()) -
+                              *frame_ids.begin() + 1 - frame_ids.size();
+
+  if (options.profile_ms)
+    PrintProfile(intervals, options.profile_ms);
+  else
+    PrintDecisions(decisions);
+
+  const double seconds = datagrams.back().time;
+  const double mbits = bytes * 8 / 1e6;
+  fprintf(stderr,
+          "%" PRId64 " frames captured: %zu datagrams to %s:%u replayed, %"
+          PRId64 " to other ports, %" PRId64 " not IPv4/UDP, %" PRId64
+          " fragments, %" PRId64 " truncated\n",
+          stats.frames, datagrams.size(), DescribeAddress(group).c_str(),
+          options.port, stats.other_ports, stats.not_ipv4_udp,
+          stats.fragments, stats.truncated);
+  fprintf(stderr, "%.3f s of capture, %.3f Mbit (%.3f Mbit/s)\n", seconds,
+          mbits, seconds > 0 ? mbits / seconds : 0);
+  fprintf(stderr,
+          "frames: %d complete, %d late, %d skipped, %" PRId64 " missing\n",
+          counts[kComplete], counts[kLate], counts[kSkipped], missing);
+  fprintf(stderr, "feedback: %" PRId64 " packets, %" PRId64 " bytes\n",
+          replayer.feedback_packets(), replayer.feedback_bytes());
+  fprintf(stderr,
+          "cpu: receiver %.3f s, replay %.3f s, process %.3f s; wall %.3f s "
+          "(%.1fx real time)\n",
+          receiver_cpu, replay_cpu, process_cpu, wall,
+          wall > 0 ? seconds / wall : 0);
+  fprintf(stderr, "receiver throughput: %.1f Mbit/s per core\n",
+          receiver_cpu > 0 ? mbits / receiver_cpu : 0);
+  return 0;
+}
@@ -0,0 +1,231 @@
+// Copyright 2015 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Reads a trace recorded with nms.startTrace()/stopTrace(), see
+// logging/trace_format.h, and rebuilds the lifecycle of every packet: when
+// it was first sent and received, how many times it was sent again, and which
+// receivers asked for it. Prints one CSV line per packet or per receiver to
+// stdout, and a summary to stderr:
+//
+//   tools/out/trace_analyzer trace.bin > packets.csv
+//   tools/out/trace_analyzer --receivers trace.bin > receivers.csv
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "logging/logging_events.h"
+#include "logging/trace_format.h"
+
+namespace {
+
+using sharer::TraceFileHeader;
+using sharer::TraceRecord;
+
+// (ssrc, frame_id, packet_id).
+using PacketId = std::tuple<uint32_t, uint32_t, uint16_t>;
+
+struct PacketLifecycle {
+  int64_t first_sent_us = -1;
+  int64_t first_received_us = -1;
+  uint32_t size = 0;
+  int sent = 0;
+  int retransmitted = 0;
+  int rejected = 0;
+  int nacks = 0;
+  int dropped = 0;
+  int received = 0;
+  std::set<uint32_t> nacking_receivers;
+};
+
+struct ReceiverStats {
+  int nacks = 0;
+  std::set<PacketId> nacked_packets;
+  int retransmitted = 0;
+  int rejected = 0;
+};
+
+struct Trace {
+  std::map<PacketId, PacketLifecycle> packets;
+  std::map<uint32_t, ReceiverStats> receivers;
+  int64_t records = 0;
+  int64_t frames_dropped = 0;
+  int64_t packets_sent = 0;
+};
+
+bool ReadTrace(FILE* file, Trace* trace) {
+  TraceFileHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      memcmp(header.magic, sharer::kTraceMagic, sizeof(header.magic))) {
+    fprintf(stderr, "Not a sharer trace.\n");
+    return false;
+  }
+  if (header.version != sharer::kTraceVersion ||
+      header.record_size != sizeof(TraceRecord)) {
+    fprintf(stderr, "Unsupported trace version %u, record size %u.\n",
+            header.version, header.record_size);
+    return false;
+  }
+
+  std::vector<TraceRecord> records(4096);
+  size_t count;
+  while ((count = fread(records.data(), sizeof(TraceRecord), records.size(),
+                        file)) > 0) {
+    trace->records += count;
+    for (size_t i = 0; i < count; i++) {
+      const TraceRecord& record = records[i];
+      if (!(record.flags & sharer::kTracePacketEvent)) {
+        if (record.type == sharer::FRAME_DROPPED) trace->frames_dropped++;
+        continue;
+      }
+
+      const PacketId id(record.ssrc, record.frame_id, record.packet_id);
+      PacketLifecycle& packet = trace->packets[id];
+      switch (record.type) {
+        case sharer::PACKET_SENT_TO_NETWORK:
+          if (!packet.sent && !packet.retransmitted) {
+            packet.first_sent_us = record.timestamp_us;
+            packet.size = record.size;
+            trace->packets_sent++;
+          }
+          packet.sent++;
+          break;
+        case sharer::PACKET_RETRANSMITTED:
+          packet.retransmitted++;
+          trace->receivers[record.receiver_id].retransmitted++;
+          break;
+        case sharer::PACKET_RTX_REJECTED:
+          packet.rejected++;
+          trace->receivers[record.receiver_id].rejected++;
+          break;
+        case sharer::PACKET_NACK_RECEIVED: {
+          packet.nacks++;
+          packet.nacking_receivers.insert(record.receiver_id);
+          ReceiverStats& receiver = trace->receivers[record.receiver_id];
+          receiver.nacks++;
+          receiver.nacked_packets.insert(id);
+          break;
+        }
+        case sharer::PACKET_DROPPED:
+          packet.dropped++;
+          break;
+        case sharer::PACKET_RECEIVED:
+          if (!packet.received) packet.first_received_us = record.timestamp_us;
+          packet.received++;
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  return true;
+}
+
+void PrintPackets(const Trace& trace) {
+  printf(
+      "ssrc,frame_id,packet_id,size,first_sent_us,first_received_us,sent,"
+      "retransmitted,rejected,nacks,nacking_receivers,dropped,received\n");
+  for (const auto& entry : trace.packets) {
+    const PacketLifecycle& packet = entry.second;
+    printf("%u,%u,%u,%u,%" PRId64 ",%" PRId64 ",%d,%d,%d,%d,%zu,%d,%d\n",
+           std::get<0>(entry.first), std::get<1>(entry.first),
+           std::get<2>(entry.first), packet.size, packet.first_sent_us,
+           packet.first_received_us, packet.sent, packet.retransmitted,
+           packet.rejected, packet.nacks, packet.nacking_receivers.size(),
+           packet.dropped, packet.received);
+  }
+}
+
+void PrintReceivers(const Trace& trace) {
+  printf(
+      "receiver_id,nacks,packets_nacked,retransmitted,rejected,"
+      "loss_estimate\n");
+  for (const auto& entry : trace.receivers) {
+    // Multicast sends and drops.
+    if (!entry.first) continue;
+    const ReceiverStats& receiver = entry.second;
+    // Every lost packet is asked for at least once, so the distinct packets
+    // asked for are an upper bound of the loss, before retransmissions.
+    const double loss =
+        trace.packets_sent
+            ? static_cast<double>(receiver.nacked_packets.size()) /
+                  trace.packets_sent
+            : 0.0;
+    printf("%08x,%d,%zu,%d,%d,%.6f\n", entry.first, receiver.nacks,
+           receiver.nacked_packets.size(), receiver.retransmitted,
+           receiver.rejected, loss);
+  }
+}
+
+void PrintSummary(const Trace& trace) {
+  int64_t duplicate_sends = 0;
+  int64_t duplicate_nacks = 0;
+  int max_sends = 0;
+  int max_nacks = 0;
+  int64_t never_sent = 0;
+  for (const auto& entry : trace.packets) {
+    const PacketLifecycle& packet = entry.second;
+    const int sends = packet.sent + packet.retransmitted;
+    if (!sends) {
+      never_sent++;
+      continue;
+    }
+    duplicate_sends += sends - 1;
+    max_sends = std::max(max_sends, sends);
+    // Asked for again by a receiver that already asked for it.
+    duplicate_nacks += packet.nacks - packet.nacking_receivers.size();
+    max_nacks = std::max(max_nacks, packet.nacks);
+  }
+
+  fprintf(stderr, "%" PRId64 " records, %zu packets, %zu receivers\n",
+          trace.records, trace.packets.size(),
+          trace.receivers.size() - trace.receivers.count(0));
+  fprintf(stderr, "duplicate sends: %" PRId64 " (max %d sends of a packet)\n",
+          duplicate_sends, max_sends);
+  fprintf(stderr,
+          "duplicate requests: %" PRId64 " (max %d requests of a packet)\n",
+          duplicate_nacks, max_nacks);
+  fprintf(stderr, "packets never sent: %" PRId64 "\n", never_sent);
+  fprintf(stderr, "frames dropped late: %" PRId64 "\n", trace.frames_dropped);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool receivers = false;
+  const char* path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--receivers"))
+      receivers = true;
+    else
+      path = argv[i];
+  }
+  if (!path) {
+    fprintf(stderr, "Usage: %s [--receivers] trace.bin\n", argv[0]);
+    return 1;
+  }
+
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    perror(path);
+    return 1;
+  }
+  Trace trace;
+  const bool ok = ReadTrace(file, &trace);
+  fclose(file);
+  if (!ok) return 1;
+
+  if (receivers)
+    PrintReceivers(trace);
+  else
+    PrintPackets(trace);
+  PrintSummary(trace);
+  return 0;
+}